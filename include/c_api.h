@@ -10,6 +10,8 @@
 #endif
 
 #include "defines.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -32,8 +34,30 @@ typedef struct {
   SOCKET sock;                 ///< Socket descriptor
   cycles_rgb color;            ///< Assigned player color
   char name[MAX_NAME_LEN + 1]; ///< Player name (NUL-terminated)
+  uint8_t *read_buffer;        ///< Bytes received ahead by cycles_recv_state()
+  size_t read_capacity;        ///< Bytes allocated in read_buffer
+  size_t read_start;           ///< First unparsed byte in read_buffer
+  size_t read_end;             ///< End of the received bytes in read_buffer
+  bool latest_only;            ///< See cycles_set_latest_only()
+  uint64_t skipped_states;     ///< States dropped by latest-only reads
+  uint8_t *write_buffer;       ///< Bytes queued on non-blocking connections
+  size_t write_capacity;       ///< Bytes allocated in write_buffer
+  size_t write_start;          ///< First unsent byte in write_buffer
+  size_t write_end;            ///< End of the queued bytes in write_buffer
+  bool nonblocking;            ///< Opened with cycles_connect_async()
+  bool connecting;             ///< TCP connection not established yet
+  bool handshaking;            ///< Name sent, color not received yet
 } cycles_connection;
 
+/**
+ * Events reported by cycles_next_event() on non-blocking connections
+ */
+typedef enum {
+  cycles_event_none = 0,  ///< Nothing complete yet, wait for the socket
+  cycles_event_connected, ///< Handshake finished, the color is in the conn
+  cycles_event_state      ///< A new state is in the state buffer
+} cycles_event;
+
 /**
  * Player state as received from the server
  */
@@ -55,15 +79,61 @@ typedef struct {
   uint32_t player_count;  ///< Number of players
   cycles_player *players; ///< List of players (size = player_count)
   /**
-   * Grid cells, row-major order, size = grid_width * grid_height.
-   * Each cell contains either 0 (empty) or the ID of the player occupying it.
+   * Grid cells of the view window, row-major order, size = view_width *
+   * view_height. Each cell contains either 0 (empty) or the ID of the player
+   * occupying it.
    *
-   * The value of grid[y * grid_width + x] corresponds to the cell at (x,y).
+   * Unless a viewport was requested the window covers the whole board, and
+   * grid[y * grid_width + x] corresponds to the cell at (x,y). Use
+   * cycles_get_grid_cell() to index it in both cases.
    */
   uint8_t *grid;
   uint32_t frame_number; ///< Current game time (in frames from start)
+  uint32_t view_x;       ///< First board column held in grid
+  uint32_t view_y;       ///< First board row held in grid
+  uint32_t view_width;   ///< Columns held in grid
+  uint32_t view_height;  ///< Rows held in grid
+  /**
+   * Downsampled board, row-major, size = overview_width * overview_height, or
+   * NULL if no overview was requested. Each byte is the occupied fraction of
+   * an overview_factor x overview_factor block of cells, scaled to 0..255.
+   */
+  uint8_t *overview;
+  uint32_t overview_factor; ///< Block size of the overview in cells
+  uint32_t overview_width;  ///< Overview blocks per row
+  uint32_t overview_height; ///< Overview rows of blocks
+  /**
+   * Zobrist hash of the whole server grid (see cycles_hash.h), valid if
+   * has_state_hash is set, i.e. after cycles_request_state_hash().
+   */
+  uint64_t state_hash;
+  bool has_state_hash; ///< Whether state_hash was sent by the server
 } cycles_game_state;
 
+/**
+ * Game state storage reused across frames, filled by
+ * cycles_recv_game_state_into().
+ *
+ * Buffers only ever grow and player names are kept per player ID, so once
+ * the largest state has been received, receiving does not allocate. The grid
+ * of full-board states is read from the socket straight into its storage.
+ * Initialize with cycles_state_buffer_init() and release with
+ * cycles_state_buffer_free(), never with cycles_free_game_state().
+ */
+typedef struct {
+  cycles_game_state state;   ///< Last received state, valid until the next
+  uint8_t *packet;           ///< Received packet bytes, except a full grid
+  size_t packet_capacity;    ///< Bytes allocated in packet
+  cycles_player *players;    ///< Storage behind state.players
+  uint32_t player_capacity;  ///< Entries allocated in players
+  uint8_t *grid;             ///< Storage behind state.grid
+  size_t grid_capacity;      ///< Bytes allocated in grid
+  uint8_t *overview;         ///< Storage behind state.overview
+  size_t overview_capacity;  ///< Bytes allocated in overview
+  char *names[256];          ///< Player names, indexed by player ID
+  size_t name_capacity[256]; ///< Bytes allocated in names
+} cycles_state_buffer;
+
 /**
  * Directions for player movement
  */
@@ -94,6 +164,62 @@ typedef struct {
 int cycles_connect(const char *name, const char *host, const char *port,
                    cycles_connection *conn);
 
+/**
+ * Start connecting to the cycles server without blocking.
+ *
+ * The socket is made non-blocking and the player name is queued, to be sent
+ * once the connection is established. Afterwards, wait for conn->sock in a
+ * poller (poll, epoll, kqueue, ...): for reading, and for writing while
+ * cycles_wants_write() is true. Whenever it is ready, call cycles_handle_io()
+ * and then cycles_next_event() until it returns cycles_event_none.
+ * cycles_event_connected reports the color; from then on states arrive as
+ * cycles_event_state. Only the host name lookup may block, so pass a numeric
+ * address to drive many connections from one thread.
+ * @param name Player name (NUL-terminated)
+ * @param host Server hostname or IP address (NUL-terminated)
+ * @param port Server port as a string (NUL-terminated)
+ * @param conn Pointer to an empty cycles_connection structure to fill in
+ * @return 0 if the connection is under way, -1 on failure (check errno)
+ */
+int cycles_connect_async(const char *name, const char *host, const char *port,
+                         cycles_connection *conn);
+
+/**
+ * Whether a non-blocking connection needs the socket to become writable,
+ * i.e. it is still connecting or has queued bytes the socket did not take.
+ * @param conn Pointer to a cycles_connection opened with
+ * cycles_connect_async()
+ * @return true to also wait for writability, false to only wait for input
+ */
+bool cycles_wants_write(const cycles_connection *conn);
+
+/**
+ * Do the pending socket work of a non-blocking connection: finish the TCP
+ * connection, send queued bytes and append everything received to the read
+ * buffer. Never blocks, and may be called whenever the poller reports the
+ * socket, or at any other time.
+ * @param conn Pointer to a cycles_connection opened with
+ * cycles_connect_async()
+ * @return 0 on success, -1 on failure or when the server closed the
+ * connection (check errno). States received before that can still be taken
+ * with cycles_next_event().
+ */
+int cycles_handle_io(cycles_connection *conn);
+
+/**
+ * Take the next complete message received on a non-blocking connection.
+ *
+ * Only parses bytes already read by cycles_handle_io(), so it never touches
+ * the socket. In latest-only mode (see cycles_set_latest_only()) stale states
+ * in the read buffer are skipped.
+ * @param conn Pointer to a cycles_connection opened with
+ * cycles_connect_async()
+ * @param buf Pointer to an initialized cycles_state_buffer, filled when a
+ * state is returned
+ * @return A cycles_event, or -1 on failure (check errno)
+ */
+int cycles_next_event(cycles_connection *conn, cycles_state_buffer *buf);
+
 /**
  * Disconnect from the server and clean up the cycles_connection structure.
  * @param conn Pointer to a cycles_connection structure previously initialized
@@ -116,14 +242,96 @@ void cycles_free_game_state(cycles_game_state *gs);
  */
 int cycles_recv_game_state(SOCKET sock, cycles_game_state *out);
 
+/**
+ * Prepare an empty state buffer.
+ * @param buf Pointer to the cycles_state_buffer to initialize
+ */
+void cycles_state_buffer_init(cycles_state_buffer *buf);
+
+/**
+ * Free all storage of a state buffer and leave it empty.
+ * @param buf Pointer to a cycles_state_buffer previously initialized
+ */
+void cycles_state_buffer_free(cycles_state_buffer *buf);
+
+/**
+ * Receive a game state update from the server into reused storage.
+ *
+ * Fills buf->state like cycles_recv_game_state() does, but without allocating
+ * once the buffers are large enough. Pointers in the previous state (players,
+ * names, grid and overview) may be overwritten or moved.
+ * @param sock Connected socket
+ * @param buf Pointer to an initialized cycles_state_buffer
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_recv_game_state_into(SOCKET sock, cycles_state_buffer *buf);
+
+/**
+ * Receive a game state update through the connection's read buffer.
+ *
+ * Like cycles_recv_game_state_into(), but the socket is read in large chunks
+ * and packets are parsed out of them, so a small state usually costs a
+ * single recv() call. Bytes received ahead stay in the connection, so once
+ * this is used, do not read conn->sock with the socket-based functions. For
+ * connections opened with cycles_connect_async(), use cycles_next_event().
+ * @param conn Pointer to an initialized cycles_connection structure
+ * @param buf Pointer to an initialized cycles_state_buffer
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_recv_state(cycles_connection *conn, cycles_state_buffer *buf);
+
+/**
+ * Make cycles_recv_state() skip to the newest complete state.
+ *
+ * A bot that falls behind the server finds several states queued on its
+ * socket. In latest-only mode, cycles_recv_state() first reads everything
+ * already received and drops all complete states but the newest, counting
+ * them in conn->skipped_states, instead of returning stale states one by one.
+ * @param conn Pointer to an initialized cycles_connection structure
+ * @param enable true to skip stale states, false to read every state
+ */
+void cycles_set_latest_only(cycles_connection *conn, bool enable);
+
 /**
  * Send a move command (direction) to the server.
+ *
+ * On connections opened with cycles_connect_async() this never blocks: bytes
+ * the socket does not take at once are queued and sent by cycles_handle_io().
+ * The same holds for the request functions below.
  * @param conn Pointer to an initialized cycles_connection structure
  * @param dir Direction as an int32_t (0=north, 1=east, 2=south, 3=west)
  * @return 0 on success, -1 on failure (check errno)
  */
 int cycles_send_move_i32(cycles_connection *conn, int32_t dir);
 
+/**
+ * Ask the server to only send the part of the board around this player.
+ *
+ * From the next frame on, received states hold the cells within radius of the
+ * player's head (a square window clipped to the board) and only the players
+ * inside it. Optionally, a downsampled overview of the whole board is
+ * included. Can be sent at any time before a move.
+ * @param conn Pointer to an initialized cycles_connection structure
+ * @param radius Half-size of the window in cells, 0 restores the full board
+ * @param overview_factor Overview block size in cells, 0 for no overview. The
+ * server ignores a factor of 1 and factors whose overview would not fit in one
+ * packet, and sends no overview then
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_request_viewport(cycles_connection *conn, uint32_t radius,
+                            uint32_t overview_factor);
+
+/**
+ * Ask the server to append the hash of the whole grid to every state.
+ *
+ * The hash lets a client check, every frame, that the board it holds matches
+ * the server's without comparing grids. See cycles_compute_grid_hash().
+ * @param conn Pointer to an initialized cycles_connection structure
+ * @param enable true to receive the hash, false to stop
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_request_state_hash(cycles_connection *conn, bool enable);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,167 @@
+#pragma once
+#include "c_api.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file c_bitboard.h
+ * @brief Reachable areas and connected regions of the board, one bit per cell.
+ *
+ * A cycles_bitboard packs a window of the board into rows of 64-bit words, so
+ * the flood fills below handle 64 cells per operation. A fill extends whole
+ * runs of free cells along a row with carry arithmetic and spreads between
+ * rows in alternating top-down and bottom-up sweeps, which settles in a few
+ * sweeps on the open boards of a game. Bitboards and component maps keep
+ * their storage between calls, so evaluating every frame does not allocate
+ * once the board size is known.
+ *
+ * A typical bot builds the free cells once per state and compares the area
+ * behind each candidate move:
+ * @code
+ * cycles_bitboard_from_state(&free_cells, gs);
+ * cycles_bitboard_reachable(&free_cells, next_position, &reach);
+ * uint32_t area = cycles_bitboard_count(&reach);
+ * @endcode
+ */
+
+/**
+ * A set of cells in a rectangular window of the board
+ */
+typedef struct {
+  uint64_t *bits;  ///< Row by row, column x is bit x % 64 of word x / 64
+  size_t capacity; ///< Words allocated in bits
+  uint32_t x;      ///< Board column of the first column
+  uint32_t y;      ///< Board row of the first row
+  uint32_t width;  ///< Columns in the window
+  uint32_t height; ///< Rows in the window
+  uint32_t words;  ///< Words per row, bits past width are always clear
+} cycles_bitboard;
+
+/**
+ * Connected regions of free cells, 4-connected like the moves of a player
+ */
+typedef struct {
+  uint32_t *labels;       ///< Region of each cell row by row, 0 if not free
+  size_t label_capacity;  ///< Entries allocated in labels
+  uint32_t *sizes;        ///< Cells of region i at sizes[i - 1]
+  uint32_t count;         ///< Number of regions
+  uint32_t size_capacity; ///< Entries allocated in sizes
+  uint32_t x;             ///< Board column of the first column of labels
+  uint32_t y;             ///< Board row of the first row of labels
+  uint32_t width;         ///< Columns in labels
+  uint32_t height;        ///< Rows in labels
+  cycles_bitboard left;   ///< Scratch, cells not labelled yet
+  cycles_bitboard part;   ///< Scratch, region being labelled
+} cycles_components;
+
+/**
+ * Prepare an empty bitboard.
+ * @param board Pointer to the cycles_bitboard to initialize
+ */
+void cycles_bitboard_init(cycles_bitboard *board);
+
+/**
+ * Free the storage of a bitboard and leave it empty.
+ * @param board Pointer to a cycles_bitboard previously initialized
+ */
+void cycles_bitboard_free(cycles_bitboard *board);
+
+/**
+ * Cover a window of the board with no cell set.
+ * @param board Pointer to an initialized cycles_bitboard
+ * @param x Board column of the first column
+ * @param y Board row of the first row
+ * @param width Columns in the window
+ * @param height Rows in the window
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_bitboard_resize(cycles_bitboard *board, uint32_t x, uint32_t y,
+                           uint32_t width, uint32_t height);
+
+/**
+ * Set the free cells of a game state, covering its view window (the whole
+ * board unless a viewport was requested).
+ * @param free_cells Pointer to an initialized cycles_bitboard
+ * @param gs Game state
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_bitboard_from_state(cycles_bitboard *free_cells,
+                               const cycles_game_state *gs);
+
+/**
+ * Whether a cell is in the set.
+ * @param board Bitboard
+ * @param p Board position
+ * @return true if p is in the window and set
+ */
+bool cycles_bitboard_get(const cycles_bitboard *board, cycles_vec2i p);
+
+/**
+ * Add a cell to the set or remove it, ignoring positions outside the window.
+ * @param board Bitboard
+ * @param p Board position
+ * @param value Whether the cell is in the set
+ */
+void cycles_bitboard_set(cycles_bitboard *board, cycles_vec2i p, bool value);
+
+/**
+ * Number of cells in the set.
+ * @param board Bitboard
+ * @return Number of cells set
+ */
+uint32_t cycles_bitboard_count(const cycles_bitboard *board);
+
+/**
+ * Find the free cells a player at start can reach.
+ *
+ * The fill starts from start and its neighbours that are free, so start may
+ * be the occupied head of a player; the head itself is only included if it is
+ * free.
+ * @param free_cells Free cells, e.g. from cycles_bitboard_from_state()
+ * @param start Board position to fill from
+ * @param reach Output, resized to the window of free_cells; must not be
+ * free_cells
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_bitboard_reachable(const cycles_bitboard *free_cells,
+                              cycles_vec2i start, cycles_bitboard *reach);
+
+/**
+ * Prepare an empty component map.
+ * @param components Pointer to the cycles_components to initialize
+ */
+void cycles_components_init(cycles_components *components);
+
+/**
+ * Free the storage of a component map and leave it empty.
+ * @param components Pointer to a cycles_components previously initialized
+ */
+void cycles_components_free(cycles_components *components);
+
+/**
+ * Split the free cells into connected regions, numbered from 1 in the order
+ * their first cell appears row by row.
+ * @param free_cells Free cells, e.g. from cycles_bitboard_from_state()
+ * @param components Pointer to an initialized cycles_components
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_bitboard_components(const cycles_bitboard *free_cells,
+                               cycles_components *components);
+
+/**
+ * Region of a cell.
+ * @param components Component map
+ * @param p Board position
+ * @return Region number, or 0 if p is not free or outside the window
+ */
+uint32_t cycles_component_at(const cycles_components *components,
+                             cycles_vec2i p);
+
+#ifdef __cplusplus
+}
+#endif
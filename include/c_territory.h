@@ -0,0 +1,133 @@
+#pragma once
+#include "c_api.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file c_territory.h
+ * @brief Voronoi territory of every player: which free cells each head
+ * reaches first.
+ *
+ * cycles_territory_update() runs one breadth-first search from all heads at
+ * once. Every cell keeps the distances of the three nearest heads, which is
+ * enough to settle who owns it when any single player is taken out of the
+ * picture. That makes cycles_territory_evaluate_move() cheap: moving one
+ * player only changes cells in its old and new regions, so a query searches
+ * those and leaves the rest of the board alone. A bot pays for one full
+ * search per state, however many candidate moves it compares.
+ */
+
+/** Owner of a cell that two or more heads reach first together */
+enum { CYCLES_TERRITORY_CONTESTED = 256 };
+
+/** Distance of a cell that no head reaches */
+#define CYCLES_TERRITORY_UNREACHED UINT32_MAX
+
+/**
+ * Territory sizes
+ */
+typedef struct {
+  uint32_t owned[256]; ///< Cells each player reaches strictly first, by ID
+  uint32_t contested;  ///< Cells two or more players reach first together
+} cycles_territory_counts;
+
+/**
+ * Territory of the last state passed to cycles_territory_update().
+ * Initialize with cycles_territory_init() and release with
+ * cycles_territory_free().
+ *
+ * Only cells inside the view window of the state are searched, so with a
+ * viewport the territory is that of the visible part of the board.
+ */
+typedef struct {
+  cycles_territory_counts counts; ///< Territory sizes of the last state
+
+  uint16_t *owner;         ///< Owner of each cell, see cycles_territory_owner()
+  uint32_t x;              ///< Board column of the first column searched
+  uint32_t y;              ///< Board row of the first row searched
+  uint32_t width;          ///< Columns searched
+  uint32_t height;         ///< Rows searched
+  cycles_vec2i heads[256]; ///< Head positions of the last state, by ID
+  bool present[256];       ///< Players in the last state, by ID
+  size_t capacity;         ///< Cells allocated in each array
+  uint8_t *blocked;        ///< Grid with a blocked border, nonzero if occupied
+  uint32_t *label_dist;    ///< Distances of the nearest heads, 3 per cell
+  uint8_t *label_id;       ///< IDs of the nearest heads, 3 per cell
+  uint8_t *label_count;    ///< Nearest heads known for each cell
+  uint32_t *queue;         ///< Scratch, search queue
+  uint32_t *query_dist;    ///< Scratch, distances from a moved head
+  uint32_t *new_mark;      ///< Scratch, cells reached from a moved head
+  uint32_t *old_mark;      ///< Scratch, cells of the region left behind
+  uint32_t query;          ///< Mark of the current query
+} cycles_territory;
+
+/**
+ * Prepare an empty territory.
+ * @param territory Pointer to the cycles_territory to initialize
+ */
+void cycles_territory_init(cycles_territory *territory);
+
+/**
+ * Free all storage of a territory and leave it empty.
+ * @param territory Pointer to a cycles_territory previously initialized
+ */
+void cycles_territory_free(cycles_territory *territory);
+
+/**
+ * Compute the territory of every player in gs.
+ *
+ * The territory keeps its own copy of the grid, so gs may be freed or reused
+ * afterwards.
+ * @param territory Pointer to an initialized cycles_territory
+ * @param gs Game state
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_territory_update(cycles_territory *territory,
+                            const cycles_game_state *gs);
+
+/**
+ * Player that reaches a cell first.
+ * @param territory Territory
+ * @param p Board position
+ * @return Player ID, CYCLES_TERRITORY_CONTESTED if several players reach p
+ * first together, or 0 if p is occupied, unreached or outside the window
+ */
+uint16_t cycles_territory_owner(const cycles_territory *territory,
+                                cycles_vec2i p);
+
+/**
+ * Distance from the nearest head to a cell.
+ * @param territory Territory
+ * @param p Board position
+ * @return Steps from the nearest head, or CYCLES_TERRITORY_UNREACHED if p is
+ * outside the window or no head reaches it
+ */
+uint32_t cycles_territory_distance(const cycles_territory *territory,
+                                   cycles_vec2i p);
+
+/**
+ * Territory sizes if one player moved and the others stayed put.
+ *
+ * The player's head moves one cell, the cell it leaves stays occupied by its
+ * trail. A move into an occupied cell or out of the window takes the player
+ * out, so its territory goes to the others. Only the cells of the player's
+ * regions before and after the move are visited; the territory itself is not
+ * changed.
+ * @param territory Territory updated with the current state
+ * @param player_id ID of a player present in that state
+ * @param dir Direction of the move
+ * @param out Territory sizes after the move
+ * @return 0 on success, -1 on failure (check errno)
+ */
+int cycles_territory_evaluate_move(cycles_territory *territory,
+                                   uint32_t player_id, cycles_direction dir,
+                                   cycles_territory_counts *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,8 @@
 #pragma once
 #include "c_api.h"
+#include "cycles_hash.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 /// \cond DO_NOT_DOCUMENT
 static inline uint32_t pcg32(uint64_t *state) {
@@ -33,6 +35,25 @@ static int rand_int_inclusive(uint64_t *state, int inclusive_max) {
   }
 }
 
+/**
+ * Bots written for a single board size can define CYCLES_FIXED_GRID_WIDTH and
+ * CYCLES_FIXED_GRID_HEIGHT before including this header. The helpers below
+ * then use those constants instead of the sizes in the game state, so bounds
+ * checks and row strides fold at compile time. Such bots must play on that
+ * board and must not request a viewport.
+ */
+#if defined(CYCLES_FIXED_GRID_WIDTH) && defined(CYCLES_FIXED_GRID_HEIGHT)
+// gs is still evaluated, so helpers taking it do not warn about it unused
+#define CYCLES_GRID_WIDTH(gs) ((void)(gs), (uint32_t)(CYCLES_FIXED_GRID_WIDTH))
+#define CYCLES_GRID_HEIGHT(gs)                                                 \
+  ((void)(gs), (uint32_t)(CYCLES_FIXED_GRID_HEIGHT))
+#else
+/// Grid width used by the helpers, see CYCLES_FIXED_GRID_WIDTH
+#define CYCLES_GRID_WIDTH(gs) ((gs)->grid_width)
+/// Grid height used by the helpers, see CYCLES_FIXED_GRID_HEIGHT
+#define CYCLES_GRID_HEIGHT(gs) ((gs)->grid_height)
+#endif
+
 /**
  * Check if a position is inside the grid boundaries.
  * @param gs Pointer to the game state
@@ -41,21 +62,67 @@ static int rand_int_inclusive(uint64_t *state, int inclusive_max) {
  */
 static inline bool cycles_is_inside_grid(const cycles_game_state *gs,
                                          cycles_vec2i p) {
-  return (p.x >= 0) && (p.y >= 0) && ((uint32_t)p.x < gs->grid_width) &&
-         ((uint32_t)p.y < gs->grid_height);
+  return ((uint32_t)p.x < CYCLES_GRID_WIDTH(gs)) &&
+         ((uint32_t)p.y < CYCLES_GRID_HEIGHT(gs));
+}
+
+/**
+ * Check if a position is inside the part of the grid received from the
+ * server (the whole grid unless a viewport was requested).
+ * @param gs Pointer to the game state
+ * @param p Cell coordinates
+ * @return true if inside, false if outside
+ */
+static inline bool cycles_is_inside_view(const cycles_game_state *gs,
+                                         cycles_vec2i p) {
+  return ((uint32_t)p.x - gs->view_x < gs->view_width) &&
+         ((uint32_t)p.y - gs->view_y < gs->view_height);
 }
 
 /**
  * Get the contents of a grid cell.
  * @param gs Pointer to the game state
  * @param p Cell coordinates
- * @return Cell contents (0 = empty, >0 = player ID)
+ * @return Cell contents (0 = empty, >0 = player ID). Cells outside the
+ * received view are reported as empty.
  * @note Behavior is undefined if p is out of bounds. Use
  * cycles_is_inside_grid() first.
  */
 static inline uint8_t cycles_get_grid_cell(const cycles_game_state *gs,
                                            cycles_vec2i p) {
-  return gs->grid[(uint32_t)p.y * gs->grid_width + (uint32_t)p.x];
+#if defined(CYCLES_FIXED_GRID_WIDTH) && defined(CYCLES_FIXED_GRID_HEIGHT)
+  return gs->grid[(size_t)(uint32_t)p.y * CYCLES_GRID_WIDTH(gs) +
+                  (uint32_t)p.x];
+#else
+  if (!cycles_is_inside_view(gs, p)) {
+    return 0;
+  }
+  return gs->grid[(size_t)((uint32_t)p.y - gs->view_y) * gs->view_width +
+                  ((uint32_t)p.x - gs->view_x)];
+#endif
+}
+
+/**
+ * Compute the Zobrist hash of the received grid cells.
+ *
+ * When the received view covers the whole board this matches the state_hash
+ * sent by the server, so comparing both checks the board for corruption or
+ * desync.
+ * @param gs Pointer to the game state
+ * @return Hash of the occupied cells in the view
+ */
+static inline uint64_t cycles_compute_grid_hash(const cycles_game_state *gs) {
+  uint64_t hash = 0;
+  for (uint32_t y = 0; y < gs->view_height; y++) {
+    const uint8_t *row = gs->grid + (size_t)y * gs->view_width;
+    uint64_t cell = (uint64_t)(gs->view_y + y) * gs->grid_width + gs->view_x;
+    for (uint32_t x = 0; x < gs->view_width; x++) {
+      if (row[x] != 0) {
+        hash ^= cycles_zobrist_key(cell + x, row[x]);
+      }
+    }
+  }
+  return hash;
 }
 
 /**
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+/**
+ * @file cycles_hash.h
+ * @brief Zobrist keys shared by the server and clients to hash board states.
+ *
+ * The hash of a board is the XOR of cycles_zobrist_key(y * width + x, owner)
+ * over all occupied cells, so writing a cell updates it in O(1) and two
+ * boards with the same contents always hash to the same value.
+ */
+
+/**
+ * Key of a (cell, owner) pair.
+ * @param cell Cell index, y * grid_width + x
+ * @param owner ID of the player occupying the cell (non-zero)
+ * @return Pseudo-random 64-bit key
+ */
+static inline uint64_t cycles_zobrist_key(uint64_t cell, uint8_t owner) {
+  // splitmix64 finalizer, so no key table has to be stored or agreed upon
+  uint64_t z = ((cell << 8) | owner) + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
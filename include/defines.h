@@ -2,6 +2,22 @@
 #define MAX_NAME_LEN 255
 enum { NUM_DIRECTIONS = 4 }; ///< Number of valid directions
 
+// Wire protocol extensions. A client opts in by sending an option packet
+// ([len=12][opcode][arg0][arg1], all big-endian u32) instead of a move; the
+// server then answers with extended state packets, flagged by the high bit of
+// the grid width field and carrying tagged sections instead of the raw grid.
+enum { CYCLES_OPTION_PACKET_LEN = 12 }; ///< Payload length of option packets
+enum {
+  CYCLES_OPTION_VIEWPORT = 1,  ///< arg0 = radius (0 = full), arg1 = overview
+  CYCLES_OPTION_STATE_HASH = 2 ///< arg0 = 1 to receive the grid hash, 0 = off
+};
+#define CYCLES_STATE_EXTENDED 0x80000000u ///< Flag in the grid width field
+enum {
+  CYCLES_SECTION_VIEW = 1,     ///< [x][y][w][h] + w*h cells
+  CYCLES_SECTION_OVERVIEW = 2, ///< [factor][w][h] + w*h density bytes
+  CYCLES_SECTION_HASH = 3      ///< [high][low] words of the grid hash
+};
+
 // These definitions helps to write cross-platform code
 #if !defined(_WIN32)
 // In UNIX, sockets are file descriptors (int)
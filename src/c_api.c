@@ -9,6 +9,7 @@
 #else
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -16,15 +17,47 @@
 #include <unistd.h>
 #endif
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ulog.h>
-// Max payload guard to avoid pathological lengths.
-enum { CYCLES_MAX_PAYLOAD = 64 * 1024 };
+// Size of the reads done by cycles_recv_state(). Larger payloads bypass the
+// read buffer and go straight to their destination.
+enum { CYCLES_READ_CHUNK = 64 * 1024 };
 // Upper bounds to keep things sane in case of malformed packets
 enum { CYCLES_MAX_PACKET = 32 * 1024 * 1024 };
 enum { CYCLES_MAX_STRING = 16 * 1024 * 1024 };
+// Color answer to the player name: [len = 3][r][g][b]
+enum { CYCLES_COLOR_BYTES = 7 };
+
+// Flags of reads that must not block, even on a blocking socket
+#if defined(MSG_DONTWAIT)
+#define CYCLES_RECV_NOWAIT MSG_DONTWAIT
+#else
+#define CYCLES_RECV_NOWAIT 0
+#endif
+// A host driving many non-blocking connections must survive a closed one
+#if defined(MSG_NOSIGNAL)
+#define CYCLES_SEND_NOSIGNAL MSG_NOSIGNAL
+#else
+#define CYCLES_SEND_NOSIGNAL 0
+#endif
+
+// Make *ptr hold at least n bytes. Storage is only reallocated when n exceeds
+// *capacity, so pass a zero capacity to always get a fresh allocation.
+static int reserve(void **ptr, size_t *capacity, size_t n) {
+  if (*ptr && n <= *capacity)
+    return 0;
+  void *tmp = realloc(*ptr, n ? n : 1);
+  if (!tmp) {
+    errno = ENOMEM;
+    return -1;
+  }
+  *ptr = tmp;
+  *capacity = n;
+  return 0;
+}
 
 static int send_all(SOCKET fd, const void *buf, size_t len) {
   // Ensure fd is valid
@@ -48,7 +81,58 @@ static int send_all(SOCKET fd, const void *buf, size_t len) {
   return 0;
 }
 
-static int send_cycles_string_packet(int sock, const char *s) {
+// Whether the last socket call failed only because it would have blocked
+static bool would_block(void) {
+#if defined(_WIN32)
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// Send queued bytes of a non-blocking connection until the socket stops
+// taking them
+static int flush_writes(cycles_connection *conn) {
+  while (conn->write_start < conn->write_end) {
+    ssize_t n = send(conn->sock, conn->write_buffer + conn->write_start,
+                     conn->write_end - conn->write_start,
+                     CYCLES_SEND_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return would_block() ? 0 : -1;
+    }
+    conn->write_start += (size_t)n;
+  }
+  conn->write_start = conn->write_end = 0;
+  return 0;
+}
+
+// Send a whole packet. Non-blocking connections queue what the socket does
+// not take, and everything while still connecting.
+static int send_bytes(cycles_connection *conn, const void *buf, size_t len) {
+  if (!conn->nonblocking)
+    return send_all(conn->sock, buf, len);
+  if (conn->write_start > 0) {
+    memmove(conn->write_buffer, conn->write_buffer + conn->write_start,
+            conn->write_end - conn->write_start);
+    conn->write_end -= conn->write_start;
+    conn->write_start = 0;
+  }
+  size_t needed = conn->write_end + len;
+  if (needed > conn->write_capacity) {
+    size_t grown = 2 * conn->write_capacity;
+    size_t want = grown > needed ? grown : needed;
+    void **data = (void **)&conn->write_buffer;
+    if (reserve(data, &conn->write_capacity, want) < 0)
+      return -1;
+  }
+  memcpy(conn->write_buffer + conn->write_end, buf, len);
+  conn->write_end = needed;
+  return conn->connecting ? 0 : flush_writes(conn);
+}
+
+static int send_cycles_string_packet(cycles_connection *conn, const char *s) {
   uint32_t name_len = (uint32_t)strlen(s);      // no NUL in payload
   uint32_t payload_len = 4u + name_len;         // [len_be][bytes]
   uint32_t packet_size_be = htonl(payload_len); // outer size (CYCLES frame)
@@ -67,18 +151,26 @@ static int send_cycles_string_packet(int sock, const char *s) {
   memcpy(buf + 4, &name_len_be, 4);
   memcpy(buf + 8, s, name_len);
 
-  int rc = send_all(sock, buf, total);
+  int rc = send_bytes(conn, buf, total);
   free(buf);
   return rc;
 }
 
-static int send_cycles_i32_packet(SOCKET sock, int32_t value) {
+static int send_cycles_i32_packet(cycles_connection *conn, int32_t value) {
   uint32_t payload_len_be = htonl(4u);
   uint32_t v_be = htonl((uint32_t)value);
   unsigned char buf[8];
   memcpy(buf, &payload_len_be, 4);
   memcpy(buf + 4, &v_be, 4);
-  return send_all(sock, buf, sizeof buf);
+  return send_bytes(conn, buf, sizeof buf);
+}
+
+static int send_cycles_option_packet(cycles_connection *conn,
+                                     uint32_t opcode, uint32_t arg0,
+                                     uint32_t arg1) {
+  uint32_t words[4] = {htonl(CYCLES_OPTION_PACKET_LEN), htonl(opcode),
+                       htonl(arg0), htonl(arg1)};
+  return send_bytes(conn, words, sizeof words);
 }
 
 static int recv_all(SOCKET fd, void *buf, size_t len) {
@@ -103,11 +195,16 @@ static int recv_all(SOCKET fd, void *buf, size_t len) {
   return 0;
 }
 
-static int recv_cycles_packet_len(SOCKET fd, uint32_t *out_len) {
-  uint32_t be = 0;
-  if (recv_all(fd, &be, sizeof(be)) < 0)
+static int parse_color(const uint8_t *buf, cycles_rgb *out) {
+  uint32_t be;
+  memcpy(&be, buf, sizeof(be));
+  if (ntohl(be) != 3) {
+    errno = EPROTO;
     return -1;
-  *out_len = ntohl(be);
+  }
+  out->r = buf[4];
+  out->g = buf[5];
+  out->b = buf[6];
   return 0;
 }
 
@@ -116,29 +213,11 @@ static int recv_cycles_color(SOCKET fd, cycles_rgb *out) {
     errno = EINVAL;
     return -1;
   }
-  uint32_t payload_len = 0;
-  if (recv_cycles_packet_len(fd, &payload_len) < 0)
-    return -1;
-  if (payload_len == 0 || payload_len > CYCLES_MAX_PAYLOAD) {
-    errno = EPROTO;
-    return -1;
-  }
-  if (payload_len != 3) {
-    char *drain = (char *)malloc(payload_len);
-    if (drain) {
-      (void)recv_all(fd, drain, payload_len);
-      free(drain);
-    }
-    errno = EPROTO;
-    return -1;
-  }
-  uint8_t buf[3];
+  // Length and color in one read
+  uint8_t buf[CYCLES_COLOR_BYTES];
   if (recv_all(fd, buf, sizeof(buf)) < 0)
     return -1;
-  out->r = buf[0];
-  out->g = buf[1];
-  out->b = buf[2];
-  return 0;
+  return parse_color(buf, out);
 }
 
 static int recv_cycles_packet(SOCKET fd, uint8_t **out, uint32_t *out_len) {
@@ -214,7 +293,30 @@ static int rd_string(const uint8_t **p, uint32_t *rem, char **out) {
   return 0;
 }
 
-static SOCKET cycles_create_socket(const char *host, const char *port) {
+static int set_nonblocking(SOCKET sock) {
+#if defined(_WIN32)
+  u_long mode = 1;
+  return ioctlsocket(sock, FIONBIO, &mode) == 0 ? 0 : -1;
+#else
+  int flags = fcntl(sock, F_GETFL, 0);
+  if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+    return -1;
+  return 0;
+#endif
+}
+
+// Whether a failed connect() on a non-blocking socket is still under way
+static bool connect_in_progress(void) {
+#if defined(_WIN32)
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EINPROGRESS;
+#endif
+}
+
+// A non-blocking socket only starts connecting, see connect_finished()
+static SOCKET cycles_create_socket(const char *host, const char *port,
+                                   bool nonblocking) {
   ulog_debug("Configuring remote address...");
   // Configure a remote address
   struct addrinfo hints;
@@ -223,7 +325,7 @@ static SOCKET cycles_create_socket(const char *host, const char *port) {
   struct addrinfo *peer_address;
   if (getaddrinfo(host, port, &hints, &peer_address) != 0) {
     ulog_error("getaddrinfo() failed. (%d)", GETSOCKETERRNO());
-    return EXIT_FAILURE;
+    return (SOCKET)-1;
   }
   char address_buffer[NI_MAXHOST];
   char service_buffer[NI_MAXSERV];
@@ -237,19 +339,58 @@ static SOCKET cycles_create_socket(const char *host, const char *port) {
                        peer_address->ai_protocol);
   if (!ISVALIDSOCKET(socket_peer)) {
     ulog_error("socket() failed. (%d)", GETSOCKETERRNO());
-    return EXIT_FAILURE;
+    freeaddrinfo(peer_address);
+    return (SOCKET)-1;
+  }
+  if (nonblocking && set_nonblocking(socket_peer) < 0) {
+    ulog_error("Failed to make the socket non-blocking. (%d)",
+               GETSOCKETERRNO());
+    freeaddrinfo(peer_address);
+    CLOSESOCKET(socket_peer);
+    return (SOCKET)-1;
   }
   ulog_debug("Connecting to remote...");
   if (connect(socket_peer, peer_address->ai_addr, peer_address->ai_addrlen) !=
-      0) {
+          0 &&
+      !(nonblocking && connect_in_progress())) {
     ulog_error("connect() failed. (%d)", GETSOCKETERRNO());
     ulog_error("%s", strerror(GETSOCKETERRNO()));
-    return EXIT_FAILURE;
+    freeaddrinfo(peer_address);
+    CLOSESOCKET(socket_peer);
+    return (SOCKET)-1;
   }
   freeaddrinfo(peer_address);
   return socket_peer;
 }
 
+// 1 once the connection of a non-blocking socket is established, 0 while
+// it is under way
+static int connect_finished(SOCKET sock) {
+  int err = 0;
+  socklen_t err_len = sizeof(err);
+  if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (char *)&err, &err_len) < 0)
+    return -1;
+  if (err != 0) {
+    errno = err;
+    return -1;
+  }
+  struct sockaddr_storage peer;
+  socklen_t peer_len = sizeof(peer);
+  if (getpeername(sock, (struct sockaddr *)&peer, &peer_len) == 0)
+    return 1;
+#if defined(_WIN32)
+  return WSAGetLastError() == WSAENOTCONN ? 0 : -1;
+#else
+  return errno == ENOTCONN ? 0 : -1;
+#endif
+}
+
+// Empty buffers and flags of a connection about to be opened
+static void reset_connection(cycles_connection *conn) {
+  memset(conn, 0, sizeof(*conn));
+  conn->sock = (SOCKET)-1;
+}
+
 int cycles_connect(const char *name, const char *host, const char *port,
                    cycles_connection *conn) {
 #if defined(_WIN32)
@@ -260,13 +401,14 @@ int cycles_connect(const char *name, const char *host, const char *port,
     return 1;
   }
 #endif
-  conn->sock = cycles_create_socket(host, port);
+  reset_connection(conn);
+  conn->sock = cycles_create_socket(host, port, false);
   if (!ISVALIDSOCKET(conn->sock)) {
     ulog_error("Failed to create socket and connect.");
     return -1;
   }
   ulog_trace("Sending player name: %s", name);
-  if (send_cycles_string_packet(conn->sock, name) != 0) {
+  if (send_cycles_string_packet(conn, name) != 0) {
     ulog_error("send() failed. (%d)", GETSOCKETERRNO());
     return -1;
   }
@@ -283,11 +425,55 @@ int cycles_connect(const char *name, const char *host, const char *port,
   return 0;
 }
 
+int cycles_connect_async(const char *name, const char *host, const char *port,
+                         cycles_connection *conn) {
+  if (!name || !host || !port || !conn) {
+    errno = EINVAL;
+    return -1;
+  }
+#if defined(_WIN32)
+  WSADATA wsaData;
+  int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
+  if (iResult != 0) {
+    ulog_error("WSAStartup failed: %d", iResult);
+    return -1;
+  }
+#endif
+  reset_connection(conn);
+  conn->nonblocking = conn->connecting = conn->handshaking = true;
+  strncpy(conn->name, name, MAX_NAME_LEN);
+  conn->name[MAX_NAME_LEN] = '\0';
+  conn->sock = cycles_create_socket(host, port, true);
+  // The name waits in the write buffer until the connection is up
+  if (!ISVALIDSOCKET(conn->sock) ||
+      reserve((void **)&conn->read_buffer, &conn->read_capacity,
+              CYCLES_READ_CHUNK) < 0 ||
+      send_cycles_string_packet(conn, name) < 0) {
+    ulog_error("Failed to start connecting.");
+    cycles_disconnect(conn);
+    return -1;
+  }
+  return 0;
+}
+
+bool cycles_wants_write(const cycles_connection *conn) {
+  return conn && conn->nonblocking &&
+         (conn->connecting || conn->write_start < conn->write_end);
+}
+
 void cycles_disconnect(cycles_connection *conn) {
   if (conn && ISVALIDSOCKET(conn->sock)) {
     CLOSESOCKET(conn->sock);
     conn->sock = -1;
   }
+  if (conn) {
+    free(conn->read_buffer);
+    conn->read_buffer = NULL;
+    conn->read_capacity = conn->read_start = conn->read_end = 0;
+    free(conn->write_buffer);
+    conn->write_buffer = NULL;
+    conn->write_capacity = conn->write_start = conn->write_end = 0;
+  }
 #ifdef _WIN32
   WSACleanup();
 #endif
@@ -308,6 +494,117 @@ void cycles_free_game_state(cycles_game_state *gs) {
   gs->grid_width = 0;
   gs->grid_height = 0;
   gs->frame_number = 0;
+  gs->view_x = gs->view_y = gs->view_width = gs->view_height = 0;
+  free(gs->overview);
+  gs->overview = NULL;
+  gs->overview_factor = gs->overview_width = gs->overview_height = 0;
+  gs->state_hash = 0;
+  gs->has_state_hash = false;
+}
+
+// Checked w * h for a section payload, fails if it does not fit in rem
+static int rd_area(uint32_t w, uint32_t h, uint32_t rem, uint32_t *out) {
+  uint64_t area = (uint64_t)w * h;
+  if (area > rem) {
+    errno = EPROTO;
+    return -1;
+  }
+  *out = (uint32_t)area;
+  return 0;
+}
+
+// Sections are stored in buf when receiving into a cycles_state_buffer, and
+// in fresh allocations owned by out when buf is NULL
+static int rd_view_section(const uint8_t **p, uint32_t *rem,
+                           cycles_game_state *out, cycles_state_buffer *buf) {
+  uint32_t x, y, w, h, area;
+  if (rd_u32(p, rem, &x) < 0 || rd_u32(p, rem, &y) < 0 ||
+      rd_u32(p, rem, &w) < 0 || rd_u32(p, rem, &h) < 0 ||
+      rd_area(w, h, *rem, &area) < 0)
+    return -1;
+  if ((uint64_t)x + w > out->grid_width ||
+      (uint64_t)y + h > out->grid_height) {
+    errno = EPROTO;
+    return -1;
+  }
+  size_t fresh = 0;
+  void **grid = buf ? (void **)&buf->grid : (void **)&out->grid;
+  if (reserve(grid, buf ? &buf->grid_capacity : &fresh, area) < 0)
+    return -1;
+  out->grid = (uint8_t *)*grid;
+  out->view_x = x;
+  out->view_y = y;
+  out->view_width = w;
+  out->view_height = h;
+  return rd_bytes(p, rem, out->grid, area);
+}
+
+static int rd_overview_section(const uint8_t **p, uint32_t *rem,
+                               cycles_game_state *out,
+                               cycles_state_buffer *buf) {
+  uint32_t factor, w, h, area;
+  if (rd_u32(p, rem, &factor) < 0 || rd_u32(p, rem, &w) < 0 ||
+      rd_u32(p, rem, &h) < 0 || rd_area(w, h, *rem, &area) < 0)
+    return -1;
+  size_t fresh = 0;
+  void **overview = buf ? (void **)&buf->overview : (void **)&out->overview;
+  if (reserve(overview, buf ? &buf->overview_capacity : &fresh, area) < 0)
+    return -1;
+  out->overview = (uint8_t *)*overview;
+  out->overview_factor = factor;
+  out->overview_width = w;
+  out->overview_height = h;
+  return rd_bytes(p, rem, out->overview, area);
+}
+
+static int rd_hash_section(const uint8_t **p, uint32_t *rem,
+                           cycles_game_state *out) {
+  uint32_t high, low;
+  if (rd_u32(p, rem, &high) < 0 || rd_u32(p, rem, &low) < 0)
+    return -1;
+  out->state_hash = (uint64_t)high << 32 | low;
+  out->has_state_hash = true;
+  return 0;
+}
+
+// Parse the tagged sections that replace the grid in extended packets.
+// Unknown sections are skipped so newer servers can add more.
+static int rd_sections(const uint8_t **p, uint32_t *rem,
+                       cycles_game_state *out, cycles_state_buffer *buf) {
+  while (*rem) {
+    uint32_t tag, len;
+    if (rd_u32(p, rem, &tag) < 0 || rd_u32(p, rem, &len) < 0)
+      return -1;
+    if (len > *rem) {
+      errno = EPROTO;
+      return -1;
+    }
+    const uint8_t *section = *p;
+    uint32_t section_rem = len;
+    int rc = 0;
+    switch (tag) {
+    case CYCLES_SECTION_VIEW:
+      rc = rd_view_section(&section, &section_rem, out, buf);
+      break;
+    case CYCLES_SECTION_OVERVIEW:
+      rc = rd_overview_section(&section, &section_rem, out, buf);
+      break;
+    case CYCLES_SECTION_HASH:
+      rc = rd_hash_section(&section, &section_rem, out);
+      break;
+    default:
+      ulog_debug("recv_game_state: skipping unknown section %u", tag);
+      section_rem = 0;
+      break;
+    }
+    if (rc < 0 || section_rem != 0) {
+      errno = EPROTO;
+      return -1;
+    }
+    *p += len;
+    *rem -= len;
+  }
+  return 0;
 }
 
 int cycles_recv_game_state(SOCKET sock, cycles_game_state *out) {
@@ -332,6 +629,9 @@ int cycles_recv_game_state(SOCKET sock, cycles_game_state *out) {
     cycles_free_game_state(out);
     return -1;
   }
+  // Packets answering a viewport request flag the width and carry sections
+  bool extended = (out->grid_width & CYCLES_STATE_EXTENDED) != 0;
+  out->grid_width &= ~CYCLES_STATE_EXTENDED;
   ulog_trace("recv_game_state: last frame number = %u", out->frame_number);
   ulog_debug("recv_game_state: grid %ux%u with %u players", out->grid_width,
              out->grid_height, out->player_count);
@@ -389,6 +689,15 @@ int cycles_recv_game_state(SOCKET sock, cycles_game_state *out) {
     return -1;
   }
   out->frame_number = frame;
+  if (extended) {
+    int rc = rd_sections(&p, &rem, out, NULL);
+    free(pkt);
+    if (rc < 0)
+      cycles_free_game_state(out);
+    return rc;
+  }
+  out->view_width = out->grid_width;
+  out->view_height = out->grid_height;
   // grid: Uint8[gridWidth * gridHeight]
   // overflow-safe: (size_t) w * h
   size_t grid_sz =
@@ -432,11 +741,341 @@ int cycles_recv_game_state(SOCKET sock, cycles_game_state *out) {
   return 0;
 }
 
+void cycles_state_buffer_init(cycles_state_buffer *buf) {
+  if (buf)
+    memset(buf, 0, sizeof(*buf));
+}
+
+void cycles_state_buffer_free(cycles_state_buffer *buf) {
+  if (!buf)
+    return;
+  free(buf->packet);
+  free(buf->players);
+  free(buf->grid);
+  free(buf->overview);
+  for (size_t i = 0; i < sizeof(buf->names) / sizeof(buf->names[0]); ++i)
+    free(buf->names[i]);
+  memset(buf, 0, sizeof(*buf));
+}
+
+// Keep the name of player id in buf, only copying it when it changed
+static int intern_name(cycles_state_buffer *buf, uint8_t id,
+                       const uint8_t *src, uint32_t n, char **out) {
+  char *name = buf->names[id];
+  if (!name || strlen(name) != n || memcmp(name, src, n) != 0) {
+    if (reserve((void **)&buf->names[id], &buf->name_capacity[id],
+                (size_t)n + 1) < 0)
+      return -1;
+    name = buf->names[id];
+    memcpy(name, src, n);
+    name[n] = '\0';
+  }
+  *out = name;
+  return 0;
+}
+
+// Read n bytes for a state. Connections without a read buffer read the
+// socket directly, others take buffered bytes first and refill the buffer
+// with large reads.
+static int read_bytes(cycles_connection *conn, void *dst, size_t n) {
+  if (!conn->read_buffer)
+    return recv_all(conn->sock, dst, n);
+  uint8_t *p = (uint8_t *)dst;
+  size_t buffered = conn->read_end - conn->read_start;
+  size_t take = buffered < n ? buffered : n;
+  memcpy(p, conn->read_buffer + conn->read_start, take);
+  conn->read_start += take;
+  p += take;
+  n -= take;
+  if (n == 0)
+    return 0;
+  conn->read_start = conn->read_end = 0;
+  if (n >= CYCLES_READ_CHUNK)
+    return recv_all(conn->sock, p, n);
+  while (conn->read_end < n) {
+    ssize_t got = recv(conn->sock, conn->read_buffer + conn->read_end,
+                       conn->read_capacity - conn->read_end, 0);
+    if (got < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (got == 0)
+      return -1; // peer closed
+    conn->read_end += (size_t)got;
+  }
+  memcpy(p, conn->read_buffer, n);
+  conn->read_start = n;
+  return 0;
+}
+
+static uint32_t be32_at(const uint8_t *p) {
+  uint32_t be;
+  memcpy(&be, p, sizeof(be));
+  return ntohl(be);
+}
+
+// Append whatever the socket already holds to the read buffer, growing it
+// while the socket keeps delivering, without blocking. Fails on socket errors
+// and when the peer closed, after keeping the bytes received before.
+static int read_available(cycles_connection *conn) {
+  if (conn->read_start > 0) {
+    memmove(conn->read_buffer, conn->read_buffer + conn->read_start,
+            conn->read_end - conn->read_start);
+    conn->read_end -= conn->read_start;
+    conn->read_start = 0;
+  }
+  for (;;) {
+    if (conn->read_end == conn->read_capacity) {
+      // Room for the largest accepted packet and its length prefix
+      size_t limit = (size_t)CYCLES_MAX_PACKET + 4;
+      if (conn->read_capacity >= limit)
+        return 0; // Parse what is there first
+      size_t grown = 2 * conn->read_capacity;
+      if (grown > limit)
+        grown = limit;
+      void **data = (void **)&conn->read_buffer;
+      if (reserve(data, &conn->read_capacity, grown) < 0)
+        return -1;
+    }
+    ssize_t got = recv(conn->sock, conn->read_buffer + conn->read_end,
+                       conn->read_capacity - conn->read_end,
+                       CYCLES_RECV_NOWAIT);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got < 0)
+      return would_block() ? 0 : -1;
+    if (got == 0) {
+      errno = ECONNRESET; // peer closed
+      return -1;
+    }
+    conn->read_end += (size_t)got;
+  }
+}
+
+// Drop every complete state in the read buffer but the newest
+static void skip_stale_states(cycles_connection *conn) {
+  size_t pos = conn->read_start, newest = pos;
+  uint64_t complete = 0;
+  while (conn->read_end - pos >= 4) {
+    size_t len = be32_at(conn->read_buffer + pos);
+    if (conn->read_end - pos - 4 < len)
+      break;
+    newest = pos;
+    pos += 4 + len;
+    complete++;
+  }
+  if (complete > 1) {
+    conn->skipped_states += complete - 1;
+    conn->read_start = newest;
+    ulog_debug("recv_state: skipped %llu stale states",
+               (unsigned long long)(complete - 1));
+  }
+}
+
+// Smallest player entry: x, y, color, empty name and id
+enum { CYCLES_MIN_PLAYER_BYTES = 4 + 4 + 3 + 4 + 1 };
+
+static int recv_state_into(cycles_connection *conn, cycles_state_buffer *buf) {
+  cycles_game_state *out = &buf->state;
+  uint32_t be = 0;
+  uint32_t header[3]; // gridWidth, gridHeight, playerCount
+  if (read_bytes(conn, &be, sizeof(be)) < 0)
+    return -1;
+  uint32_t len = ntohl(be);
+  if (len < sizeof(header) || len > CYCLES_MAX_PACKET) {
+    errno = EPROTO;
+    return -1;
+  }
+  if (read_bytes(conn, header, sizeof(header)) < 0)
+    return -1;
+  uint32_t width = ntohl(header[0]);
+  bool extended = (width & CYCLES_STATE_EXTENDED) != 0;
+  out->grid_width = width & ~CYCLES_STATE_EXTENDED;
+  out->grid_height = ntohl(header[1]);
+  out->player_count = ntohl(header[2]);
+  uint32_t rem = len - (uint32_t)sizeof(header);
+  // A full grid ends the packet, it is read straight into its storage below
+  uint64_t grid_sz =
+      extended ? 0 : (uint64_t)out->grid_width * out->grid_height;
+  if (grid_sz > rem) {
+    errno = EPROTO;
+    return -1;
+  }
+  rem -= (uint32_t)grid_sz;
+  if (reserve((void **)&buf->packet, &buf->packet_capacity, rem) < 0 ||
+      read_bytes(conn, buf->packet, rem) < 0)
+    return -1;
+  ulog_debug("recv_game_state_into: got %u bytes", len);
+  if (out->player_count > rem / CYCLES_MIN_PLAYER_BYTES) {
+    errno = EPROTO;
+    return -1;
+  }
+  size_t player_bytes = (size_t)buf->player_capacity * sizeof(cycles_player);
+  if (reserve((void **)&buf->players, &player_bytes,
+              (size_t)out->player_count * sizeof(cycles_player)) < 0)
+    return -1;
+  buf->player_capacity = (uint32_t)(player_bytes / sizeof(cycles_player));
+  out->players = buf->players;
+  const uint8_t *p = buf->packet;
+  for (uint32_t i = 0; i < out->player_count; ++i) {
+    cycles_player *player = &out->players[i];
+    uint8_t r, g, b, id;
+    uint32_t n;
+    if (rd_i32(&p, &rem, &player->x) < 0 || rd_i32(&p, &rem, &player->y) < 0 ||
+        rd_u8(&p, &rem, &r) < 0 || rd_u8(&p, &rem, &g) < 0 ||
+        rd_u8(&p, &rem, &b) < 0 || rd_u32(&p, &rem, &n) < 0)
+      return -1;
+    if (n >= rem) { // The id byte follows the name
+      errno = EPROTO;
+      return -1;
+    }
+    const uint8_t *name = p;
+    p += n;
+    rem -= n;
+    if (rd_u8(&p, &rem, &id) < 0 ||
+        intern_name(buf, id, name, n, &player->name) < 0)
+      return -1;
+    player->color = (cycles_rgb){r, g, b};
+    player->id = id;
+  }
+  if (rd_u32(&p, &rem, &out->frame_number) < 0)
+    return -1;
+  if (extended)
+    return rd_sections(&p, &rem, out, buf);
+  if (rem != 0) {
+    errno = EPROTO;
+    return -1;
+  }
+  if (reserve((void **)&buf->grid, &buf->grid_capacity, grid_sz) < 0 ||
+      read_bytes(conn, buf->grid, grid_sz) < 0)
+    return -1;
+  out->grid = buf->grid;
+  out->view_width = out->grid_width;
+  out->view_height = out->grid_height;
+  return 0;
+}
+
+// Fill buf from conn, leaving an empty state on failure
+static int recv_state(cycles_connection *conn, cycles_state_buffer *buf) {
+  // Fields of sections missing from this packet must not survive
+  memset(&buf->state, 0, sizeof(buf->state));
+  if (recv_state_into(conn, buf) < 0) {
+    memset(&buf->state, 0, sizeof(buf->state));
+    return -1;
+  }
+  return 0;
+}
+
+int cycles_recv_game_state_into(SOCKET sock, cycles_state_buffer *buf) {
+  if (!buf) {
+    errno = EINVAL;
+    return -1;
+  }
+  cycles_connection unbuffered = {.sock = sock};
+  return recv_state(&unbuffered, buf);
+}
+
+int cycles_recv_state(cycles_connection *conn, cycles_state_buffer *buf) {
+  if (!conn || !buf) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (!conn->read_buffer &&
+      reserve((void **)&conn->read_buffer, &conn->read_capacity,
+              CYCLES_READ_CHUNK) < 0)
+    return -1;
+  if (conn->latest_only) {
+#if defined(MSG_DONTWAIT)
+    // Errors show on the blocking read that follows
+    (void)read_available(conn);
+#endif
+    skip_stale_states(conn);
+  }
+  return recv_state(conn, buf);
+}
+
+int cycles_handle_io(cycles_connection *conn) {
+  if (!conn || !conn->nonblocking || !conn->read_buffer) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (conn->connecting) {
+    int rc = connect_finished(conn->sock);
+    if (rc <= 0)
+      return rc;
+    conn->connecting = false;
+    ulog_trace("Connected, sending player name: %s", conn->name);
+  }
+  if (flush_writes(conn) < 0)
+    return -1;
+  return read_available(conn);
+}
+
+int cycles_next_event(cycles_connection *conn, cycles_state_buffer *buf) {
+  if (!conn || !buf || !conn->nonblocking || !conn->read_buffer) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (conn->handshaking) {
+    if (conn->read_end - conn->read_start < CYCLES_COLOR_BYTES)
+      return cycles_event_none;
+    if (parse_color(conn->read_buffer + conn->read_start, &conn->color) < 0)
+      return -1;
+    conn->read_start += CYCLES_COLOR_BYTES;
+    conn->handshaking = false;
+    return cycles_event_connected;
+  }
+  if (conn->latest_only)
+    skip_stale_states(conn);
+  // Only parse complete packets, so recv_state() never reads the socket
+  size_t buffered = conn->read_end - conn->read_start;
+  if (buffered < 4)
+    return cycles_event_none;
+  uint32_t len = be32_at(conn->read_buffer + conn->read_start);
+  if (len > CYCLES_MAX_PACKET) {
+    errno = EPROTO;
+    return -1;
+  }
+  if (buffered - 4 < len)
+    return cycles_event_none;
+  if (recv_state(conn, buf) < 0)
+    return -1;
+  return cycles_event_state;
+}
+
+void cycles_set_latest_only(cycles_connection *conn, bool enable) {
+  if (conn)
+    conn->latest_only = enable;
+}
+
 int cycles_send_move_i32(cycles_connection *conn, int32_t dir) {
   ulog_trace("Sending move direction: %d", dir);
   if (!conn) {
     errno = EINVAL;
     return -1;
   }
-  return send_cycles_i32_packet(conn->sock, dir);
+  return send_cycles_i32_packet(conn, dir);
+}
+
+int cycles_request_viewport(cycles_connection *conn, uint32_t radius,
+                            uint32_t overview_factor) {
+  ulog_trace("Requesting viewport: radius %u overview %u", radius,
+             overview_factor);
+  if (!conn) {
+    errno = EINVAL;
+    return -1;
+  }
+  return send_cycles_option_packet(conn, CYCLES_OPTION_VIEWPORT, radius,
+                                   overview_factor);
+}
+
+int cycles_request_state_hash(cycles_connection *conn, bool enable) {
+  ulog_trace("Requesting state hash: %s", enable ? "on" : "off");
+  if (!conn) {
+    errno = EINVAL;
+    return -1;
+  }
+  return send_cycles_option_packet(conn, CYCLES_OPTION_STATE_HASH,
+                                   enable ? 1u : 0u, 0);
 }
@@ -0,0 +1,385 @@
+#include "c_bitboard.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CYCLES_BITBOARD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Initial entries of the region size list
+enum { CYCLES_MIN_COMPONENTS = 64 };
+
+static inline uint64_t *board_row(const cycles_bitboard *board, uint32_t y) {
+  return board->bits + (size_t)y * board->words;
+}
+
+void cycles_bitboard_init(cycles_bitboard *board) {
+  if (board)
+    memset(board, 0, sizeof(*board));
+}
+
+void cycles_bitboard_free(cycles_bitboard *board) {
+  if (!board)
+    return;
+  free(board->bits);
+  memset(board, 0, sizeof(*board));
+}
+
+int cycles_bitboard_resize(cycles_bitboard *board, uint32_t x, uint32_t y,
+                           uint32_t width, uint32_t height) {
+  if (!board) {
+    errno = EINVAL;
+    return -1;
+  }
+  uint32_t words = (uint32_t)(((uint64_t)width + 63) / 64);
+  size_t total = (size_t)words * height;
+  if (total > board->capacity) {
+    uint64_t *tmp = realloc(board->bits, total * sizeof(uint64_t));
+    if (!tmp) {
+      errno = ENOMEM;
+      return -1;
+    }
+    board->bits = tmp;
+    board->capacity = total;
+  }
+  if (total)
+    memset(board->bits, 0, total * sizeof(uint64_t));
+  board->x = x;
+  board->y = y;
+  board->width = width;
+  board->height = height;
+  board->words = words;
+  return 0;
+}
+
+// Packs one grid row into a cleared bitboard row
+typedef void (*PackRowFn)(const uint8_t *cells, uint32_t width, uint64_t *out);
+
+// Set the bits of the empty cells of one grid row in a cleared bitboard row
+static void pack_free_row(const uint8_t *cells, uint32_t width, uint64_t *out) {
+  uint32_t x = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 16 <= width; x += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(cells + x));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+    out[x / 64] |= (uint64_t)mask << (x % 64);
+  }
+#endif
+  for (; x < width; x++) {
+    out[x / 64] |= (uint64_t)(cells[x] == 0) << (x % 64);
+  }
+}
+
+#if defined(CYCLES_BITBOARD_AVX2)
+__attribute__((target("avx2"))) static void
+pack_free_row_avx2(const uint8_t *cells, uint32_t width, uint64_t *out) {
+  uint32_t x = 0;
+  const __m256i zero = _mm256_setzero_si256();
+  for (; x + 32 <= width; x += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(cells + x));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+    out[x / 64] |= (uint64_t)mask << (x % 64);
+  }
+  for (; x < width; x++) {
+    out[x / 64] |= (uint64_t)(cells[x] == 0) << (x % 64);
+  }
+}
+#endif
+
+// AVX2 when the CPU running the bot has it, whatever the build flags
+static PackRowFn best_pack_row(void) {
+#if defined(CYCLES_BITBOARD_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return pack_free_row_avx2;
+#endif
+  return pack_free_row;
+}
+
+int cycles_bitboard_from_state(cycles_bitboard *free_cells,
+                               const cycles_game_state *gs) {
+  if (!free_cells || !gs ||
+      ((size_t)gs->view_width * gs->view_height > 0 && !gs->grid)) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (cycles_bitboard_resize(free_cells, gs->view_x, gs->view_y,
+                             gs->view_width, gs->view_height) < 0)
+    return -1;
+  PackRowFn pack_row = best_pack_row();
+  for (uint32_t y = 0; y < gs->view_height; y++) {
+    pack_row(gs->grid + (size_t)y * gs->view_width, gs->view_width,
+                  board_row(free_cells, y));
+  }
+  return 0;
+}
+
+// Column and row of p in the window, false if p is outside
+static bool window_cell(const cycles_bitboard *board, cycles_vec2i p,
+                        uint32_t *col, uint32_t *row) {
+  int64_t cx = (int64_t)p.x - board->x;
+  int64_t cy = (int64_t)p.y - board->y;
+  if (cx < 0 || cy < 0 || cx >= board->width || cy >= board->height)
+    return false;
+  *col = (uint32_t)cx;
+  *row = (uint32_t)cy;
+  return true;
+}
+
+bool cycles_bitboard_get(const cycles_bitboard *board, cycles_vec2i p) {
+  uint32_t col, row;
+  if (!board || !window_cell(board, p, &col, &row))
+    return false;
+  return (board_row(board, row)[col / 64] >> (col % 64)) & 1;
+}
+
+void cycles_bitboard_set(cycles_bitboard *board, cycles_vec2i p, bool value) {
+  uint32_t col, row;
+  if (!board || !window_cell(board, p, &col, &row))
+    return;
+  uint64_t *word = &board_row(board, row)[col / 64];
+  uint64_t bit = (uint64_t)1 << (col % 64);
+  *word = value ? *word | bit : *word & ~bit;
+}
+
+uint32_t cycles_bitboard_count(const cycles_bitboard *board) {
+  if (!board)
+    return 0;
+  uint64_t count = 0;
+  size_t total = (size_t)board->words * board->height;
+  for (size_t i = 0; i < total; i++)
+    count += (uint64_t)__builtin_popcountll(board->bits[i]);
+  return (uint32_t)count;
+}
+
+static inline uint64_t reverse_bits(uint64_t v) {
+  v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+  v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+  v = ((v >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((v & 0x0F0F0F0F0F0F0F0Full) << 4);
+  return __builtin_bswap64(v);
+}
+
+// Extend the cells of row to the whole runs of free cells containing them.
+// Adding a seed to the run of set bits it sits in carries to the end of the
+// run, so f + s flips exactly the run above each seed. The same on
+// bit-reversed words fills towards lower columns.
+static void fill_row(uint64_t *row, const uint64_t *free_row, uint32_t words) {
+  uint64_t in = 0;
+  for (uint32_t i = 0; i < words; i++) {
+    uint64_t f = free_row[i];
+    uint64_t s = (row[i] | in) & f;
+    uint64_t up = (((f + s) ^ f) & f) | s;
+    row[i] = up;
+    in = up >> 63;
+  }
+  in = 0;
+  for (uint32_t i = words; i-- > 0;) {
+    uint64_t f = reverse_bits(free_row[i]);
+    uint64_t s = (reverse_bits(row[i]) | in) & f;
+    uint64_t down = (((f + s) ^ f) & f) | s;
+    row[i] = reverse_bits(down);
+    in = down >> 63;
+  }
+}
+
+// Add the free cells of row y next to row from, then fill along row y;
+// returns whether row y grew
+static bool grow_row(cycles_bitboard *reach, const cycles_bitboard *free_cells,
+                     uint32_t y, uint32_t from) {
+  uint64_t *row = board_row(reach, y);
+  const uint64_t *next = board_row(reach, from);
+  const uint64_t *free_row = board_row(free_cells, y);
+  bool grew = false;
+  for (uint32_t i = 0; i < reach->words; i++) {
+    uint64_t add = next[i] & free_row[i] & ~row[i];
+    row[i] |= add;
+    grew |= add != 0;
+  }
+  if (grew)
+    fill_row(row, free_row, reach->words);
+  return grew;
+}
+
+// Grow reach, whose set rows lie in [*lo, *hi] and are filled along the rows,
+// to every free cell connected to it. Sweeps alternate downwards and upwards
+// until one changes nothing, and only visit rows next to the set rows.
+static void flood_rows(const cycles_bitboard *free_cells,
+                       cycles_bitboard *reach, uint32_t *lo, uint32_t *hi) {
+  for (int pass = 0;; pass++) {
+    bool changed = false;
+    if (pass % 2 == 0) {
+      for (uint32_t y = *lo; y + 1 < reach->height && y <= *hi; y++) {
+        if (grow_row(reach, free_cells, y + 1, y)) {
+          changed = true;
+          if (y + 1 > *hi)
+            *hi = y + 1;
+        }
+      }
+    } else {
+      for (uint32_t y = *hi; y > 0 && y >= *lo; y--) {
+        if (grow_row(reach, free_cells, y - 1, y)) {
+          changed = true;
+          if (y - 1 < *lo)
+            *lo = y - 1;
+        }
+      }
+    }
+    if (!changed && pass > 0)
+      return;
+  }
+}
+
+int cycles_bitboard_reachable(const cycles_bitboard *free_cells,
+                              cycles_vec2i start, cycles_bitboard *reach) {
+  if (!free_cells || !reach || free_cells == reach) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (cycles_bitboard_resize(reach, free_cells->x, free_cells->y,
+                             free_cells->width, free_cells->height) < 0)
+    return -1;
+  const cycles_vec2i seeds[] = {start,
+                                {start.x, start.y - 1},
+                                {start.x + 1, start.y},
+                                {start.x, start.y + 1},
+                                {start.x - 1, start.y}};
+  uint32_t lo = reach->height, hi = 0;
+  for (size_t i = 0; i < sizeof(seeds) / sizeof(seeds[0]); i++) {
+    uint32_t col, row;
+    if (cycles_bitboard_get(free_cells, seeds[i]) &&
+        window_cell(reach, seeds[i], &col, &row)) {
+      cycles_bitboard_set(reach, seeds[i], true);
+      lo = row < lo ? row : lo;
+      hi = row > hi ? row : hi;
+    }
+  }
+  if (lo > hi)
+    return 0;
+  for (uint32_t y = lo; y <= hi; y++)
+    fill_row(board_row(reach, y), board_row(free_cells, y), reach->words);
+  flood_rows(free_cells, reach, &lo, &hi);
+  return 0;
+}
+
+void cycles_components_init(cycles_components *components) {
+  if (!components)
+    return;
+  memset(components, 0, sizeof(*components));
+  cycles_bitboard_init(&components->left);
+  cycles_bitboard_init(&components->part);
+}
+
+void cycles_components_free(cycles_components *components) {
+  if (!components)
+    return;
+  free(components->labels);
+  free(components->sizes);
+  cycles_bitboard_free(&components->left);
+  cycles_bitboard_free(&components->part);
+  memset(components, 0, sizeof(*components));
+}
+
+static int push_size(cycles_components *components, uint32_t size) {
+  if (components->count == components->size_capacity) {
+    uint32_t grown = components->size_capacity
+                         ? 2 * components->size_capacity
+                         : (uint32_t)CYCLES_MIN_COMPONENTS;
+    uint32_t *tmp = realloc(components->sizes, grown * sizeof(uint32_t));
+    if (!tmp) {
+      errno = ENOMEM;
+      return -1;
+    }
+    components->sizes = tmp;
+    components->size_capacity = grown;
+  }
+  components->sizes[components->count++] = size;
+  return 0;
+}
+
+// Label the cells of part as region id, remove them from left and clear part
+static uint32_t take_region(cycles_components *components, uint32_t lo,
+                            uint32_t hi, uint32_t id) {
+  cycles_bitboard *left = &components->left, *part = &components->part;
+  uint32_t size = 0;
+  for (uint32_t y = lo; y <= hi; y++) {
+    uint64_t *row = board_row(part, y), *left_row = board_row(left, y);
+    uint32_t *labels = components->labels + (size_t)y * components->width;
+    for (uint32_t i = 0; i < part->words; i++) {
+      uint64_t bits = row[i];
+      left_row[i] &= ~bits;
+      size += (uint32_t)__builtin_popcountll(bits);
+      for (; bits; bits &= bits - 1)
+        labels[i * 64 + (uint32_t)__builtin_ctzll(bits)] = id;
+      row[i] = 0;
+    }
+  }
+  return size;
+}
+
+int cycles_bitboard_components(const cycles_bitboard *free_cells,
+                               cycles_components *components) {
+  if (!free_cells || !components) {
+    errno = EINVAL;
+    return -1;
+  }
+  size_t cells = (size_t)free_cells->width * free_cells->height;
+  if (cells > components->label_capacity) {
+    uint32_t *tmp = realloc(components->labels, cells * sizeof(uint32_t));
+    if (!tmp) {
+      errno = ENOMEM;
+      return -1;
+    }
+    components->labels = tmp;
+    components->label_capacity = cells;
+  }
+  cycles_bitboard *left = &components->left, *part = &components->part;
+  if (cycles_bitboard_resize(left, free_cells->x, free_cells->y,
+                             free_cells->width, free_cells->height) < 0 ||
+      cycles_bitboard_resize(part, free_cells->x, free_cells->y,
+                             free_cells->width, free_cells->height) < 0)
+    return -1;
+  if (cells) {
+    memset(components->labels, 0, cells * sizeof(uint32_t));
+    memcpy(left->bits, free_cells->bits,
+           (size_t)left->words * left->height * sizeof(uint64_t));
+  }
+  components->x = free_cells->x;
+  components->y = free_cells->y;
+  components->width = free_cells->width;
+  components->height = free_cells->height;
+  components->count = 0;
+  // Each region grows from the first cell not labelled yet, within the cells
+  // left, so it never leaks into a region labelled before
+  for (uint32_t y = 0; y < left->height; y++) {
+    const uint64_t *left_row = board_row(left, y);
+    for (uint32_t i = 0; i < left->words; i++) {
+      while (left_row[i]) {
+        uint64_t *row = board_row(part, y);
+        row[i] = left_row[i] & -left_row[i];
+        fill_row(row, left_row, part->words);
+        uint32_t lo = y, hi = y;
+        flood_rows(left, part, &lo, &hi);
+        uint32_t size = take_region(components, lo, hi, components->count + 1);
+        if (push_size(components, size) < 0)
+          return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+uint32_t cycles_component_at(const cycles_components *components,
+                             cycles_vec2i p) {
+  if (!components || !components->labels)
+    return 0;
+  int64_t cx = (int64_t)p.x - components->x;
+  int64_t cy = (int64_t)p.y - components->y;
+  if (cx < 0 || cy < 0 || cx >= components->width ||
+      cy >= components->height)
+    return 0;
+  return components->labels[(size_t)cy * components->width + (size_t)cx];
+}
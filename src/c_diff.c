@@ -0,0 +1,312 @@
+#include "c_diff.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Initial entries of a change list
+enum { CYCLES_DIFF_MIN_CHANGES = 64 };
+
+void cycles_frame_diff_init(cycles_frame_diff *diff) {
+  if (diff)
+    memset(diff, 0, sizeof(*diff));
+}
+
+void cycles_frame_diff_free(cycles_frame_diff *diff) {
+  if (!diff)
+    return;
+  free(diff->occupied);
+  free(diff->freed);
+  free(diff->grid);
+  free(diff->scratch);
+  memset(diff, 0, sizeof(*diff));
+}
+
+// Index of the first byte at or after i where a and b may differ, in steps
+// of whole blocks; n if all remaining blocks are equal
+#if defined(__SSE2__)
+static size_t skip_equal(const uint8_t *a, const uint8_t *b, size_t i,
+                         size_t n) {
+  // Most of the board is unchanged, so test 64 bytes per branch
+  for (; i + 64 <= n; i += 64) {
+    __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                _mm_loadu_si128((const __m128i *)(b + i)));
+    __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 16)),
+                                _mm_loadu_si128((const __m128i *)(b + i + 16)));
+    __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 32)),
+                                _mm_loadu_si128((const __m128i *)(b + i + 32)));
+    __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 48)),
+                                _mm_loadu_si128((const __m128i *)(b + i + 48)));
+    __m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+    if (_mm_movemask_epi8(all) != 0xFFFF)
+      break;
+  }
+  for (; i + 16 <= n; i += 16) {
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                _mm_loadu_si128((const __m128i *)(b + i)));
+    unsigned mask = ~(unsigned)_mm_movemask_epi8(eq) & 0xFFFF;
+    if (mask)
+      return i + (size_t)__builtin_ctz(mask);
+  }
+  return i;
+}
+#elif defined(__aarch64__)
+static size_t skip_equal(const uint8_t *a, const uint8_t *b, size_t i,
+                         size_t n) {
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    if (vminvq_u8(eq) != 0xFF)
+      break;
+  }
+  return i;
+}
+#else
+static size_t skip_equal(const uint8_t *a, const uint8_t *b, size_t i,
+                         size_t n) {
+  for (; i + 8 <= n; i += 8) {
+    uint64_t wa, wb;
+    memcpy(&wa, a + i, 8);
+    memcpy(&wb, b + i, 8);
+    if (wa != wb)
+      break;
+  }
+  return i;
+}
+#endif
+
+// Index of the first byte at or after i where a and b differ, or n
+static size_t next_change(const uint8_t *a, const uint8_t *b, size_t i,
+                          size_t n) {
+  i = skip_equal(a, b, i, n);
+  while (i < n && a[i] == b[i])
+    i++;
+  return i;
+}
+
+static int push_change(cycles_cell_change **list, uint32_t *count,
+                       uint32_t *capacity, cycles_cell_change change) {
+  if (*count == *capacity) {
+    uint32_t grown =
+        *capacity ? 2 * *capacity : (uint32_t)CYCLES_DIFF_MIN_CHANGES;
+    cycles_cell_change *tmp = realloc(*list, grown * sizeof(**list));
+    if (!tmp) {
+      errno = ENOMEM;
+      return -1;
+    }
+    *list = tmp;
+    *capacity = grown;
+  }
+  (*list)[(*count)++] = change;
+  return 0;
+}
+
+// Whether the stored grid belongs to a board of the size of gs
+static bool same_board(const cycles_frame_diff *diff,
+                       const cycles_game_state *gs) {
+  return diff->has_grid && diff->grid_width == gs->grid_width &&
+         diff->grid_height == gs->grid_height;
+}
+
+// Cells of a view window, in board coordinates
+typedef struct {
+  uint32_t x0, y0, x1, y1;
+} cycles_diff_rect;
+
+static cycles_diff_rect view_rect(uint32_t x, uint32_t y, uint32_t width,
+                                  uint32_t height) {
+  return (cycles_diff_rect){x, y, x + width, y + height};
+}
+
+static bool rect_contains(cycles_diff_rect r, uint32_t x, uint32_t y) {
+  return x >= r.x0 && x < r.x1 && y >= r.y0 && y < r.y1;
+}
+
+// Report the occupied cells of row y, columns [from, to), as scrolled out
+static int report_scrolled_out(cycles_frame_diff *diff, const uint8_t *row,
+                               uint32_t y, uint32_t from, uint32_t to) {
+  for (uint32_t x = from; x < to; x++) {
+    if (!row[x - diff->view_x])
+      continue;
+    cycles_cell_change change = {
+        .x = (int32_t)x, .y = (int32_t)y, .owner = row[x - diff->view_x],
+        .scrolled = true};
+    if (push_change(&diff->freed, &diff->freed_count, &diff->freed_capacity,
+                    change) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Move the stored grid to the window of gs. Occupied cells that leave the
+// window are reported as freed, cells that enter it start out empty, so the
+// comparison that follows reports them as occupied. Returns the overlap of
+// both windows in *overlap.
+static int move_window(cycles_frame_diff *diff, const cycles_game_state *gs,
+                       size_t cells, cycles_diff_rect *overlap) {
+  if (cells > diff->scratch_capacity) {
+    uint8_t *tmp = realloc(diff->scratch, cells);
+    if (!tmp) {
+      errno = ENOMEM;
+      return -1;
+    }
+    diff->scratch = tmp;
+    diff->scratch_capacity = cells;
+  }
+  cycles_diff_rect old = view_rect(diff->view_x, diff->view_y,
+                                   diff->view_width, diff->view_height);
+  cycles_diff_rect cur = view_rect(gs->view_x, gs->view_y, gs->view_width,
+                                   gs->view_height);
+  cycles_diff_rect both = {
+      old.x0 > cur.x0 ? old.x0 : cur.x0, old.y0 > cur.y0 ? old.y0 : cur.y0,
+      old.x1 < cur.x1 ? old.x1 : cur.x1, old.y1 < cur.y1 ? old.y1 : cur.y1};
+  if (both.x0 >= both.x1 || both.y0 >= both.y1)
+    both = (cycles_diff_rect){0, 0, 0, 0};
+
+  for (uint32_t y = old.y0; y < old.y1; y++) {
+    const uint8_t *row = diff->grid + (size_t)(y - old.y0) * diff->view_width;
+    bool kept = y >= both.y0 && y < both.y1;
+    if (!kept ? report_scrolled_out(diff, row, y, old.x0, old.x1) < 0
+              : report_scrolled_out(diff, row, y, old.x0, both.x0) < 0 ||
+                    report_scrolled_out(diff, row, y, both.x1, old.x1) < 0)
+      return -1;
+  }
+
+  memset(diff->scratch, 0, cells);
+  for (uint32_t y = both.y0; y < both.y1; y++) {
+    memcpy(diff->scratch + (size_t)(y - cur.y0) * gs->view_width +
+               (both.x0 - cur.x0),
+           diff->grid + (size_t)(y - old.y0) * diff->view_width +
+               (both.x0 - old.x0),
+           both.x1 - both.x0);
+  }
+  uint8_t *grid = diff->grid;
+  size_t capacity = diff->grid_capacity;
+  diff->grid = diff->scratch;
+  diff->grid_capacity = diff->scratch_capacity;
+  diff->scratch = grid;
+  diff->scratch_capacity = capacity;
+  diff->view_x = gs->view_x;
+  diff->view_y = gs->view_y;
+  diff->view_width = gs->view_width;
+  diff->view_height = gs->view_height;
+  *overlap = both;
+  return 0;
+}
+
+// Start over from an empty grid covering the window of gs
+static int reset_grid(cycles_frame_diff *diff, const cycles_game_state *gs,
+                      size_t cells) {
+  if (cells > diff->grid_capacity) {
+    uint8_t *tmp = realloc(diff->grid, cells);
+    if (!tmp) {
+      errno = ENOMEM;
+      return -1;
+    }
+    diff->grid = tmp;
+    diff->grid_capacity = cells;
+  }
+  memset(diff->grid, 0, cells);
+  diff->grid_width = gs->grid_width;
+  diff->grid_height = gs->grid_height;
+  diff->view_x = gs->view_x;
+  diff->view_y = gs->view_y;
+  diff->view_width = gs->view_width;
+  diff->view_height = gs->view_height;
+  diff->has_grid = true;
+  return 0;
+}
+
+static void diff_heads(cycles_frame_diff *diff, const cycles_game_state *gs) {
+  bool seen[256] = {false};
+  diff->move_count = 0;
+  for (uint32_t i = 0; i < gs->player_count; i++) {
+    const cycles_player *p = &gs->players[i];
+    cycles_vec2i to = {p->x, p->y};
+    cycles_head_move *move = &diff->moves[diff->move_count++];
+    move->id = p->id;
+    move->to = to;
+    move->appeared = !diff->present[p->id];
+    move->from = move->appeared ? to : diff->heads[p->id];
+    diff->heads[p->id] = to;
+    seen[p->id] = true;
+  }
+  diff->gone_count = 0;
+  for (uint32_t id = 0; id < 256; id++) {
+    if (diff->present[id] && !seen[id])
+      diff->gone[diff->gone_count++] = (uint8_t)id;
+    diff->present[id] = seen[id];
+  }
+}
+
+int cycles_frame_diff_update(cycles_frame_diff *diff,
+                             const cycles_game_state *gs) {
+  if (!diff || !gs || gs->player_count > 256 ||
+      (gs->player_count && !gs->players)) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (uint32_t i = 0; i < gs->player_count; i++) {
+    if (gs->players[i].id > 255) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  size_t cells = (size_t)gs->view_width * gs->view_height;
+  if (cells && !gs->grid) {
+    errno = EINVAL;
+    return -1;
+  }
+  diff->occupied_count = 0;
+  diff->freed_count = 0;
+  diff->reset = !same_board(diff, gs);
+  cycles_diff_rect overlap = view_rect(gs->view_x, gs->view_y, gs->view_width,
+                                       gs->view_height);
+  if (diff->reset) {
+    if (reset_grid(diff, gs, cells) < 0) {
+      diff->has_grid = false;
+      return -1;
+    }
+  } else if ((diff->view_x != gs->view_x || diff->view_y != gs->view_y ||
+              diff->view_width != gs->view_width ||
+              diff->view_height != gs->view_height) &&
+             move_window(diff, gs, cells, &overlap) < 0) {
+    diff->has_grid = false;
+    return -1;
+  }
+
+  // The stored grid catches up cell by cell, so it is never copied whole
+  uint8_t *prev = diff->grid;
+  const uint8_t *next = gs->grid;
+  for (size_t i = next_change(prev, next, 0, cells); i < cells;
+       i = next_change(prev, next, i + 1, cells)) {
+    cycles_cell_change change = {
+        .x = (int32_t)(gs->view_x + i % gs->view_width),
+        .y = (int32_t)(gs->view_y + i / gs->view_width),
+    };
+    if (prev[i]) {
+      change.owner = prev[i];
+      if (push_change(&diff->freed, &diff->freed_count, &diff->freed_capacity,
+                      change) < 0) {
+        diff->has_grid = false;
+        return -1;
+      }
+    }
+    if (next[i]) {
+      change.owner = next[i];
+      change.scrolled = !rect_contains(overlap, (uint32_t)change.x,
+                                       (uint32_t)change.y);
+      if (push_change(&diff->occupied, &diff->occupied_count,
+                      &diff->occupied_capacity, change) < 0) {
+        diff->has_grid = false;
+        return -1;
+      }
+    }
+    prev[i] = next[i];
+  }
+  diff_heads(diff, gs);
+  return 0;
+}
@@ -0,0 +1,344 @@
+#include "c_territory.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Nearest heads kept per cell. Three are enough to tell, with any one player
+// left out, whether the best of the others is alone or tied.
+enum { LABELS = 3 };
+
+// Cells are stored row by row with a border of blocked cells around the
+// window, so neighbours are found without bounds checks
+static inline uint32_t stride(const cycles_territory *t) {
+  return t->width + 2;
+}
+
+void cycles_territory_init(cycles_territory *territory) {
+  if (territory)
+    memset(territory, 0, sizeof(*territory));
+}
+
+void cycles_territory_free(cycles_territory *territory) {
+  if (!territory)
+    return;
+  free(territory->owner);
+  free(territory->blocked);
+  free(territory->label_dist);
+  free(territory->label_id);
+  free(territory->label_count);
+  free(territory->queue);
+  free(territory->query_dist);
+  free(territory->new_mark);
+  free(territory->old_mark);
+  memset(territory, 0, sizeof(*territory));
+}
+
+static int grow(void **data, size_t bytes) {
+  void *tmp = realloc(*data, bytes ? bytes : 1);
+  if (!tmp) {
+    errno = ENOMEM;
+    return -1;
+  }
+  *data = tmp;
+  return 0;
+}
+
+static int reserve_cells(cycles_territory *t, size_t cells) {
+  if (cells <= t->capacity && t->owner)
+    return 0;
+  if (grow((void **)&t->owner, cells * sizeof(uint16_t)) < 0 ||
+      grow((void **)&t->blocked, cells) < 0 ||
+      grow((void **)&t->label_dist, cells * LABELS * sizeof(uint32_t)) < 0 ||
+      grow((void **)&t->label_id, cells * LABELS) < 0 ||
+      grow((void **)&t->label_count, cells) < 0 ||
+      grow((void **)&t->queue, cells * LABELS * sizeof(uint32_t)) < 0 ||
+      grow((void **)&t->query_dist, cells * sizeof(uint32_t)) < 0 ||
+      grow((void **)&t->new_mark, cells * sizeof(uint32_t)) < 0 ||
+      grow((void **)&t->old_mark, cells * sizeof(uint32_t)) < 0)
+    return -1;
+  t->capacity = cells;
+  return 0;
+}
+
+// Index of p in the window, false if p is outside
+static bool window_index(const cycles_territory *t, cycles_vec2i p,
+                         uint32_t *index) {
+  int64_t cx = (int64_t)p.x - t->x;
+  int64_t cy = (int64_t)p.y - t->y;
+  if (cx < 0 || cy < 0 || cx >= t->width || cy >= t->height)
+    return false;
+  *index = ((uint32_t)cy + 1) * stride(t) + (uint32_t)cx + 1;
+  return true;
+}
+
+// Free neighbours of cell v, returns how many were written to out
+static int free_neighbours(const cycles_territory *t, uint32_t v,
+                           uint32_t out[4]) {
+  const uint32_t candidates[4] = {v - stride(t), v + 1, v + stride(t), v - 1};
+  int count = 0;
+  for (int k = 0; k < 4; k++) {
+    if (!t->blocked[candidates[k]])
+      out[count++] = candidates[k];
+  }
+  return count;
+}
+
+static void count_owner(cycles_territory_counts *counts, uint16_t owner,
+                        int delta) {
+  if (owner == CYCLES_TERRITORY_CONTESTED)
+    counts->contested += (uint32_t)delta;
+  else if (owner != 0)
+    counts->owned[owner] += (uint32_t)delta;
+}
+
+int cycles_territory_update(cycles_territory *territory,
+                            const cycles_game_state *gs) {
+  if (!territory || !gs || gs->player_count > 256 ||
+      (gs->player_count && !gs->players)) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (uint32_t i = 0; i < gs->player_count; i++) {
+    if (gs->players[i].id > 255) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  size_t cells = ((size_t)gs->view_width + 2) * ((size_t)gs->view_height + 2);
+  if ((gs->view_width && gs->view_height && !gs->grid) ||
+      cells * LABELS > UINT32_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+  cycles_territory *t = territory;
+  if (reserve_cells(t, cells) < 0)
+    return -1;
+  t->x = gs->view_x;
+  t->y = gs->view_y;
+  t->width = gs->view_width;
+  t->height = gs->view_height;
+  memset(t->blocked, 1, cells);
+  for (uint32_t y = 0; y < t->height; y++) {
+    memcpy(t->blocked + (y + 1) * stride(t) + 1,
+           gs->grid + (size_t)y * t->width, t->width);
+  }
+  memset(t->label_count, 0, cells);
+  memset(t->owner, 0, cells * sizeof(uint16_t));
+  memset(t->new_mark, 0, cells * sizeof(uint32_t));
+  memset(t->old_mark, 0, cells * sizeof(uint32_t));
+  memset(&t->counts, 0, sizeof(t->counts));
+  memset(t->present, 0, sizeof(t->present));
+  t->query = 0;
+
+  // Every head starts at distance 0 from its own cell. Queue entries are
+  // labels (cell * LABELS + slot), and are queued in order of distance.
+  uint32_t head = 0, tail = 0;
+  for (uint32_t i = 0; i < gs->player_count; i++) {
+    const cycles_player *p = &gs->players[i];
+    cycles_vec2i pos = {p->x, p->y};
+    t->heads[p->id] = pos;
+    t->present[p->id] = true;
+    uint32_t v;
+    if (!window_index(t, pos, &v) || t->label_count[v])
+      continue;
+    t->label_dist[v * LABELS] = 0;
+    t->label_id[v * LABELS] = (uint8_t)p->id;
+    t->label_count[v] = 1;
+    t->queue[tail++] = v * LABELS;
+  }
+  // Byte stores may alias the territory, keep the arrays in locals
+  const uint8_t *blocked = t->blocked;
+  uint32_t *label_dist = t->label_dist, *queue = t->queue;
+  uint8_t *label_id = t->label_id, *label_count = t->label_count;
+  while (head < tail) {
+    uint32_t label = queue[head++];
+    uint32_t v = label / LABELS, d = label_dist[label] + 1;
+    uint8_t id = label_id[label];
+    const uint32_t next[4] = {v - stride(t), v + 1, v + stride(t), v - 1};
+    for (int k = 0; k < 4; k++) {
+      uint32_t n = next[k];
+      uint8_t known = label_count[n];
+      if (blocked[n] || known == LABELS)
+        continue;
+      bool seen = false;
+      for (uint8_t j = 0; j < known && !seen; j++)
+        seen = label_id[n * LABELS + j] == id;
+      if (seen)
+        continue;
+      label_dist[n * LABELS + known] = d;
+      label_id[n * LABELS + known] = id;
+      label_count[n] = known + 1;
+      queue[tail++] = n * LABELS + known;
+    }
+  }
+  for (size_t v = stride(t); v < cells - stride(t); v++) {
+    if (t->blocked[v] || !t->label_count[v])
+      continue;
+    const uint32_t *dist = &t->label_dist[v * LABELS];
+    bool tied = t->label_count[v] > 1 && dist[1] == dist[0];
+    t->owner[v] = tied ? CYCLES_TERRITORY_CONTESTED : t->label_id[v * LABELS];
+    count_owner(&t->counts, t->owner[v], 1);
+  }
+  return 0;
+}
+
+uint16_t cycles_territory_owner(const cycles_territory *territory,
+                                cycles_vec2i p) {
+  uint32_t v;
+  if (!territory || !territory->owner || !window_index(territory, p, &v))
+    return 0;
+  return territory->owner[v];
+}
+
+uint32_t cycles_territory_distance(const cycles_territory *territory,
+                                   cycles_vec2i p) {
+  uint32_t v;
+  if (!territory || !territory->label_count ||
+      !window_index(territory, p, &v) || !territory->label_count[v])
+    return CYCLES_TERRITORY_UNREACHED;
+  return territory->label_dist[v * LABELS];
+}
+
+// Nearest of the heads other than id at cell v, and the distance of the next
+// one after it
+static void others_nearest(const cycles_territory *t, uint32_t v, uint8_t id,
+                           uint32_t *best, uint8_t *best_id,
+                           uint32_t *second) {
+  *best = *second = CYCLES_TERRITORY_UNREACHED;
+  *best_id = 0;
+  bool found = false;
+  for (uint8_t j = 0; j < t->label_count[v]; j++) {
+    if (t->label_id[v * LABELS + j] == id)
+      continue;
+    if (!found) {
+      *best = t->label_dist[v * LABELS + j];
+      *best_id = t->label_id[v * LABELS + j];
+      found = true;
+    } else {
+      *second = t->label_dist[v * LABELS + j];
+      return;
+    }
+  }
+}
+
+// Whether id is among the heads nearest to cell v
+static bool owns_or_shares(const cycles_territory *t, uint32_t v, uint8_t id) {
+  for (uint8_t j = 0; j < t->label_count[v]; j++) {
+    if (t->label_dist[v * LABELS + j] != t->label_dist[v * LABELS])
+      return false;
+    if (t->label_id[v * LABELS + j] == id)
+      return true;
+  }
+  return false;
+}
+
+// Move the count of cell v from its current owner to its owner after the move
+static void recount(const cycles_territory *t, uint32_t v, uint8_t id,
+                    cycles_territory_counts *out) {
+  uint32_t best, second;
+  uint8_t best_id;
+  others_nearest(t, v, id, &best, &best_id, &second);
+  uint32_t mine = t->new_mark[v] == t->query ? t->query_dist[v]
+                                             : CYCLES_TERRITORY_UNREACHED;
+  uint16_t owner = 0;
+  if (mine < best)
+    owner = id;
+  else if (mine == best && mine != CYCLES_TERRITORY_UNREACHED)
+    owner = CYCLES_TERRITORY_CONTESTED;
+  else if (best != CYCLES_TERRITORY_UNREACHED)
+    owner = second == best ? CYCLES_TERRITORY_CONTESTED : best_id;
+  count_owner(out, t->owner[v], -1);
+  count_owner(out, owner, 1);
+}
+
+static cycles_vec2i step(cycles_vec2i p, cycles_direction dir) {
+  switch (dir) {
+  case cycles_north:
+    return (cycles_vec2i){p.x, p.y - 1};
+  case cycles_east:
+    return (cycles_vec2i){p.x + 1, p.y};
+  case cycles_south:
+    return (cycles_vec2i){p.x, p.y + 1};
+  case cycles_west:
+    return (cycles_vec2i){p.x - 1, p.y};
+  }
+  return p;
+}
+
+// Start a query, so the marks of earlier queries no longer match
+static void next_query(cycles_territory *t) {
+  if (++t->query == 0) {
+    size_t cells = (size_t)stride(t) * (t->height + 2);
+    memset(t->new_mark, 0, cells * sizeof(uint32_t));
+    memset(t->old_mark, 0, cells * sizeof(uint32_t));
+    t->query = 1;
+  }
+}
+
+int cycles_territory_evaluate_move(cycles_territory *territory,
+                                   uint32_t player_id, cycles_direction dir,
+                                   cycles_territory_counts *out) {
+  cycles_territory *t = territory;
+  uint32_t from;
+  if (!t || !out || player_id > 255 || !t->present[player_id] ||
+      !window_index(t, t->heads[player_id], &from)) {
+    errno = EINVAL;
+    return -1;
+  }
+  uint8_t id = (uint8_t)player_id;
+  *out = t->counts;
+  next_query(t);
+  uint32_t to = 0;
+  bool moved = window_index(t, step(t->heads[player_id], dir), &to) &&
+               !t->blocked[to];
+
+  // The new head blocks its cell. Search from it, but only into cells this
+  // player reaches no later than everybody else.
+  uint32_t reached = 0;
+  if (moved) {
+    count_owner(out, t->owner[to], -1);
+    t->query_dist[to] = 0;
+    uint32_t head = 0;
+    t->queue[reached++] = to;
+    while (head < reached) {
+      uint32_t v = t->queue[head++], d = t->query_dist[v] + 1;
+      uint32_t next[4];
+      int count = free_neighbours(t, v, next);
+      for (int k = 0; k < count; k++) {
+        uint32_t n = next[k], best, second;
+        uint8_t best_id;
+        if (n == to || t->new_mark[n] == t->query)
+          continue;
+        others_nearest(t, n, id, &best, &best_id, &second);
+        if (d > best)
+          continue;
+        t->new_mark[n] = t->query;
+        t->query_dist[n] = d;
+        t->queue[reached++] = n;
+      }
+    }
+    for (uint32_t i = 1; i < reached; i++)
+      recount(t, t->queue[i], id, out);
+  }
+
+  // The region held before the move, where the player may lose cells. It is
+  // connected to the old head through cells the player also held.
+  uint32_t head = 0, tail = 0;
+  t->queue[tail++] = from;
+  while (head < tail) {
+    uint32_t v = t->queue[head++];
+    uint32_t next[4];
+    int count = free_neighbours(t, v, next);
+    for (int k = 0; k < count; k++) {
+      uint32_t n = next[k];
+      if (t->old_mark[n] == t->query || !owns_or_shares(t, n, id))
+        continue;
+      t->old_mark[n] = t->query;
+      t->queue[tail++] = n;
+      // The new head was counted above, and the new region as it was found
+      if (t->new_mark[n] != t->query && !(moved && n == to))
+        recount(t, n, id, out);
+    }
+  }
+  return 0;
+}
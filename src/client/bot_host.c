@@ -0,0 +1,597 @@
+#include "bot_host.h"
+#include "c_utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ulog.h>
+#include <unistd.h>
+
+enum {
+  POLL_TIMEOUT_MS = 100, /* Longest wait before checking for a stop */
+  MIN_SAMPLES = 256,     /* Initial latency samples per bot */
+  MAX_PORTS = 64,        /* Servers the bots can be spread over */
+  MAX_CONNECTING = 32    /* Handshakes in flight, servers accept serially */
+};
+
+// While a bot is busy, a worker owns its connection and the network thread
+// leaves it alone. The worker's writes are published by clearing busy.
+typedef struct {
+  cycles_connection conn;   /* Non-blocking connection */
+  cycles_state_buffer buf;  /* Last received state */
+  void *storage;            /* Strategy storage */
+  uint64_t received_ns;     /* When the network thread last read data */
+  atomic_bool busy;         /* Queued or being played by a worker */
+  atomic_bool connected;    /* Handshake finished */
+  bool open;                /* Connection not closed yet */
+  bool failed;              /* Connection failed */
+  bool gone;                /* Player missing from the last state */
+  uint32_t *samples;        /* Move latencies in microseconds */
+  uint32_t sample_count;    /* Entries in samples */
+  uint32_t sample_capacity; /* Entries allocated in samples */
+} Bot;
+
+struct BotHost {
+  BotHostConfig config;
+  char *port_list;        /* Copy of config.port split in place */
+  char *ports[MAX_PORTS]; /* Servers, bots are spread round-robin */
+  uint32_t port_count;    /* Entries in ports */
+  Bot *bots;
+  uint32_t bot_count;
+  uint32_t next_bot;      /* First bot not connecting yet */
+  uint32_t open_count;    /* Bots whose connection is open */
+  struct pollfd *fds;     /* Poll set, rebuilt every round */
+  uint32_t *fd_bots;      /* Bot of each entry in fds */
+  int wake[2];            /* Pipe waking the network thread */
+  atomic_bool stopping;
+
+  pthread_t *workers;       /* Parse states and compute the moves */
+  uint32_t worker_count;    /* Entries in workers */
+  pthread_mutex_t mutex;    /* Protects the fields below */
+  pthread_cond_t work_cond; /* Signalled when a bot is queued */
+  pthread_cond_t idle_cond; /* Signalled when no bot is busy any more */
+  uint32_t *queue;          /* Ring of bots waiting for a worker */
+  uint32_t queue_head;      /* Next entry of queue to play */
+  uint32_t queue_count;     /* Entries in queue */
+  uint32_t busy_count;      /* Bots queued or being played */
+  bool quitting;            /* Set when the workers must exit */
+};
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Built-in strategies */
+
+typedef struct {
+  uint64_t rng;
+  cycles_direction previous;
+  int inertia; /* Weight of keeping the previous direction */
+} RandomBot;
+
+static void random_init(void *bot, uint64_t seed) {
+  RandomBot *r = (RandomBot *)bot;
+  r->rng = seed;
+  r->previous = cycles_north;
+  r->inertia = rand_int_inclusive(&r->rng, 50);
+}
+
+static cycles_direction random_decide(void *bot, const cycles_game_state *gs,
+                                      const cycles_player *me) {
+  RandomBot *r = (RandomBot *)bot;
+  cycles_vec2i pos = {me->x, me->y};
+  int proposal = rand_int_inclusive(&r->rng, NUM_DIRECTIONS - 1 + r->inertia);
+  if (proposal >= NUM_DIRECTIONS &&
+      cycles_is_valid_move(gs, pos, r->previous)) {
+    return r->previous;
+  }
+  // Otherwise a uniform pick among the valid directions, if any
+  cycles_direction valid[NUM_DIRECTIONS];
+  int count = 0;
+  for (int d = 0; d < NUM_DIRECTIONS; d++) {
+    cycles_direction dir = cycles_get_direction_from_value(d);
+    if (cycles_is_valid_move(gs, pos, dir)) {
+      valid[count++] = dir;
+    }
+  }
+  if (count > 0) {
+    r->previous = valid[rand_int_inclusive(&r->rng, count - 1)];
+  }
+  return r->previous;
+}
+
+static cycles_direction north_decide(void *bot, const cycles_game_state *gs,
+                                     const cycles_player *me) {
+  (void)bot;
+  (void)gs;
+  (void)me;
+  return cycles_north;
+}
+
+static const BotStrategy strategies[] = {
+    {"random", sizeof(RandomBot), random_init, random_decide},
+    {"north", 0, NULL, north_decide},
+};
+
+const BotStrategy *bot_strategy_find(const char *name) {
+  if (!name) {
+    return NULL;
+  }
+  for (size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++) {
+    if (strcmp(strategies[i].name, name) == 0) {
+      return &strategies[i];
+    }
+  }
+  return NULL;
+}
+
+/* Host */
+
+static void close_bot(BotHost *host, Bot *bot) {
+  if (bot->open) {
+    cycles_disconnect(&bot->conn);
+    bot->open = false;
+    host->open_count--;
+  }
+}
+
+// Split a comma separated port list, returns the number of ports
+static uint32_t split_ports(char *list, char *ports[MAX_PORTS]) {
+  uint32_t count = 0;
+  for (char *save = NULL, *port = strtok_r(list, ",", &save);
+       port && count < MAX_PORTS; port = strtok_r(NULL, ",", &save)) {
+    ports[count++] = port;
+  }
+  return count;
+}
+
+static void record_latency(Bot *bot, uint64_t ns) {
+  if (bot->sample_count == bot->sample_capacity) {
+    uint32_t grown = bot->sample_capacity ? 2 * bot->sample_capacity
+                                          : (uint32_t)MIN_SAMPLES;
+    uint32_t *samples = realloc(bot->samples, grown * sizeof(uint32_t));
+    if (!samples) {
+      return;
+    }
+    bot->samples = samples;
+    bot->sample_capacity = grown;
+  }
+  uint64_t us = ns / 1000;
+  bot->samples[bot->sample_count++] = us > UINT32_MAX ? UINT32_MAX : us;
+}
+
+static const cycles_player *find_player(const cycles_game_state *gs,
+                                        const char *name) {
+  for (uint32_t i = 0; i < gs->player_count; i++) {
+    if (strcmp(gs->players[i].name, name) == 0) {
+      return &gs->players[i];
+    }
+  }
+  return NULL;
+}
+
+// Parse what one bot received and answer its latest state. Runs on a worker
+// and only touches this bot, so bots never wait for each other.
+static void play_bot(BotHost *host, Bot *bot) {
+  bool ready = false;
+  int event;
+  while ((event = cycles_next_event(&bot->conn, &bot->buf)) > 0) {
+    if (event == cycles_event_connected) {
+      atomic_store(&bot->connected, true);
+    } else {
+      // Latest-only mode already dropped older states
+      ready = true;
+    }
+  }
+  if (event < 0) {
+    bot->failed = true;
+    return;
+  }
+  if (!ready) {
+    return;
+  }
+  const cycles_game_state *gs = &bot->buf.state;
+  const cycles_player *me = find_player(gs, bot->conn.name);
+  if (!me) {
+    bot->gone = true;
+    return;
+  }
+  cycles_direction move =
+      host->config.strategy->decide_move(bot->storage, gs, me);
+  if (cycles_send_move_i32(&bot->conn, move) < 0) {
+    bot->failed = true;
+    return;
+  }
+  record_latency(bot, now_ns() - bot->received_ns);
+}
+
+// Make poll() in bot_host_run() return, async-signal-safe
+static void wake_network(BotHost *host) {
+  char byte = 0;
+  // A full pipe already holds a pending wake-up
+  ssize_t written = write(host->wake[1], &byte, 1);
+  (void)written;
+}
+
+static void *worker_main(void *arg) {
+  BotHost *host = (BotHost *)arg;
+  pthread_mutex_lock(&host->mutex);
+  for (;;) {
+    while (!host->quitting && host->queue_count == 0) {
+      pthread_cond_wait(&host->work_cond, &host->mutex);
+    }
+    if (host->quitting) {
+      break;
+    }
+    Bot *bot = &host->bots[host->queue[host->queue_head]];
+    host->queue_head = (host->queue_head + 1) % host->bot_count;
+    host->queue_count--;
+    pthread_mutex_unlock(&host->mutex);
+    play_bot(host, bot);
+    atomic_store_explicit(&bot->busy, false, memory_order_release);
+    wake_network(host);
+    pthread_mutex_lock(&host->mutex);
+    if (--host->busy_count == 0) {
+      pthread_cond_broadcast(&host->idle_cond);
+    }
+  }
+  pthread_mutex_unlock(&host->mutex);
+  return NULL;
+}
+
+// Hand a bot to the workers. Only called for bots that are not busy, so the
+// ring of bot_count entries never overflows.
+static void queue_bot(BotHost *host, uint32_t index) {
+  atomic_store_explicit(&host->bots[index].busy, true, memory_order_relaxed);
+  pthread_mutex_lock(&host->mutex);
+  uint32_t tail = (host->queue_head + host->queue_count) % host->bot_count;
+  host->queue[tail] = index;
+  host->queue_count++;
+  host->busy_count++;
+  pthread_cond_signal(&host->work_cond);
+  pthread_mutex_unlock(&host->mutex);
+}
+
+// Wait until the workers are done with every queued bot
+static void wait_idle(BotHost *host) {
+  pthread_mutex_lock(&host->mutex);
+  while (host->busy_count > 0) {
+    pthread_cond_wait(&host->idle_cond, &host->mutex);
+  }
+  pthread_mutex_unlock(&host->mutex);
+}
+
+static int open_wake_pipe(int wake[2]) {
+  if (pipe(wake) < 0) {
+    wake[0] = wake[1] = -1;
+    return -1;
+  }
+  for (int i = 0; i < 2; i++) {
+    int flags = fcntl(wake[i], F_GETFL);
+    if (flags < 0 || fcntl(wake[i], F_SETFL, flags | O_NONBLOCK) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int start_workers(BotHost *host, uint32_t threads) {
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 1 ? (uint32_t)cpus : 1;
+  }
+  host->workers = calloc(threads, sizeof(pthread_t));
+  if (!host->workers) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < threads; i++) {
+    if (pthread_create(&host->workers[i], NULL, worker_main, host) != 0) {
+      break;
+    }
+    host->worker_count++;
+  }
+  return host->worker_count > 0 ? 0 : -1;
+}
+
+BotHost *bot_host_create(const BotHostConfig *config) {
+  if (!config || !config->host || !config->port || !config->strategy ||
+      !config->strategy->decide_move || config->bots == 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  BotHost *host = calloc(1, sizeof(BotHost));
+  if (!host) {
+    return NULL;
+  }
+  host->config = *config;
+  if (!host->config.name_prefix) {
+    host->config.name_prefix = "bot";
+  }
+  host->bot_count = config->bots;
+  atomic_init(&host->stopping, false);
+  pthread_mutex_init(&host->mutex, NULL);
+  pthread_cond_init(&host->work_cond, NULL);
+  pthread_cond_init(&host->idle_cond, NULL);
+  host->port_list = strdup(config->port);
+  host->bots = calloc(config->bots, sizeof(Bot));
+  // One more entry for the wake pipe
+  host->fds = calloc(config->bots + 1, sizeof(struct pollfd));
+  host->fd_bots = calloc(config->bots + 1, sizeof(uint32_t));
+  host->queue = calloc(config->bots, sizeof(uint32_t));
+  if (open_wake_pipe(host->wake) < 0 || !host->port_list || !host->bots ||
+      !host->fds || !host->fd_bots || !host->queue) {
+    bot_host_destroy(host);
+    return NULL;
+  }
+  host->port_count = split_ports(host->port_list, host->ports);
+  if (host->port_count == 0) {
+    bot_host_destroy(host);
+    errno = EINVAL;
+    return NULL;
+  }
+  const BotStrategy *strategy = config->strategy;
+  for (uint32_t i = 0; i < config->bots; i++) {
+    Bot *bot = &host->bots[i];
+    cycles_state_buffer_init(&bot->buf);
+    atomic_init(&bot->busy, false);
+    atomic_init(&bot->connected, false);
+    if (strategy->state_size > 0) {
+      bot->storage = calloc(1, strategy->state_size);
+      if (!bot->storage) {
+        bot_host_destroy(host);
+        return NULL;
+      }
+    }
+    if (strategy->init) {
+      strategy->init(bot->storage,
+                     config->seed + (i + 1) * 0x9E3779B97F4A7C15ull);
+    }
+  }
+  if (start_workers(host, config->threads) < 0) {
+    bot_host_destroy(host);
+    return NULL;
+  }
+  return host;
+}
+
+void bot_host_destroy(BotHost *host) {
+  if (!host) {
+    return;
+  }
+  pthread_mutex_lock(&host->mutex);
+  host->quitting = true;
+  pthread_cond_broadcast(&host->work_cond);
+  pthread_mutex_unlock(&host->mutex);
+  for (uint32_t i = 0; i < host->worker_count; i++) {
+    pthread_join(host->workers[i], NULL);
+  }
+  for (uint32_t i = 0; host->bots && i < host->bot_count; i++) {
+    Bot *bot = &host->bots[i];
+    close_bot(host, bot);
+    cycles_state_buffer_free(&bot->buf);
+    free(bot->storage);
+    free(bot->samples);
+  }
+  for (int i = 0; i < 2; i++) {
+    if (host->wake[i] >= 0) {
+      close(host->wake[i]);
+    }
+  }
+  pthread_cond_destroy(&host->work_cond);
+  pthread_cond_destroy(&host->idle_cond);
+  pthread_mutex_destroy(&host->mutex);
+  free(host->workers);
+  free(host->port_list);
+  free(host->bots);
+  free(host->fds);
+  free(host->fd_bots);
+  free(host->queue);
+  free(host);
+}
+
+// Start handshakes until MAX_CONNECTING are in flight. A server takes one
+// handshake at a time from a short listen queue, so connecting every bot at
+// once would only overflow it and wait out SYN retransmissions.
+static void start_connections(BotHost *host) {
+  uint32_t connecting = 0;
+  for (uint32_t i = 0; i < host->next_bot; i++) {
+    connecting +=
+        host->bots[i].open && !atomic_load(&host->bots[i].connected);
+  }
+  while (host->next_bot < host->bot_count && connecting < MAX_CONNECTING) {
+    uint32_t i = host->next_bot++;
+    Bot *bot = &host->bots[i];
+    char name[MAX_NAME_LEN + 1];
+    snprintf(name, sizeof(name), "%s%u", host->config.name_prefix, i);
+    if (cycles_connect_async(name, host->config.host,
+                             host->ports[i % host->port_count],
+                             &bot->conn) < 0) {
+      ulog_warn("%s: failed to start connecting (%s)", name, strerror(errno));
+      continue;
+    }
+    cycles_set_latest_only(&bot->conn, true);
+    bot->open = true;
+    host->open_count++;
+    connecting++;
+  }
+}
+
+// Fill the poll set with the wake pipe and every open bot no worker holds,
+// closing the bots a worker found finished. Returns the number of entries.
+static nfds_t build_poll_set(BotHost *host) {
+  host->fds[0] = (struct pollfd){host->wake[0], POLLIN, 0};
+  nfds_t count = 1;
+  for (uint32_t i = 0; i < host->next_bot; i++) {
+    Bot *bot = &host->bots[i];
+    if (!bot->open ||
+        atomic_load_explicit(&bot->busy, memory_order_acquire)) {
+      continue;
+    }
+    if (bot->failed) {
+      ulog_debug("%s: connection closed", bot->conn.name);
+      close_bot(host, bot);
+      continue;
+    }
+    if (bot->gone) {
+      ulog_debug("%s: no longer in the game, disconnecting", bot->conn.name);
+      close_bot(host, bot);
+      continue;
+    }
+    short out = cycles_wants_write(&bot->conn) ? POLLOUT : 0;
+    host->fds[count] = (struct pollfd){bot->conn.sock, POLLIN | out, 0};
+    host->fd_bots[count++] = i;
+  }
+  return count;
+}
+
+static void drain_wake_pipe(BotHost *host) {
+  char bytes[64];
+  while (read(host->wake[0], bytes, sizeof(bytes)) > 0) {
+  }
+}
+
+int bot_host_run(BotHost *host) {
+  if (!host) {
+    errno = EINVAL;
+    return -1;
+  }
+  int status = 0;
+  while ((host->open_count > 0 || host->next_bot < host->bot_count) &&
+         !atomic_load(&host->stopping)) {
+    start_connections(host);
+    nfds_t count = build_poll_set(host);
+    int ready = poll(host->fds, count, POLL_TIMEOUT_MS);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ulog_error("poll() failed: %s", strerror(errno));
+      status = -1;
+      break;
+    }
+    if (host->fds[0].revents != 0) {
+      drain_wake_pipe(host);
+    }
+    // Only do I/O here, the workers parse and answer every bot that got data
+    for (nfds_t k = 1; k < count; k++) {
+      if (host->fds[k].revents == 0) {
+        continue;
+      }
+      Bot *bot = &host->bots[host->fd_bots[k]];
+      size_t before = bot->conn.read_end - bot->conn.read_start;
+      if (cycles_handle_io(&bot->conn) < 0) {
+        bot->failed = true;
+        continue;
+      }
+      if (bot->conn.read_end - bot->conn.read_start > before) {
+        bot->received_ns = now_ns();
+        queue_bot(host, host->fd_bots[k]);
+      }
+    }
+  }
+  wait_idle(host);
+  return status;
+}
+
+void bot_host_stop(BotHost *host) {
+  if (host) {
+    atomic_store(&host->stopping, true);
+    wake_network(host);
+  }
+}
+
+uint32_t bot_host_count(const BotHost *host) {
+  return host ? host->bot_count : 0;
+}
+
+static int compare_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples
+static uint32_t percentile(const uint32_t *sorted, uint32_t count,
+                           uint32_t percent) {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Fill the percentiles of out from unsorted samples, sorting them in place
+static void summarize(uint32_t *samples, uint32_t count, BotLatency *out) {
+  qsort(samples, count, sizeof(uint32_t), compare_u32);
+  out->moves = count;
+  out->p50_us = percentile(samples, count, 50);
+  out->p90_us = percentile(samples, count, 90);
+  out->p99_us = percentile(samples, count, 99);
+  out->max_us = count ? samples[count - 1] : 0;
+}
+
+void bot_host_latency(const BotHost *host, uint32_t bot, BotLatency *out) {
+  if (!out) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  if (!host || bot >= host->bot_count) {
+    return;
+  }
+  const Bot *b = &host->bots[bot];
+  out->connected = atomic_load(&b->connected);
+  out->skipped_states = b->conn.skipped_states;
+  uint32_t *sorted = malloc((b->sample_count ? b->sample_count : 1) *
+                            sizeof(uint32_t));
+  if (!sorted) {
+    return;
+  }
+  memcpy(sorted, b->samples, b->sample_count * sizeof(uint32_t));
+  summarize(sorted, b->sample_count, out);
+  free(sorted);
+}
+
+void bot_host_report(const BotHost *host) {
+  if (!host) {
+    return;
+  }
+  uint64_t total = 0;
+  uint32_t connected = 0;
+  for (uint32_t i = 0; i < host->bot_count; i++) {
+    const Bot *bot = &host->bots[i];
+    BotLatency latency;
+    bot_host_latency(host, i, &latency);
+    total += bot->sample_count;
+    connected += latency.connected;
+    ulog_info("%s: %u moves, latency p50 %.3f p90 %.3f p99 %.3f max %.3f ms, "
+              "%llu states skipped",
+              bot->conn.name, latency.moves, latency.p50_us / 1e3,
+              latency.p90_us / 1e3, latency.p99_us / 1e3,
+              latency.max_us / 1e3,
+              (unsigned long long)latency.skipped_states);
+  }
+  uint32_t *all = malloc((total ? total : 1) * sizeof(uint32_t));
+  if (!all || total > UINT32_MAX) {
+    free(all);
+    return;
+  }
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < host->bot_count; i++) {
+    const Bot *bot = &host->bots[i];
+    memcpy(all + count, bot->samples, bot->sample_count * sizeof(uint32_t));
+    count += bot->sample_count;
+  }
+  BotLatency latency;
+  summarize(all, count, &latency);
+  free(all);
+  ulog_info("All %u bots (%u connected): %u moves, latency p50 %.3f p90 %.3f "
+            "p99 %.3f max %.3f ms",
+            host->bot_count, connected, latency.moves, latency.p50_us / 1e3,
+            latency.p90_us / 1e3, latency.p99_us / 1e3, latency.max_us / 1e3);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "c_api.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file bot_host.h
+ * @brief Many bots in one process.
+ *
+ * One thread multiplexes the non-blocking connections of all bots (see
+ * cycles_connect_async()) with poll() and only does their I/O. A bot that
+ * received data is queued for a pool of worker threads, which parse its
+ * latest state, pick a move and queue it on the connection. A bot is queued at
+ * most once and its socket is left alone until a worker is done with it, so a
+ * slow move only delays its own bot. For every bot the host records the
+ * latency from the network thread reading a state to its move being queued.
+ */
+
+/**
+ * @brief Move callback of a bot strategy, called on a worker thread
+ * @param bot Per-bot storage of BotStrategy::state_size bytes
+ * @param gs State just received
+ * @param me This bot's player in gs
+ * @return Direction to move in
+ */
+typedef cycles_direction (*BotDecideMove)(void *bot,
+                                          const cycles_game_state *gs,
+                                          const cycles_player *me);
+
+/**
+ * @brief A way of playing, shared by any number of bots
+ */
+typedef struct {
+  const char *name;                       ///< Name on the command line
+  size_t state_size;                      ///< Per-bot storage, may be 0
+  void (*init)(void *bot, uint64_t seed); ///< Optional, prepares storage
+  BotDecideMove decide_move;              ///< Picks the move of a frame
+} BotStrategy;
+
+/**
+ * @brief What to run and where to connect
+ */
+typedef struct {
+  const char *host;            ///< Server address, numeric to avoid lookups
+  const char *port;            ///< Server port, or ports separated by commas
+  const char *name_prefix;     ///< Bots are named prefix0, prefix1, ...
+  uint32_t bots;               ///< Number of bots
+  uint32_t threads;            ///< Worker threads, 0 for one per CPU
+  const BotStrategy *strategy; ///< Strategy of every bot
+  uint64_t seed;               ///< Seed of the per-bot storage
+} BotHostConfig;
+
+/**
+ * @brief Move latency of one bot, in microseconds
+ */
+typedef struct {
+  uint32_t moves;          ///< Moves sent
+  uint64_t skipped_states; ///< Stale states skipped (see latest-only mode)
+  bool connected;          ///< Whether the handshake finished
+  uint32_t p50_us;         ///< Median latency
+  uint32_t p90_us;         ///< 90th percentile
+  uint32_t p99_us;         ///< 99th percentile
+  uint32_t max_us;         ///< Worst latency
+} BotLatency;
+
+/** Opaque host */
+typedef struct BotHost BotHost;
+
+/**
+ * @brief Find a built-in strategy
+ *
+ * "random" moves like client_c_simple, a random valid direction biased
+ * towards the previous one; "north" always moves north.
+ * @return Strategy, or NULL if there is none by that name
+ */
+const BotStrategy *bot_strategy_find(const char *name);
+
+/**
+ * @brief Create the host, bots connect once bot_host_run() is called
+ * @return Host, or NULL on an invalid config or allocation failure
+ */
+BotHost *bot_host_create(const BotHostConfig *config);
+
+/**
+ * @brief Disconnect all bots and free the host
+ */
+void bot_host_destroy(BotHost *host);
+
+/**
+ * @brief Play until every connection is closed or bot_host_stop() is called
+ *
+ * Bots connect a few at a time, since a server handshakes clients one by one
+ * from a short listen queue. A bot whose player is no longer in the game
+ * disconnects, like client_c_simple does.
+ * @return 0 on success, -1 on NULL host or a failing poll()
+ */
+int bot_host_run(BotHost *host);
+
+/**
+ * @brief Make bot_host_run() return soon, callable from any thread and from
+ * signal handlers
+ */
+void bot_host_stop(BotHost *host);
+
+/**
+ * @brief Number of bots of the host
+ */
+uint32_t bot_host_count(const BotHost *host);
+
+/**
+ * @brief Latency percentiles of one bot, call after bot_host_run() returned
+ */
+void bot_host_latency(const BotHost *host, uint32_t bot, BotLatency *out);
+
+/**
+ * @brief Log the latency percentiles of every bot and of all bots together
+ */
+void bot_host_report(const BotHost *host);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+#include "bot_host.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <ulog.h>
+#ifndef DEFAULT_ULOG_LEVEL
+#define DEFAULT_ULOG_LEVEL ULOG_LEVEL_INFO
+#endif
+
+static BotHost *running_host = NULL;
+
+static void handle_interrupt(int sig) {
+  (void)sig;
+  bot_host_stop(running_host);
+}
+
+// Every bot holds a socket, so make sure the process may open enough of them
+static void raise_file_limit(uint32_t bots) {
+  struct rlimit limit;
+  rlim_t needed = (rlim_t)bots + 64;
+  if (getrlimit(RLIMIT_NOFILE, &limit) < 0 || limit.rlim_cur >= needed) {
+    return;
+  }
+  limit.rlim_cur = limit.rlim_max < needed ? limit.rlim_max : needed;
+  if (setrlimit(RLIMIT_NOFILE, &limit) < 0 || limit.rlim_cur < needed) {
+    ulog_warn("Can only open %llu files, some bots will fail to connect",
+              (unsigned long long)limit.rlim_cur);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  // Get the port(s) from the env variable CYCLES_PORT
+  const char *PORT = getenv("CYCLES_PORT");
+  if (argc < 3) {
+    ulog_error("Usage: %s <host_address> <bots> [strategy] [threads]",
+               argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (PORT == NULL) {
+    ulog_error("Environment variable CYCLES_PORT not set.");
+    return EXIT_FAILURE;
+  }
+  ulog_output_level_set_all(DEFAULT_ULOG_LEVEL);
+  int bots = atoi(argv[2]);
+  const char *strategy_name = argc > 3 ? argv[3] : "random";
+  int threads = argc > 4 ? atoi(argv[4]) : 0;
+  const BotStrategy *strategy = bot_strategy_find(strategy_name);
+  if (bots <= 0 || threads < 0 || !strategy) {
+    ulog_error("Invalid arguments: %d bots, strategy %s, %d threads", bots,
+               strategy_name, threads);
+    return EXIT_FAILURE;
+  }
+  raise_file_limit((uint32_t)bots);
+
+  BotHostConfig config = {
+      .host = argv[1],
+      .port = PORT,
+      .name_prefix = strategy->name,
+      .bots = (uint32_t)bots,
+      .threads = (uint32_t)threads,
+      .strategy = strategy,
+      .seed = (uint64_t)time(NULL),
+  };
+  BotHost *host = bot_host_create(&config);
+  if (!host) {
+    ulog_error("Could not start any bot");
+    return EXIT_FAILURE;
+  }
+  running_host = host;
+  signal(SIGINT, handle_interrupt);
+  signal(SIGTERM, handle_interrupt);
+  // A peer closing on us must not kill the other bots
+  signal(SIGPIPE, SIG_IGN);
+  int status = bot_host_run(host);
+  bot_host_report(host);
+  running_host = NULL;
+  bot_host_destroy(host);
+  return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
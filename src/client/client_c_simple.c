@@ -104,17 +104,20 @@ int main(int argc, char *argv[]) {
   float inertia = rand_int_inclusive(&rng_state, 50);
   int32_t direction = -1;
   uint frame = 0;
+  // Reused every frame, so the loop does not allocate
+  cycles_state_buffer buf;
+  cycles_state_buffer_init(&buf);
+  const cycles_game_state *gs = &buf.state;
   for (;;) {
-    cycles_game_state gs;
-    if (cycles_recv_game_state(conn.sock, &gs) < 0) {
+    if (cycles_recv_state(&conn, &buf) < 0) {
       ulog_error("recv_game_state() failed. (%d)", GETSOCKETERRNO());
       break;
     }
-    ulog_debug("Frame %d: grid %ux%u with %u players", frame, gs.grid_width,
-               gs.grid_height, gs.player_count);
+    ulog_debug("Frame %d: grid %ux%u with %u players", frame, gs->grid_width,
+               gs->grid_height, gs->player_count);
     cycles_player *me = NULL;
-    for (uint32_t i = 0; i < gs.player_count; ++i) {
-      cycles_player *p = &gs.players[i];
+    for (uint32_t i = 0; i < gs->player_count; ++i) {
+      cycles_player *p = &gs->players[i];
       if (hash_color(p->color) == my_hash) {
         me = p;
       }
@@ -127,20 +130,18 @@ int main(int argc, char *argv[]) {
       ulog_info("Player '%s' is no longer in the game (kicked/disconnected). "
                 "Exiting gracefully.",
                 conn.name);
-      cycles_free_game_state(&gs);
       break;
     }
-    direction = decide_move(&gs, me, direction, inertia, &rng_state);
+    direction = decide_move(gs, me, direction, inertia, &rng_state);
     if (cycles_send_move_i32(&conn, direction) < 0) {
       ulog_error("send() failed. (%d)", GETSOCKETERRNO());
-      cycles_free_game_state(&gs);
       break;
     }
     ulog_debug("Sent move direction %d", direction);
-    cycles_free_game_state(&gs);
     frame++;
   }
   ulog_debug("Cleaning up...");
+  cycles_state_buffer_free(&buf);
   cycles_disconnect(&conn);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,201 @@
+#include "board_lod.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint8_t *owners;   /* Row-major, NULL for level 0 */
+  uint64_t *changed; /* Rows recomputed by the current update */
+  uint64_t *pending; /* Rows changed since taken */
+} LodLevel;
+
+struct BoardLod {
+  uint32_t level_count;
+  LodLevel levels[BOARD_LOD_MAX_LEVELS];
+  uint8_t *scratch; /* Two board rows */
+};
+
+static size_t row_words(uint32_t rows) { return ((size_t)rows + 63) / 64; }
+
+static bool row_bit(const uint64_t *bits, uint32_t y) {
+  return (bits[y >> 6] >> (y & 63)) & 1u;
+}
+
+BoardLod *board_lod_create(uint32_t width, uint32_t height,
+                           uint32_t top_size) {
+  if (width == 0 || height == 0) {
+    return NULL;
+  }
+  BoardLod *lod = calloc(1, sizeof(BoardLod));
+  if (!lod) {
+    return NULL;
+  }
+  bool ok = (lod->scratch = malloc(2 * (size_t)width)) != NULL;
+  for (uint32_t k = 0; ok && k < BOARD_LOD_MAX_LEVELS; k++) {
+    LodLevel *level = &lod->levels[k];
+    level->width = k ? (lod->levels[k - 1].width + 1) / 2 : width;
+    level->height = k ? (lod->levels[k - 1].height + 1) / 2 : height;
+    level->changed = calloc(row_words(level->height), sizeof(uint64_t));
+    level->pending = calloc(row_words(level->height), sizeof(uint64_t));
+    if (k > 0) {
+      level->owners = calloc((size_t)level->width * level->height, 1);
+    }
+    ok = level->changed && level->pending && (k == 0 || level->owners);
+    lod->level_count = k + 1;
+    if (top_size == 0 ||
+        (level->width <= top_size && level->height <= top_size)) {
+      break;
+    }
+  }
+  if (!ok) {
+    board_lod_destroy(lod);
+    return NULL;
+  }
+  return lod;
+}
+
+void board_lod_destroy(BoardLod *lod) {
+  if (!lod) {
+    return;
+  }
+  for (uint32_t k = 0; k < lod->level_count; k++) {
+    free(lod->levels[k].owners);
+    free(lod->levels[k].changed);
+    free(lod->levels[k].pending);
+  }
+  free(lod->scratch);
+  free(lod);
+}
+
+uint32_t board_lod_levels(const BoardLod *lod) {
+  return lod ? lod->level_count : 0;
+}
+
+void board_lod_level_size(const BoardLod *lod, uint32_t level,
+                          uint32_t *width, uint32_t *height) {
+  *width = lod->levels[level].width;
+  *height = lod->levels[level].height;
+}
+
+/* out[x] = first owner of the 2x2 block at (2x, 0) in rows a and b */
+static void reduce_row(const uint8_t *a, const uint8_t *b, uint32_t width,
+                       uint8_t *out, uint32_t out_width) {
+  for (uint32_t x = 0; x < out_width; x++) {
+    uint32_t x0 = 2 * x, x1 = 2 * x + 1 < width ? 2 * x + 1 : 2 * x;
+    uint8_t v = a[x0] ? a[x0] : a[x1];
+    if (!v && b) {
+      v = b[x0] ? b[x0] : b[x1];
+    }
+    out[x] = v;
+  }
+}
+
+void board_lod_update(BoardLod *lod, const Grid *grid, const uint64_t *rows) {
+  if (!lod || !grid || !rows) {
+    return;
+  }
+  LodLevel *base = &lod->levels[0];
+  memcpy(base->changed, rows, row_words(base->height) * sizeof(uint64_t));
+  for (uint32_t k = 0; k < lod->level_count; k++) {
+    LodLevel *level = &lod->levels[k];
+    LodLevel *below = k ? &lod->levels[k - 1] : NULL;
+    for (size_t i = 0; i < row_words(level->height); i++) {
+      if (!below) {
+        level->pending[i] |= level->changed[i];
+        continue;
+      }
+      // Row y changes when row 2y or 2y + 1 below it changed
+      uint64_t word = 0;
+      for (uint32_t half = 0; half < 2; half++) {
+        size_t src = 2 * i + half;
+        if (src >= row_words(below->height)) {
+          break;
+        }
+        uint64_t b = below->changed[src];
+        b = (b | b >> 1) & 0x5555555555555555ull;
+        // Compress the even bits into the low 32, then place them
+        b = (b | b >> 1) & 0x3333333333333333ull;
+        b = (b | b >> 2) & 0x0F0F0F0F0F0F0F0Full;
+        b = (b | b >> 4) & 0x00FF00FF00FF00FFull;
+        b = (b | b >> 8) & 0x0000FFFF0000FFFFull;
+        b = (b | b >> 16) & 0x00000000FFFFFFFFull;
+        word |= b << (32 * half);
+      }
+      level->changed[i] = word;
+      level->pending[i] |= word;
+    }
+    if (!below) {
+      continue;
+    }
+    for (uint32_t y = 0; y < level->height; y++) {
+      uint64_t word = level->changed[y >> 6] >> (y & 63);
+      if (!word) {
+        y |= 63;
+        continue;
+      }
+      y += (uint32_t)__builtin_ctzll(word);
+      if (y >= level->height) {
+        break;
+      }
+      uint32_t src_rows = 2 * y + 1 < below->height ? 2 : 1;
+      const uint8_t *a, *b;
+      if (k == 1) {
+        grid_copy_rows(grid, 2 * y, src_rows, lod->scratch);
+        a = lod->scratch;
+      } else {
+        a = below->owners + (size_t)2 * y * below->width;
+      }
+      b = src_rows == 2 ? a + below->width : NULL;
+      reduce_row(a, b, below->width,
+                 level->owners + (size_t)y * level->width, level->width);
+    }
+  }
+}
+
+void board_lod_invalidate(BoardLod *lod) {
+  if (!lod) {
+    return;
+  }
+  for (uint32_t k = 0; k < lod->level_count; k++) {
+    LodLevel *level = &lod->levels[k];
+    for (uint32_t y = 0; y < level->height; y++) {
+      level->pending[y >> 6] |= 1ull << (y & 63);
+    }
+  }
+}
+
+bool board_lod_take_rows(BoardLod *lod, uint32_t level, uint32_t y0,
+                         uint32_t y1, uint32_t *first, uint32_t *count) {
+  if (!lod || level >= lod->level_count) {
+    return false;
+  }
+  LodLevel *l = &lod->levels[level];
+  if (y1 > l->height) {
+    y1 = l->height;
+  }
+  uint32_t y = y0;
+  while (y < y1 && !row_bit(l->pending, y)) {
+    uint64_t word = l->pending[y >> 6] >> (y & 63);
+    y = word ? y + (uint32_t)__builtin_ctzll(word) : (y | 63) + 1;
+  }
+  if (y >= y1) {
+    return false;
+  }
+  uint32_t end = y;
+  while (end < y1 && row_bit(l->pending, end)) {
+    l->pending[end >> 6] &= ~(1ull << (end & 63));
+    end++;
+  }
+  *first = y;
+  *count = end - y;
+  return true;
+}
+
+const uint8_t *board_lod_row(const BoardLod *lod, uint32_t level, uint32_t y) {
+  if (!lod || level == 0 || level >= lod->level_count) {
+    return NULL;
+  }
+  const LodLevel *l = &lod->levels[level];
+  return l->owners + (size_t)y * l->width;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "grid.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file board_lod.h
+ * @brief Reduced copies of the board owners, for drawing it zoomed out.
+ *
+ * Level 0 is the board itself (read from the Grid). Each further level
+ * halves both sizes, a cell taking the first non-empty owner of the 2x2
+ * cells below it, so a one-cell trail stays visible at every level. Levels
+ * are added until the last one fits in top_size cells along both sides.
+ *
+ * Only the rows under changed board rows are recomputed, and every level
+ * keeps the set of rows changed since they were last taken, so a level can
+ * be uploaded lazily, only while it is on screen.
+ */
+
+enum {
+  BOARD_LOD_MAX_LEVELS = 16 ///< Including level 0
+};
+
+/** Opaque level-of-detail pyramid */
+typedef struct BoardLod BoardLod;
+
+/**
+ * @brief Create the levels for a board, all of them empty
+ * @param top_size Largest side of the last level, 0 = level 0 only
+ * @return Pyramid, or NULL on failure
+ */
+BoardLod *board_lod_create(uint32_t width, uint32_t height, uint32_t top_size);
+
+/**
+ * @brief Free the pyramid
+ */
+void board_lod_destroy(BoardLod *lod);
+
+/**
+ * @brief Number of levels, including level 0
+ */
+uint32_t board_lod_levels(const BoardLod *lod);
+
+/**
+ * @brief Size of a level in cells
+ */
+void board_lod_level_size(const BoardLod *lod, uint32_t level,
+                          uint32_t *width, uint32_t *height);
+
+/**
+ * @brief Recompute the cells above changed board rows
+ * @param rows Bitset of changed board rows, as from game_take_dirty_rows()
+ */
+void board_lod_update(BoardLod *lod, const Grid *grid, const uint64_t *rows);
+
+/**
+ * @brief Mark every row of every level as changed, e.g. after a palette
+ * change
+ */
+void board_lod_invalidate(BoardLod *lod);
+
+/**
+ * @brief Take the first run of changed rows of a level inside [y0, y1)
+ * @param first Set to the first row of the run
+ * @param count Set to the number of rows in the run
+ * @return false if no row in [y0, y1) changed
+ */
+bool board_lod_take_rows(BoardLod *lod, uint32_t level, uint32_t y0,
+                         uint32_t y1, uint32_t *first, uint32_t *count);
+
+/**
+ * @brief Owners of one row of a level above 0 (level 0 is the Grid)
+ */
+const uint8_t *board_lod_row(const BoardLod *lod, uint32_t level, uint32_t y);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,132 @@
+#include "camera.h"
+#include <math.h>
+#include <stddef.h>
+
+/* Largest zoom in pixels per cell, unless the whole board needs more */
+#define CAMERA_MAX_ZOOM 32.0f
+
+/* Keep the view inside the board, centred along axes where it all fits */
+static void clamp_axis(float *center, float view, float zoom, uint32_t size) {
+  float extent = view / zoom;
+  if (extent >= (float)size) {
+    *center = (float)size / 2.0f;
+  } else if (*center < extent / 2.0f) {
+    *center = extent / 2.0f;
+  } else if (*center > (float)size - extent / 2.0f) {
+    *center = (float)size - extent / 2.0f;
+  }
+}
+
+static void clamp_view(Camera *c) {
+  clamp_axis(&c->center_x, (float)c->view_width, c->zoom, c->board_width);
+  clamp_axis(&c->center_y, (float)c->view_height, c->zoom, c->board_height);
+}
+
+int camera_init(Camera *c, uint32_t board_width, uint32_t board_height,
+                int view_width, int view_height) {
+  if (!c || board_width == 0 || board_height == 0 || view_width <= 0 ||
+      view_height <= 0) {
+    return -1;
+  }
+  c->board_width = board_width;
+  c->board_height = board_height;
+  c->view_width = view_width;
+  c->view_height = view_height;
+  float fit_x = (float)view_width / (float)board_width;
+  float fit_y = (float)view_height / (float)board_height;
+  c->min_zoom = fit_x < fit_y ? fit_x : fit_y;
+  c->max_zoom = c->min_zoom > CAMERA_MAX_ZOOM ? c->min_zoom : CAMERA_MAX_ZOOM;
+  camera_reset(c);
+  return 0;
+}
+
+void camera_reset(Camera *c) {
+  if (!c) {
+    return;
+  }
+  c->zoom = c->min_zoom;
+  c->follow = 0;
+  c->center_x = (float)c->board_width / 2.0f;
+  c->center_y = (float)c->board_height / 2.0f;
+}
+
+void camera_zoom_at(Camera *c, float factor, float x, float y) {
+  if (!c || !(factor > 0.0f)) {
+    return;
+  }
+  float board_x, board_y;
+  camera_screen_to_board(c, x, y, &board_x, &board_y);
+  float zoom = c->zoom * factor;
+  c->zoom = zoom < c->min_zoom   ? c->min_zoom
+            : zoom > c->max_zoom ? c->max_zoom
+                                 : zoom;
+  // Move the centre so (x, y) shows the same board point as before
+  c->center_x = board_x - (x - (float)c->view_width / 2.0f) / c->zoom;
+  c->center_y = board_y - (y - (float)c->view_height / 2.0f) / c->zoom;
+  clamp_view(c);
+}
+
+void camera_pan(Camera *c, float dx, float dy) {
+  if (!c) {
+    return;
+  }
+  c->follow = 0;
+  c->center_x += dx / c->zoom;
+  c->center_y += dy / c->zoom;
+  clamp_view(c);
+}
+
+void camera_center_on(Camera *c, float x, float y) {
+  if (!c) {
+    return;
+  }
+  c->center_x = x;
+  c->center_y = y;
+  clamp_view(c);
+}
+
+void camera_screen_to_board(const Camera *c, float x, float y, float *board_x,
+                            float *board_y) {
+  *board_x = c->center_x + (x - (float)c->view_width / 2.0f) / c->zoom;
+  *board_y = c->center_y + (y - (float)c->view_height / 2.0f) / c->zoom;
+}
+
+void camera_board_to_screen(const Camera *c, float x, float y,
+                            float *screen_x, float *screen_y) {
+  *screen_x = (x - c->center_x) * c->zoom + (float)c->view_width / 2.0f;
+  *screen_y = (y - c->center_y) * c->zoom + (float)c->view_height / 2.0f;
+}
+
+static uint32_t clip_cell(float v, uint32_t size) {
+  if (v <= 0.0f) {
+    return 0;
+  }
+  return v >= (float)size ? size : (uint32_t)v;
+}
+
+void camera_visible_cells(const Camera *c, CameraCells *cells) {
+  float x0, y0, x1, y1;
+  camera_screen_to_board(c, 0.0f, 0.0f, &x0, &y0);
+  camera_screen_to_board(c, (float)c->view_width, (float)c->view_height, &x1,
+                         &y1);
+  cells->x0 = clip_cell(floorf(x0), c->board_width);
+  cells->y0 = clip_cell(floorf(y0), c->board_height);
+  cells->x1 = clip_cell(ceilf(x1), c->board_width);
+  cells->y1 = clip_cell(ceilf(y1), c->board_height);
+}
+
+bool camera_shows_board(const Camera *c) {
+  CameraCells cells;
+  camera_visible_cells(c, &cells);
+  return cells.x0 == 0 && cells.y0 == 0 && cells.x1 == c->board_width &&
+         cells.y1 == c->board_height;
+}
+
+uint32_t camera_lod_level(const Camera *c) {
+  uint32_t level = 0;
+  // Tolerance so a fit zoom of exactly 1/2^n picks level n
+  while (level < 31 && c->zoom * (float)(1u << level) < 0.999f) {
+    level++;
+  }
+  return level;
+}
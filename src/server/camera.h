@@ -0,0 +1,107 @@
+#pragma once
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file camera.h
+ * @brief View of the board: which cells are on screen and where.
+ *
+ * The camera maps board cells to viewport pixels with a zoom factor
+ * (pixels per cell) and the board point shown at the centre of the
+ * viewport. It never shows more than the whole board, and keeps the board
+ * centred along any axis where the whole board fits. It can follow a
+ * player, in which case the renderer re-centres it on that player's head
+ * every frame.
+ */
+
+/**
+ * @brief Board view
+ */
+typedef struct {
+  uint32_t board_width;  ///< Board size in cells
+  uint32_t board_height; ///< Board size in cells
+  int view_width;        ///< Viewport size in pixels
+  int view_height;       ///< Viewport size in pixels
+  float zoom;            ///< Pixels per cell
+  float min_zoom;        ///< Zoom that fits the whole board
+  float max_zoom;        ///< Largest allowed zoom
+  float center_x;        ///< Board point at the viewport centre, in cells
+  float center_y;        ///< Board point at the viewport centre, in cells
+  PlayerId follow;       ///< Player kept centred, 0 = free camera
+} Camera;
+
+/**
+ * @brief Cells [x0, x1) x [y0, y1), clipped to the board
+ */
+typedef struct {
+  uint32_t x0;
+  uint32_t y0;
+  uint32_t x1;
+  uint32_t y1;
+} CameraCells;
+
+/**
+ * @brief Set up a camera showing the whole board
+ * @return 0 on success, -1 on NULL camera or empty board or viewport
+ */
+int camera_init(Camera *camera, uint32_t board_width, uint32_t board_height,
+                int view_width, int view_height);
+
+/**
+ * @brief Show the whole board again and stop following
+ */
+void camera_reset(Camera *camera);
+
+/**
+ * @brief Multiply the zoom by factor, keeping the board point under the
+ * viewport pixel (x, y) in place
+ */
+void camera_zoom_at(Camera *camera, float factor, float x, float y);
+
+/**
+ * @brief Move the view by (dx, dy) pixels and stop following
+ */
+void camera_pan(Camera *camera, float dx, float dy);
+
+/**
+ * @brief Centre the view on a board point (in cells)
+ */
+void camera_center_on(Camera *camera, float x, float y);
+
+/**
+ * @brief Board point (in cells) shown at viewport pixel (x, y)
+ */
+void camera_screen_to_board(const Camera *camera, float x, float y,
+                            float *board_x, float *board_y);
+
+/**
+ * @brief Viewport pixel of the board point (x, y), in cells
+ */
+void camera_board_to_screen(const Camera *camera, float x, float y,
+                            float *screen_x, float *screen_y);
+
+/**
+ * @brief Cells at least partly inside the viewport
+ */
+void camera_visible_cells(const Camera *camera, CameraCells *cells);
+
+/**
+ * @brief Whether the view shows the whole board
+ */
+bool camera_shows_board(const Camera *camera);
+
+/**
+ * @brief Level of detail for the current zoom: the smallest n such that a
+ * texel 2^n cells wide is at least one pixel, so no cell is skipped
+ */
+uint32_t camera_lod_level(const Camera *camera);
+
+#ifdef __cplusplus
+}
+#endif
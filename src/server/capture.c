@@ -0,0 +1,378 @@
+#include "capture.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+  CAPTURE_DEFAULT_QUEUE = 8,  /* Frames, about a quarter second at 30 fps */
+  PNG_STORED_BLOCK = 65535    /* Largest uncompressed deflate block */
+};
+
+struct CaptureSink {
+  CaptureFormat format;
+  uint32_t width;
+  uint32_t height;
+  char *pattern;             /* PNG file name pattern */
+  FILE *file;                /* Y4M or raw output */
+  uint8_t *encoded;          /* One frame in the output layout */
+  size_t encoded_size;       /* Bytes used in encoded */
+  uint64_t frame_index;      /* Next frame to write (encoder only) */
+  pthread_t encoder;
+  pthread_mutex_t mutex;     /* Protects the fields below */
+  pthread_cond_t ready_cond; /* Signalled when a frame is queued or closing */
+  uint32_t **slots;          /* Queued frames, tightly packed ARGB8888 */
+  uint32_t capacity;         /* Number of slots */
+  uint32_t head;             /* Oldest queued slot */
+  uint32_t count;            /* Queued slots */
+  bool closing;
+  CaptureStats stats;
+};
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void build_crc_table(void) {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) {
+      c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    crc_table[n] = c;
+  }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+/* Write a chunk whose data is given in pieces, CRC computed on the fly */
+static bool png_write_chunk(FILE *f, const char *type, const uint8_t *data,
+                            uint32_t size) {
+  uint8_t head[8];
+  put_be32(head, size);
+  memcpy(head + 4, type, 4);
+  uint32_t crc = crc_update(0xFFFFFFFFu, head + 4, 4);
+  crc = crc_update(crc, data, size);
+  uint8_t tail[4];
+  put_be32(tail, crc ^ 0xFFFFFFFFu);
+  return fwrite(head, 1, 8, f) == 8 &&
+         (size == 0 || fwrite(data, 1, size, f) == size) &&
+         fwrite(tail, 1, 4, f) == 4;
+}
+
+/*
+ * PNG with the scanlines in uncompressed deflate blocks: larger files than a
+ * real compressor, but no dependency and little CPU per frame.
+ */
+static bool png_write(FILE *f, const uint8_t *raw, size_t raw_size,
+                      uint32_t width, uint32_t height) {
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                       '\n'};
+  uint8_t ihdr[13] = {0};
+  put_be32(ihdr, width);
+  put_be32(ihdr + 4, height);
+  ihdr[8] = 8; // Bit depth
+  ihdr[9] = 2; // Truecolour
+  if (fwrite(signature, 1, 8, f) != 8 || !png_write_chunk(f, "IHDR", ihdr, 13))
+    return false;
+  size_t blocks = (raw_size + PNG_STORED_BLOCK - 1) / PNG_STORED_BLOCK;
+  size_t idat_size = 2 + blocks * 5 + raw_size + 4;
+  uint8_t head[8];
+  put_be32(head, (uint32_t)idat_size);
+  memcpy(head + 4, "IDAT", 4);
+  uint32_t crc = crc_update(0xFFFFFFFFu, head + 4, 4);
+  static const uint8_t zlib_header[2] = {0x78, 0x01};
+  bool ok = fwrite(head, 1, 8, f) == 8 && fwrite(zlib_header, 1, 2, f) == 2;
+  crc = crc_update(crc, zlib_header, 2);
+  uint32_t adler_a = 1, adler_b = 0;
+  for (size_t offset = 0; ok && offset < raw_size;
+       offset += PNG_STORED_BLOCK) {
+    size_t len = raw_size - offset < PNG_STORED_BLOCK ? raw_size - offset
+                                                      : PNG_STORED_BLOCK;
+    uint8_t block[5] = {offset + len == raw_size, (uint8_t)len,
+                        (uint8_t)(len >> 8), (uint8_t)~len,
+                        (uint8_t)(~len >> 8)};
+    ok = fwrite(block, 1, 5, f) == 5 &&
+         fwrite(raw + offset, 1, len, f) == len;
+    crc = crc_update(crc_update(crc, block, 5), raw + offset, len);
+    for (size_t i = 0; i < len; i++) {
+      adler_a = (adler_a + raw[offset + i]) % 65521;
+      adler_b = (adler_b + adler_a) % 65521;
+    }
+  }
+  uint8_t adler[4];
+  put_be32(adler, adler_b << 16 | adler_a);
+  crc = crc_update(crc, adler, 4);
+  uint8_t tail[4];
+  put_be32(tail, crc ^ 0xFFFFFFFFu);
+  return ok && fwrite(adler, 1, 4, f) == 4 && fwrite(tail, 1, 4, f) == 4 &&
+         png_write_chunk(f, "IEND", NULL, 0);
+}
+
+static uint8_t clamp_u8(int v) { return v > 255 ? 255 : (uint8_t)v; }
+
+/* BT.601 full range (as in JPEG), chroma averaged over 2x2 pixels */
+static void encode_y4m(CaptureSink *s, const uint32_t *frame) {
+  uint32_t w = s->width, h = s->height;
+  uint32_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+  uint8_t *y_plane = s->encoded;
+  uint8_t *u_plane = y_plane + (size_t)w * h;
+  uint8_t *v_plane = u_plane + (size_t)cw * ch;
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t p = frame[(size_t)y * w + x];
+      int r = (p >> 16) & 0xFF, g = (p >> 8) & 0xFF, b = p & 0xFF;
+      y_plane[(size_t)y * w + x] = (uint8_t)((77 * r + 150 * g + 29 * b +
+                                              128) >> 8);
+    }
+  }
+  for (uint32_t cy = 0; cy < ch; cy++) {
+    for (uint32_t cx = 0; cx < cw; cx++) {
+      int r = 0, g = 0, b = 0, n = 0;
+      for (uint32_t y = 2 * cy; y < 2 * cy + 2 && y < h; y++) {
+        for (uint32_t x = 2 * cx; x < 2 * cx + 2 && x < w; x++) {
+          uint32_t p = frame[(size_t)y * w + x];
+          r += (p >> 16) & 0xFF;
+          g += (p >> 8) & 0xFF;
+          b += p & 0xFF;
+          n++;
+        }
+      }
+      r /= n;
+      g /= n;
+      b /= n;
+      /* Offset by 128 << 8 so the shifted values are never negative */
+      u_plane[(size_t)cy * cw + cx] =
+          clamp_u8((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+      v_plane[(size_t)cy * cw + cx] =
+          clamp_u8((128 * r - 107 * g - 21 * b + 32896) >> 8);
+    }
+  }
+  s->encoded_size = (size_t)w * h + 2 * (size_t)cw * ch;
+}
+
+static void encode_rgb(CaptureSink *s, const uint32_t *frame, bool png) {
+  uint8_t *out = s->encoded;
+  for (uint32_t y = 0; y < s->height; y++) {
+    if (png) {
+      *out++ = 0; // No filter
+    }
+    for (uint32_t x = 0; x < s->width; x++) {
+      uint32_t p = frame[(size_t)y * s->width + x];
+      *out++ = (uint8_t)(p >> 16);
+      *out++ = (uint8_t)(p >> 8);
+      *out++ = (uint8_t)p;
+    }
+  }
+  s->encoded_size = (size_t)(out - s->encoded);
+}
+
+static bool write_frame(CaptureSink *s, const uint32_t *frame) {
+  switch (s->format) {
+  case capture_format_y4m:
+    encode_y4m(s, frame);
+    return fputs("FRAME\n", s->file) >= 0 &&
+           fwrite(s->encoded, 1, s->encoded_size, s->file) == s->encoded_size;
+  case capture_format_rgb:
+    encode_rgb(s, frame, false);
+    return fwrite(s->encoded, 1, s->encoded_size, s->file) == s->encoded_size;
+  case capture_format_png: {
+    encode_rgb(s, frame, true);
+    char path[4096];
+    snprintf(path, sizeof(path), s->pattern, (unsigned)s->frame_index);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+      return false;
+    }
+    bool ok = png_write(f, s->encoded, s->encoded_size, s->width, s->height);
+    return fclose(f) == 0 && ok;
+  }
+  }
+  return false;
+}
+
+static void *encoder_main(void *arg) {
+  CaptureSink *s = arg;
+  pthread_mutex_lock(&s->mutex);
+  for (;;) {
+    while (s->count == 0 && !s->closing) {
+      pthread_cond_wait(&s->ready_cond, &s->mutex);
+    }
+    if (s->count == 0) {
+      break;
+    }
+    const uint32_t *frame = s->slots[s->head];
+    pthread_mutex_unlock(&s->mutex);
+    bool ok = write_frame(s, frame);
+    s->frame_index++;
+    pthread_mutex_lock(&s->mutex);
+    if (ok) {
+      s->stats.written++;
+    } else {
+      s->stats.errors++;
+    }
+    s->head = (s->head + 1) % s->capacity;
+    s->count--;
+  }
+  pthread_mutex_unlock(&s->mutex);
+  return NULL;
+}
+
+int capture_format_from_name(const char *name, CaptureFormat *format) {
+  if (!name || !format) {
+    return -1;
+  }
+  if (strcmp(name, "y4m") == 0) {
+    *format = capture_format_y4m;
+  } else if (strcmp(name, "rgb") == 0) {
+    *format = capture_format_rgb;
+  } else if (strcmp(name, "png") == 0) {
+    *format = capture_format_png;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/* Accept exactly one conversion, %u with optional zero padding and width */
+static char *png_pattern(const char *path) {
+  const char *percent = strchr(path, '%');
+  if (!percent) {
+    size_t len = strlen(path);
+    if (len > 4 && strcmp(path + len - 4, ".png") == 0) {
+      len -= 4;
+    }
+    char *pattern = malloc(len + sizeof("_%06u.png"));
+    if (pattern) {
+      memcpy(pattern, path, len);
+      memcpy(pattern + len, "_%06u.png", sizeof("_%06u.png"));
+    }
+    return pattern;
+  }
+  const char *p = percent + 1;
+  while (isdigit((unsigned char)*p)) {
+    p++;
+  }
+  if (*p != 'u' || strchr(p, '%')) {
+    return NULL;
+  }
+  return strdup(path);
+}
+
+static void capture_free(CaptureSink *s) {
+  if (s->file) {
+    fclose(s->file);
+  }
+  for (uint32_t i = 0; s->slots && i < s->capacity; i++) {
+    free(s->slots[i]);
+  }
+  free(s->slots);
+  free(s->encoded);
+  free(s->pattern);
+  pthread_cond_destroy(&s->ready_cond);
+  pthread_mutex_destroy(&s->mutex);
+  free(s);
+}
+
+CaptureSink *capture_open(const char *path, CaptureFormat format,
+                          uint32_t width, uint32_t height, uint32_t fps,
+                          uint32_t queue_frames) {
+  if (!path || width == 0 || height == 0 || format > capture_format_png) {
+    return NULL;
+  }
+  pthread_once(&crc_table_once, build_crc_table);
+  CaptureSink *s = calloc(1, sizeof(CaptureSink));
+  if (!s) {
+    return NULL;
+  }
+  pthread_mutex_init(&s->mutex, NULL);
+  pthread_cond_init(&s->ready_cond, NULL);
+  s->format = format;
+  s->width = width;
+  s->height = height;
+  s->capacity = queue_frames ? queue_frames : CAPTURE_DEFAULT_QUEUE;
+  size_t pixels = (size_t)width * height;
+  s->slots = calloc(s->capacity, sizeof(uint32_t *));
+  bool ok = s->slots != NULL;
+  for (uint32_t i = 0; ok && i < s->capacity; i++) {
+    s->slots[i] = malloc(pixels * sizeof(uint32_t));
+    ok = s->slots[i] != NULL;
+  }
+  // RGB with a filter byte per row covers the Y4M planes as well
+  ok = ok && (s->encoded = malloc(pixels * 3 + height)) != NULL;
+  if (ok && format == capture_format_png) {
+    ok = (s->pattern = png_pattern(path)) != NULL;
+  } else if (ok) {
+    ok = (s->file = fopen(path, "wb")) != NULL;
+    if (ok && format == capture_format_y4m) {
+      ok = fprintf(s->file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n",
+                   width, height, fps ? fps : 30) > 0;
+    }
+  }
+  if (!ok || pthread_create(&s->encoder, NULL, encoder_main, s) != 0) {
+    capture_free(s);
+    return NULL;
+  }
+  return s;
+}
+
+bool capture_submit(CaptureSink *s, const uint32_t *pixels, size_t pitch) {
+  if (!s || !pixels) {
+    return false;
+  }
+  pthread_mutex_lock(&s->mutex);
+  s->stats.submitted++;
+  if (s->count == s->capacity) {
+    s->stats.dropped++;
+    pthread_mutex_unlock(&s->mutex);
+    return false;
+  }
+  // Only the encoder moves head, and never past the queued slots
+  uint32_t *slot = s->slots[(s->head + s->count) % s->capacity];
+  pthread_mutex_unlock(&s->mutex);
+  for (uint32_t y = 0; y < s->height; y++) {
+    memcpy(slot + (size_t)y * s->width, (const uint8_t *)pixels + y * pitch,
+           s->width * sizeof(uint32_t));
+  }
+  pthread_mutex_lock(&s->mutex);
+  s->count++;
+  pthread_cond_signal(&s->ready_cond);
+  pthread_mutex_unlock(&s->mutex);
+  return true;
+}
+
+void capture_get_stats(CaptureSink *s, CaptureStats *stats) {
+  if (!s || !stats) {
+    return;
+  }
+  pthread_mutex_lock(&s->mutex);
+  *stats = s->stats;
+  pthread_mutex_unlock(&s->mutex);
+}
+
+void capture_close(CaptureSink *s, CaptureStats *stats) {
+  if (!s) {
+    return;
+  }
+  pthread_mutex_lock(&s->mutex);
+  s->closing = true;
+  pthread_cond_signal(&s->ready_cond);
+  pthread_mutex_unlock(&s->mutex);
+  pthread_join(s->encoder, NULL);
+  if (stats) {
+    *stats = s->stats;
+  }
+  capture_free(s);
+}
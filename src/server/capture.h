@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file capture.h
+ * @brief Recording of rendered frames, encoded on a background thread.
+ *
+ * Frames are copied into a bounded queue and written by an encoder thread,
+ * so submitting never waits on the disk or the encoder. When the queue is
+ * full the frame is dropped and counted instead.
+ */
+
+/**
+ * @brief Output formats
+ */
+typedef enum {
+  capture_format_y4m = 0, ///< YUV4MPEG2 4:2:0 video, readable by ffmpeg
+  capture_format_rgb = 1, ///< Headerless 24-bit RGB frames, back to back
+  capture_format_png = 2  ///< One PNG file per frame
+} CaptureFormat;
+
+/**
+ * @brief Capture counters
+ */
+typedef struct {
+  uint64_t submitted; ///< Frames passed to capture_submit()
+  uint64_t written;   ///< Frames encoded and written
+  uint64_t dropped;   ///< Frames dropped because the queue was full
+  uint64_t errors;    ///< Frames lost to write errors
+} CaptureStats;
+
+/** Opaque capture sink */
+typedef struct CaptureSink CaptureSink;
+
+/**
+ * @brief Parse a format name ("y4m", "rgb" or "png")
+ * @return 0 on success, -1 if the name is unknown
+ */
+int capture_format_from_name(const char *name, CaptureFormat *format);
+
+/**
+ * @brief Start recording
+ *
+ * For capture_format_png the path is a printf pattern taking the frame
+ * index (e.g. "frames/%06u.png"); a path without '%' gets "_%06u.png"
+ * appended, replacing a ".png" extension. Other formats write one file.
+ * @param fps Frame rate stored in the Y4M header
+ * @param queue_frames Frames the queue can hold, 0 picks a default
+ * @return Sink, or NULL on failure (file could not be opened, bad size)
+ */
+CaptureSink *capture_open(const char *path, CaptureFormat format,
+                          uint32_t width, uint32_t height, uint32_t fps,
+                          uint32_t queue_frames);
+
+/**
+ * @brief Queue an ARGB8888 frame for encoding
+ * @param pitch Bytes per row of pixels
+ * @return true if queued, false if dropped (queue full or NULL arguments)
+ */
+bool capture_submit(CaptureSink *sink, const uint32_t *pixels, size_t pitch);
+
+/**
+ * @brief Get the capture counters
+ */
+void capture_get_stats(CaptureSink *sink, CaptureStats *stats);
+
+/**
+ * @brief Encode the queued frames, stop the encoder and close the output
+ * @param stats If not NULL, receives the final counters
+ */
+void capture_close(CaptureSink *sink, CaptureStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,342 @@
+#include "frame_ring.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FRAME_RING_MAGIC 0x52465943u /* "CYFR" */
+#define FRAME_RING_VERSION 1u
+
+/* Copies of a slot attempted by frame_ring_read() before giving up */
+#define FRAME_RING_READ_ATTEMPTS 8
+
+/* Row version of a reader row whose copy may be torn */
+#define ROW_UNKNOWN UINT64_MAX
+
+/* Start of the segment */
+typedef struct {
+  _Atomic uint32_t magic; /* Stored last, once the segment is ready */
+  uint32_t version;
+  FrameRingInfo info;
+  uint32_t slot_count;
+  uint64_t slot_size;         /* Bytes per slot, including rows */
+  _Atomic uint64_t published; /* Number of the newest slot write, 0 = none */
+  _Atomic uint32_t closed;    /* Set by frame_ring_destroy() */
+} RingHeader;
+
+/* Start of a slot, followed by grid_height row versions and the grid */
+typedef struct {
+  _Atomic uint64_t sequence; /* Odd while the server writes the slot */
+  uint64_t number;           /* Value of published for this write */
+  RenderFrame frame;
+} RingSlot;
+
+struct FrameRingWriter {
+  char *name;
+  uint8_t *base;
+  size_t size;
+  uint64_t published;
+  bool filled[FRAME_RING_SLOTS]; /* Slot written once, rows valid */
+  RenderFrameTrack track;        /* Heads at the last publish */
+};
+
+struct FrameRingReader {
+  const uint8_t *base;
+  size_t size;
+  uint64_t last_number;
+  uint8_t *grid;      /* Private copy of the grid */
+  uint64_t *versions; /* Row versions of the private copy */
+  uint32_t *incoming; /* Row versions of the slot being copied */
+  uint64_t *changed;  /* Rows copied but not yet loaded into the game */
+};
+
+static size_t align_up(size_t n) { return (n + 63) & ~(size_t)63; }
+
+static size_t header_size(void) { return align_up(sizeof(RingHeader)); }
+
+static size_t slot_size(const FrameRingInfo *info) {
+  return align_up(sizeof(RingSlot) + sizeof(uint32_t) * info->grid_height +
+                  (size_t)info->grid_width * info->grid_height);
+}
+
+static RingSlot *slot_at(uint8_t *base, uint64_t number) {
+  const RingHeader *h = (const RingHeader *)base;
+  return (RingSlot *)(base + header_size() +
+                      (number % h->slot_count) * h->slot_size);
+}
+
+static uint32_t *slot_versions(RingSlot *slot) {
+  return (uint32_t *)(slot + 1);
+}
+
+static uint8_t *slot_grid(RingSlot *slot, const FrameRingInfo *info) {
+  return (uint8_t *)(slot_versions(slot) + info->grid_height);
+}
+
+FrameRingWriter *frame_ring_create(const char *name,
+                                   const GameConfig *config) {
+  if (!name || name[0] != '/' || !config || config->grid_width == 0 ||
+      config->grid_height == 0) {
+    return NULL;
+  }
+  FrameRingWriter *ring = calloc(1, sizeof(FrameRingWriter));
+  if (!ring || !(ring->name = strdup(name))) {
+    free(ring);
+    return NULL;
+  }
+  FrameRingInfo info = {config->grid_width, config->grid_height,
+                        config->game_width, config->game_height};
+  ring->size = header_size() + FRAME_RING_SLOTS * slot_size(&info);
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    free(ring->name);
+    free(ring);
+    return NULL;
+  }
+  void *base = MAP_FAILED;
+  if (ftruncate(fd, (off_t)ring->size) == 0) {
+    base = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(name);
+    free(ring->name);
+    free(ring);
+    return NULL;
+  }
+  ring->base = base;
+  // A new segment reads as zeros: no frame published, every slot even
+  RingHeader *h = (RingHeader *)ring->base;
+  h->version = FRAME_RING_VERSION;
+  h->info = info;
+  h->slot_count = FRAME_RING_SLOTS;
+  h->slot_size = slot_size(&info);
+  atomic_store_explicit(&h->magic, FRAME_RING_MAGIC, memory_order_release);
+  return ring;
+}
+
+void frame_ring_destroy(FrameRingWriter *ring) {
+  if (!ring) {
+    return;
+  }
+  RingHeader *h = (RingHeader *)ring->base;
+  atomic_store_explicit(&h->closed, 1u, memory_order_release);
+  munmap(ring->base, ring->size);
+  shm_unlink(ring->name);
+  free(ring->name);
+  free(ring);
+}
+
+int frame_ring_publish(FrameRingWriter *ring, Game *game, uint64_t now_ns) {
+  if (!ring || !game) {
+    return -1;
+  }
+  RingHeader *h = (RingHeader *)ring->base;
+  const Grid *grid = game_get_grid_storage(game);
+  if (grid->width != h->info.grid_width ||
+      grid->height != h->info.grid_height) {
+    return -1;
+  }
+  uint64_t number = ring->published + 1;
+  uint64_t interval_ns = 0;
+  if (ring->published) {
+    uint64_t last = slot_at(ring->base, ring->published)->frame.time_ns;
+    interval_ns = now_ns - last;
+  }
+  RingSlot *slot = slot_at(ring->base, number);
+  bool *filled = &ring->filled[number % FRAME_RING_SLOTS];
+  uint64_t sequence =
+      atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+  atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->number = number;
+  render_frame_fill(&slot->frame, &ring->track, game, now_ns);
+  slot->frame.interval_ns = interval_ns;
+  slot->frame.alpha = 1.0f;
+  uint32_t *versions = slot_versions(slot);
+  uint8_t *owners = slot_grid(slot, &h->info);
+  // Copy runs of rows written since this slot was last filled
+  for (uint32_t y = 0; y < grid->height;) {
+    uint32_t end = y;
+    while (end < grid->height) {
+      uint32_t version = game_row_version(game, end);
+      if (*filled && versions[end] == version) {
+        break;
+      }
+      versions[end++] = version;
+    }
+    if (end > y) {
+      grid_copy_rows(grid, y, end - y, owners + (size_t)y * grid->width);
+    }
+    y = end + 1;
+  }
+  *filled = true;
+  atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+  atomic_store_explicit(&h->published, number, memory_order_release);
+  ring->published = number;
+  return 0;
+}
+
+FrameRingReader *frame_ring_open(const char *name) {
+  if (!name) {
+    return NULL;
+  }
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= header_size()) {
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+  RingHeader *h = base;
+  size_t size = (size_t)st.st_size;
+  if (atomic_load_explicit(&h->magic, memory_order_acquire) !=
+          FRAME_RING_MAGIC ||
+      h->version != FRAME_RING_VERSION || h->slot_count == 0 ||
+      h->slot_size != slot_size(&h->info) ||
+      size != header_size() + h->slot_count * h->slot_size) {
+    munmap(base, size);
+    return NULL;
+  }
+  FrameRingReader *reader = calloc(1, sizeof(FrameRingReader));
+  if (!reader) {
+    munmap(base, size);
+    return NULL;
+  }
+  reader->base = base;
+  reader->size = size;
+  const FrameRingInfo *info = &h->info;
+  reader->grid = malloc((size_t)info->grid_width * info->grid_height);
+  reader->versions = malloc(info->grid_height * sizeof(uint64_t));
+  reader->incoming = malloc(info->grid_height * sizeof(uint32_t));
+  reader->changed =
+      calloc(((size_t)info->grid_height + 63) / 64, sizeof(uint64_t));
+  if (!reader->grid || !reader->versions || !reader->incoming ||
+      !reader->changed) {
+    frame_ring_close(reader);
+    return NULL;
+  }
+  for (uint32_t y = 0; y < info->grid_height; y++) {
+    reader->versions[y] = ROW_UNKNOWN;
+  }
+  return reader;
+}
+
+void frame_ring_close(FrameRingReader *reader) {
+  if (!reader) {
+    return;
+  }
+  munmap((void *)reader->base, reader->size);
+  free(reader->grid);
+  free(reader->versions);
+  free(reader->incoming);
+  free(reader->changed);
+  free(reader);
+}
+
+void frame_ring_get_info(const FrameRingReader *reader, FrameRingInfo *info) {
+  *info = ((const RingHeader *)reader->base)->info;
+}
+
+bool frame_ring_closed(const FrameRingReader *reader) {
+  if (!reader) {
+    return false;
+  }
+  const RingHeader *h = (const RingHeader *)reader->base;
+  return atomic_load_explicit(&h->closed, memory_order_acquire) != 0;
+}
+
+/* Copy one slot into the private grid, false if the server wrote it
+ * meanwhile (rows copied by this attempt are then marked unknown) */
+static bool copy_slot(FrameRingReader *reader, RingSlot *slot,
+                      RenderFrame *frame, uint64_t *number) {
+  const FrameRingInfo *info = &((const RingHeader *)reader->base)->info;
+  uint64_t before =
+      atomic_load_explicit(&slot->sequence, memory_order_acquire);
+  if (before & 1u) {
+    return false;
+  }
+  *number = slot->number;
+  memcpy(frame, &slot->frame, offsetof(RenderFrame, players));
+  uint32_t count = frame->player_count <= MAX_PLAYERS ? frame->player_count
+                                                       : MAX_PLAYERS;
+  memcpy(frame->players, slot->frame.players, count * sizeof(Player));
+  memcpy(frame->previous, slot->frame.previous, count * sizeof(Vec2i));
+  memcpy(reader->incoming, slot_versions(slot),
+         info->grid_height * sizeof(uint32_t));
+  const uint8_t *owners = slot_grid(slot, info);
+  for (uint32_t y = 0; y < info->grid_height; y++) {
+    if (reader->versions[y] != reader->incoming[y]) {
+      size_t offset = (size_t)y * info->grid_width;
+      memcpy(reader->grid + offset, owners + offset, info->grid_width);
+      reader->versions[y] = reader->incoming[y];
+      reader->changed[y >> 6] |= 1ull << (y & 63);
+    }
+  }
+  atomic_thread_fence(memory_order_acquire);
+  uint64_t after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+  if (after == before && count == frame->player_count) {
+    return true;
+  }
+  for (uint32_t y = 0; y < info->grid_height; y++) {
+    if (reader->versions[y] == reader->incoming[y] &&
+        (reader->changed[y >> 6] >> (y & 63)) & 1u) {
+      reader->versions[y] = ROW_UNKNOWN;
+    }
+  }
+  return false;
+}
+
+int frame_ring_read(FrameRingReader *reader, Game *game, RenderFrame *frame) {
+  if (!reader || !game || !frame) {
+    return -1;
+  }
+  const RingHeader *h = (const RingHeader *)reader->base;
+  const Grid *grid = game_get_grid_storage(game);
+  if (grid->width != h->info.grid_width ||
+      grid->height != h->info.grid_height) {
+    return -1;
+  }
+  bool copied = false;
+  uint64_t number = 0;
+  for (int attempt = 0; attempt < FRAME_RING_READ_ATTEMPTS && !copied;
+       attempt++) {
+    uint64_t published =
+        atomic_load_explicit(&h->published, memory_order_acquire);
+    if (published == reader->last_number) {
+      return 0;
+    }
+    RingSlot *slot = slot_at((uint8_t *)reader->base, published);
+    copied = copy_slot(reader, slot, frame, &number);
+  }
+  if (!copied) {
+    return 0;
+  }
+  reader->last_number = number;
+  // Hand the copied rows to the game in runs
+  for (uint32_t y = 0; y < h->info.grid_height;) {
+    uint32_t end = y;
+    while (end < h->info.grid_height &&
+           (reader->changed[end >> 6] >> (end & 63)) & 1u) {
+      reader->changed[end >> 6] &= ~(1ull << (end & 63));
+      end++;
+    }
+    if (end > y) {
+      game_load_rows(game, y, end - y,
+                     reader->grid + (size_t)y * h->info.grid_width);
+    }
+    y = end + 1;
+  }
+  return 1;
+}
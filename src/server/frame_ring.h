@@ -0,0 +1,110 @@
+#pragma once
+
+#include "game_logic.h"
+#include "render_sched.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file frame_ring.h
+ * @brief Simulated frames shared with other processes through POSIX shared
+ * memory.
+ *
+ * The server publishes every tick into the next of FRAME_RING_SLOTS slots of
+ * a shared memory segment: the players as a RenderFrame, a write counter per
+ * grid row (see game_row_version()) and the grid owners. Each slot is guarded
+ * by a sequence lock, odd while the server writes it, and a reader copies a
+ * slot again when the sequence moved under it. Only rows whose counter
+ * changed are copied, by the server into the slot and by readers out of it.
+ *
+ * Readers map the segment read-only and never write to it, so any number of
+ * them can attach and detach while the game runs without slowing the
+ * simulation down.
+ */
+
+enum {
+  FRAME_RING_SLOTS = 4 ///< Slots the server cycles through
+};
+
+/**
+ * @brief Board and window sizes of a published game
+ */
+typedef struct {
+  uint32_t grid_width;  ///< Grid size in cells
+  uint32_t grid_height; ///< Grid size in cells
+  uint32_t game_width;  ///< Window size of the server renderer
+  uint32_t game_height; ///< Window size of the server renderer
+} FrameRingInfo;
+
+/** Opaque publishing side, owned by the server */
+typedef struct FrameRingWriter FrameRingWriter;
+
+/** Opaque reading side, one per observer */
+typedef struct FrameRingReader FrameRingReader;
+
+/**
+ * @brief Create the shared memory segment for a game
+ *
+ * A segment left behind under the same name is unlinked first; observers
+ * still mapping it keep their copy.
+ * @param name POSIX shared memory name, starting with '/'
+ * @return Writer, or NULL on failure
+ */
+FrameRingWriter *frame_ring_create(const char *name, const GameConfig *config);
+
+/**
+ * @brief Mark the segment closed for readers, then unmap and unlink it
+ */
+void frame_ring_destroy(FrameRingWriter *ring);
+
+/**
+ * @brief Publish the current grid and players of a game, called by the
+ * simulation after every tick
+ * @return 0 on success, -1 on NULL arguments or a grid of another size
+ */
+int frame_ring_publish(FrameRingWriter *ring, Game *game, uint64_t now_ns);
+
+/**
+ * @brief Attach to a segment created by frame_ring_create()
+ * @return Reader, or NULL if the segment does not exist (yet) or is not a
+ * frame ring
+ */
+FrameRingReader *frame_ring_open(const char *name);
+
+/**
+ * @brief Detach from the segment
+ */
+void frame_ring_close(FrameRingReader *reader);
+
+/**
+ * @brief Get the sizes of the published game
+ */
+void frame_ring_get_info(const FrameRingReader *reader, FrameRingInfo *info);
+
+/**
+ * @brief Read the newest published frame, if it is newer than the last one
+ * read
+ *
+ * Rows that changed since the previous read are written into game with
+ * game_load_rows(), so a renderer drawing game picks them up as dirty rows.
+ * Never blocks: if the server keeps rewriting the slot being copied, the
+ * call gives up and reports no new frame.
+ * @param game Game with the published grid size, receives the grid
+ * @param frame Output, filled only when a new frame was read
+ * @return 1 if a new frame was read, 0 if not, -1 on NULL arguments or a
+ * grid of another size
+ */
+int frame_ring_read(FrameRingReader *reader, Game *game, RenderFrame *frame);
+
+/**
+ * @brief Whether the server destroyed the ring, so no frame will follow
+ */
+bool frame_ring_closed(const FrameRingReader *reader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,6 +8,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <yaml.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 struct Game {
   GameConfig config;
@@ -87,21 +92,131 @@ static void generate_color_palette(Rgb *palette, int num_colors) {
   }
 }
 
-static uint8_t *get_cell(Game *game, int x, int y) {
-  return &game->grid[y * game->config.grid_width + x];
+/* Tail nodes are carved out of fixed-size blocks and recycled through a free
+ * list, so moving players does not call malloc once the pool is warm. */
+enum { TAIL_BLOCK_NODES = 1024 };
+
+struct TailBlock {
+  struct TailBlock *next;
+  TailNode nodes[TAIL_BLOCK_NODES];
+};
+
+/* Add blocks until the free list holds at least count nodes */
+static int tail_pool_reserve(Game *game, size_t count) {
+  while (game->tail_free_count < count) {
+    struct TailBlock *block = malloc(sizeof(struct TailBlock));
+    if (!block) {
+      return -1;
+    }
+    block->next = game->tail_blocks;
+    game->tail_blocks = block;
+    for (int i = 0; i < TAIL_BLOCK_NODES; i++) {
+      block->nodes[i].next = game->tail_free_list;
+      game->tail_free_list = &block->nodes[i];
+    }
+    game->tail_free_count += TAIL_BLOCK_NODES;
+  }
+  return 0;
+}
+
+static TailNode *tail_node_alloc(Game *game) {
+  if (tail_pool_reserve(game, 1) != 0) {
+    return NULL;
+  }
+  TailNode *node = game->tail_free_list;
+  game->tail_free_list = node->next;
+  game->tail_free_count--;
+  node->next = NULL;
+  return node;
+}
+
+static void tail_node_release(Game *game, TailNode *node) {
+  node->next = game->tail_free_list;
+  game->tail_free_list = node;
+  game->tail_free_count++;
+}
+
+static void tail_release_all(Game *game, TailNode *head) {
+  while (head) {
+    TailNode *next = head->next;
+    tail_node_release(game, head);
+    head = next;
+  }
+}
+
+/* Detach every tail from the players so player_destroy() does not free pool
+ * memory, then release the blocks themselves */
+static void tail_pool_destroy(Game *game) {
+  if (game->players) {
+    for (uint32_t i = 0; i < game->players->size; i++) {
+      game->players->tails[i] = NULL;
+    }
+  }
+  struct TailBlock *block = game->tail_blocks;
+  while (block) {
+    struct TailBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  game->tail_blocks = NULL;
+  game->tail_free_list = NULL;
+  game->tail_free_count = 0;
+}
+
+static uint8_t get_cell(const Game *game, int x, int y) {
+  return grid_get(&game->grid, (uint32_t)x, (uint32_t)y);
+}
+
+/* Words in the dirty row bitmap */
+static size_t dirty_row_words(const Game *game) {
+  return ((size_t)game->grid.height + 63) / 64;
+}
+
+/* Mark a row for game_take_dirty_rows(), after its cells were written */
+static void mark_row_dirty(Game *game, uint32_t y) {
+  __atomic_fetch_add(&game->row_versions[y], 1u, __ATOMIC_RELAXED);
+  __atomic_fetch_or(&game->dirty_rows[y >> 6], 1ULL << (y & 63),
+                    __ATOMIC_RELEASE);
 }
 
-static bool is_legal_move(Game *game, Vec2i new_pos) {
+static void mark_all_rows_dirty(Game *game) {
+  for (uint32_t y = 0; y < game->grid.height; y++) {
+    mark_row_dirty(game, y);
+  }
+}
+
+/* Write a grid cell, keeping the occupancy bits and state hash in sync */
+static int set_cell(Game *game, int x, int y, PlayerId id) {
+  uint64_t cell = (uint64_t)(uint32_t)y * game->grid.width + (uint32_t)x;
+  PlayerId old = get_cell(game, x, y);
+  if (grid_set(&game->grid, (uint32_t)x, (uint32_t)y, id) != 0) {
+    return -1;
+  }
+  mark_row_dirty(game, (uint32_t)y);
+  if (old != 0) {
+    game->state_hash ^= cycles_zobrist_key(cell, old);
+  }
+  if (id != 0) {
+    game->state_hash ^= cycles_zobrist_key(cell, id);
+  }
+  return 0;
+}
+
+static bool is_legal_move(const Game *game, Vec2i new_pos) {
   if (new_pos.x < 0 || new_pos.x >= (int)game->config.grid_width ||
       new_pos.y < 0 || new_pos.y >= (int)game->config.grid_height) {
     return false;
   }
-  if (*get_cell(game, new_pos.x, new_pos.y) != 0) {
+  if (grid_is_occupied(&game->grid, (uint32_t)new_pos.x,
+                       (uint32_t)new_pos.y)) {
     return false;
   }
   return true;
 }
 
+/* Defined with the legality kernels below */
+static uint8_t fixed_board_index(const GameConfig *config);
+
 Game *game_create(const GameConfig *config) {
   if (!config) {
     return NULL;
@@ -116,14 +231,24 @@ Game *game_create(const GameConfig *config) {
     free(game);
     return NULL;
   }
-  game->grid =
-      calloc(config->grid_width * config->grid_height, sizeof(uint8_t));
-  if (!game->grid) {
+  if (grid_init_ex(&game->grid, config->grid_width, config->grid_height,
+                   config->grid_storage, config->huge_pages) != 0) {
+    map_destroy(game->players);
+    free(game);
+    return NULL;
+  }
+  game->dirty_rows = calloc(dirty_row_words(game) + 1, sizeof(uint64_t));
+  game->row_versions = calloc(config->grid_height, sizeof(uint32_t));
+  if (!game->dirty_rows || !game->row_versions) {
+    free(game->dirty_rows);
+    free(game->row_versions);
+    grid_free(&game->grid);
     map_destroy(game->players);
     free(game);
     return NULL;
   }
   pthread_mutex_init(&game->game_mutex, NULL);
+  game->fixed_board = fixed_board_index(config);
   game->frame = 0;
   game->max_tail_length = 55;
   game->rng_state = 123456789ULL; /* Fixed seed for now */
@@ -136,10 +261,13 @@ void game_destroy(Game *game) {
   if (!game) {
     return;
   }
+  tail_pool_destroy(game);
   if (game->players) {
     map_destroy(game->players);
   }
-  free(game->grid);
+  grid_free(&game->grid);
+  free(game->dirty_rows);
+  free(game->row_versions);
   pthread_mutex_destroy(&game->game_mutex);
   free(game);
 }
@@ -166,14 +294,17 @@ PlayerId game_add_player(Game *game, const char *name) {
       pthread_mutex_unlock(&game->game_mutex);
       return 0; /* Grid is full */
     }
-  } while (*get_cell(game, position.x, position.y) != 0);
+  } while (get_cell(game, position.x, position.y) != 0);
   Player player;
   Rgb color = palette[game->id_counter % MAX_PLAYERS];
   if (player_create(game->id_counter, name, position, color, &player) != 0) {
     pthread_mutex_unlock(&game->game_mutex);
     return 0;
   }
-  *get_cell(game, position.x, position.y) = game->id_counter;
+  if (set_cell(game, position.x, position.y, game->id_counter) != 0) {
+    pthread_mutex_unlock(&game->game_mutex);
+    return 0;
+  }
   if (map_insert(game->players, game->id_counter, &player) != 0) {
     pthread_mutex_unlock(&game->game_mutex);
     return 0;
@@ -189,97 +320,369 @@ void game_remove_player(Game *game, PlayerId id) {
     return;
   }
   pthread_mutex_lock(&game->game_mutex);
-  Player *player = map_find(game->players, id);
-  if (!player) {
+  PlayerMap *map = game->players;
+  int slot = map_slot(map, id);
+  if (slot < 0) {
     pthread_mutex_unlock(&game->game_mutex);
     return;
   }
-  *get_cell(game, player->position.x, player->position.y) = 0;
-  TailNode *current = player->tail_linked_list;
+  set_cell(game, map->positions[slot].x, map->positions[slot].y, 0);
+  TailNode *current = map->tails[slot];
   while (current) {
-    *get_cell(game, current->position.x, current->position.y) = 0;
+    set_cell(game, current->position.x, current->position.y, 0);
     current = current->next;
   }
-  map_delete(game->players, id);
+  tail_release_all(game, map->tails[slot]);
+  map->tails[slot] = NULL;
+  map_delete(map, id);
   pthread_mutex_unlock(&game->game_mutex);
 }
 
-void game_move_players(Game *game, const Direction *directions) {
+static Vec2i move_target(const PlayerMap *map, uint32_t slot,
+                         const Direction *directions) {
+  Vec2i dir_vec = direction_to_vector(directions[map->keys[slot]]);
+  return (Vec2i){map->positions[slot].x + dir_vec.x,
+                 map->positions[slot].y + dir_vec.y};
+}
+
+/*
+ * Legality kernels: for slots [begin, end) write the target of each player
+ * and whether it is inside the board and empty. All of them give the same
+ * result as move_target() followed by is_legal_move().
+ */
+typedef void (*LegalityKernelFn)(const Game *game, const Direction *directions,
+                                 uint32_t begin, uint32_t end, Vec2i *targets,
+                                 bool *legal);
+
+static void legality_scalar(const Game *game, const Direction *directions,
+                            uint32_t begin, uint32_t end, Vec2i *targets,
+                            bool *legal) {
+  for (uint32_t i = begin; i < end; i++) {
+    targets[i] = move_target(game->players, i, directions);
+    legal[i] = is_legal_move(game, targets[i]);
+  }
+}
+
+/*
+ * Kernels specialized on common board sizes. Width, height and the bitboard
+ * stride are constants, so the bounds check is one unsigned compare per axis
+ * and the occupancy lookup needs no multiply. They read the row-aligned
+ * bitboard of dense and tiled grids.
+ */
+#define FIXED_BOARDS(X) X(100, 100) X(256, 256)
+
+#define DEFINE_FIXED_LEGALITY(W, H)                                            \
+  static void legality_##W##x##H(const Game *game,                             \
+                                 const Direction *directions, uint32_t begin,  \
+                                 uint32_t end, Vec2i *targets, bool *legal) {  \
+    enum { stride = ((W) + 63) / 64 };                                         \
+    const uint64_t *occupancy = game->grid.occupancy;                          \
+    for (uint32_t i = begin; i < end; i++) {                                   \
+      Vec2i target = move_target(game->players, i, directions);                \
+      uint32_t x = (uint32_t)target.x;                                         \
+      uint32_t y = (uint32_t)target.y;                                         \
+      targets[i] = target;                                                     \
+      legal[i] = x < (W) && y < (H) &&                                         \
+                 !((occupancy[y * stride + (x >> 6)] >> (x & 63)) & 1u);       \
+    }                                                                          \
+  }
+FIXED_BOARDS(DEFINE_FIXED_LEGALITY)
+#undef DEFINE_FIXED_LEGALITY
+
+#define FIXED_BOARD_ENTRY(W, H) {W, H, legality_##W##x##H},
+static const struct {
+  uint32_t width;
+  uint32_t height;
+  LegalityKernelFn legality;
+} fixed_boards[] = {{0, 0, NULL}, FIXED_BOARDS(FIXED_BOARD_ENTRY)};
+#undef FIXED_BOARD_ENTRY
+
+/* Index into fixed_boards for a configuration, 0 if there is none */
+static uint8_t fixed_board_index(const GameConfig *config) {
+  if (config->grid_storage == grid_storage_chunked) {
+    return 0;
+  }
+  for (uint8_t i = 1; i < sizeof fixed_boards / sizeof fixed_boards[0]; i++) {
+    if (fixed_boards[i].width == config->grid_width &&
+        fixed_boards[i].height == config->grid_height) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+bool game_has_fixed_board_kernels(const Game *game) {
+  return game && game->fixed_board != 0;
+}
+
+/* The vector kernels read the occupancy bitboard of dense and tiled grids in
+ * 32-bit words with 32-bit indices */
+static bool legality_vectorizable(const Game *game) {
+  const Grid *grid = &game->grid;
+  return grid->storage != grid_storage_chunked && grid->width <= INT32_MAX &&
+         (uint64_t)grid->height * grid->occupancy_stride * 2 <= INT32_MAX;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static void
+legality_avx2(const Game *game, const Direction *directions, uint32_t begin,
+              uint32_t end, Vec2i *targets, bool *legal) {
+  const PlayerMap *map = game->players;
+  const Grid *grid = &game->grid;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i width = _mm256_set1_epi32((int)grid->width);
+  const __m256i height = _mm256_set1_epi32((int)grid->height);
+  const __m256i stride = _mm256_set1_epi32((int)grid->occupancy_stride * 2);
+  const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  const int *occupancy = (const int *)grid->occupancy;
+  uint32_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    /* Deinterleave 8 positions into x and y lanes */
+    __m256i lo = _mm256_loadu_si256((const __m256i *)&map->positions[i]);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)&map->positions[i + 4]);
+    lo = _mm256_permutevar8x32_epi32(lo, split);
+    hi = _mm256_permutevar8x32_epi32(hi, split);
+    __m256i x = _mm256_permute2x128_si256(lo, hi, 0x20);
+    __m256i y = _mm256_permute2x128_si256(lo, hi, 0x31);
+    /* Directions by player ID: dx = (d == east) - (d == west), likewise dy */
+    __m256i ids =
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&map->keys[i]));
+    __m256i dir = _mm256_i32gather_epi32((const int *)directions, ids, 4);
+    x = _mm256_sub_epi32(
+        x, _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(east)));
+    x = _mm256_add_epi32(
+        x, _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(west)));
+    y = _mm256_sub_epi32(
+        y, _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(south)));
+    y = _mm256_add_epi32(
+        y, _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(north)));
+    /* 0 <= x < width and 0 <= y < height */
+    __m256i inside = _mm256_andnot_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, x),
+                        _mm256_cmpgt_epi32(zero, y)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(width, x),
+                         _mm256_cmpgt_epi32(height, y)));
+    /* Gather the occupancy word of every inside lane and test the bit */
+    __m256i word_index = _mm256_add_epi32(_mm256_mullo_epi32(y, stride),
+                                          _mm256_srli_epi32(x, 5));
+    __m256i words =
+        _mm256_mask_i32gather_epi32(zero, occupancy, word_index, inside, 4);
+    __m256i bit = _mm256_and_si256(
+        _mm256_srlv_epi32(words, _mm256_and_si256(x, _mm256_set1_epi32(31))),
+        one);
+    __m256i ok = _mm256_andnot_si256(_mm256_cmpeq_epi32(bit, one), inside);
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(ok));
+    /* Interleave x and y back into Vec2i order */
+    __m256i xy_lo = _mm256_unpacklo_epi32(x, y);
+    __m256i xy_hi = _mm256_unpackhi_epi32(x, y);
+    _mm256_storeu_si256((__m256i *)&targets[i],
+                        _mm256_permute2x128_si256(xy_lo, xy_hi, 0x20));
+    _mm256_storeu_si256((__m256i *)&targets[i + 4],
+                        _mm256_permute2x128_si256(xy_lo, xy_hi, 0x31));
+    for (int lane = 0; lane < 8; lane++) {
+      legal[i + lane] = (mask >> lane) & 1;
+    }
+  }
+  legality_scalar(game, directions, i, end, targets, legal);
+}
+#endif
+
+#if defined(__aarch64__)
+/* NEON has no gathers: targets and bounds are vectorized, cell lookups are
+ * done per lane */
+static void legality_neon(const Game *game, const Direction *directions,
+                          uint32_t begin, uint32_t end, Vec2i *targets,
+                          bool *legal) {
+  const PlayerMap *map = game->players;
+  const Grid *grid = &game->grid;
+  const uint32x4_t width = vdupq_n_u32(grid->width);
+  const uint32x4_t height = vdupq_n_u32(grid->height);
+  uint32_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    int32x4x2_t xy = vld2q_s32((const int32_t *)&map->positions[i]);
+    int32_t dir_lanes[4];
+    for (int lane = 0; lane < 4; lane++) {
+      dir_lanes[lane] = (int32_t)directions[map->keys[i + lane]];
+    }
+    int32x4_t dir = vld1q_s32(dir_lanes);
+    /* Comparison lanes are all ones (-1) when true */
+    xy.val[0] = vsubq_s32(xy.val[0], vreinterpretq_s32_u32(vceqq_s32(
+                                         dir, vdupq_n_s32(east))));
+    xy.val[0] = vaddq_s32(xy.val[0], vreinterpretq_s32_u32(vceqq_s32(
+                                         dir, vdupq_n_s32(west))));
+    xy.val[1] = vsubq_s32(xy.val[1], vreinterpretq_s32_u32(vceqq_s32(
+                                         dir, vdupq_n_s32(south))));
+    xy.val[1] = vaddq_s32(xy.val[1], vreinterpretq_s32_u32(vceqq_s32(
+                                         dir, vdupq_n_s32(north))));
+    /* Unsigned compares also reject negative coordinates */
+    uint32x4_t inside =
+        vandq_u32(vcltq_u32(vreinterpretq_u32_s32(xy.val[0]), width),
+                  vcltq_u32(vreinterpretq_u32_s32(xy.val[1]), height));
+    vst2q_s32((int32_t *)&targets[i], xy);
+    uint32_t inside_lanes[4];
+    vst1q_u32(inside_lanes, inside);
+    for (int lane = 0; lane < 4; lane++) {
+      Vec2i t = targets[i + lane];
+      legal[i + lane] =
+          inside_lanes[lane] &&
+          !grid_is_occupied(grid, (uint32_t)t.x, (uint32_t)t.y);
+    }
+  }
+  legality_scalar(game, directions, i, end, targets, legal);
+}
+#endif
+
+static LegalityKernel best_kernel = legality_kernel_scalar;
+static pthread_once_t best_kernel_once = PTHREAD_ONCE_INIT;
+
+static void detect_legality_kernel(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    best_kernel = legality_kernel_avx2;
+  }
+#elif defined(__aarch64__)
+  best_kernel = legality_kernel_neon;
+#endif
+}
+
+LegalityKernel game_best_legality_kernel(void) {
+  pthread_once(&best_kernel_once, detect_legality_kernel);
+  return best_kernel;
+}
+
+/* Kernel implementing a LegalityKernel, or NULL if it is not available */
+static LegalityKernelFn legality_kernel_fn(const Game *game,
+                                           LegalityKernel kernel) {
+  switch (kernel) {
+  case legality_kernel_scalar:
+    return legality_scalar;
+  case legality_kernel_fixed:
+    return fixed_boards[game->fixed_board].legality;
+#if defined(__x86_64__) || defined(__i386__)
+  case legality_kernel_avx2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? legality_avx2 : NULL;
+#endif
+#if defined(__aarch64__)
+  case legality_kernel_neon:
+    return legality_neon;
+#endif
+  default:
+    return NULL;
+  }
+}
+
+/* Kernel used for this game's ticks */
+static LegalityKernelFn game_legality_kernel(const Game *game) {
+  if (!legality_vectorizable(game)) {
+    return legality_scalar;
+  }
+  LegalityKernel kernel = game_best_legality_kernel();
+  /* Below one AVX2 step the vector kernels only run the generic loop */
+  if (game->fixed_board &&
+      (kernel == legality_kernel_scalar || game->players->size < 8)) {
+    kernel = legality_kernel_fixed;
+  }
+  return legality_kernel_fn(game, kernel);
+}
+
+int game_check_moves(const Game *game, const Direction *directions,
+                     LegalityKernel kernel, Vec2i *targets, bool *legal) {
+  if (!game || !directions || !targets || !legal) {
+    return -1;
+  }
+  LegalityKernelFn fn = legality_kernel_fn(game, kernel);
+  if (!fn) {
+    return -1;
+  }
+  if (!legality_vectorizable(game)) {
+    fn = legality_scalar;
+  }
+  fn(game, directions, 0, game->players->size, targets, legal);
+  return (int)game->players->size;
+}
+
+static void resolve_moves(const Game *game, const Direction *directions,
+                          LegalityKernelFn legality, Vec2i *new_positions,
+                          bool *colliding) {
+  const PlayerMap *map = game->players;
+  bool legal[MAX_PLAYERS];
+  legality(game, directions, 0, map->size, new_positions, legal);
+  for (uint32_t i = 0; i < map->size; i++) {
+    if (!legal[i]) {
+      colliding[i] = true;
+    }
+    for (uint32_t j = i + 1; j < map->size; j++) {
+      if (new_positions[i].x == new_positions[j].x &&
+          new_positions[i].y == new_positions[j].y) {
+        colliding[i] = true;
+        colliding[j] = true;
+      }
+    }
+  }
+}
+
+int game_move_players(Game *game, const Direction *directions) {
   if (!game || !directions) {
-    return;
+    return -1;
   }
   game->max_tail_length = 55 + game->frame / 100;
-  Player *player_ptrs[MAX_PLAYERS];
-  uint32_t player_count = map_get_all(game->players, player_ptrs);
+  PlayerMap *map = game->players;
+  uint32_t player_count = map->size;
   if (player_count == 0) {
-    return;
+    return 0;
   }
+  /* Per-slot results; ids are kept since removals reorder the slots */
+  PlayerId ids[MAX_PLAYERS];
+  memcpy(ids, map->keys, player_count * sizeof(PlayerId));
   Vec2i new_positions[MAX_PLAYERS] = {0};
-  bool has_direction[MAX_PLAYERS] = {false};
-  for (uint32_t i = 0; i < player_count; i++) {
-    Player *player = player_ptrs[i];
-    PlayerId id = player->id;
-    Direction dir = directions[id];
-    Vec2i dir_vec = direction_to_vector(dir);
-    new_positions[id].x = player->position.x + dir_vec.x;
-    new_positions[id].y = player->position.y + dir_vec.y;
-    has_direction[id] = true;
-  }
   bool colliding[MAX_PLAYERS] = {false};
+  LegalityKernelFn legality = game_legality_kernel(game);
+  resolve_moves(game, directions, legality, new_positions, colliding);
+  /*
+   * Surviving targets are distinct cells that were empty before the tick and
+   * trimming only clears cells of the moving player, so the apply phase has
+   * no conflicts.
+   */
   for (uint32_t i = 0; i < player_count; i++) {
-    PlayerId id1 = player_ptrs[i]->id;
-    if (!has_direction[id1])
-      continue;
-    for (uint32_t j = i + 1; j < player_count; j++) {
-      PlayerId id2 = player_ptrs[j]->id;
-      if (!has_direction[id2])
-        continue;
-      if (new_positions[id1].x == new_positions[id2].x &&
-          new_positions[id1].y == new_positions[id2].y) {
-        colliding[id1] = true;
-        colliding[id2] = true;
-      }
+    if (colliding[i]) {
+      game_remove_player(game, ids[i]);
     }
   }
+  int status = 0;
   for (uint32_t i = 0; i < player_count; i++) {
-    PlayerId id = player_ptrs[i]->id;
-    if (!has_direction[id])
+    if (colliding[i])
       continue;
-    if (!is_legal_move(game, new_positions[id])) {
-      colliding[id] = true;
-    }
-  }
-  for (uint32_t i = 0; i < player_count; i++) {
-    PlayerId id = player_ptrs[i]->id;
-    if (colliding[id]) {
-      game_remove_player(game, id);
-    }
-  }
-  for (uint32_t i = 0; i < player_count; i++) {
-    PlayerId id = player_ptrs[i]->id;
-    if (!has_direction[id] || colliding[id])
+    int slot = map_slot(map, ids[i]);
+    if (slot < 0)
       continue;
-    Player *player = map_find(game->players, id);
-    if (!player)
+    Vec2i new_pos = new_positions[i];
+    if (set_cell(game, new_pos.x, new_pos.y, ids[i]) != 0) {
+      /* The head could not be written, so the player cannot move on */
+      game_remove_player(game, ids[i]);
+      status = -1;
       continue;
-    Vec2i new_pos = new_positions[id];
-    *get_cell(game, new_pos.x, new_pos.y) = id;
-    TailNode *new_tail = malloc(sizeof(TailNode));
+    }
+    TailNode *new_tail = tail_node_alloc(game);
     if (new_tail) {
-      new_tail->position = player->position;
-      new_tail->next = player->tail_linked_list;
-      player->tail_linked_list = new_tail;
+      new_tail->position = map->positions[slot];
+      new_tail->next = map->tails[slot];
+      map->tails[slot] = new_tail;
     }
     uint32_t tail_len = 0;
-    TailNode *current = player->tail_linked_list;
+    TailNode *current = map->tails[slot];
     TailNode *prev = NULL;
     while (current) {
       tail_len++;
       if (tail_len > game->max_tail_length) {
-        *get_cell(game, current->position.x, current->position.y) = 0;
+        if (set_cell(game, current->position.x, current->position.y, 0) != 0) {
+          status = -1;
+        }
         TailNode *to_free = current;
         current = current->next;
-        free(to_free);
+        tail_node_release(game, to_free);
         if (prev) {
           prev->next = NULL;
         }
@@ -288,12 +691,107 @@ void game_move_players(Game *game, const Direction *directions) {
         current = current->next;
       }
     }
-    player->position = new_pos;
+    map->positions[slot] = new_pos;
   }
+  return status;
 }
 
 const uint8_t *game_get_grid(const Game *game) {
-  return game ? game->grid : NULL;
+  if (!game || game->grid.storage != grid_storage_dense) {
+    return NULL;
+  }
+  return game->grid.cells;
+}
+
+const Grid *game_get_grid_storage(const Game *game) {
+  return game ? &game->grid : NULL;
+}
+
+const uint64_t *game_get_occupancy(const Game *game, uint32_t *words_per_row) {
+  if (!game) {
+    return NULL;
+  }
+  if (words_per_row) {
+    *words_per_row = game->grid.occupancy_stride;
+  }
+  return game->grid.occupancy;
+}
+
+uint64_t game_count_occupied_cells(const Game *game) {
+  return game ? grid_count_occupied(&game->grid) : 0;
+}
+
+bool game_take_dirty_rows(Game *game, uint64_t *rows) {
+  if (!game || !rows) {
+    return false;
+  }
+  uint64_t any = 0;
+  for (size_t i = 0; i < dirty_row_words(game); i++) {
+    uint64_t word = __atomic_exchange_n(&game->dirty_rows[i], 0,
+                                        __ATOMIC_ACQUIRE);
+    rows[i] |= word;
+    any |= word;
+  }
+  return any != 0;
+}
+
+uint32_t game_row_version(const Game *game, uint32_t y) {
+  if (!game || y >= game->grid.height) {
+    return 0;
+  }
+  return __atomic_load_n(&game->row_versions[y], __ATOMIC_RELAXED);
+}
+
+int game_load_rows(Game *game, uint32_t y, uint32_t count,
+                   const uint8_t *owners) {
+  if (!game || !owners || y > game->grid.height ||
+      count > game->grid.height - y) {
+    return -1;
+  }
+  const uint32_t width = game->grid.width;
+  for (uint32_t row = y; row < y + count; row++, owners += width) {
+    for (uint32_t x = 0; x < width; x++) {
+      if (get_cell(game, (int)x, (int)row) != owners[x] &&
+          set_cell(game, (int)x, (int)row, owners[x]) != 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+uint64_t game_get_state_hash(const Game *game) {
+  return game ? game->state_hash : 0;
+}
+
+uint64_t game_compute_state_hash(const Game *game) {
+  if (!game) {
+    return 0;
+  }
+  uint64_t hash = 0;
+  GridChunkIter it;
+  GridChunkView view;
+  grid_chunk_iter_init(&it, &game->grid);
+  while (grid_chunk_iter_next(&it, &view)) {
+    for (uint32_t j = 0; j < view.height; j++) {
+      uint64_t word = view.occupancy[j * view.occupancy_stride];
+      uint64_t row = (uint64_t)(view.y + j) * game->grid.width;
+      while (word) {
+        uint32_t i = (uint32_t)__builtin_ctzll(word);
+        hash ^= cycles_zobrist_key(row + view.x + i,
+                                   view.cells[j * view.stride + i]);
+        word &= word - 1;
+      }
+    }
+  }
+  return hash;
+}
+
+PageBacking game_get_grid_backing(const Game *game) {
+  if (!game || game->grid.storage == grid_storage_chunked) {
+    return page_backing_heap;
+  }
+  return game->grid.cells_backing;
 }
 
 void game_get_grid_size(const Game *game, uint32_t *width, uint32_t *height) {
@@ -304,7 +802,7 @@ void game_get_grid_size(const Game *game, uint32_t *width, uint32_t *height) {
   *height = game->config.grid_height;
 }
 
-uint32_t game_get_players(Game *game, Player **players) {
+uint32_t game_get_players(Game *game, Player *players) {
   if (!game || !players) {
     return 0;
   }
@@ -314,14 +812,14 @@ uint32_t game_get_players(Game *game, Player **players) {
   return player_count;
 }
 
-const Player *game_get_player(Game *game, PlayerId id) {
-  if (!game) {
-    return NULL;
+bool game_get_player(Game *game, PlayerId id, Player *player) {
+  if (!game || !player) {
+    return false;
   }
-  pthread_mutex_lock((pthread_mutex_t *)&game->game_mutex);
-  Player *p = map_find(game->players, id);
-  pthread_mutex_unlock((pthread_mutex_t *)&game->game_mutex);
-  return p;
+  pthread_mutex_lock(&game->game_mutex);
+  bool found = map_find(game->players, id, player);
+  pthread_mutex_unlock(&game->game_mutex);
+  return found;
 }
 
 bool game_is_over(const Game *game) {
@@ -339,6 +837,174 @@ void game_set_frame(Game *game, uint32_t frame) {
   }
 }
 
+static bool same_grid_size(const GameConfig *a, const GameConfig *b) {
+  return a->grid_width == b->grid_width && a->grid_height == b->grid_height &&
+         a->grid_storage == b->grid_storage;
+}
+
+Game *game_clone(const Game *game) {
+  if (!game) {
+    return NULL;
+  }
+  Game *clone = game_create(&game->config);
+  if (!clone) {
+    return NULL;
+  }
+  if (grid_copy(&clone->grid, &game->grid) != 0) {
+    game_destroy(clone);
+    return NULL;
+  }
+  PlayerMap *map = clone->players;
+  *map = *game->players;
+  for (uint32_t i = 0; i < map->size; i++) {
+    TailNode *head = NULL;
+    TailNode **link = &head;
+    for (const TailNode *src = map->tails[i]; src; src = src->next) {
+      TailNode *node = tail_node_alloc(clone);
+      if (!node) {
+        game_destroy(clone);
+        return NULL;
+      }
+      node->position = src->position;
+      *link = node;
+      link = &node->next;
+    }
+    map->tails[i] = head;
+  }
+  clone->frame = game->frame;
+  clone->max_tail_length = game->max_tail_length;
+  clone->rng_state = game->rng_state;
+  clone->id_counter = game->id_counter;
+  clone->game_started = game->game_started;
+  clone->state_hash = game->state_hash;
+  mark_all_rows_dirty(clone);
+  return clone;
+}
+
+GameSnapshot *game_snapshot_create(const Game *game) {
+  if (!game) {
+    return NULL;
+  }
+  GameSnapshot *snapshot = calloc(1, sizeof(GameSnapshot));
+  if (!snapshot) {
+    return NULL;
+  }
+  snapshot->config = game->config;
+  /* Every tail node owns a distinct occupied cell */
+  snapshot->tail_capacity = game_count_occupied_cells(game) + MAX_PLAYERS;
+  snapshot->tails = malloc(snapshot->tail_capacity * sizeof(Vec2i));
+  if (grid_init_ex(&snapshot->grid, game->grid.width, game->grid.height,
+                   game->grid.storage, game->grid.huge_pages) != 0 ||
+      !snapshot->tails) {
+    game_snapshot_destroy(snapshot);
+    return NULL;
+  }
+  return snapshot;
+}
+
+void game_snapshot_destroy(GameSnapshot *snapshot) {
+  if (!snapshot) {
+    return;
+  }
+  grid_free(&snapshot->grid);
+  free(snapshot->tails);
+  free(snapshot);
+}
+
+/* Make room for every tail cell of the game, so copying them cannot fail */
+static int snapshot_reserve_tails(GameSnapshot *snapshot, const Game *game) {
+  const PlayerMap *map = game->players;
+  size_t count = 0;
+  for (uint32_t i = 0; i < map->size; i++) {
+    for (const TailNode *n = map->tails[i]; n; n = n->next) {
+      count++;
+    }
+  }
+  if (count <= snapshot->tail_capacity) {
+    return 0;
+  }
+  size_t capacity = snapshot->tail_capacity * 2;
+  if (capacity < count) {
+    capacity = count;
+  }
+  Vec2i *tails = realloc(snapshot->tails, capacity * sizeof(Vec2i));
+  if (!tails) {
+    return -1;
+  }
+  snapshot->tails = tails;
+  snapshot->tail_capacity = capacity;
+  return 0;
+}
+
+int game_snapshot(const Game *game, GameSnapshot *snapshot) {
+  if (!game || !snapshot || !same_grid_size(&game->config, &snapshot->config)) {
+    return -1;
+  }
+  /* Both steps that can fail leave the snapshot as it was, so a failed
+   * snapshot still holds the previous one */
+  if (snapshot_reserve_tails(snapshot, game) != 0 ||
+      grid_copy(&snapshot->grid, &game->grid) != 0) {
+    return -1;
+  }
+  snapshot->players = *game->players;
+  snapshot->tail_count = 0;
+  for (uint32_t i = 0; i < snapshot->players.size; i++) {
+    snapshot->tail_lengths[i] = 0;
+    for (const TailNode *n = snapshot->players.tails[i]; n; n = n->next) {
+      snapshot->tails[snapshot->tail_count++] = n->position;
+      snapshot->tail_lengths[i]++;
+    }
+    snapshot->players.tails[i] = NULL;
+  }
+  snapshot->frame = game->frame;
+  snapshot->max_tail_length = game->max_tail_length;
+  snapshot->rng_state = game->rng_state;
+  snapshot->id_counter = game->id_counter;
+  snapshot->game_started = game->game_started;
+  snapshot->state_hash = game->state_hash;
+  return 0;
+}
+
+int game_restore(Game *game, const GameSnapshot *snapshot) {
+  if (!game || !snapshot || !same_grid_size(&game->config, &snapshot->config)) {
+    return -1;
+  }
+  /*
+   * Everything that can fail comes first: the nodes are reserved without
+   * counting the current tails, which only return to the pool below, and a
+   * failed grid copy leaves the grid as it was.
+   */
+  if (tail_pool_reserve(game, snapshot->tail_count) != 0 ||
+      grid_copy(&game->grid, &snapshot->grid) != 0) {
+    return -1;
+  }
+  PlayerMap *map = game->players;
+  for (uint32_t i = 0; i < map->size; i++) {
+    tail_release_all(game, map->tails[i]);
+  }
+  *map = snapshot->players;
+  const Vec2i *src = snapshot->tails;
+  for (uint32_t i = 0; i < map->size; i++) {
+    TailNode *head = NULL;
+    TailNode **link = &head;
+    for (uint32_t j = 0; j < snapshot->tail_lengths[i]; j++) {
+      TailNode *node = tail_node_alloc(game); /* Reserved above */
+      node->position = *src++;
+      *link = node;
+      link = &node->next;
+    }
+    map->tails[i] = head;
+  }
+  game->frame = snapshot->frame;
+  game->max_tail_length = snapshot->max_tail_length;
+  game->rng_state = snapshot->rng_state;
+  game->id_counter = snapshot->id_counter;
+  game->game_started = snapshot->game_started;
+  game->state_hash = snapshot->state_hash;
+  mark_all_rows_dirty(game);
+  return 0;
+}
+
 int game_config_load(const char *path, GameConfig *config) {
   if (!path || !config) {
     return -1;
@@ -383,6 +1049,26 @@ int game_config_load(const char *path, GameConfig *config) {
           config->game_width = (uint32_t)strtoul(value, NULL, 10);
         } else if (strcmp(current_key, "gameHeight") == 0) {
           config->game_height = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(current_key, "gridStorage") == 0) {
+          if (strcmp(value, "chunked") == 0) {
+            config->grid_storage = grid_storage_chunked;
+          } else if (strcmp(value, "tiled") == 0) {
+            config->grid_storage = grid_storage_tiled;
+          } else {
+            config->grid_storage = grid_storage_dense;
+          }
+        } else if (strcmp(current_key, "hugePages") == 0) {
+          config->huge_pages = strcmp(value, "true") == 0 ||
+                               strcmp(value, "True") == 0 ||
+                               strcmp(value, "1") == 0;
+        } else if (strcmp(current_key, "renderFps") == 0) {
+          config->render_fps = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(current_key, "renderEveryNthTick") == 0) {
+          config->render_tick_stride = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(current_key, "renderInterpolate") == 0) {
+          config->render_interpolate = strcmp(value, "true") == 0 ||
+                                       strcmp(value, "True") == 0 ||
+                                       strcmp(value, "1") == 0;
         } else if (strcmp(current_key, "enablePostProcessing") == 0) {
           if (strcmp(value, "true") == 0 || strcmp(value, "True") == 0 ||
               strcmp(value, "1") == 0) {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "cycles_hash.h"
+#include "grid.h"
 #include "player.h"
 #include "player_map.h"
 #include "server_utils.h"
@@ -17,22 +19,55 @@ extern "C" {
  * @brief Core game logic for the Cycles game server (C port).
  */
 
+struct TailBlock;
+
 /**
  * @brief Game structure, main state holder
  */
 typedef struct {
-  GameConfig config;  ///< Game configuration
-  PlayerMap *players; ///< Map of players
-  uint8_t *grid;      ///< Game grid
-  uint32_t frame;     ///< Current frame number
+  GameConfig config;         ///< Game configuration
+  PlayerMap *players;        ///< Map of players
+  Grid grid;                 ///< Game grid and occupancy bits
+  uint32_t frame;            ///< Current frame number
 
   pthread_mutex_t game_mutex;
   size_t max_tail_length;
   uint64_t rng_state;
   PlayerId id_counter;
   bool game_started;
+  struct TailBlock *tail_blocks; ///< Storage blocks backing all tail nodes
+  TailNode *tail_free_list;      ///< Recycled tail nodes
+  size_t tail_free_count;        ///< Nodes in tail_free_list
+  uint64_t state_hash;           ///< Zobrist hash of the grid contents
+  uint8_t fixed_board; ///< Size-specialized kernel set, 0 = generic only
+  uint64_t *dirty_rows; ///< Rows written since game_take_dirty_rows()
+  uint32_t *row_versions; ///< Per-row write counters, see game_row_version()
 } Game;
 
+/**
+ * @brief Preallocated copy of a game state
+ *
+ * Holds everything needed to rewind a Game: grid, occupancy, players with
+ * their tails (flattened), RNG state, frame and tail length. Buffers are
+ * sized when the snapshot is created and only grow when a later snapshot
+ * holds more tail cells than any previous one.
+ */
+typedef struct {
+  GameConfig config;                  ///< Configuration of the captured game
+  Grid grid;                          ///< Copy of the grid and occupancy
+  PlayerMap players;                  ///< Players, tail pointers cleared
+  Vec2i *tails;                       ///< All tails, concatenated in slot order
+  uint32_t tail_lengths[MAX_PLAYERS]; ///< Tail length per map slot
+  size_t tail_count;                  ///< Number of valid entries in tails
+  size_t tail_capacity;               ///< Allocated entries in tails
+  uint32_t frame;                     ///< Captured frame number
+  size_t max_tail_length;             ///< Captured tail length limit
+  uint64_t rng_state;                 ///< Captured RNG state
+  PlayerId id_counter;                ///< Next player ID to hand out
+  bool game_started;                  ///< Captured game_started flag
+  uint64_t state_hash;                ///< Captured grid hash
+} GameSnapshot;
+
 /**
  * @brief Create a new game instance
  */
@@ -57,36 +92,170 @@ void game_remove_player(Game *game, PlayerId id);
 /**
  * @brief Move all players, detect collisions, update grid
  * @param directions Array indexed by player ID (size MAX_PLAYERS)
+ * @return 0 on success, -1 if a cell could not be written; a player whose
+ * new head could not be written is removed
+ */
+int game_move_players(Game *game, const Direction *directions);
+
+/**
+ * @brief Implementations of the move legality pass of game_move_players()
+ */
+typedef enum {
+  legality_kernel_scalar = 0, ///< Portable loop, one player at a time
+  legality_kernel_avx2 = 1,   ///< x86-64, 8 players per step with gathers
+  legality_kernel_neon = 2,   ///< AArch64, 4 players per step
+  legality_kernel_fixed = 3   ///< Scalar, board size fixed at compile time
+} LegalityKernel;
+
+/**
+ * @brief Fastest legality kernel supported by this CPU
+ *
+ * Picked once at runtime; this is the kernel game_move_players() uses.
+ * Games on a board with size-specialized kernels (see
+ * game_has_fixed_board_kernels()) use legality_kernel_fixed instead when the
+ * vector kernel would not fill a single step.
+ */
+LegalityKernel game_best_legality_kernel(void);
+
+/**
+ * @brief Check whether the game runs kernels specialized on its board size
+ *
+ * Chosen in game_create() for the common 100x100 and 256x256 boards with
+ * dense or tiled storage. Other boards use the generic kernels.
+ */
+bool game_has_fixed_board_kernels(const Game *game);
+
+/**
+ * @brief Run the legality pass alone, for testing and benchmarking
+ *
+ * For every player slot computes the target cell for directions[id] and
+ * whether it is inside the board and empty. Collisions between players are
+ * not considered.
+ * @param targets Output, one entry per slot (size MAX_PLAYERS)
+ * @param legal Output, one entry per slot (size MAX_PLAYERS)
+ * @return Number of players, or -1 if the kernel is not supported here
  */
-void game_move_players(Game *game, const Direction *directions);
+int game_check_moves(const Game *game, const Direction *directions,
+                     LegalityKernel kernel, Vec2i *targets, bool *legal);
 
 /**
  * @brief Get read-only access to grid data
- * @return Grid pointer (row-major, size = width * height)
+ * @return Grid pointer (row-major, size = width * height), or NULL if the
+ * grid uses chunked or tiled storage. Use game_get_grid_storage() with
+ * grid_chunk_iter_next() or grid_copy_rows() to read any storage.
  */
 const uint8_t *game_get_grid(const Game *game);
 
+/**
+ * @brief Get read-only access to the grid storage
+ */
+const Grid *game_get_grid_storage(const Game *game);
+
+/**
+ * @brief Get read-only access to the occupancy bitboard
+ *
+ * Bit (x & 63) of word [y * words_per_row + (x >> 6)] is set when cell (x,y)
+ * is occupied. Each row starts on a word boundary and padding bits past the
+ * grid width are always zero. The bitboard is updated together with the grid.
+ *
+ * @param words_per_row Output for the number of 64-bit words per row
+ * @return Bitboard pointer, or NULL if game is NULL or the grid uses chunked
+ * storage (chunk views carry their own occupancy words)
+ */
+const uint64_t *game_get_occupancy(const Game *game, uint32_t *words_per_row);
+
+/**
+ * @brief Test a cell in an occupancy bitboard
+ * @note No bounds checking is performed
+ */
+static inline bool game_occupancy_test(const uint64_t *occupancy,
+                                       uint32_t words_per_row, uint32_t x,
+                                       uint32_t y) {
+  return (occupancy[(size_t)y * words_per_row + (x >> 6)] >> (x & 63)) & 1u;
+}
+
+/**
+ * @brief Count occupied cells using the occupancy bitboard
+ */
+uint64_t game_count_occupied_cells(const Game *game);
+
+/**
+ * @brief Collect the grid rows written since the previous call
+ *
+ * Bit (y & 63) of rows[y >> 6] is set for every row y that had a cell write,
+ * and the game's own set is cleared. The bits are handed over atomically, so
+ * a renderer may call this while the simulation runs on another thread.
+ * @param rows Bitmap of (height + 63) / 64 words, OR-ed with the dirty rows
+ * @return true if any row was dirty
+ */
+bool game_take_dirty_rows(Game *game, uint64_t *rows);
+
+/**
+ * @brief Get the write counter of a grid row
+ *
+ * The counter grows on every cell write to the row, so any number of readers
+ * can find the rows changed since they last looked by comparing counters,
+ * unlike game_take_dirty_rows() which has a single consumer.
+ * @return Counter of row y, 0 for a NULL game or a row outside the grid
+ */
+uint32_t game_row_version(const Game *game, uint32_t y);
+
+/**
+ * @brief Overwrite whole grid rows, e.g. with a board received from elsewhere
+ *
+ * Cells are written like moves write them, so occupancy, the state hash,
+ * dirty rows and row versions stay consistent. Players are not touched.
+ * @param owners count rows of grid_width owner ids, row-major
+ * @return 0 on success, -1 on NULL arguments or rows outside the grid
+ */
+int game_load_rows(Game *game, uint32_t y, uint32_t count,
+                   const uint8_t *owners);
+
+/**
+ * @brief Get the Zobrist hash of the grid, maintained on every cell write
+ *
+ * The hash is the XOR of cycles_zobrist_key() over all occupied cells (see
+ * cycles_hash.h), so clients can compute it from a received grid.
+ */
+uint64_t game_get_state_hash(const Game *game);
+
+/**
+ * @brief Recompute the grid hash from scratch, for verification
+ */
+uint64_t game_compute_state_hash(const Game *game);
+
+/**
+ * @brief Get the memory backing of the grid cells
+ *
+ * Reports whether the hugePages option actually obtained huge pages. Chunked
+ * grids and small boards always report page_backing_heap.
+ */
+PageBacking game_get_grid_backing(const Game *game);
+
 /**
  * @brief Get grid dimensions
  */
 void game_get_grid_size(const Game *game, uint32_t *width, uint32_t *height);
 
 /**
- * @brief Get read-only access to a player
+ * @brief Get a copy of a player
+ *
+ * The tail list of the copy belongs to the game and is only valid until the
+ * next game_move_players() or game_remove_player().
  * @param id Player ID
- * @return Pointer to player structure, or NULL if not found
+ * @param player Output, filled if the player is found
+ * @return true if found
  */
-const Player *game_get_player(Game *game, PlayerId id);
+bool game_get_player(Game *game, PlayerId id, Player *player);
 
 /**
- * @brief
- */
-/**
- * @brief Get all active players
- * @param players Output array (allocated by caller)
+ * @brief Get copies of all active players
+ *
+ * Tail lists are shared with the game, as for game_get_player().
+ * @param players Output array (allocated by caller, MAX_PLAYERS entries)
  * @return Number of active players
  */
-uint32_t game_get_players(Game *game, Player **players);
+uint32_t game_get_players(Game *game, Player *players);
 
 /**
  * @brief Check if game is over (0 or 1 players remaining)
@@ -99,6 +268,47 @@ bool game_is_over(const Game *game);
 uint32_t game_get_frame(const Game *game);
 void game_set_frame(Game *game, uint32_t frame);
 
+/**
+ * @brief Create an independent deep copy of a game
+ *
+ * The clone has its own grid, players, tails and RNG state, so it can be
+ * advanced with game_move_players() without affecting the original.
+ * @return New game (free with game_destroy()), or NULL on failure
+ */
+Game *game_clone(const Game *game);
+
+/**
+ * @brief Allocate a snapshot arena sized for a game
+ * @return Snapshot (free with game_snapshot_destroy()), or NULL on failure
+ */
+GameSnapshot *game_snapshot_create(const Game *game);
+
+/**
+ * @brief Destroy a snapshot arena
+ */
+void game_snapshot_destroy(GameSnapshot *snapshot);
+
+/**
+ * @brief Copy the current game state into a snapshot arena
+ *
+ * Does not allocate unless the game holds more tail cells than the arena has
+ * ever stored.
+ * @return 0 on success, -1 on failure (NULL arguments, grid size or storage
+ * mismatch, or out of memory), in which case the snapshot keeps what the last
+ * successful game_snapshot() stored
+ */
+int game_snapshot(const Game *game, GameSnapshot *snapshot);
+
+/**
+ * @brief Rewind a game to a previously taken snapshot
+ *
+ * Grid, occupancy and players are copied back and tails are rebuilt from the
+ * game's recycled tail nodes, so restoring never allocates per node.
+ * @return 0 on success, -1 on failure (NULL arguments, grid size mismatch or
+ * out of memory), in which case the game is left unchanged
+ */
+int game_restore(Game *game, const GameSnapshot *snapshot);
+
 /**
  * @brief Load configuration from YAML file
  * @return 0 on success, -1 on failure
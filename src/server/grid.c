@@ -0,0 +1,315 @@
+#include "grid.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t chunk_count(const Grid *grid) {
+  return (size_t)grid->chunks_x * grid->chunks_y;
+}
+
+static size_t occupancy_word_count(const Grid *grid) {
+  return (size_t)grid->occupancy_stride * grid->height;
+}
+
+/* Allocation sizes of the dense arrays, one spare element like before.
+ * Tiled grids are padded to whole blocks. */
+static size_t cells_bytes(const Grid *grid) {
+  if (grid->storage == grid_storage_tiled) {
+    return (chunk_count(grid) << (2 * GRID_CHUNK_SHIFT)) + 1;
+  }
+  return ((size_t)grid->width * grid->height + 1) * sizeof(uint8_t);
+}
+
+static size_t occupancy_bytes(const Grid *grid) {
+  return (occupancy_word_count(grid) + 1) * sizeof(uint64_t);
+}
+
+int grid_init(Grid *grid, uint32_t width, uint32_t height,
+              GridStorage storage) {
+  return grid_init_ex(grid, width, height, storage, false);
+}
+
+int grid_init_ex(Grid *grid, uint32_t width, uint32_t height,
+                 GridStorage storage, bool huge_pages) {
+  if (!grid) {
+    return -1;
+  }
+  memset(grid, 0, sizeof(Grid));
+  grid->storage = storage;
+  grid->width = width;
+  grid->height = height;
+  grid->chunks_x = (width + GRID_CHUNK_MASK) >> GRID_CHUNK_SHIFT;
+  grid->chunks_y = (height + GRID_CHUNK_MASK) >> GRID_CHUNK_SHIFT;
+  if (storage == grid_storage_chunked) {
+    grid->chunks = calloc(chunk_count(grid) + 1, sizeof(GridChunk *));
+    return grid->chunks ? 0 : -1;
+  }
+  grid->occupancy_stride = (width + 63) / 64;
+  grid->huge_pages = huge_pages;
+  grid->cells =
+      huge_pages_alloc(cells_bytes(grid), huge_pages, &grid->cells_backing);
+  grid->occupancy = huge_pages_alloc(occupancy_bytes(grid), huge_pages,
+                                     &grid->occupancy_backing);
+  if (!grid->cells || !grid->occupancy) {
+    grid_free(grid);
+    return -1;
+  }
+  return 0;
+}
+
+void grid_free(Grid *grid) {
+  if (!grid) {
+    return;
+  }
+  huge_pages_free(grid->cells, cells_bytes(grid), grid->cells_backing);
+  huge_pages_free(grid->occupancy, occupancy_bytes(grid),
+                  grid->occupancy_backing);
+  if (grid->chunks) {
+    for (size_t i = 0; i < chunk_count(grid); i++) {
+      free(grid->chunks[i]);
+    }
+    free(grid->chunks);
+  }
+  memset(grid, 0, sizeof(Grid));
+}
+
+int grid_copy(Grid *dst, const Grid *src) {
+  if (!dst || !src || dst->storage != src->storage ||
+      dst->width != src->width || dst->height != src->height) {
+    return -1;
+  }
+  if (src->storage != grid_storage_chunked) {
+    memcpy(dst->cells, src->cells, cells_bytes(src));
+    memcpy(dst->occupancy, src->occupancy,
+           occupancy_word_count(src) * sizeof(uint64_t));
+    return 0;
+  }
+  /* Allocate first, so a failure leaves dst with the same contents. New
+   * chunks start empty, which is what a missing chunk means too. */
+  for (size_t i = 0; i < chunk_count(src); i++) {
+    if (src->chunks[i] && !dst->chunks[i]) {
+      dst->chunks[i] = calloc(1, sizeof(GridChunk));
+      if (!dst->chunks[i]) {
+        return -1;
+      }
+      dst->allocated_chunks++;
+    }
+  }
+  for (size_t i = 0; i < chunk_count(src); i++) {
+    if (src->chunks[i]) {
+      memcpy(dst->chunks[i], src->chunks[i], sizeof(GridChunk));
+    } else if (dst->chunks[i]) {
+      free(dst->chunks[i]);
+      dst->chunks[i] = NULL;
+      dst->allocated_chunks--;
+    }
+  }
+  return 0;
+}
+
+int grid_set_chunked(Grid *grid, uint32_t x, uint32_t y, uint8_t value) {
+  size_t index = grid_chunk_index(grid, x, y);
+  GridChunk *chunk = grid->chunks[index];
+  if (!chunk) {
+    if (value == 0) {
+      return 0;
+    }
+    chunk = calloc(1, sizeof(GridChunk));
+    if (!chunk) {
+      return -1;
+    }
+    grid->chunks[index] = chunk;
+    grid->allocated_chunks++;
+  }
+  uint8_t *cell = &chunk->cells[grid_chunk_offset(x, y)];
+  uint64_t *word = &chunk->occupancy[y & GRID_CHUNK_MASK];
+  uint64_t bit = 1ULL << (x & GRID_CHUNK_MASK);
+  if (*cell == 0 && value != 0) {
+    chunk->occupied++;
+  } else if (*cell != 0 && value == 0) {
+    chunk->occupied--;
+  }
+  *cell = value;
+  if (value != 0) {
+    *word |= bit;
+  } else {
+    *word &= ~bit;
+  }
+  if (chunk->occupied == 0) {
+    free(chunk);
+    grid->chunks[index] = NULL;
+    grid->allocated_chunks--;
+  }
+  return 0;
+}
+
+uint64_t grid_count_occupied(const Grid *grid) {
+  if (!grid) {
+    return 0;
+  }
+  uint64_t count = 0;
+  if (grid->storage != grid_storage_chunked) {
+    for (size_t i = 0; i < occupancy_word_count(grid); i++) {
+      count += (uint64_t)__builtin_popcountll(grid->occupancy[i]);
+    }
+    return count;
+  }
+  for (size_t i = 0; i < chunk_count(grid); i++) {
+    if (grid->chunks[i]) {
+      count += grid->chunks[i]->occupied;
+    }
+  }
+  return count;
+}
+
+void grid_copy_rows(const Grid *grid, uint32_t y, uint32_t rows,
+                    uint8_t *dst) {
+  if (!grid) {
+    return;
+  }
+  grid_copy_window(grid, 0, y, grid->width, rows, dst);
+}
+
+/* Transpose tiles back to row-major. Each tile is one cache line, so it is
+ * read once for all its rows in the window, 8 cells per load. */
+static void copy_window_tiled(const Grid *grid, uint32_t x, uint32_t y,
+                              uint32_t width, uint32_t height, uint8_t *dst) {
+  uint32_t row = y;
+  while (row < y + height) {
+    uint32_t rows = GRID_TILE_MASK + 1 - (row & GRID_TILE_MASK);
+    if (rows > y + height - row) {
+      rows = y + height - row;
+    }
+    uint32_t col = x;
+    while (col < x + width) {
+      uint32_t run = GRID_TILE_MASK + 1 - (col & GRID_TILE_MASK);
+      if (run > x + width - col) {
+        run = x + width - col;
+      }
+      const uint8_t *src = &grid->cells[grid_cell_offset(grid, col, row)];
+      uint8_t *out = dst + (size_t)(row - y) * width + (col - x);
+      if (run == GRID_TILE_MASK + 1) {
+        for (uint32_t j = 0; j < rows; j++) {
+          uint64_t cells;
+          memcpy(&cells, src + ((size_t)j << GRID_TILE_SHIFT), sizeof cells);
+          memcpy(out + (size_t)j * width, &cells, sizeof cells);
+        }
+      } else {
+        for (uint32_t j = 0; j < rows; j++) {
+          memcpy(out + (size_t)j * width, src + ((size_t)j << GRID_TILE_SHIFT),
+                 run);
+        }
+      }
+      col += run;
+    }
+    row += rows;
+  }
+}
+
+void grid_copy_window(const Grid *grid, uint32_t x, uint32_t y,
+                      uint32_t width, uint32_t height, uint8_t *dst) {
+  if (!grid || !dst || width == 0 || height == 0) {
+    return;
+  }
+  if (grid->storage == grid_storage_dense) {
+    for (uint32_t row = 0; row < height; row++) {
+      memcpy(dst + (size_t)row * width,
+             &grid->cells[(size_t)(y + row) * grid->width + x], width);
+    }
+    return;
+  }
+  if (grid->storage == grid_storage_tiled) {
+    copy_window_tiled(grid, x, y, width, height, dst);
+    return;
+  }
+  memset(dst, 0, (size_t)width * height);
+  for (uint32_t row = y; row < y + height; row++) {
+    uint8_t *out = dst + (size_t)(row - y) * width;
+    uint32_t col = x;
+    while (col < x + width) {
+      /* Copy the run of cells that falls into the chunk holding col */
+      uint32_t run = GRID_CHUNK_SIZE - (col & GRID_CHUNK_MASK);
+      if (run > x + width - col) {
+        run = x + width - col;
+      }
+      const GridChunk *chunk = grid->chunks[grid_chunk_index(grid, col, row)];
+      if (chunk) {
+        memcpy(out + (col - x), &chunk->cells[grid_chunk_offset(col, row)],
+               run);
+      }
+      col += run;
+    }
+  }
+}
+
+void grid_chunk_iter_init(GridChunkIter *iter, const Grid *grid) {
+  if (!iter) {
+    return;
+  }
+  iter->grid = grid;
+  iter->next_chunk = 0;
+}
+
+/* Fill a view for tile (cx, cy); returns false if the tile is empty. Tiled
+ * grids are copied to scratch in row-major order. */
+static bool grid_tile_view(const Grid *grid, uint32_t cx, uint32_t cy,
+                           uint8_t *scratch, GridChunkView *view) {
+  uint32_t x0 = cx << GRID_CHUNK_SHIFT;
+  uint32_t y0 = cy << GRID_CHUNK_SHIFT;
+  view->x = x0;
+  view->y = y0;
+  view->width = grid->width - x0 < GRID_CHUNK_SIZE ? grid->width - x0
+                                                   : GRID_CHUNK_SIZE;
+  view->height = grid->height - y0 < GRID_CHUNK_SIZE ? grid->height - y0
+                                                     : GRID_CHUNK_SIZE;
+  if (grid->storage == grid_storage_chunked) {
+    const GridChunk *chunk = grid->chunks[(size_t)cy * grid->chunks_x + cx];
+    if (!chunk) {
+      return false;
+    }
+    view->cells = chunk->cells;
+    view->stride = GRID_CHUNK_SIZE;
+    view->occupancy = chunk->occupancy;
+    view->occupancy_stride = 1;
+    return true;
+  }
+  /* Dense tiles are 64 wide, so each row maps to exactly one word */
+  const uint64_t *occupancy =
+      &grid->occupancy[(size_t)y0 * grid->occupancy_stride + cx];
+  uint64_t any = 0;
+  for (uint32_t j = 0; j < view->height; j++) {
+    any |= occupancy[(size_t)j * grid->occupancy_stride];
+  }
+  if (!any) {
+    return false;
+  }
+  if (grid->storage == grid_storage_tiled) {
+    copy_window_tiled(grid, x0, y0, view->width, view->height, scratch);
+    view->cells = scratch;
+    view->stride = view->width;
+  } else {
+    view->cells = &grid->cells[(size_t)y0 * grid->width + x0];
+    view->stride = grid->width;
+  }
+  view->occupancy = occupancy;
+  view->occupancy_stride = grid->occupancy_stride;
+  return true;
+}
+
+bool grid_chunk_iter_next(GridChunkIter *iter, GridChunkView *view) {
+  if (!iter || !iter->grid || !view) {
+    return false;
+  }
+  const Grid *grid = iter->grid;
+  uint32_t chunks_x = (grid->width + GRID_CHUNK_MASK) >> GRID_CHUNK_SHIFT;
+  uint32_t chunks_y = (grid->height + GRID_CHUNK_MASK) >> GRID_CHUNK_SHIFT;
+  size_t total = (size_t)chunks_x * chunks_y;
+  while (iter->next_chunk < total) {
+    size_t index = iter->next_chunk++;
+    uint32_t cx = (uint32_t)(index % chunks_x);
+    uint32_t cy = (uint32_t)(index / chunks_x);
+    if (grid_tile_view(grid, cx, cy, iter->scratch, view)) {
+      return true;
+    }
+  }
+  return false;
+}
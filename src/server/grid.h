@@ -0,0 +1,260 @@
+#pragma once
+
+#include "huge_pages.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file grid.h
+ * @brief Storage for the game grid (owner byte per cell plus occupancy bits).
+ *
+ * Three backends are available:
+ * - Dense: one row-major byte array and a row-aligned occupancy bitboard.
+ * - Chunked: fixed-size square chunks allocated on first write and freed when
+ *   their last cell is cleared, so memory scales with the occupied area.
+ * - Tiled: like dense, but cells are stored in 8x8 tiles of one cache line
+ *   each, Morton-ordered inside page-sized 64x64 blocks. Neighbours in any
+ *   direction usually share a cache line, and always a page within a block.
+ *   Use grid_copy_window() to get row-major data, e.g. for the wire.
+ *
+ * All indexing is done in 64 bits, so boards larger than 2^31 cells work.
+ * The dense arrays can optionally be backed by huge pages (see huge_pages.h).
+ */
+
+/** Chunk side is 1 << GRID_CHUNK_SHIFT cells */
+enum { GRID_CHUNK_SHIFT = 6 };
+/** Chunk side in cells, one occupancy word per chunk row */
+enum { GRID_CHUNK_SIZE = 1 << GRID_CHUNK_SHIFT };
+/** Mask to get the in-chunk coordinate */
+enum { GRID_CHUNK_MASK = GRID_CHUNK_SIZE - 1 };
+/** Tile side of the tiled backend is 1 << GRID_TILE_SHIFT cells */
+enum { GRID_TILE_SHIFT = 3 };
+/** Mask to get the in-tile coordinate */
+enum { GRID_TILE_MASK = (1 << GRID_TILE_SHIFT) - 1 };
+
+/**
+ * @brief A lazily allocated square piece of a chunked grid
+ */
+typedef struct {
+  uint8_t cells[GRID_CHUNK_SIZE * GRID_CHUNK_SIZE]; ///< Row-major owners
+  uint64_t occupancy[GRID_CHUNK_SIZE];              ///< One word per row
+  uint32_t occupied;                                ///< Non-empty cells
+} GridChunk;
+
+/**
+ * @brief Grid storage
+ */
+typedef struct {
+  GridStorage storage; ///< Backend in use
+  uint32_t width;      ///< Width in cells
+  uint32_t height;     ///< Height in cells
+  /* Dense and tiled backends */
+  uint8_t *cells;                ///< Owners, see grid_cell_offset()
+  uint64_t *occupancy;           ///< Row-aligned occupancy bitboard
+  uint32_t occupancy_stride;     ///< 64-bit words per bitboard row
+  bool huge_pages;               ///< Huge pages were requested
+  PageBacking cells_backing;     ///< Backing of cells
+  PageBacking occupancy_backing; ///< Backing of occupancy
+  /* Chunked backend, chunks_x and chunks_y also count tiled blocks */
+  GridChunk **chunks;      ///< Chunk table, NULL entries are empty
+  uint32_t chunks_x;       ///< Chunks per row of chunks
+  uint32_t chunks_y;       ///< Rows of chunks
+  size_t allocated_chunks; ///< Number of live chunks
+} Grid;
+
+/**
+ * @brief Read-only view of one chunk-sized tile of a grid
+ *
+ * Cell (x + i, y + j) lives at cells[j * stride + i]. Bit i of
+ * occupancy[j * occupancy_stride] is set when that cell is occupied.
+ */
+typedef struct {
+  uint32_t x;                ///< First column of the tile
+  uint32_t y;                ///< First row of the tile
+  uint32_t width;            ///< Tile width, clipped to the grid
+  uint32_t height;           ///< Tile height, clipped to the grid
+  const uint8_t *cells;      ///< Cell (x, y)
+  size_t stride;             ///< Cells between consecutive rows
+  const uint64_t *occupancy; ///< Occupancy word of the first row
+  size_t occupancy_stride;   ///< Words between consecutive rows
+} GridChunkView;
+
+/**
+ * @brief Iterator over the non-empty tiles of a grid
+ */
+typedef struct {
+  const Grid *grid;
+  size_t next_chunk;
+  /** Row-major copy of the current block of a tiled grid */
+  uint8_t scratch[GRID_CHUNK_SIZE * GRID_CHUNK_SIZE];
+} GridChunkIter;
+
+/**
+ * @brief Initialize an empty grid
+ * @return 0 on success, -1 on allocation failure
+ */
+int grid_init(Grid *grid, uint32_t width, uint32_t height,
+              GridStorage storage);
+
+/**
+ * @brief Initialize an empty grid, optionally backing the dense arrays with
+ * huge pages
+ *
+ * The backing obtained is reported in cells_backing and occupancy_backing.
+ * The chunked backend ignores huge_pages, its chunks are much smaller than a
+ * huge page.
+ * @return 0 on success, -1 on allocation failure
+ */
+int grid_init_ex(Grid *grid, uint32_t width, uint32_t height,
+                 GridStorage storage, bool huge_pages);
+
+/**
+ * @brief Release all grid memory
+ */
+void grid_free(Grid *grid);
+
+/**
+ * @brief Copy contents of src into dst
+ *
+ * Both grids must have the same size and storage. Chunks are reused where
+ * possible, so copying between warm grids does not allocate. On failure dst
+ * keeps its contents.
+ * @return 0 on success, -1 on mismatch or allocation failure
+ */
+int grid_copy(Grid *dst, const Grid *src);
+
+/**
+ * @brief Set the owner of a cell (0 clears it)
+ * @return 0 on success, -1 if a chunk could not be allocated
+ * @note No bounds checking is performed
+ */
+int grid_set_chunked(Grid *grid, uint32_t x, uint32_t y, uint8_t value);
+
+/**
+ * @brief Count occupied cells
+ */
+uint64_t grid_count_occupied(const Grid *grid);
+
+/**
+ * @brief Copy rows [y, y + rows) into a row-major buffer of width * rows
+ * bytes. Empty chunks are written as zeros.
+ */
+void grid_copy_rows(const Grid *grid, uint32_t y, uint32_t rows,
+                    uint8_t *dst);
+
+/**
+ * @brief Copy the window [x, x + width) x [y, y + height) into a row-major
+ * buffer of width * height bytes. The window must lie inside the grid.
+ */
+void grid_copy_window(const Grid *grid, uint32_t x, uint32_t y,
+                      uint32_t width, uint32_t height, uint8_t *dst);
+
+/**
+ * @brief Start iterating over the tiles of a grid that hold occupied cells
+ */
+void grid_chunk_iter_init(GridChunkIter *iter, const Grid *grid);
+
+/**
+ * @brief Advance the iterator
+ *
+ * For tiled grids the view cells point into the iterator and are only valid
+ * until the next call.
+ * @return true and fills view if a tile was found, false when done
+ */
+bool grid_chunk_iter_next(GridChunkIter *iter, GridChunkView *view);
+
+static inline size_t grid_chunk_index(const Grid *grid, uint32_t x,
+                                      uint32_t y) {
+  return (size_t)(y >> GRID_CHUNK_SHIFT) * grid->chunks_x +
+         (x >> GRID_CHUNK_SHIFT);
+}
+
+static inline size_t grid_chunk_offset(uint32_t x, uint32_t y) {
+  return ((size_t)(y & GRID_CHUNK_MASK) << GRID_CHUNK_SHIFT) |
+         (x & GRID_CHUNK_MASK);
+}
+
+/* Spread the low three bits of v to even bit positions */
+static inline size_t grid_spread3(uint32_t v) {
+  return (v & 1u) | ((v & 2u) << 1) | ((v & 4u) << 2);
+}
+
+/**
+ * @brief Index of a cell in the cells array of a dense or tiled grid
+ *
+ * Tiled cells live in the 64x64 block of grid_chunk_index(), in the tile at
+ * the Morton index of the tile coordinates, row-major inside the tile.
+ */
+static inline size_t grid_cell_offset(const Grid *grid, uint32_t x,
+                                      uint32_t y) {
+  if (grid->storage == grid_storage_dense) {
+    return (size_t)y * grid->width + x;
+  }
+  size_t tile = grid_spread3((x >> GRID_TILE_SHIFT) & GRID_TILE_MASK) |
+                grid_spread3((y >> GRID_TILE_SHIFT) & GRID_TILE_MASK) << 1;
+  return grid_chunk_index(grid, x, y) << (2 * GRID_CHUNK_SHIFT) |
+         tile << (2 * GRID_TILE_SHIFT) |
+         (size_t)(y & GRID_TILE_MASK) << GRID_TILE_SHIFT |
+         (x & GRID_TILE_MASK);
+}
+
+/**
+ * @brief Get the owner of a cell
+ * @note No bounds checking is performed
+ */
+static inline uint8_t grid_get(const Grid *grid, uint32_t x, uint32_t y) {
+  if (grid->storage != grid_storage_chunked) {
+    return grid->cells[grid_cell_offset(grid, x, y)];
+  }
+  const GridChunk *chunk = grid->chunks[grid_chunk_index(grid, x, y)];
+  return chunk ? chunk->cells[grid_chunk_offset(x, y)] : 0;
+}
+
+/**
+ * @brief Check whether a cell is occupied using the occupancy bits
+ * @note No bounds checking is performed
+ */
+static inline bool grid_is_occupied(const Grid *grid, uint32_t x,
+                                    uint32_t y) {
+  if (grid->storage != grid_storage_chunked) {
+    return (grid->occupancy[(size_t)y * grid->occupancy_stride + (x >> 6)] >>
+            (x & 63)) &
+           1u;
+  }
+  const GridChunk *chunk = grid->chunks[grid_chunk_index(grid, x, y)];
+  return chunk && ((chunk->occupancy[y & GRID_CHUNK_MASK] >>
+                    (x & GRID_CHUNK_MASK)) &
+                   1u);
+}
+
+/**
+ * @brief Set the owner of a cell (0 clears it), keeping occupancy in sync
+ * @return 0 on success, -1 if a chunk could not be allocated
+ * @note No bounds checking is performed
+ */
+static inline int grid_set(Grid *grid, uint32_t x, uint32_t y,
+                           uint8_t value) {
+  if (grid->storage == grid_storage_chunked) {
+    return grid_set_chunked(grid, x, y, value);
+  }
+  grid->cells[grid_cell_offset(grid, x, y)] = value;
+  uint64_t *word =
+      &grid->occupancy[(size_t)y * grid->occupancy_stride + (x >> 6)];
+  uint64_t bit = 1ULL << (x & 63);
+  if (value != 0) {
+    *word |= bit;
+  } else {
+    *word &= ~bit;
+  }
+  return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
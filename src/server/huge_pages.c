@@ -0,0 +1,86 @@
+#include "huge_pages.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+static size_t round_to_huge_page(size_t size) {
+  return (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+}
+
+/* Map length bytes aligned to a huge page, so THP can back all of it */
+static void *map_aligned(size_t length) {
+  size_t padded = length + HUGE_PAGE_SIZE;
+  uint8_t *raw = mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return NULL;
+  }
+  uintptr_t start = ((uintptr_t)raw + HUGE_PAGE_SIZE - 1) &
+                    ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+  uint8_t *aligned = (uint8_t *)start;
+  size_t head = (size_t)(aligned - raw);
+  if (head) {
+    munmap(raw, head);
+  }
+  size_t tail = padded - head - length;
+  if (tail) {
+    munmap(aligned + length, tail);
+  }
+  return aligned;
+}
+
+void *huge_pages_alloc(size_t size, bool huge, PageBacking *backing) {
+  if (!backing) {
+    return NULL;
+  }
+  if (!huge || size < HUGE_PAGE_SIZE) {
+    *backing = page_backing_heap;
+    return calloc(1, size ? size : 1);
+  }
+  size_t length = round_to_huge_page(size);
+#ifdef MAP_HUGETLB
+  void *ptr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED) {
+    *backing = page_backing_hugetlb;
+    return ptr;
+  }
+#endif
+  /* No reserved huge pages: fall back to transparent ones */
+  void *mapped = map_aligned(length);
+  if (!mapped) {
+    return NULL;
+  }
+  *backing = page_backing_regular;
+#ifdef MADV_HUGEPAGE
+  if (madvise(mapped, length, MADV_HUGEPAGE) == 0) {
+    *backing = page_backing_thp;
+  }
+#endif
+  return mapped;
+}
+
+void huge_pages_free(void *ptr, size_t size, PageBacking backing) {
+  if (!ptr) {
+    return;
+  }
+  if (backing == page_backing_heap) {
+    free(ptr);
+    return;
+  }
+  munmap(ptr, round_to_huge_page(size));
+}
+
+const char *huge_pages_backing_name(PageBacking backing) {
+  switch (backing) {
+  case page_backing_heap:
+    return "heap";
+  case page_backing_regular:
+    return "regular pages";
+  case page_backing_thp:
+    return "transparent huge pages";
+  case page_backing_hugetlb:
+    return "hugetlb pages";
+  }
+  return "unknown";
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file huge_pages.h
+ * @brief Allocation of large buffers backed by huge pages when available.
+ *
+ * Big grids and packet buffers are accessed randomly every frame, so backing
+ * them with 2 MiB pages cuts TLB misses. Explicit huge pages (MAP_HUGETLB)
+ * are tried first, then transparent huge pages (madvise(MADV_HUGEPAGE)), and
+ * finally plain pages. Buffers smaller than a huge page always come from the
+ * heap.
+ */
+
+/** Size of the huge pages requested */
+enum { HUGE_PAGE_SIZE = 2 * 1024 * 1024 };
+
+/** Memory backing obtained for a buffer */
+typedef enum {
+  page_backing_heap = 0,    ///< malloc, small or huge pages not requested
+  page_backing_regular = 1, ///< mmap with regular pages
+  page_backing_thp = 2,     ///< mmap advised for transparent huge pages
+  page_backing_hugetlb = 3  ///< mmap with MAP_HUGETLB
+} PageBacking;
+
+/**
+ * @brief Allocate a zeroed buffer
+ * @param size Size in bytes
+ * @param huge Whether to try huge pages
+ * @param backing Output, backing obtained (needed to free the buffer)
+ * @return Buffer, or NULL on failure
+ */
+void *huge_pages_alloc(size_t size, bool huge, PageBacking *backing);
+
+/**
+ * @brief Free a buffer from huge_pages_alloc()
+ * @param ptr Buffer (NULL is ignored)
+ * @param size Size passed to huge_pages_alloc()
+ * @param backing Backing returned by huge_pages_alloc()
+ */
+void huge_pages_free(void *ptr, size_t size, PageBacking backing);
+
+/**
+ * @brief Human readable name of a backing, for logs
+ */
+const char *huge_pages_backing_name(PageBacking backing);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,274 @@
+#include "label_cache.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  char *text;             /* Owned copy, NULL for a free slot */
+  uint64_t hash;          /* Hash of the whole key */
+  uint32_t color;         /* Packed fill colour */
+  uint32_t outline_color; /* Packed outline colour */
+  int outline_thickness;  /* Outline width in pixels, 0 = none */
+  SDL_Texture *texture;   /* Rasterized label, outline included */
+  int width;              /* Texture width */
+  int height;             /* Texture height */
+  uint64_t last_used;     /* Clock value of the last draw */
+} LabelEntry;
+
+struct LabelCache {
+  SDL_Renderer *renderer;
+  TTF_Font *font;
+  LabelEntry *entries;     /* capacity slots, looked up by hash */
+  uint32_t capacity;
+  uint64_t clock;          /* Incremented on every draw */
+  SDL_Texture *digits;     /* White digits 0-9, tinted when drawn */
+  SDL_Rect digit_rects[10];
+  LabelCacheStats stats;
+};
+
+static uint32_t pack_color(SDL_Color c) {
+  return (uint32_t)c.r << 24 | (uint32_t)c.g << 16 | (uint32_t)c.b << 8 | c.a;
+}
+
+/* FNV-1a over the text, then the colours and thickness */
+static uint64_t label_hash(const char *text, uint32_t color,
+                           uint32_t outline_color, int outline_thickness) {
+  uint64_t hash = 1469598103934665603ULL;
+  for (const char *p = text; *p; p++) {
+    hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+  }
+  uint64_t tail[3] = {color, outline_color, (uint64_t)outline_thickness};
+  for (int i = 0; i < 3; i++) {
+    hash = (hash ^ tail[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static void entry_clear(LabelEntry *e) {
+  if (e->texture) {
+    SDL_DestroyTexture(e->texture);
+  }
+  free(e->text);
+  memset(e, 0, sizeof(LabelEntry));
+}
+
+/**
+ * @brief Rasterize text with its outline into one surface
+ *
+ * The outline is the text stamped at every offset in
+ * [-thickness, thickness]^2, so the glyphs are rendered twice rather than
+ * once per offset.
+ */
+static SDL_Surface *rasterize_label(TTF_Font *font, const char *text,
+                                    SDL_Color color, SDL_Color outline_color,
+                                    int thickness) {
+  SDL_Surface *fill = TTF_RenderText_Blended(font, text, color);
+  if (!fill || thickness <= 0) {
+    return fill;
+  }
+  SDL_Surface *edge = TTF_RenderText_Blended(font, text, outline_color);
+  SDL_Surface *label = SDL_CreateRGBSurfaceWithFormat(
+      0, fill->w + 2 * thickness, fill->h + 2 * thickness, 32,
+      SDL_PIXELFORMAT_ARGB8888);
+  if (!edge || !label) {
+    SDL_FreeSurface(fill);
+    SDL_FreeSurface(edge);
+    SDL_FreeSurface(label);
+    return NULL;
+  }
+  for (int ox = -thickness; ox <= thickness; ox++) {
+    for (int oy = -thickness; oy <= thickness; oy++) {
+      if (ox == 0 && oy == 0)
+        continue;
+      SDL_Rect dst = {thickness + ox, thickness + oy, edge->w, edge->h};
+      SDL_BlitSurface(edge, NULL, label, &dst);
+    }
+  }
+  SDL_Rect dst = {thickness, thickness, fill->w, fill->h};
+  SDL_BlitSurface(fill, NULL, label, &dst);
+  SDL_FreeSurface(edge);
+  SDL_FreeSurface(fill);
+  return label;
+}
+
+/* Render the ten digits side by side into one white texture */
+static void build_digit_atlas(LabelCache *cache) {
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *glyphs[10] = {NULL};
+  int width = 0;
+  int height = 0;
+  bool ok = true;
+  for (int d = 0; d < 10 && ok; d++) {
+    char digit[2] = {(char)('0' + d), '\0'};
+    glyphs[d] = TTF_RenderText_Blended(cache->font, digit, white);
+    ok = glyphs[d] != NULL;
+    if (ok) {
+      cache->digit_rects[d] = (SDL_Rect){width, 0, glyphs[d]->w, glyphs[d]->h};
+      width += glyphs[d]->w;
+      height = glyphs[d]->h > height ? glyphs[d]->h : height;
+    }
+  }
+  SDL_Surface *atlas =
+      ok ? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                          SDL_PIXELFORMAT_ARGB8888)
+         : NULL;
+  if (atlas) {
+    for (int d = 0; d < 10; d++) {
+      /* Copy the glyph pixels as they are, alpha included */
+      SDL_SetSurfaceBlendMode(glyphs[d], SDL_BLENDMODE_NONE);
+      SDL_BlitSurface(glyphs[d], NULL, atlas, &cache->digit_rects[d]);
+    }
+    cache->digits = SDL_CreateTextureFromSurface(cache->renderer, atlas);
+    if (cache->digits) {
+      SDL_SetTextureBlendMode(cache->digits, SDL_BLENDMODE_BLEND);
+    }
+    SDL_FreeSurface(atlas);
+  }
+  for (int d = 0; d < 10; d++) {
+    SDL_FreeSurface(glyphs[d]);
+  }
+}
+
+LabelCache *label_cache_create(SDL_Renderer *renderer, TTF_Font *font,
+                               uint32_t capacity) {
+  if (!renderer || !font || capacity == 0) {
+    return NULL;
+  }
+  LabelCache *cache = calloc(1, sizeof(LabelCache));
+  if (!cache) {
+    return NULL;
+  }
+  cache->entries = calloc(capacity, sizeof(LabelEntry));
+  if (!cache->entries) {
+    free(cache);
+    return NULL;
+  }
+  cache->renderer = renderer;
+  cache->font = font;
+  cache->capacity = capacity;
+  build_digit_atlas(cache);
+  return cache;
+}
+
+void label_cache_destroy(LabelCache *cache) {
+  if (!cache) {
+    return;
+  }
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    entry_clear(&cache->entries[i]);
+  }
+  if (cache->digits) {
+    SDL_DestroyTexture(cache->digits);
+  }
+  free(cache->entries);
+  free(cache);
+}
+
+/* Find a label, or the slot to rasterize it into (free or least recent) */
+static LabelEntry *find_entry(LabelCache *cache, const char *text,
+                              uint64_t hash, uint32_t color,
+                              uint32_t outline_color, int outline_thickness,
+                              bool *found) {
+  LabelEntry *victim = &cache->entries[0];
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    LabelEntry *e = &cache->entries[i];
+    if (!e->text) {
+      if (victim->text) {
+        victim = e;
+      }
+      continue;
+    }
+    if (e->hash == hash && e->color == color &&
+        e->outline_color == outline_color &&
+        e->outline_thickness == outline_thickness &&
+        strcmp(e->text, text) == 0) {
+      *found = true;
+      return e;
+    }
+    if (victim->text && e->last_used < victim->last_used) {
+      victim = e;
+    }
+  }
+  *found = false;
+  return victim;
+}
+
+int label_cache_draw(LabelCache *cache, const char *text, int x, int y,
+                     SDL_Color color, SDL_Color outline_color,
+                     int outline_thickness) {
+  if (!cache || !text) {
+    return -1;
+  }
+  if (outline_thickness < 0) {
+    outline_thickness = 0;
+  }
+  uint32_t fill = pack_color(color);
+  uint32_t outline = outline_thickness > 0 ? pack_color(outline_color) : 0;
+  uint64_t hash = label_hash(text, fill, outline, outline_thickness);
+  bool found = false;
+  LabelEntry *e = find_entry(cache, text, hash, fill, outline,
+                             outline_thickness, &found);
+  if (found) {
+    cache->stats.hits++;
+  } else {
+    cache->stats.misses++;
+    if (e->text) {
+      cache->stats.evictions++;
+      entry_clear(e);
+    }
+    SDL_Surface *surface = rasterize_label(cache->font, text, color,
+                                           outline_color, outline_thickness);
+    if (!surface) {
+      return -1;
+    }
+    e->texture = SDL_CreateTextureFromSurface(cache->renderer, surface);
+    e->width = surface->w;
+    e->height = surface->h;
+    SDL_FreeSurface(surface);
+    e->text = strdup(text);
+    if (!e->texture || !e->text) {
+      entry_clear(e);
+      return -1;
+    }
+    e->hash = hash;
+    e->color = fill;
+    e->outline_color = outline;
+    e->outline_thickness = outline_thickness;
+  }
+  e->last_used = ++cache->clock;
+  SDL_Rect dst = {x - e->outline_thickness, y - e->outline_thickness,
+                  e->width, e->height};
+  SDL_RenderCopy(cache->renderer, e->texture, NULL, &dst);
+  return e->width - 2 * e->outline_thickness;
+}
+
+int label_cache_draw_number(LabelCache *cache, uint32_t value, int x, int y,
+                            SDL_Color color) {
+  if (!cache || !cache->digits) {
+    return -1;
+  }
+  char digits[16];
+  int count = snprintf(digits, sizeof(digits), "%u", value);
+  SDL_SetTextureColorMod(cache->digits, color.r, color.g, color.b);
+  SDL_SetTextureAlphaMod(cache->digits, color.a);
+  int width = 0;
+  for (int i = 0; i < count; i++) {
+    const SDL_Rect *src = &cache->digit_rects[digits[i] - '0'];
+    SDL_Rect dst = {x + width, y, src->w, src->h};
+    SDL_RenderCopy(cache->renderer, cache->digits, src, &dst);
+    width += src->w;
+  }
+  return width;
+}
+
+void label_cache_get_stats(const LabelCache *cache, LabelCacheStats *stats) {
+  if (!cache || !stats) {
+    return;
+  }
+  *stats = cache->stats;
+  stats->size = 0;
+  for (uint32_t i = 0; i < cache->capacity; i++) {
+    stats->size += cache->entries[i].text != NULL;
+  }
+}
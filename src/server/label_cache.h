@@ -0,0 +1,75 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file label_cache.h
+ * @brief Cache of rasterized text labels for the renderer.
+ *
+ * Labels are keyed by (text, colour, outline colour, outline thickness) and
+ * rasterized once into a texture, outline included, so drawing a cached
+ * label is a single copy. The least recently drawn label is evicted when the
+ * cache is full. Numbers that change every frame are drawn from an atlas of
+ * the ten digits instead, so they never miss.
+ */
+
+/** Opaque label cache */
+typedef struct LabelCache LabelCache;
+
+/**
+ * @brief Cache counters, for profiling
+ */
+typedef struct {
+  uint64_t hits;      ///< Draws served from a cached texture
+  uint64_t misses;    ///< Draws that had to rasterize the label
+  uint64_t evictions; ///< Labels dropped to make room
+  uint32_t size;      ///< Labels currently cached
+} LabelCacheStats;
+
+/**
+ * @brief Create a cache
+ * @param renderer Renderer owning the textures
+ * @param font Font used for every label (not owned)
+ * @param capacity Maximum number of cached labels
+ * @return Cache, or NULL on failure
+ */
+LabelCache *label_cache_create(SDL_Renderer *renderer, TTF_Font *font,
+                               uint32_t capacity);
+
+/**
+ * @brief Destroy a cache and its textures
+ */
+void label_cache_destroy(LabelCache *cache);
+
+/**
+ * @brief Draw a label with its top-left corner at (x, y)
+ *
+ * The outline, if any, extends outline_thickness pixels around the text,
+ * which stays at (x, y).
+ * @return Width of the text in pixels, or -1 if it could not be rasterized
+ */
+int label_cache_draw(LabelCache *cache, const char *text, int x, int y,
+                     SDL_Color color, SDL_Color outline_color,
+                     int outline_thickness);
+
+/**
+ * @brief Draw a decimal number from the digit atlas
+ * @return Width of the drawn number in pixels, or -1 on failure
+ */
+int label_cache_draw_number(LabelCache *cache, uint32_t value, int x, int y,
+                            SDL_Color color);
+
+/**
+ * @brief Get the cache counters
+ */
+void label_cache_get_stats(const LabelCache *cache, LabelCacheStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
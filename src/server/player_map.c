@@ -9,6 +9,7 @@ PlayerMap *map_create(void) {
   if (!map) {
     return NULL;
   }
+  memset(map->slot_of, MAP_NO_SLOT, sizeof(map->slot_of));
   return map;
 }
 
@@ -16,66 +17,84 @@ int map_insert(PlayerMap *map, MapKey key, const Player *player) {
   if (!map || !player) {
     return -1;
   }
-  MapEntry *entry = &map->entries[key];
-  if (entry->occupied) {
+  if (map->slot_of[key] != MAP_NO_SLOT || map->size >= MAX_PLAYERS) {
     return -1;
   }
-  map->size++;
-  entry->occupied = true;
-  entry->key = key;
-  entry->player = *player;
+  uint32_t slot = map->size++;
+  map->slot_of[key] = (uint8_t)slot;
+  map->keys[slot] = key;
+  map->positions[slot] = player->position;
+  map->tails[slot] = player->tail_linked_list;
+  memcpy(map->cold[slot].name, player->name, sizeof(player->name));
+  map->cold[slot].color = player->color;
   return 0;
 }
 
-Player *map_find(PlayerMap *map, MapKey key) {
-  if (!map) {
-    return NULL;
+int map_slot(const PlayerMap *map, MapKey key) {
+  if (!map || map->slot_of[key] == MAP_NO_SLOT) {
+    return -1;
   }
+  return map->slot_of[key];
+}
 
-  MapEntry *entry = &map->entries[key];
-  if (entry->occupied) {
-    return &entry->player;
-  }
+/* Assemble the player in a slot from the packed arrays */
+static void copy_player(const PlayerMap *map, uint32_t slot, Player *out) {
+  out->id = map->keys[slot];
+  memcpy(out->name, map->cold[slot].name, sizeof(out->name));
+  out->position = map->positions[slot];
+  out->tail_linked_list = map->tails[slot];
+  out->color = map->cold[slot].color;
+}
 
-  return NULL;
+bool map_find(const PlayerMap *map, MapKey key, Player *out_player) {
+  int slot = map_slot(map, key);
+  if (slot < 0 || !out_player) {
+    return false;
+  }
+  copy_player(map, (uint32_t)slot, out_player);
+  return true;
 }
 
 void map_delete(PlayerMap *map, MapKey key) {
-  if (!map) {
+  int slot = map_slot(map, key);
+  if (slot < 0) {
     return;
   }
-  MapEntry *entry = &map->entries[key];
-  if (entry->occupied) {
-    player_destroy(&entry->player);
-    entry->occupied = false;
-    map->size--;
-    memset(entry, 0, sizeof(MapEntry));
+  Player player;
+  copy_player(map, (uint32_t)slot, &player);
+  player_destroy(&player);
+  uint32_t last = --map->size;
+  if ((uint32_t)slot != last) {
+    /* Swap-remove: the last player takes over the freed slot */
+    map->keys[slot] = map->keys[last];
+    map->positions[slot] = map->positions[last];
+    map->tails[slot] = map->tails[last];
+    map->cold[slot] = map->cold[last];
+    map->slot_of[map->keys[slot]] = (uint8_t)slot;
   }
+  map->slot_of[key] = MAP_NO_SLOT;
+  map->tails[last] = NULL;
+  memset(&map->cold[last], 0, sizeof(PlayerColdData));
 }
 
 uint32_t map_size(const PlayerMap *map) { return map ? map->size : 0; }
 
-uint32_t map_get_all(PlayerMap *map, Player **out_players) {
+uint32_t map_get_all(const PlayerMap *map, Player *out_players) {
   if (!map || !out_players) {
     return 0;
   }
-  uint32_t count = 0;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (map->entries[i].occupied) {
-      out_players[count++] = &map->entries[i].player;
-    }
+  for (uint32_t i = 0; i < map->size; i++) {
+    copy_player(map, i, &out_players[i]);
   }
-  return count;
+  return map->size;
 }
 
 static void map_clear(PlayerMap *map) {
   if (!map) {
     return;
   }
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (map->entries[i].occupied) {
-      map_delete(map, i);
-    }
+  while (map->size > 0) {
+    map_delete(map, map->keys[map->size - 1]);
   }
 }
 
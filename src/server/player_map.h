@@ -11,30 +11,52 @@ extern "C" {
 
 /**
  * @file player_map.h
- * @brief Simple hash map for storing players by ID.
+ * @brief Dense player table indexed by player ID.
  *
- * Maps uint8_t keys (player IDs) to Player structures.
- * Maximum capacity: MAX_PLAYERS players (0..MAX_PLAYERS-1).
+ * Maps uint8_t keys (player IDs) to players. Live players are packed in
+ * slots [0, size): the data every tick reads (keys, positions and tails)
+ * lives in parallel arrays, and the rest (names and colors) in a separate
+ * array of the same slots. Deleting swaps the last player into the freed
+ * slot, so iteration only touches live players.
+ *
+ * Maximum capacity: MAX_PLAYERS players, with any key in 0..255.
  */
 
 /** Map key type (player ID) */
 typedef uint8_t MapKey;
 
+/** Number of possible keys */
+enum { MAP_KEY_COUNT = 256 };
+
+/** Value of PlayerMap::slot_of for keys not in the map */
+enum { MAP_NO_SLOT = 0xFF };
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+_Static_assert(MAX_PLAYERS < MAP_NO_SLOT, "slots must fit below MAP_NO_SLOT");
+#endif
+
 /**
- * @brief Internal map entry
+ * @brief Player data that is not touched by the moves
  */
-typedef struct MapEntry {
-  MapKey key;
-  Player player;
-  bool occupied;
-} MapEntry;
+typedef struct {
+  char name[MAX_PLAYER_NAME_LEN]; /* Player name */
+  Rgb color;                      /* Player color */
+} PlayerColdData;
 
 /**
  * @brief Player map structure
+ *
+ * Slots move when a player is deleted, so players are handed out as copies.
+ * Positions and tails are written directly in their arrays, at the slot
+ * returned by map_slot().
  */
 typedef struct {
-  MapEntry entries[MAX_PLAYERS]; /* One slot per possible key */
-  uint32_t size;                 /* Number of active entries */
+  uint8_t slot_of[MAP_KEY_COUNT];   /* Slot of each key, or MAP_NO_SLOT */
+  uint32_t size;                    /* Number of active entries */
+  MapKey keys[MAX_PLAYERS];         /* Key of each slot */
+  Vec2i positions[MAX_PLAYERS];     /* Head position of each slot */
+  TailNode *tails[MAX_PLAYERS];     /* Tail list of each slot */
+  PlayerColdData cold[MAX_PLAYERS]; /* Name and color of each slot */
 } PlayerMap;
 
 /**
@@ -56,12 +78,13 @@ int map_insert(PlayerMap *map, MapKey key, const Player *player);
  * @brief Find a player in the map
  * @param map Player map
  * @param key Player ID key
- * @return Pointer to player, or NULL if not found
+ * @param out_player Output, a copy of the player if found
+ * @return true if found
  */
-Player *map_find(PlayerMap *map, MapKey key);
+bool map_find(const PlayerMap *map, MapKey key, Player *out_player);
 
 /**
- * @brief Delete a player from the map
+ * @brief Delete a player from the map and free its tail list
  * @param map Player map
  * @param key Player ID key
  */
@@ -70,11 +93,19 @@ void map_delete(PlayerMap *map, MapKey key);
 /**
  * @brief Get all players in the map
  * @param map Player map
- * @param out_players Output array to fill with player pointers (allocated by
- * caller, size at least map_size(map))
+ * @param out_players Output array to fill with player copies in slot order
+ * (allocated by caller, size at least map_size(map))
  * @return Number of players written to out_players
  */
-uint32_t map_get_all(PlayerMap *map, Player **out_players);
+uint32_t map_get_all(const PlayerMap *map, Player *out_players);
+
+/**
+ * @brief Get the slot holding a key
+ * @param map Player map
+ * @param key Player ID key
+ * @return Slot in [0, map_size(map)), or -1 if not found
+ */
+int map_slot(const PlayerMap *map, MapKey key);
 
 /**
  * @brief Get the number of players in the map
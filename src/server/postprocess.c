@@ -0,0 +1,586 @@
+#include "postprocess.h"
+#include "thread_pool.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+enum {
+  LINEAR_MAX = 4095,           /* 12-bit linear light, 1.0 */
+  ENCODE_SIZE = 2 * 4096,      /* Encodable linear range, up to 2.0 */
+  BLOOM_GAIN = 512,            /* Bloom added to the frame, in 1/256 */
+  BAND_ROWS = 16,              /* Rows per thread pool task */
+  PAD = 2                      /* Samples before and after each level row */
+};
+
+/* Blur taps: dst[i] = (a + 4b + 6c + 4d + e + 8) / 16 at index i. Inputs are
+ * at most LINEAR_MAX, so the sum fits in 16 bits. */
+typedef void (*BlurTapsFn)(uint16_t *dst, const uint16_t *a, const uint16_t *b,
+                           const uint16_t *c, const uint16_t *d,
+                           const uint16_t *e, uint32_t n);
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  size_t stride;          /* Samples per row, padding included */
+  uint16_t *planes[3];    /* R, G, B, each at sample 0 of row 0 */
+} BloomLevel;
+
+struct PostProcess {
+  uint32_t width;
+  uint32_t height;
+  BlurTapsFn blur;
+  uint32_t level_count;
+  BloomLevel levels[POSTPROCESS_LEVELS];
+  BloomLevel scratch;           /* Horizontal pass output, level 0 sized */
+  ThreadPool *pool;
+  uint16_t decode[256];         /* 8-bit sRGB to linear */
+  uint8_t encode[ENCODE_SIZE];  /* Linear, compressed above 0.5, to sRGB */
+  /* Background worker */
+  pthread_mutex_t mutex;        /* Protects the fields below */
+  pthread_cond_t work_cond;     /* Signalled when a frame is submitted */
+  pthread_t worker;
+  bool worker_started;
+  bool stopping;
+  uint32_t *input;              /* Last submitted frame */
+  uint32_t *working;            /* Frame being processed (worker only) */
+  uint32_t *finished;           /* Worker output (worker only) */
+  uint32_t *output;             /* Last finished frame */
+  bool input_pending;           /* input holds a frame not yet started */
+  bool output_ready;            /* output not yet taken */
+  uint64_t skipped;
+};
+
+static void blur_taps_scalar(uint16_t *dst, const uint16_t *a,
+                             const uint16_t *b, const uint16_t *c,
+                             const uint16_t *d, const uint16_t *e,
+                             uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) {
+    dst[i] = (uint16_t)((a[i] + e[i] + 4 * (b[i] + d[i]) + 6 * c[i] + 8) >> 4);
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static void
+blur_taps_avx2(uint16_t *dst, const uint16_t *a, const uint16_t *b,
+               const uint16_t *c, const uint16_t *d, const uint16_t *e,
+               uint32_t n) {
+  const __m256i six = _mm256_set1_epi16(6);
+  const __m256i round = _mm256_set1_epi16(8);
+  uint32_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+    __m256i vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+    __m256i vc = _mm256_loadu_si256((const __m256i *)&c[i]);
+    __m256i vd = _mm256_loadu_si256((const __m256i *)&d[i]);
+    __m256i ve = _mm256_loadu_si256((const __m256i *)&e[i]);
+    __m256i outer = _mm256_add_epi16(va, ve);
+    __m256i inner = _mm256_add_epi16(vb, vd);
+    __m256i centre = _mm256_mullo_epi16(vc, six);
+    __m256i sum = _mm256_add_epi16(
+        _mm256_add_epi16(outer, _mm256_slli_epi16(inner, 2)),
+        _mm256_add_epi16(centre, round));
+    _mm256_storeu_si256((__m256i *)&dst[i], _mm256_srli_epi16(sum, 4));
+  }
+  blur_taps_scalar(dst + i, a + i, b + i, c + i, d + i, e + i, n - i);
+}
+#endif
+
+#if defined(__aarch64__)
+static void blur_taps_neon(uint16_t *dst, const uint16_t *a,
+                           const uint16_t *b, const uint16_t *c,
+                           const uint16_t *d, const uint16_t *e, uint32_t n) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t outer = vaddq_u16(vld1q_u16(&a[i]), vld1q_u16(&e[i]));
+    uint16x8_t inner = vaddq_u16(vld1q_u16(&b[i]), vld1q_u16(&d[i]));
+    uint16x8_t sum = vmlaq_n_u16(vaddq_u16(outer, vshlq_n_u16(inner, 2)),
+                                 vld1q_u16(&c[i]), 6);
+    /* Rounding shift, (sum + 8) >> 4 */
+    vst1q_u16(&dst[i], vrshrq_n_u16(sum, 4));
+  }
+  blur_taps_scalar(dst + i, a + i, b + i, c + i, d + i, e + i, n - i);
+}
+#endif
+
+static PostProcessKernel best_kernel = postprocess_kernel_scalar;
+static pthread_once_t best_kernel_once = PTHREAD_ONCE_INIT;
+
+static void detect_postprocess_kernel(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    best_kernel = postprocess_kernel_avx2;
+  }
+#elif defined(__aarch64__)
+  best_kernel = postprocess_kernel_neon;
+#endif
+}
+
+PostProcessKernel postprocess_best_kernel(void) {
+  pthread_once(&best_kernel_once, detect_postprocess_kernel);
+  return best_kernel;
+}
+
+/* Kernel implementing a PostProcessKernel, or NULL if it is not available */
+static BlurTapsFn blur_kernel_fn(PostProcessKernel kernel) {
+  switch (kernel) {
+  case postprocess_kernel_scalar:
+    return blur_taps_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+  case postprocess_kernel_avx2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? blur_taps_avx2 : NULL;
+#endif
+#if defined(__aarch64__)
+  case postprocess_kernel_neon:
+    return blur_taps_neon;
+#endif
+  default:
+    return NULL;
+  }
+}
+
+static int level_alloc(BloomLevel *level, uint32_t width, uint32_t height) {
+  level->width = width;
+  level->height = height;
+  level->stride = (size_t)width + 2 * PAD;
+  for (int c = 0; c < 3; c++) {
+    uint16_t *base = calloc(level->stride * height, sizeof(uint16_t));
+    if (!base) {
+      return -1;
+    }
+    level->planes[c] = base + PAD;
+  }
+  return 0;
+}
+
+static void level_free(BloomLevel *level) {
+  for (int c = 0; c < 3; c++) {
+    if (level->planes[c]) {
+      free(level->planes[c] - PAD);
+      level->planes[c] = NULL;
+    }
+  }
+}
+
+/* Linear light above 0.5 is compressed towards 1.0 with a Reinhard shoulder
+ * that keeps the slope continuous, so bloom on bright trails saturates
+ * smoothly instead of clipping. */
+static void build_tables(PostProcess *pp) {
+  for (int i = 0; i < 256; i++) {
+    pp->decode[i] = (uint16_t)lround(pow(i / 255.0, 2.2) * LINEAR_MAX);
+  }
+  for (int i = 0; i < ENCODE_SIZE; i++) {
+    double x = (double)i / LINEAR_MAX;
+    if (x > 0.5) {
+      double u = x - 0.5;
+      x = 0.5 + 0.5 * u / (u + 0.5);
+    }
+    pp->encode[i] = (uint8_t)lround(pow(x, 1.0 / 2.2) * 255.0);
+  }
+}
+
+PostProcess *postprocess_create(uint32_t width, uint32_t height,
+                                uint32_t threads) {
+  if (width < 2 || height < 2) {
+    return NULL;
+  }
+  PostProcess *pp = calloc(1, sizeof(PostProcess));
+  if (!pp) {
+    return NULL;
+  }
+  pp->width = width;
+  pp->height = height;
+  pp->blur = blur_kernel_fn(postprocess_best_kernel());
+  pthread_mutex_init(&pp->mutex, NULL);
+  pthread_cond_init(&pp->work_cond, NULL);
+  build_tables(pp);
+  bool ok = true;
+  for (uint32_t l = 0; l < POSTPROCESS_LEVELS && ok; l++) {
+    uint32_t w = width >> (l + 1);
+    uint32_t h = height >> (l + 1);
+    if (w == 0 || h == 0) {
+      break;
+    }
+    ok = level_alloc(&pp->levels[l], w, h) == 0;
+    pp->level_count = l + 1;
+  }
+  ok = ok && level_alloc(&pp->scratch, width >> 1, height >> 1) == 0;
+  pp->pool = ok ? thread_pool_create(threads) : NULL;
+  if (!pp->pool) {
+    postprocess_destroy(pp);
+    return NULL;
+  }
+  return pp;
+}
+
+void postprocess_destroy(PostProcess *pp) {
+  if (!pp) {
+    return;
+  }
+  if (pp->worker_started) {
+    pthread_mutex_lock(&pp->mutex);
+    pp->stopping = true;
+    pthread_cond_signal(&pp->work_cond);
+    pthread_mutex_unlock(&pp->mutex);
+    pthread_join(pp->worker, NULL);
+  }
+  thread_pool_destroy(pp->pool);
+  for (uint32_t l = 0; l < POSTPROCESS_LEVELS; l++) {
+    level_free(&pp->levels[l]);
+  }
+  level_free(&pp->scratch);
+  free(pp->input);
+  free(pp->working);
+  free(pp->finished);
+  free(pp->output);
+  pthread_cond_destroy(&pp->work_cond);
+  pthread_mutex_destroy(&pp->mutex);
+  free(pp);
+}
+
+int postprocess_set_kernel(PostProcess *pp, PostProcessKernel kernel) {
+  BlurTapsFn fn = blur_kernel_fn(kernel);
+  if (!pp || !fn) {
+    return -1;
+  }
+  pp->blur = fn;
+  return 0;
+}
+
+/* One pipeline step run over bands of rows */
+typedef struct {
+  PostProcess *pp;
+  BloomLevel *level;       /* Level being written */
+  const BloomLevel *from;  /* Level being read, for resampling */
+  const uint32_t *frame;   /* Input frame */
+  size_t frame_pitch;      /* Input row length in pixels */
+  uint32_t *out;           /* Output frame */
+  size_t out_pitch;        /* Output row length in pixels */
+  bool layer;              /* Output only the light added to the frame */
+} BloomJob;
+
+static uint32_t band_count(uint32_t rows) {
+  return (rows + BAND_ROWS - 1) / BAND_ROWS;
+}
+
+static void band_rows(uint32_t index, uint32_t rows, uint32_t *begin,
+                      uint32_t *end) {
+  *begin = index * BAND_ROWS;
+  *end = *begin + BAND_ROWS < rows ? *begin + BAND_ROWS : rows;
+}
+
+/* Decode 2x2 blocks of the frame into level 0, leaving out pure white */
+static void prefilter_task(void *ctx, uint32_t index) {
+  const BloomJob *job = ctx;
+  const PostProcess *pp = job->pp;
+  BloomLevel *level = job->level;
+  uint32_t begin, end;
+  band_rows(index, level->height, &begin, &end);
+  for (uint32_t y = begin; y < end; y++) {
+    const uint32_t *rows[2] = {job->frame + (2 * y) * job->frame_pitch,
+                               job->frame + (2 * y + 1) * job->frame_pitch};
+    uint16_t *dst[3];
+    for (int c = 0; c < 3; c++) {
+      dst[c] = level->planes[c] + y * level->stride;
+    }
+    for (uint32_t x = 0; x < level->width; x++) {
+      uint32_t sum[3] = {0, 0, 0};
+      for (int k = 0; k < 4; k++) {
+        uint32_t p = rows[k >> 1][2 * x + (k & 1)];
+        if ((p & 0xFFFFFFu) == 0xFFFFFFu) {
+          continue;
+        }
+        sum[0] += pp->decode[(p >> 16) & 0xFF];
+        sum[1] += pp->decode[(p >> 8) & 0xFF];
+        sum[2] += pp->decode[p & 0xFF];
+      }
+      for (int c = 0; c < 3; c++) {
+        dst[c][x] = (uint16_t)((sum[c] + 2) >> 2);
+      }
+    }
+  }
+}
+
+/* Average 2x2 blocks of the previous level */
+static void downsample_task(void *ctx, uint32_t index) {
+  const BloomJob *job = ctx;
+  BloomLevel *level = job->level;
+  const BloomLevel *from = job->from;
+  uint32_t begin, end;
+  band_rows(index, level->height, &begin, &end);
+  for (int c = 0; c < 3; c++) {
+    for (uint32_t y = begin; y < end; y++) {
+      const uint16_t *r0 = from->planes[c] + (2 * y) * from->stride;
+      const uint16_t *r1 = r0 + from->stride;
+      uint16_t *dst = level->planes[c] + y * level->stride;
+      for (uint32_t x = 0; x < level->width; x++) {
+        dst[x] = (uint16_t)((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] +
+                             r1[2 * x + 1] + 2) >> 2);
+      }
+    }
+  }
+}
+
+/* Average the next smaller, already blurred level into this one */
+static void upsample_task(void *ctx, uint32_t index) {
+  const BloomJob *job = ctx;
+  BloomLevel *level = job->level;
+  const BloomLevel *from = job->from;
+  uint32_t begin, end;
+  band_rows(index, level->height, &begin, &end);
+  for (int c = 0; c < 3; c++) {
+    for (uint32_t y = begin; y < end; y++) {
+      uint32_t sy = y >> 1 < from->height ? y >> 1 : from->height - 1;
+      const uint16_t *src = from->planes[c] + sy * from->stride;
+      uint16_t *dst = level->planes[c] + y * level->stride;
+      for (uint32_t x = 0; x < level->width; x++) {
+        uint32_t sx = x >> 1 < from->width ? x >> 1 : from->width - 1;
+        dst[x] = (uint16_t)((dst[x] + src[sx] + 1) >> 1);
+      }
+    }
+  }
+}
+
+static void blur_h_task(void *ctx, uint32_t index) {
+  const BloomJob *job = ctx;
+  BloomLevel *level = job->level;
+  const BloomLevel *scratch = &job->pp->scratch;
+  uint32_t begin, end;
+  band_rows(index, level->height, &begin, &end);
+  uint32_t w = level->width;
+  for (int c = 0; c < 3; c++) {
+    for (uint32_t y = begin; y < end; y++) {
+      uint16_t *row = level->planes[c] + y * level->stride;
+      // Clamp to the edge through the padding
+      row[-2] = row[-1] = row[0];
+      row[w] = row[w + 1] = row[w - 1];
+      job->pp->blur(scratch->planes[c] + y * level->stride, row - 2, row - 1,
+                    row, row + 1, row + 2, w);
+    }
+  }
+}
+
+static void blur_v_task(void *ctx, uint32_t index) {
+  const BloomJob *job = ctx;
+  BloomLevel *level = job->level;
+  const BloomLevel *scratch = &job->pp->scratch;
+  uint32_t begin, end;
+  band_rows(index, level->height, &begin, &end);
+  int last = (int)level->height - 1;
+  for (int c = 0; c < 3; c++) {
+    for (uint32_t y = begin; y < end; y++) {
+      const uint16_t *taps[5];
+      for (int k = 0; k < 5; k++) {
+        int ty = (int)y + k - 2;
+        ty = ty < 0 ? 0 : (ty > last ? last : ty);
+        taps[k] = scratch->planes[c] + (size_t)ty * level->stride;
+      }
+      job->pp->blur(level->planes[c] + y * level->stride, taps[0], taps[1],
+                    taps[2], taps[3], taps[4], level->width);
+    }
+  }
+}
+
+/* Add level 0 to the frame and encode, except pure white. A layer holds
+ * the difference to the frame, to be added back with saturation. */
+static void composite_task(void *ctx, uint32_t index) {
+  const BloomJob *job = ctx;
+  const PostProcess *pp = job->pp;
+  const BloomLevel *bloom = &pp->levels[0];
+  uint32_t begin, end;
+  band_rows(index, pp->height, &begin, &end);
+  for (uint32_t y = begin; y < end; y++) {
+    const uint32_t *src = job->frame + y * job->frame_pitch;
+    uint32_t *dst = job->out + y * job->out_pitch;
+    uint32_t by = y >> 1 < bloom->height ? y >> 1 : bloom->height - 1;
+    const uint16_t *b[3];
+    for (int c = 0; c < 3; c++) {
+      b[c] = bloom->planes[c] + by * bloom->stride;
+    }
+    for (uint32_t x = 0; x < pp->width; x++) {
+      uint32_t bx = x >> 1 < bloom->width ? x >> 1 : bloom->width - 1;
+      uint32_t p = src[x];
+      if ((p & 0xFFFFFFu) == 0xFFFFFFu) {
+        // Text is kept as drawn
+        dst[x] = job->layer ? 0xFF000000u : 0xFFFFFFFFu;
+        continue;
+      }
+      uint32_t r = pp->decode[(p >> 16) & 0xFF] + b[0][bx] * BLOOM_GAIN / 256;
+      uint32_t g = pp->decode[(p >> 8) & 0xFF] + b[1][bx] * BLOOM_GAIN / 256;
+      uint32_t bl = pp->decode[p & 0xFF] + b[2][bx] * BLOOM_GAIN / 256;
+      r = r < ENCODE_SIZE ? r : ENCODE_SIZE - 1;
+      g = g < ENCODE_SIZE ? g : ENCODE_SIZE - 1;
+      bl = bl < ENCODE_SIZE ? bl : ENCODE_SIZE - 1;
+      r = pp->encode[r];
+      g = pp->encode[g];
+      bl = pp->encode[bl];
+      if (job->layer) {
+        // Shoulder compression may darken bright pixels, the layer can't
+        uint32_t pr = (p >> 16) & 0xFF, pg = (p >> 8) & 0xFF, pb = p & 0xFF;
+        r = r > pr ? r - pr : 0;
+        g = g > pg ? g - pg : 0;
+        bl = bl > pb ? bl - pb : 0;
+      }
+      dst[x] = 0xFF000000u | r << 16 | g << 8 | bl;
+    }
+  }
+}
+
+static void blur_level(PostProcess *pp, BloomLevel *level) {
+  BloomJob job = {.pp = pp, .level = level};
+  thread_pool_run(pp->pool, band_count(level->height), blur_h_task, &job);
+  thread_pool_run(pp->pool, band_count(level->height), blur_v_task, &job);
+}
+
+static int run_bloom(PostProcess *pp, const uint32_t *src, size_t src_pitch,
+                     uint32_t *dst, size_t dst_pitch, bool layer) {
+  if (!pp || !src || !dst) {
+    return -1;
+  }
+  BloomJob job = {.pp = pp,
+                  .frame = src,
+                  .frame_pitch = src_pitch / sizeof(uint32_t),
+                  .out = dst,
+                  .out_pitch = dst_pitch / sizeof(uint32_t),
+                  .layer = layer};
+  job.level = &pp->levels[0];
+  thread_pool_run(pp->pool, band_count(job.level->height), prefilter_task,
+                  &job);
+  for (uint32_t l = 1; l < pp->level_count; l++) {
+    job.level = &pp->levels[l];
+    job.from = &pp->levels[l - 1];
+    thread_pool_run(pp->pool, band_count(job.level->height), downsample_task,
+                    &job);
+  }
+  // Blur from the smallest level up, merging each into the next
+  blur_level(pp, &pp->levels[pp->level_count - 1]);
+  for (uint32_t l = pp->level_count - 1; l > 0; l--) {
+    job.level = &pp->levels[l - 1];
+    job.from = &pp->levels[l];
+    thread_pool_run(pp->pool, band_count(job.level->height), upsample_task,
+                    &job);
+    blur_level(pp, job.level);
+  }
+  thread_pool_run(pp->pool, band_count(pp->height), composite_task, &job);
+  return 0;
+}
+
+int postprocess_apply(PostProcess *pp, const uint32_t *src, size_t src_pitch,
+                      uint32_t *dst, size_t dst_pitch) {
+  return run_bloom(pp, src, src_pitch, dst, dst_pitch, false);
+}
+
+int postprocess_apply_layer(PostProcess *pp, const uint32_t *src,
+                            size_t src_pitch, uint32_t *dst,
+                            size_t dst_pitch) {
+  return run_bloom(pp, src, src_pitch, dst, dst_pitch, true);
+}
+
+static void *worker_main(void *arg) {
+  PostProcess *pp = arg;
+  size_t pitch = (size_t)pp->width * sizeof(uint32_t);
+  pthread_mutex_lock(&pp->mutex);
+  for (;;) {
+    while (!pp->stopping && !pp->input_pending) {
+      pthread_cond_wait(&pp->work_cond, &pp->mutex);
+    }
+    if (pp->stopping) {
+      break;
+    }
+    uint32_t *frame = pp->input;
+    pp->input = pp->working;
+    pp->working = frame;
+    pp->input_pending = false;
+    pthread_mutex_unlock(&pp->mutex);
+    postprocess_apply_layer(pp, pp->working, pitch, pp->finished, pitch);
+    pthread_mutex_lock(&pp->mutex);
+    uint32_t *done = pp->output;
+    pp->output = pp->finished;
+    pp->finished = done;
+    pp->output_ready = true;
+  }
+  pthread_mutex_unlock(&pp->mutex);
+  return NULL;
+}
+
+static void copy_frame(uint32_t *dst, size_t dst_pitch, const uint32_t *src,
+                       size_t src_pitch, uint32_t width, uint32_t height) {
+  for (uint32_t y = 0; y < height; y++) {
+    memcpy((uint8_t *)dst + y * dst_pitch,
+           (const uint8_t *)src + y * src_pitch, width * sizeof(uint32_t));
+  }
+}
+
+static int start_worker(PostProcess *pp) {
+  size_t size = (size_t)pp->width * pp->height * sizeof(uint32_t);
+  pp->input = malloc(size);
+  pp->working = malloc(size);
+  pp->finished = malloc(size);
+  pp->output = malloc(size);
+  if (!pp->input || !pp->working || !pp->finished || !pp->output ||
+      pthread_create(&pp->worker, NULL, worker_main, pp) != 0) {
+    /* Leave nothing behind, the next submit starts over */
+    free(pp->input);
+    free(pp->working);
+    free(pp->finished);
+    free(pp->output);
+    pp->input = pp->working = pp->finished = pp->output = NULL;
+    return -1;
+  }
+  pp->worker_started = true;
+  return 0;
+}
+
+int postprocess_submit(PostProcess *pp, const uint32_t *src,
+                       size_t src_pitch) {
+  if (!pp || !src) {
+    return -1;
+  }
+  pthread_mutex_lock(&pp->mutex);
+  if (!pp->worker_started && start_worker(pp) != 0) {
+    pthread_mutex_unlock(&pp->mutex);
+    return -1;
+  }
+  if (pp->input_pending) {
+    pp->skipped++;
+  }
+  copy_frame(pp->input, (size_t)pp->width * sizeof(uint32_t), src, src_pitch,
+             pp->width, pp->height);
+  pp->input_pending = true;
+  pthread_cond_signal(&pp->work_cond);
+  pthread_mutex_unlock(&pp->mutex);
+  return 0;
+}
+
+bool postprocess_take(PostProcess *pp, uint32_t *dst, size_t dst_pitch) {
+  if (!pp || !dst) {
+    return false;
+  }
+  pthread_mutex_lock(&pp->mutex);
+  bool ready = pp->output_ready;
+  if (ready) {
+    copy_frame(dst, dst_pitch, pp->output,
+               (size_t)pp->width * sizeof(uint32_t), pp->width, pp->height);
+    pp->output_ready = false;
+  }
+  pthread_mutex_unlock(&pp->mutex);
+  return ready;
+}
+
+uint64_t postprocess_skipped_frames(PostProcess *pp) {
+  if (!pp) {
+    return 0;
+  }
+  pthread_mutex_lock(&pp->mutex);
+  uint64_t skipped = pp->skipped;
+  pthread_mutex_unlock(&pp->mutex);
+  return skipped;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file postprocess.h
+ * @brief Bloom effect computed on the CPU, a port of the bloom shaders.
+ *
+ * Frames are ARGB8888. Bright pixels are decoded to 12-bit linear light and
+ * averaged down to half resolution (pure white, used for text, is left out
+ * as in the shaders), then down to POSTPROCESS_LEVELS progressively smaller
+ * levels. Starting from the smallest, each level is blurred with a separable
+ * 5-tap binomial filter and averaged into the next larger one, so the blur
+ * radius doubles at every level. The result is added to the frame and
+ * compressed above half intensity before encoding back to 8 bits. White
+ * pixels are copied unchanged.
+ *
+ * Rows are split into bands processed on a thread pool, and the blur rows
+ * use the widest vector kernel the CPU supports.
+ */
+
+enum {
+  POSTPROCESS_LEVELS = 4 ///< Bloom levels, from 1/2 to 1/16 resolution
+};
+
+/**
+ * @brief Implementations of the blur rows
+ */
+typedef enum {
+  postprocess_kernel_scalar = 0, ///< Portable loop
+  postprocess_kernel_avx2 = 1,   ///< x86-64, 16 samples per step
+  postprocess_kernel_neon = 2    ///< AArch64, 8 samples per step
+} PostProcessKernel;
+
+/** Opaque bloom pipeline with its buffers */
+typedef struct PostProcess PostProcess;
+
+/**
+ * @brief Fastest blur kernel supported by this CPU
+ */
+PostProcessKernel postprocess_best_kernel(void);
+
+/**
+ * @brief Create a pipeline for frames of a fixed size
+ * @param threads Band workers, 0 picks one per online CPU minus the caller
+ * @return Pipeline, or NULL on failure (including frames smaller than 2x2)
+ */
+PostProcess *postprocess_create(uint32_t width, uint32_t height,
+                                uint32_t threads);
+
+/**
+ * @brief Stop the background worker, if any, and free the pipeline
+ */
+void postprocess_destroy(PostProcess *pp);
+
+/**
+ * @brief Select the blur kernel, for testing and benchmarking
+ * @return 0 on success, -1 if the kernel is not supported here
+ */
+int postprocess_set_kernel(PostProcess *pp, PostProcessKernel kernel);
+
+/**
+ * @brief Apply the effect on the calling thread (and the band workers)
+ * @param src Input frame, src_pitch bytes per row
+ * @param dst Output frame, dst_pitch bytes per row, may not alias src
+ * @return 0 on success, -1 on NULL arguments
+ */
+int postprocess_apply(PostProcess *pp, const uint32_t *src, size_t src_pitch,
+                      uint32_t *dst, size_t dst_pitch);
+
+/**
+ * @brief Compute only the light the effect adds to a frame
+ *
+ * Adding the layer to src with saturation, e.g. SDL_BLENDMODE_ADD, gives
+ * the output of postprocess_apply() except that bright pixels are not
+ * compressed. The layer may be added over a newer frame.
+ * @return 0 on success, -1 on NULL arguments
+ */
+int postprocess_apply_layer(PostProcess *pp, const uint32_t *src,
+                            size_t src_pitch, uint32_t *dst,
+                            size_t dst_pitch);
+
+/**
+ * @brief Hand a frame to the background worker, which computes its layer
+ * with postprocess_apply_layer()
+ *
+ * The frame is copied, so the caller may reuse it right away. The worker
+ * is started on the first call. If the worker is still busy with an older
+ * frame, a frame submitted earlier and not yet started is replaced.
+ * @return 0 on success, -1 on failure
+ */
+int postprocess_submit(PostProcess *pp, const uint32_t *src,
+                       size_t src_pitch);
+
+/**
+ * @brief Copy out the newest layer finished by the worker
+ * @return true if a layer finished since the previous call was copied
+ */
+bool postprocess_take(PostProcess *pp, uint32_t *dst, size_t dst_pitch);
+
+/**
+ * @brief Frames dropped by postprocess_submit() before being processed
+ */
+uint64_t postprocess_skipped_frames(PostProcess *pp);
+
+#ifdef __cplusplus
+}
+#endif
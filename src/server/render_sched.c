@@ -0,0 +1,275 @@
+#include "render_sched.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct RenderScheduler {
+  uint32_t period_ns;          /* Render period, 0 = follow the simulation */
+  uint32_t tick_stride;        /* Frames per render when following */
+  bool interpolate;            /* Slide heads between ticks */
+  pthread_mutex_t mutex;       /* Protects the fields below */
+  pthread_cond_t published;    /* Signalled on every publish */
+  RenderFrame latest;          /* Last published frame */
+  bool has_frame;              /* latest is valid */
+  uint64_t sequence;           /* Incremented on every publish */
+  bool rendered_any;           /* A render was handed out */
+  uint32_t last_frame;         /* Frame number of the last render */
+  float last_alpha;            /* Interpolation of the last render */
+  uint64_t next_due_ns;        /* Start of the next render slot */
+  RenderSchedStats stats;
+  uint32_t grid_width;         /* Board size of the configuration */
+  uint32_t grid_height;
+  uint8_t *grid;               /* Board of the last published frame */
+  uint64_t *changed;           /* Rows of grid not yet loaded by the reader */
+  /* Publisher side only */
+  RenderFrame staging;         /* Frame being built */
+  RenderFrameTrack track;      /* Heads at the last publish */
+  uint32_t *versions;          /* Row versions copied into grid */
+  bool grid_filled;            /* grid holds every row */
+};
+
+static size_t changed_words(const RenderScheduler *sched) {
+  return ((size_t)sched->grid_height + 63) / 64;
+}
+
+uint64_t render_sched_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+RenderScheduler *render_sched_create(const GameConfig *config) {
+  if (!config) {
+    return NULL;
+  }
+  RenderScheduler *sched = calloc(1, sizeof(RenderScheduler));
+  if (!sched) {
+    return NULL;
+  }
+  sched->period_ns =
+      config->render_fps > 0 ? 1000000000u / config->render_fps : 0;
+  sched->tick_stride =
+      config->render_tick_stride > 0 ? config->render_tick_stride : 1;
+  sched->interpolate = config->render_interpolate && sched->period_ns > 0;
+  sched->grid_width = config->grid_width;
+  sched->grid_height = config->grid_height;
+  sched->grid = malloc((size_t)sched->grid_width * sched->grid_height + 1);
+  sched->changed = calloc(changed_words(sched) + 1, sizeof(uint64_t));
+  sched->versions = calloc((size_t)sched->grid_height + 1, sizeof(uint32_t));
+  if (!sched->grid || !sched->changed || !sched->versions) {
+    free(sched->grid);
+    free(sched->changed);
+    free(sched->versions);
+    free(sched);
+    return NULL;
+  }
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&sched->published, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&sched->mutex, NULL);
+  return sched;
+}
+
+void render_sched_destroy(RenderScheduler *sched) {
+  if (!sched) {
+    return;
+  }
+  pthread_cond_destroy(&sched->published);
+  pthread_mutex_destroy(&sched->mutex);
+  free(sched->grid);
+  free(sched->changed);
+  free(sched->versions);
+  free(sched);
+}
+
+void render_frame_fill(RenderFrame *frame, RenderFrameTrack *track,
+                       Game *game, uint64_t now_ns) {
+  frame->player_count = game_get_players(game, frame->players);
+  frame->frame = game_get_frame(game);
+  frame->game_over = game_is_over(game);
+  frame->time_ns = now_ns;
+  bool seen[256] = {false};
+  for (uint32_t i = 0; i < frame->player_count; i++) {
+    const Player *p = &frame->players[i];
+    frame->players[i].tail_linked_list = NULL;
+    frame->previous[i] =
+        track->last_alive[p->id] ? track->last_position[p->id] : p->position;
+    track->last_position[p->id] = p->position;
+    seen[p->id] = true;
+  }
+  memcpy(track->last_alive, seen, sizeof(seen));
+}
+
+/* Copy the rows written since the previous publish, called with the lock */
+static void publish_rows(RenderScheduler *sched, const Game *game) {
+  const Grid *grid = game_get_grid_storage(game);
+  for (uint32_t y = 0; y < sched->grid_height;) {
+    uint32_t end = y;
+    while (end < sched->grid_height) {
+      uint32_t version = game_row_version(game, end);
+      if (sched->grid_filled && sched->versions[end] == version) {
+        break;
+      }
+      sched->versions[end] = version;
+      sched->changed[end >> 6] |= 1ull << (end & 63);
+      end++;
+    }
+    if (end > y) {
+      grid_copy_rows(grid, y, end - y,
+                     sched->grid + (size_t)y * sched->grid_width);
+    }
+    y = end + 1;
+  }
+  sched->grid_filled = true;
+}
+
+/* Load the rows changed since the previous call into board, called with the
+ * lock */
+static void load_rows(RenderScheduler *sched, Game *board) {
+  for (uint32_t y = 0; y < sched->grid_height;) {
+    uint32_t end = y;
+    while (end < sched->grid_height &&
+           (sched->changed[end >> 6] >> (end & 63)) & 1u) {
+      sched->changed[end >> 6] &= ~(1ull << (end & 63));
+      end++;
+    }
+    if (end > y) {
+      game_load_rows(board, y, end - y,
+                     sched->grid + (size_t)y * sched->grid_width);
+    }
+    y = end + 1;
+  }
+}
+
+int render_sched_publish(RenderScheduler *sched, Game *game, uint64_t now_ns) {
+  if (!sched || !game) {
+    return -1;
+  }
+  const Grid *grid = game_get_grid_storage(game);
+  if (grid->width != sched->grid_width ||
+      grid->height != sched->grid_height) {
+    return -1;
+  }
+  RenderFrame *f = &sched->staging;
+  render_frame_fill(f, &sched->track, game, now_ns);
+  pthread_mutex_lock(&sched->mutex);
+  f->interval_ns = sched->has_frame ? now_ns - sched->latest.time_ns : 0;
+  // Only the used player slots need to reach the reader
+  size_t head = offsetof(RenderFrame, players);
+  memcpy(&sched->latest, f, head);
+  memcpy(sched->latest.players, f->players,
+         f->player_count * sizeof(Player));
+  memcpy(sched->latest.previous, f->previous,
+         f->player_count * sizeof(Vec2i));
+  publish_rows(sched, game);
+  sched->has_frame = true;
+  sched->sequence++;
+  sched->stats.published++;
+  pthread_cond_broadcast(&sched->published);
+  pthread_mutex_unlock(&sched->mutex);
+  return 0;
+}
+
+static bool render_due(const RenderScheduler *sched, uint64_t now_ns,
+                       bool fresh) {
+  if (!sched->rendered_any) {
+    return true;
+  }
+  if (sched->period_ns > 0) {
+    return now_ns >= sched->next_due_ns;
+  }
+  // Following the simulation: only new frames, every tick_stride-th one
+  return fresh &&
+         (sched->latest.frame - sched->last_frame >= sched->tick_stride ||
+          sched->latest.game_over);
+}
+
+bool render_sched_next(RenderScheduler *sched, uint64_t now_ns,
+                       RenderFrame *frame, Game *board) {
+  if (!sched || !frame) {
+    return false;
+  }
+  pthread_mutex_lock(&sched->mutex);
+  const RenderFrame *latest = &sched->latest;
+  bool fresh = !sched->rendered_any || latest->frame != sched->last_frame;
+  if (!sched->has_frame || !render_due(sched, now_ns, fresh)) {
+    pthread_mutex_unlock(&sched->mutex);
+    return false;
+  }
+  size_t head = offsetof(RenderFrame, players);
+  memcpy(frame, latest, head);
+  memcpy(frame->players, latest->players,
+         latest->player_count * sizeof(Player));
+  memcpy(frame->previous, latest->previous,
+         latest->player_count * sizeof(Vec2i));
+  if (board) {
+    load_rows(sched, board);
+  }
+  frame->alpha = 1.0f;
+  if (sched->interpolate && latest->interval_ns > 0) {
+    uint64_t since = now_ns > latest->time_ns ? now_ns - latest->time_ns : 0;
+    frame->alpha = since >= latest->interval_ns
+                       ? 1.0f
+                       : (float)since / (float)latest->interval_ns;
+  }
+  if (sched->rendered_any) {
+    uint32_t expected = sched->period_ns > 0 ? 1 : sched->tick_stride;
+    uint32_t gap = latest->frame - sched->last_frame;
+    if (fresh && gap > expected) {
+      sched->stats.dropped += gap - expected;
+    }
+    if (!fresh && frame->alpha == sched->last_alpha) {
+      sched->stats.duplicated++;
+    }
+  }
+  if (sched->period_ns > 0) {
+    // Skip the slots that were missed instead of rendering them late
+    sched->next_due_ns = sched->rendered_any
+                             ? sched->next_due_ns + sched->period_ns
+                             : now_ns + sched->period_ns;
+    if (sched->next_due_ns <= now_ns) {
+      sched->next_due_ns = now_ns + sched->period_ns;
+    }
+  }
+  sched->rendered_any = true;
+  sched->last_frame = latest->frame;
+  sched->last_alpha = frame->alpha;
+  sched->stats.rendered++;
+  pthread_mutex_unlock(&sched->mutex);
+  return true;
+}
+
+void render_sched_wait(RenderScheduler *sched, uint32_t timeout_ms) {
+  if (!sched) {
+    return;
+  }
+  uint64_t now = render_sched_now_ns();
+  uint64_t deadline = now + (uint64_t)timeout_ms * 1000000ULL;
+  pthread_mutex_lock(&sched->mutex);
+  if (sched->period_ns > 0 && sched->rendered_any &&
+      sched->next_due_ns < deadline) {
+    deadline = sched->next_due_ns > now ? sched->next_due_ns : now;
+  }
+  struct timespec ts = {(time_t)(deadline / 1000000000ULL),
+                        (long)(deadline % 1000000000ULL)};
+  uint64_t sequence = sched->sequence;
+  // At a fixed rate a publish only matters before the first render
+  bool paced = sched->period_ns > 0 && sched->rendered_any;
+  while ((paced || sched->sequence == sequence) &&
+         pthread_cond_timedwait(&sched->published, &sched->mutex, &ts) == 0) {
+  }
+  pthread_mutex_unlock(&sched->mutex);
+}
+
+void render_sched_get_stats(RenderScheduler *sched, RenderSchedStats *stats) {
+  if (!sched || !stats) {
+    return;
+  }
+  pthread_mutex_lock(&sched->mutex);
+  *stats = sched->stats;
+  pthread_mutex_unlock(&sched->mutex);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "game_logic.h"
+#include "player.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file render_sched.h
+ * @brief Hands simulated frames to the render thread at its own rate.
+ *
+ * The simulation publishes a RenderFrame after every tick with a copy of the
+ * players, and copies the grid rows written since the previous publish
+ * into the scheduler. The render thread loads those rows into a Game of its
+ * own, so it never reads the simulation's Game while it runs.
+ *
+ * The render thread asks render_sched_next() whether a render is due. With
+ * renderFps = 0 it renders every renderEveryNthTick-th published frame and
+ * nothing in between. Otherwise it renders at renderFps and, if
+ * renderInterpolate is set, slides heads from their previous cell towards
+ * the current one as time passes between ticks.
+ */
+
+/**
+ * @brief Players of one simulated frame, as seen by the renderer
+ */
+typedef struct {
+  uint32_t frame;               ///< Simulation frame number
+  uint64_t time_ns;             ///< When it was published
+  uint64_t interval_ns;         ///< Time since the previous publish
+  bool game_over;               ///< game_is_over() when published
+  uint32_t player_count;        ///< Valid entries in players and previous
+  Player players[MAX_PLAYERS];  ///< Player copies, tail pointers cleared
+  Vec2i previous[MAX_PLAYERS];  ///< Head of each player one tick earlier
+  float alpha;                  ///< Head position between previous (0) and
+                                ///< current (1), set by render_sched_next()
+} RenderFrame;
+
+/**
+ * @brief Heads of the last frame a producer built, by player ID, so the next
+ * frame knows where each head came from. Starts zeroed.
+ */
+typedef struct {
+  Vec2i last_position[256]; ///< Head of each player ID in the last frame
+  bool last_alive[256];     ///< Player ID was alive in the last frame
+} RenderFrameTrack;
+
+/**
+ * @brief Fill a frame with the current players of a game
+ *
+ * Shared by every producer of RenderFrames. Sets all fields except
+ * interval_ns and alpha, and advances track to this frame.
+ */
+void render_frame_fill(RenderFrame *frame, RenderFrameTrack *track,
+                       Game *game, uint64_t now_ns);
+
+/**
+ * @brief Render pacing counters
+ */
+typedef struct {
+  uint64_t published;  ///< Frames published by the simulation
+  uint64_t rendered;   ///< Renders handed out by render_sched_next()
+  uint64_t dropped;    ///< Published frames skipped beyond the tick stride
+  uint64_t duplicated; ///< Renders identical to the one before
+} RenderSchedStats;
+
+/** Opaque render scheduler */
+typedef struct RenderScheduler RenderScheduler;
+
+/**
+ * @brief Create a scheduler with the render options of a configuration
+ * @return Scheduler, or NULL on failure
+ */
+RenderScheduler *render_sched_create(const GameConfig *config);
+
+/**
+ * @brief Destroy a scheduler
+ */
+void render_sched_destroy(RenderScheduler *sched);
+
+/**
+ * @brief Monotonic clock used for publish and render times
+ */
+uint64_t render_sched_now_ns(void);
+
+/**
+ * @brief Publish the current players and board of a game, called by the
+ * simulation after every tick
+ * @return 0 on success, -1 on NULL arguments or a board of another size
+ * than the configuration
+ */
+int render_sched_publish(RenderScheduler *sched, Game *game, uint64_t now_ns);
+
+/**
+ * @brief Check whether a render is due and get the frame to draw
+ *
+ * Never blocks. Each call that returns true counts as one render.
+ * @param frame Output, filled only when a render is due
+ * @param board Render-side Game, created from the same configuration, that
+ * receives the rows changed since the previous render through
+ * game_load_rows(); NULL to only get the players
+ * @return true if the caller should render frame and board now
+ */
+bool render_sched_next(RenderScheduler *sched, uint64_t now_ns,
+                       RenderFrame *frame, Game *board);
+
+/**
+ * @brief Sleep until a render may be due
+ *
+ * Returns when a frame is published (renderFps = 0), when the next render
+ * slot starts (renderFps > 0) or after timeout_ms, whichever comes first.
+ */
+void render_sched_wait(RenderScheduler *sched, uint32_t timeout_ms);
+
+/**
+ * @brief Get the pacing counters
+ */
+void render_sched_get_stats(RenderScheduler *sched, RenderSchedStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,19 +6,280 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <SDL2/SDL_ttf.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ulog.h>
 
-// TailNode is defined in player.h
-typedef struct TailNode TailNode;
+/* Enough for every player name plus the fixed banner and splash labels */
+enum { RENDERER_LABEL_CAPACITY = 2 * MAX_PLAYERS };
+
+enum {
+  BANNER_HEIGHT = 100, ///< Pixels above the board
+  MINIMAP_SIZE = 160,  ///< Largest minimap side in pixels
+  MINIMAP_MARGIN = 10  ///< Pixels between the minimap and the board edge
+};
+
+/* Zoom steps for the mouse wheel and keys, pan step as a view fraction */
+#define ZOOM_STEP 1.25f
+#define PAN_STEP 0.1f
+
+static size_t dirty_row_words(const GameRenderer *r) {
+  return ((size_t)r->config.grid_height + 63) / 64;
+}
+
+static void destroy_grid_texture(GameRenderer *r) {
+  if (r->grid_texture) {
+    SDL_DestroyTexture(r->grid_texture);
+    r->grid_texture = NULL;
+  }
+  for (uint32_t k = 0; k < BOARD_LOD_MAX_LEVELS; k++) {
+    if (r->lod_textures[k]) {
+      SDL_DestroyTexture(r->lod_textures[k]);
+      r->lod_textures[k] = NULL;
+    }
+  }
+  board_lod_destroy(r->lod);
+  free(r->dirty_rows);
+  free(r->row_buffer);
+  r->lod = NULL;
+  r->dirty_rows = NULL;
+  r->row_buffer = NULL;
+}
+
+static SDL_Texture *create_board_texture(GameRenderer *r, uint32_t width,
+                                         uint32_t height) {
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(r->renderer, &info) == 0 &&
+      ((info.max_texture_width && (int)width > info.max_texture_width) ||
+       (info.max_texture_height && (int)height > info.max_texture_height))) {
+    return NULL;
+  }
+  return SDL_CreateTexture(r->renderer, SDL_PIXELFORMAT_ARGB8888,
+                           SDL_TEXTUREACCESS_STREAMING, (int)width,
+                           (int)height);
+}
 
 /**
- * @brief Create a new SDL renderer
+ * @brief Create the board textures, one per level of detail
+ *
+ * Levels whose texture cannot be created (e.g. larger than the maximum
+ * texture size) are skipped and a coarser level is drawn instead. Without
+ * any texture the visible cells are drawn one run at a time.
  */
-GameRenderer *renderer_create(const GameConfig *config) {
+static void create_grid_texture(GameRenderer *r) {
+  uint32_t width = r->config.grid_width;
+  uint32_t height = r->config.grid_height;
+  r->dirty_rows = (uint64_t *)calloc(dirty_row_words(r) + 1,
+                                     sizeof(uint64_t));
+  r->row_buffer = (uint8_t *)malloc((size_t)width + 1);
+  r->lod = board_lod_create(width, height, MINIMAP_SIZE);
+  if (!r->dirty_rows || !r->row_buffer || !r->lod) {
+    ulog_warn("Failed to allocate the board levels, board not drawn");
+    destroy_grid_texture(r);
+    return;
+  }
+  r->grid_texture = create_board_texture(r, width, height);
+  if (!r->grid_texture) {
+    ulog_warn("No texture for the %ux%u board (%s), drawing it from coarser "
+              "levels or cell by cell",
+              width, height, SDL_GetError());
+  }
+  for (uint32_t k = 1; k < board_lod_levels(r->lod); k++) {
+    uint32_t level_width, level_height;
+    board_lod_level_size(r->lod, k, &level_width, &level_height);
+    r->lod_textures[k] = create_board_texture(r, level_width, level_height);
+  }
+  for (int i = 0; i < 256; i++) {
+    r->palette[i] = 0xFF000000u;
+  }
+  // The first frame uploads the whole board
+  board_lod_invalidate(r->lod);
+}
+
+/**
+ * @brief Texture of a level of detail, NULL if it has none
+ */
+static SDL_Texture *level_texture(const GameRenderer *r, uint32_t level) {
+  return level ? r->lod_textures[level] : r->grid_texture;
+}
+
+/**
+ * @brief Rasterize a white annulus inner <= d < outer around the centre of a
+ * (2 * half + 1)^2 sprite, transparent elsewhere
+ */
+static SDL_Texture *create_circle_sprite(SDL_Renderer *renderer, int half,
+                                         float inner, float outer) {
+  int side = 2 * half + 1;
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+      0, side, side, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!surface) {
+    return NULL;
+  }
+  for (int y = 0; y < side; y++) {
+    uint32_t *row =
+        (uint32_t *)((uint8_t *)surface->pixels + (size_t)y * surface->pitch);
+    for (int x = 0; x < side; x++) {
+      int dx = x - half;
+      int dy = y - half;
+      float d = sqrtf((float)(dx * dx + dy * dy));
+      row[x] = d >= inner && d < outer ? 0xFFFFFFFFu : 0u;
+    }
+  }
+  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
+  if (texture) {
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  }
+  return texture;
+}
+
+/**
+ * @brief Pre-render the head shapes drawn by draw_filled_circle() and
+ * draw_circle_outline() in render_players()
+ */
+static void create_head_sprites(GameRenderer *r) {
+  int radius = (int)r->config.cell_size;
+  r->head_half_size = radius + 4;
+  r->head_fill = create_circle_sprite(r->renderer, r->head_half_size, -1.0f,
+                                      (float)radius + 0.5f);
+  r->head_ring = create_circle_sprite(r->renderer, r->head_half_size,
+                                      (float)radius + 0.5f,
+                                      (float)radius + 3.5f);
+  if (!r->head_fill || !r->head_ring) {
+    ulog_warn("Failed to create head sprites: %s", SDL_GetError());
+    if (r->head_fill) {
+      SDL_DestroyTexture(r->head_fill);
+    }
+    if (r->head_ring) {
+      SDL_DestroyTexture(r->head_ring);
+    }
+    r->head_fill = NULL;
+    r->head_ring = NULL;
+  }
+}
+
+static void destroy_postprocess(GameRenderer *r) {
+  postprocess_destroy(r->post);
+  if (r->post_texture) {
+    SDL_DestroyTexture(r->post_texture);
+  }
+  free(r->post_frame);
+  r->post = NULL;
+  r->post_texture = NULL;
+  r->post_frame = NULL;
+}
+
+/**
+ * @brief Set up the CPU bloom pass over the whole window
+ */
+static void create_postprocess(GameRenderer *r) {
+  int width = 0, height = 0;
+  SDL_GetRendererOutputSize(r->renderer, &width, &height);
+  r->post_width = width;
+  r->post_height = height;
+  r->post = postprocess_create((uint32_t)width, (uint32_t)height, 0);
+  r->post_texture =
+      SDL_CreateTexture(r->renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_STREAMING, width, height);
+  r->post_frame = malloc((size_t)width * height * sizeof(uint32_t));
+  if (!r->post || !r->post_texture || !r->post_frame ||
+      SDL_SetTextureBlendMode(r->post_texture, SDL_BLENDMODE_ADD) != 0) {
+    ulog_warn("Post-processing disabled, setup failed: %s", SDL_GetError());
+    destroy_postprocess(r);
+  }
+}
+
+/**
+ * @brief Queue the drawn frame for recording
+ *
+ * Offscreen frames are read straight from the target surface, window frames
+ * are read back from the renderer first.
+ */
+static void capture_rendered_frame(GameRenderer *r) {
+  if (r->surface) {
+    SDL_RenderFlush(r->renderer);
+    capture_submit(r->capture, r->surface->pixels, (size_t)r->surface->pitch);
+    return;
+  }
+  int pitch = r->capture_width * (int)sizeof(uint32_t);
+  if (SDL_RenderReadPixels(r->renderer, NULL, SDL_PIXELFORMAT_ARGB8888,
+                           r->capture_frame, pitch) == 0) {
+    capture_submit(r->capture, r->capture_frame, (size_t)pitch);
+  }
+}
+
+/**
+ * @brief Present the frame, through the bloom pass if enabled
+ *
+ * The drawn frame is read back and handed to the post-process worker, and
+ * the last bloom layer it finished is added over it. Only the bloom lags,
+ * the frame itself is always the current one.
+ * The final frame is then queued on the capture sink, if recording.
+ */
+static void present_frame(GameRenderer *r) {
+  if (r->post) {
+    int pitch = r->post_width * (int)sizeof(uint32_t);
+    if (SDL_RenderReadPixels(r->renderer, NULL, SDL_PIXELFORMAT_ARGB8888,
+                             r->post_frame, pitch) == 0) {
+      postprocess_submit(r->post, r->post_frame, (size_t)pitch);
+    }
+    if (postprocess_take(r->post, r->post_frame, (size_t)pitch)) {
+      SDL_UpdateTexture(r->post_texture, NULL, r->post_frame, pitch);
+      r->post_ready = true;
+    }
+    if (r->post_ready) {
+      SDL_RenderCopy(r->renderer, r->post_texture, NULL, NULL);
+    }
+  }
+  if (r->capture) {
+    capture_rendered_frame(r);
+  }
+  SDL_RenderPresent(r->renderer);
+}
+
+/**
+ * @brief Create the window and its renderer, or an offscreen surface
+ */
+static bool create_target(GameRenderer *r, bool offscreen) {
+  if (offscreen) {
+    r->surface = SDL_CreateRGBSurfaceWithFormat(
+        0, r->window_width, r->window_height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!r->surface) {
+      ulog_error("SDL_CreateRGBSurfaceWithFormat failed: %s", SDL_GetError());
+      return false;
+    }
+    r->renderer = SDL_CreateSoftwareRenderer(r->surface);
+    if (!r->renderer) {
+      ulog_error("SDL_CreateSoftwareRenderer failed: %s", SDL_GetError());
+      SDL_FreeSurface(r->surface);
+      r->surface = NULL;
+      return false;
+    }
+    return true;
+  }
+  r->window = SDL_CreateWindow("Cycles", SDL_WINDOWPOS_UNDEFINED,
+                               SDL_WINDOWPOS_UNDEFINED, r->window_width,
+                               r->window_height, SDL_WINDOW_SHOWN);
+  if (!r->window) {
+    ulog_error("SDL_CreateWindow failed: %s", SDL_GetError());
+    return false;
+  }
+  r->renderer = SDL_CreateRenderer(
+      r->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+  if (!r->renderer) {
+    ulog_error("SDL_CreateRenderer failed: %s", SDL_GetError());
+    SDL_DestroyWindow(r->window);
+    r->window = NULL;
+    return false;
+  }
+  return true;
+}
+
+static GameRenderer *create_renderer(const GameConfig *config,
+                                     bool offscreen) {
   if (!config) {
     ulog_error("renderer_create: config is NULL");
     return NULL;
@@ -32,7 +293,8 @@ GameRenderer *renderer_create(const GameConfig *config) {
   r->window_width = config->game_width;
   r->window_height = config->game_height + 100; // 100 for banner
   r->is_open = true;
-  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+  // Offscreen rendering only needs events, not a video driver or display
+  if (SDL_Init(offscreen ? SDL_INIT_EVENTS : SDL_INIT_VIDEO) < 0) {
     ulog_error("SDL_Init failed: %s", SDL_GetError());
     free(r);
     return NULL;
@@ -43,21 +305,7 @@ GameRenderer *renderer_create(const GameConfig *config) {
     free(r);
     return NULL;
   }
-  r->window = SDL_CreateWindow("Cycles", SDL_WINDOWPOS_UNDEFINED,
-                               SDL_WINDOWPOS_UNDEFINED, r->window_width,
-                               r->window_height, SDL_WINDOW_SHOWN);
-  if (!r->window) {
-    ulog_error("SDL_CreateWindow failed: %s", SDL_GetError());
-    TTF_Quit();
-    SDL_Quit();
-    free(r);
-    return NULL;
-  }
-  r->renderer = SDL_CreateRenderer(
-      r->window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-  if (!r->renderer) {
-    ulog_error("SDL_CreateRenderer failed: %s", SDL_GetError());
-    SDL_DestroyWindow(r->window);
+  if (!create_target(r, offscreen)) {
     TTF_Quit();
     SDL_Quit();
     free(r);
@@ -69,25 +317,111 @@ GameRenderer *renderer_create(const GameConfig *config) {
     ulog_warn("Failed to load font from embedded resources: %s",
               TTF_GetError());
     // Proceeding without font
+  } else {
+    r->labels =
+        label_cache_create(r->renderer, r->font, RENDERER_LABEL_CAPACITY);
+  }
+  camera_init(&r->camera, config->grid_width, config->grid_height,
+              (int)config->game_width, (int)config->game_height);
+  r->show_minimap = true;
+  create_grid_texture(r);
+  create_head_sprites(r);
+  if (config->enable_postprocessing) {
+    create_postprocess(r);
   }
   return r;
 }
 
+/**
+ * @brief Create a new SDL renderer
+ */
+GameRenderer *renderer_create(const GameConfig *config) {
+  return create_renderer(config, false);
+}
+
+/**
+ * @brief Create a renderer drawing into a surface, without a window
+ */
+GameRenderer *renderer_create_offscreen(const GameConfig *config) {
+  return create_renderer(config, true);
+}
+
+/**
+ * @brief Record every presented frame
+ */
+int renderer_start_capture(GameRenderer *r, const char *path,
+                           CaptureFormat format, uint32_t fps) {
+  if (!r || !path || r->capture) {
+    return -1;
+  }
+  int width = 0, height = 0;
+  SDL_GetRendererOutputSize(r->renderer, &width, &height);
+  if (!r->surface) {
+    r->capture_frame = malloc((size_t)width * height * sizeof(uint32_t));
+    if (!r->capture_frame) {
+      return -1;
+    }
+  }
+  r->capture = capture_open(path, format, (uint32_t)width, (uint32_t)height,
+                            fps, 0);
+  if (!r->capture) {
+    ulog_error("Failed to open capture output %s", path);
+    free(r->capture_frame);
+    r->capture_frame = NULL;
+    return -1;
+  }
+  r->capture_width = width;
+  r->capture_height = height;
+  return 0;
+}
+
+/**
+ * @brief Finish writing the recording
+ */
+void renderer_stop_capture(GameRenderer *r) {
+  if (!r || !r->capture) {
+    return;
+  }
+  CaptureStats stats;
+  capture_close(r->capture, &stats);
+  ulog_info("Capture: %llu frames, %llu written, %llu dropped, %llu errors",
+            (unsigned long long)stats.submitted,
+            (unsigned long long)stats.written,
+            (unsigned long long)stats.dropped,
+            (unsigned long long)stats.errors);
+  free(r->capture_frame);
+  r->capture = NULL;
+  r->capture_frame = NULL;
+}
+
 /**
  * @brief Destroy renderer and free resources
  */
 void renderer_destroy(GameRenderer *r) {
   if (!r)
     return;
+  renderer_stop_capture(r);
+  destroy_postprocess(r);
+  label_cache_destroy(r->labels);
   if (r->font) {
     TTF_CloseFont(r->font);
   }
+  destroy_grid_texture(r);
+  if (r->head_fill) {
+    SDL_DestroyTexture(r->head_fill);
+  }
+  if (r->head_ring) {
+    SDL_DestroyTexture(r->head_ring);
+  }
   if (r->renderer) {
     SDL_DestroyRenderer(r->renderer);
   }
   if (r->window) {
     SDL_DestroyWindow(r->window);
   }
+  if (r->surface) {
+    SDL_FreeSurface(r->surface);
+  }
   TTF_Quit();
   SDL_Quit();
   free(r);
@@ -98,8 +432,57 @@ void renderer_destroy(GameRenderer *r) {
  */
 bool renderer_is_open(const GameRenderer *r) { return r && r->is_open; }
 
+/**
+ * @brief Move the camera for a key, return false if the key is not bound
+ */
+static bool handle_camera_key(GameRenderer *r, SDL_Keycode key) {
+  Camera *camera = &r->camera;
+  float center_x = (float)camera->view_width / 2.0f;
+  float center_y = (float)camera->view_height / 2.0f;
+  switch (key) {
+  case SDLK_PLUS:
+  case SDLK_EQUALS:
+  case SDLK_KP_PLUS:
+    camera_zoom_at(camera, ZOOM_STEP, center_x, center_y);
+    return true;
+  case SDLK_MINUS:
+  case SDLK_KP_MINUS:
+    camera_zoom_at(camera, 1.0f / ZOOM_STEP, center_x, center_y);
+    return true;
+  case SDLK_LEFT:
+    camera_pan(camera, -PAN_STEP * (float)camera->view_width, 0.0f);
+    return true;
+  case SDLK_RIGHT:
+    camera_pan(camera, PAN_STEP * (float)camera->view_width, 0.0f);
+    return true;
+  case SDLK_UP:
+    camera_pan(camera, 0.0f, -PAN_STEP * (float)camera->view_height);
+    return true;
+  case SDLK_DOWN:
+    camera_pan(camera, 0.0f, PAN_STEP * (float)camera->view_height);
+    return true;
+  case SDLK_0:
+  case SDLK_HOME:
+    camera_reset(camera);
+    return true;
+  case SDLK_f:
+  case SDLK_TAB:
+    r->follow_next = true;
+    return true;
+  case SDLK_m:
+    r->show_minimap = !r->show_minimap;
+    return true;
+  default:
+    return false;
+  }
+}
+
 /**
  * @brief Poll for events
+ *
+ * Besides quitting and SPACE, the wheel zooms at the mouse, dragging with
+ * the left button or the arrow keys pan, +/- zoom, 0 or Home shows the
+ * whole board, F or Tab follows the next player and M toggles the minimap.
  * @param out_space_pressed Set to true if space bar was pressed
  * @return false if quit event received, true otherwise
  */
@@ -123,6 +506,30 @@ bool renderer_poll_events(GameRenderer *r, bool *out_space_pressed) {
       if (event.key.keysym.sym == SDLK_SPACE && out_space_pressed) {
         *out_space_pressed = true;
       }
+      handle_camera_key(r, event.key.keysym.sym);
+      break;
+    case SDL_MOUSEWHEEL: {
+      int x = 0, y = 0;
+      SDL_GetMouseState(&x, &y);
+      camera_zoom_at(&r->camera, powf(ZOOM_STEP, (float)event.wheel.y),
+                     (float)x, (float)(y - BANNER_HEIGHT));
+      break;
+    }
+    case SDL_MOUSEBUTTONDOWN:
+      if (event.button.button == SDL_BUTTON_LEFT) {
+        r->dragging = true;
+      }
+      break;
+    case SDL_MOUSEBUTTONUP:
+      if (event.button.button == SDL_BUTTON_LEFT) {
+        r->dragging = false;
+      }
+      break;
+    case SDL_MOUSEMOTION:
+      if (r->dragging) {
+        camera_pan(&r->camera, (float)-event.motion.xrel,
+                   (float)-event.motion.yrel);
+      }
       break;
     }
   }
@@ -193,60 +600,364 @@ static void render_text(SDL_Renderer *renderer, TTF_Font *font,
 }
 
 /**
- * @brief Render players (heads, tails, names)
+ * @brief Draw text through the label cache, rasterizing it if there is none
+ * @return Width of the text in pixels, or -1 if unknown
  */
-static void render_players(GameRenderer *r, const Game *game) {
-  if (!r || !game)
+static int draw_label(GameRenderer *r, const char *text, int x, int y,
+                      SDL_Color color, SDL_Color outline_color,
+                      int outline_thickness) {
+  int width = label_cache_draw(r->labels, text, x, y, color, outline_color,
+                               outline_thickness);
+  if (width < 0) {
+    render_text(r->renderer, r->font, text, x, y, color, outline_color,
+                outline_thickness);
+  }
+  return width;
+}
+
+/**
+ * @brief Draw a "<prefix><value>" counter, the value from the digit atlas
+ */
+static void draw_counter(GameRenderer *r, const char *prefix, uint32_t value,
+                         int x, int y, SDL_Color color) {
+  SDL_Color none = {0, 0, 0, 0};
+  int width = label_cache_draw(r->labels, prefix, x, y, color, none, 0);
+  if (width < 0 ||
+      label_cache_draw_number(r->labels, value, x + width, y, color) < 0) {
+    char text[64];
+    snprintf(text, sizeof(text), "%s%u", prefix, value);
+    render_text(r->renderer, r->font, text, x, y, color, none, 0);
+  }
+}
+
+/**
+ * @brief Write rows [y, y + rows) of a level into its texture
+ * @param dense Row-major board owners, or NULL to read them through the grid
+ */
+static void upload_level_rows(GameRenderer *r, const Grid *grid,
+                              const uint8_t *dense, uint32_t level,
+                              uint32_t y, uint32_t rows) {
+  uint32_t width, height;
+  board_lod_level_size(r->lod, level, &width, &height);
+  SDL_Texture *texture = level_texture(r, level);
+  SDL_Rect rect = {0, (int)y, (int)width, (int)rows};
+  void *pixels = NULL;
+  int pitch = 0;
+  if (SDL_LockTexture(texture, &rect, &pixels, &pitch) != 0) {
+    ulog_warn("SDL_LockTexture failed: %s", SDL_GetError());
+    return;
+  }
+  for (uint32_t j = 0; j < rows; j++) {
+    const uint8_t *owners = r->row_buffer;
+    if (level > 0) {
+      owners = board_lod_row(r->lod, level, y + j);
+    } else if (dense) {
+      owners = dense + (size_t)(y + j) * width;
+    } else {
+      grid_copy_rows(grid, y + j, 1, r->row_buffer);
+    }
+    uint32_t *out = (uint32_t *)((uint8_t *)pixels + (size_t)j * pitch);
+    for (uint32_t x = 0; x < width; x++) {
+      out[x] = r->palette[owners[x]];
+    }
+  }
+  SDL_UnlockTexture(texture);
+}
+
+/**
+ * @brief Upload the rows of a level inside [y0, y1) that changed since
+ * they were last uploaded
+ */
+static void sync_level(GameRenderer *r, const Grid *grid, const uint8_t *dense,
+                       uint32_t level, uint32_t y0, uint32_t y1) {
+  uint32_t first, count;
+  while (board_lod_take_rows(r->lod, level, y0, y1, &first, &count)) {
+    upload_level_rows(r, grid, dense, level, first, count);
+  }
+}
+
+/**
+ * @brief Window rectangle of the board area
+ */
+static SDL_Rect board_viewport(const GameRenderer *r) {
+  SDL_Rect viewport = {0, BANNER_HEIGHT, r->camera.view_width,
+                       r->camera.view_height};
+  return viewport;
+}
+
+/**
+ * @brief Window rectangle covering the board cells [x0, x1) x [y0, y1)
+ */
+static SDL_Rect board_to_window(const GameRenderer *r, float x0, float y0,
+                                float x1, float y1) {
+  float left, top, right, bottom;
+  camera_board_to_screen(&r->camera, x0, y0, &left, &top);
+  camera_board_to_screen(&r->camera, x1, y1, &right, &bottom);
+  SDL_Rect rect = {(int)lroundf(left), (int)lroundf(top) + BANNER_HEIGHT, 0,
+                   0};
+  rect.w = (int)lroundf(right) - (int)lroundf(left);
+  rect.h = (int)lroundf(bottom) - (int)lroundf(top);
+  return rect;
+}
+
+/**
+ * @brief Draw the visible cells as runs of rectangles, when no level has a
+ * texture. The camera is then at level 0, so there are no more visible
+ * cells than pixels.
+ */
+static void render_cells(GameRenderer *r, const Grid *grid,
+                         const CameraCells *cells) {
+  uint32_t width = cells->x1 - cells->x0;
+  for (uint32_t y = cells->y0; y < cells->y1; y++) {
+    grid_copy_window(grid, cells->x0, y, width, 1, r->row_buffer);
+    uint32_t x = 0;
+    while (x < width) {
+      uint8_t owner = r->row_buffer[x];
+      uint32_t end = x + 1;
+      while (end < width && r->row_buffer[end] == owner) {
+        end++;
+      }
+      if (owner) {
+        uint32_t argb = r->palette[owner];
+        SDL_SetRenderDrawColor(r->renderer, (argb >> 16) & 0xFF,
+                               (argb >> 8) & 0xFF, argb & 0xFF, 255);
+        SDL_Rect rect =
+            board_to_window(r, (float)(cells->x0 + x), (float)y,
+                            (float)(cells->x0 + end), (float)(y + 1));
+        SDL_RenderFillRect(r->renderer, &rect);
+      }
+      x = end;
+    }
+  }
+}
+
+/**
+ * @brief Bring the board levels up to date and draw the visible part
+ *
+ * Every frame the levels are recomputed under the rows written since the
+ * previous one. The level drawn is the finest whose cells are at least a
+ * pixel wide, and only its rows inside the view are uploaded, so the cost
+ * follows the pixels on screen rather than the board size.
+ */
+static void render_board(GameRenderer *r, Game *game, const Player *players,
+                         uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    const Player *p = &players[i];
+    uint32_t argb = 0xFF000000u | (uint32_t)p->color.r << 16 |
+                    (uint32_t)p->color.g << 8 | p->color.b;
+    if (r->palette[p->id] != argb) {
+      // A colour change invalidates every texel of that owner
+      r->palette[p->id] = argb;
+      board_lod_invalidate(r->lod);
+    }
+  }
+  if (r->board != game) {
+    // Dirty rows only describe changes within one game
+    r->board = game;
+    board_lod_invalidate(r->lod);
+  }
+  memset(r->dirty_rows, 0, dirty_row_words(r) * sizeof(uint64_t));
+  game_take_dirty_rows(game, r->dirty_rows);
+  const Grid *grid = game_get_grid_storage(game);
+  const uint8_t *dense = game_get_grid(game);
+  board_lod_update(r->lod, grid, r->dirty_rows);
+  uint32_t levels = board_lod_levels(r->lod);
+  uint32_t level = camera_lod_level(&r->camera);
+  if (level >= levels) {
+    level = levels - 1;
+  }
+  while (level + 1 < levels && !level_texture(r, level)) {
+    level++;
+  }
+  SDL_Rect viewport = board_viewport(r);
+  SDL_RenderSetClipRect(r->renderer, &viewport);
+  CameraCells cells;
+  camera_visible_cells(&r->camera, &cells);
+  SDL_Texture *texture = level_texture(r, level);
+  if (texture) {
+    uint32_t width, height, round = (1u << level) - 1;
+    board_lod_level_size(r->lod, level, &width, &height);
+    uint32_t x0 = cells.x0 >> level, y0 = cells.y0 >> level;
+    uint32_t x1 = (cells.x1 + round) >> level;
+    uint32_t y1 = (cells.y1 + round) >> level;
+    x1 = x1 < width ? x1 : width;
+    y1 = y1 < height ? y1 : height;
+    sync_level(r, grid, dense, level, y0, y1);
+    SDL_Rect src = {(int)x0, (int)y0, (int)(x1 - x0), (int)(y1 - y0)};
+    SDL_Rect dst = board_to_window(
+        r, (float)((uint64_t)x0 << level), (float)((uint64_t)y0 << level),
+        (float)((uint64_t)x1 << level), (float)((uint64_t)y1 << level));
+    SDL_RenderCopy(r->renderer, texture, &src, &dst);
+  } else {
+    render_cells(r, grid, &cells);
+  }
+  SDL_RenderSetClipRect(r->renderer, NULL);
+}
+
+/**
+ * @brief Draw the coarsest level in a corner of the board, with the part
+ * in view outlined, while the view does not show the whole board
+ */
+static void render_minimap(GameRenderer *r, Game *game) {
+  if (!r->show_minimap || camera_shows_board(&r->camera)) {
+    return;
+  }
+  uint32_t top = board_lod_levels(r->lod) - 1;
+  SDL_Texture *texture = level_texture(r, top);
+  if (!texture) {
+    return;
+  }
+  uint32_t width, height;
+  board_lod_level_size(r->lod, top, &width, &height);
+  sync_level(r, game_get_grid_storage(game), game_get_grid(game), top, 0,
+             height);
+  float scale = fminf((float)MINIMAP_SIZE / (float)width,
+                      (float)MINIMAP_SIZE / (float)height);
+  SDL_Rect viewport = board_viewport(r);
+  SDL_Rect frame = {0, 0, (int)((float)width * scale),
+                    (int)((float)height * scale)};
+  frame.x = viewport.x + viewport.w - frame.w - MINIMAP_MARGIN;
+  frame.y = viewport.y + viewport.h - frame.h - MINIMAP_MARGIN;
+  SDL_SetRenderDrawColor(r->renderer, 0, 0, 0, 255);
+  SDL_RenderFillRect(r->renderer, &frame);
+  SDL_RenderCopy(r->renderer, texture, NULL, &frame);
+  SDL_SetRenderDrawColor(r->renderer, 128, 128, 128, 255);
+  SDL_RenderDrawRect(r->renderer, &frame);
+  // Minimap pixels per board cell
+  float cell = scale / (float)(1u << top);
+  CameraCells cells;
+  camera_visible_cells(&r->camera, &cells);
+  SDL_Rect view = {frame.x + (int)((float)cells.x0 * cell),
+                   frame.y + (int)((float)cells.y0 * cell),
+                   (int)fmaxf(2.0f, (float)(cells.x1 - cells.x0) * cell),
+                   (int)fmaxf(2.0f, (float)(cells.y1 - cells.y0) * cell)};
+  SDL_SetRenderDrawColor(r->renderer, 255, 255, 255, 255);
+  SDL_RenderDrawRect(r->renderer, &view);
+}
+
+/**
+ * @brief Draw a head from the pre-rendered sprites, half pixels from its
+ * centre to its edge
+ */
+static void render_head_sprite(GameRenderer *r, int cx, int cy, int half,
+                               Rgb color) {
+  SDL_Rect rect = {cx - half, cy - half, 2 * half + 1, 2 * half + 1};
+  SDL_SetTextureColorMod(r->head_fill, color.r * 0.8, color.g * 0.8,
+                         color.b * 0.8);
+  SDL_RenderCopy(r->renderer, r->head_fill, NULL, &rect);
+  SDL_SetTextureColorMod(r->head_ring, color.r, color.g, color.b);
+  SDL_RenderCopy(r->renderer, r->head_ring, NULL, &rect);
+}
+
+/**
+ * @brief Point the camera at the followed player, picking the next one
+ * first if requested
+ */
+static void update_follow(GameRenderer *r, const Player *players,
+                          uint32_t count, const Vec2i *previous, float alpha) {
+  Camera *camera = &r->camera;
+  if (r->follow_next && count > 0) {
+    // The lowest ID above the current one, wrapping to the lowest
+    PlayerId lowest = players[0].id, next = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      PlayerId id = players[i].id;
+      lowest = id < lowest ? id : lowest;
+      if (id > camera->follow && (!next || id < next)) {
+        next = id;
+      }
+    }
+    camera->follow = next ? next : lowest;
+    if (camera_shows_board(camera)) {
+      camera_zoom_at(camera, 4.0f, (float)camera->view_width / 2.0f,
+                     (float)camera->view_height / 2.0f);
+    }
+  }
+  r->follow_next = false;
+  if (!camera->follow) {
     return;
-  const int banner_height = 100;
-  const int offset_y = banner_height;
-  const int offset_x = 0;
-  const int cell_size = (int)r->config.cell_size;
-  // Get all active players
-  Player *player_ptrs[MAX_PLAYERS];
-  uint32_t player_count = game_get_players((Game *)game, player_ptrs);
-  if (player_count == 0) {
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    const Player *p = &players[i];
+    if (p->id == camera->follow) {
+      float x = (float)p->position.x, y = (float)p->position.y;
+      if (previous && alpha < 1.0f) {
+        x -= (1.0f - alpha) * (float)(p->position.x - previous[i].x);
+        y -= (1.0f - alpha) * (float)(p->position.y - previous[i].y);
+      }
+      camera_center_on(camera, x + 0.5f, y + 0.5f);
+      return;
+    }
+  }
+  camera->follow = 0; // Eliminated
+}
+
+/**
+ * @brief Render players (board, heads, names) and the minimap
+ */
+static void render_players(GameRenderer *r, const Game *game,
+                           const Player *players, uint32_t player_count,
+                           const Vec2i *previous, float alpha) {
+  if (!r || !game)
     return;
+  update_follow(r, players, player_count, previous, alpha);
+  if (r->lod) {
+    render_board(r, (Game *)game, players, player_count);
   }
+  // Heads keep their size relative to a cell as the camera zooms
+  const float head_scale = r->camera.zoom / r->camera.min_zoom;
+  const int head_half = (int)lroundf((float)r->head_half_size * head_scale);
+  const int radius = (int)(r->config.cell_size * head_scale);
+  const SDL_Rect viewport = board_viewport(r);
+  const int margin = head_half + 100; // Names extend right of the head
   for (uint32_t i = 0; i < player_count; i++) {
-    const Player *player = player_ptrs[i];
-    // Draw tail (iterate through linked list)
-    TailNode *tail_node = player->tail_linked_list;
-    while (tail_node) {
-      Vec2i tail_pos = tail_node->position;
-      SDL_Rect rect = {tail_pos.x * cell_size + offset_x,
-                       tail_pos.y * cell_size + offset_y, cell_size, cell_size};
-      SDL_SetRenderDrawColor(r->renderer, player->color.r, player->color.g,
-                             player->color.b, 255);
-      SDL_RenderFillRect(r->renderer, &rect);
-      tail_node = tail_node->next;
+    const Player *player = &players[i];
+    float x = (float)player->position.x, y = (float)player->position.y;
+    if (previous && alpha < 1.0f) {
+      // Slide from the previous head cell towards the current one
+      x -= (1.0f - alpha) * (float)(player->position.x - previous[i].x);
+      y -= (1.0f - alpha) * (float)(player->position.y - previous[i].y);
+    }
+    float screen_x, screen_y;
+    camera_board_to_screen(&r->camera, x, y, &screen_x, &screen_y);
+    int head_x = (int)lroundf(screen_x) + viewport.x;
+    int head_y = (int)lroundf(screen_y) + viewport.y;
+    if (head_x < viewport.x - margin ||
+        head_x > viewport.x + viewport.w + margin ||
+        head_y < viewport.y - margin ||
+        head_y > viewport.y + viewport.h + margin) {
+      continue;
+    }
+    if (r->head_fill) {
+      render_head_sprite(r, head_x, head_y, head_half, player->color);
+    } else {
+      // Draw head (filled circle with darker color)
+      uint8_t darker_r = player->color.r * 0.8;
+      uint8_t darker_g = player->color.g * 0.8;
+      uint8_t darker_b = player->color.b * 0.8;
+      draw_filled_circle(r->renderer, head_x, head_y, radius, darker_r,
+                         darker_g, darker_b);
+      // Draw head border
+      draw_circle_outline(r->renderer, head_x, head_y, radius + 1, 3,
+                          player->color.r, player->color.g, player->color.b);
     }
-    // Draw head (filled circle with darker color)
-    int head_x = player->position.x * cell_size + offset_x;
-    int head_y = player->position.y * cell_size + offset_y;
-    uint8_t darker_r = player->color.r * 0.8;
-    uint8_t darker_g = player->color.g * 0.8;
-    uint8_t darker_b = player->color.b * 0.8;
-    draw_filled_circle(r->renderer, head_x, head_y, cell_size, darker_r,
-                       darker_g, darker_b);
-    // Draw head border
-    draw_circle_outline(r->renderer, head_x, head_y, cell_size + 1, 3,
-                        player->color.r, player->color.g, player->color.b);
     // Draw player name
     if (r->font) {
       SDL_Color white = {255, 255, 255, 255};
       SDL_Color black = {0, 0, 0, 255};
-      render_text(r->renderer, r->font, player->name, head_x - 20, head_y - 20,
-                  white, black, 2);
+      draw_label(r, player->name, head_x - 20, head_y - 20, white, black, 2);
     }
   }
+  if (r->lod) {
+    render_minimap(r, (Game *)game);
+  }
 }
 
 /**
  * @brief Render banner (top bar with stats)
  */
-static void render_banner(GameRenderer *r, const Game *game) {
-  if (!r || !game)
+static void render_banner(GameRenderer *r, uint32_t frame,
+                          uint32_t player_count) {
+  if (!r)
     return;
   const int banner_height = 80;
   // Draw black banner background
@@ -256,39 +967,31 @@ static void render_banner(GameRenderer *r, const Game *game) {
   if (!r->font)
     return;
   SDL_Color white = {255, 255, 255, 255};
-  SDL_Color black = {0, 0, 0, 255};
   // Draw frame number
-  char frame_text[64];
-  snprintf(frame_text, sizeof(frame_text), "Frame: %u", game_get_frame(game));
-  render_text(r->renderer, r->font, frame_text, 10, 10, white, black, 0);
+  draw_counter(r, "Frame: ", frame, 10, 10, white);
   // Draw player count
-  Player *player_ptrs[MAX_PLAYERS];
-  uint32_t player_count = game_get_players((Game *)game, player_ptrs);
-  char players_text[64];
-  snprintf(players_text, sizeof(players_text), "Players: %u", player_count);
-  render_text(r->renderer, r->font, players_text, 10, 40, white, black, 0);
+  draw_counter(r, "Players: ", player_count, 10, 40, white);
 }
 
 /**
  * @brief Render game over screen
  */
-static void render_game_over(GameRenderer *r, const Game *game) {
-  if (!r || !game || !r->font)
+static void render_game_over(GameRenderer *r, const Player *players,
+                             uint32_t player_count) {
+  if (!r || !r->font)
     return;
   SDL_Color white = {255, 255, 255, 255};
   SDL_Color black = {0, 0, 0, 255};
   // Draw "Game Over" text
-  render_text(r->renderer, r->font, "Game Over", r->window_width / 2 - 100,
-              r->window_height / 2 - 30, black, white, 3);
+  draw_label(r, "Game Over", r->window_width / 2 - 100,
+             r->window_height / 2 - 30, black, white, 3);
   // Draw winner if there's one player left
-  Player *player_ptrs[MAX_PLAYERS];
-  uint32_t player_count = game_get_players((Game *)game, player_ptrs);
   if (player_count > 0) {
     char winner_text[128];
     snprintf(winner_text, sizeof(winner_text), "Winner: %s",
-             player_ptrs[0]->name);
-    render_text(r->renderer, r->font, winner_text, r->window_width / 2 - 100,
-                r->window_height / 2 + 30, black, white, 3);
+             players[0].name);
+    draw_label(r, winner_text, r->window_width / 2 - 100,
+               r->window_height / 2 + 30, black, white, 3);
   }
 }
 
@@ -300,12 +1003,32 @@ void renderer_render(GameRenderer *r, const Game *game) {
     return;
   SDL_SetRenderDrawColor(r->renderer, 0, 0, 0, 255);
   SDL_RenderClear(r->renderer);
-  render_players(r, game);
+  Player players[MAX_PLAYERS];
+  uint32_t player_count = game_get_players((Game *)game, players);
+  render_players(r, game, players, player_count, NULL, 1.0f);
   if (game_is_over(game)) {
-    render_game_over(r, game);
+    render_game_over(r, players, player_count);
   }
-  render_banner(r, game);
-  SDL_RenderPresent(r->renderer);
+  render_banner(r, game_get_frame(game), player_count);
+  present_frame(r);
+}
+
+/**
+ * @brief Render a frame published through a RenderScheduler
+ */
+void renderer_render_frame(GameRenderer *r, const Game *game,
+                           const RenderFrame *frame) {
+  if (!r || !game || !frame)
+    return;
+  SDL_SetRenderDrawColor(r->renderer, 0, 0, 0, 255);
+  SDL_RenderClear(r->renderer);
+  render_players(r, game, frame->players, frame->player_count,
+                 frame->previous, frame->alpha);
+  if (frame->game_over) {
+    render_game_over(r, frame->players, frame->player_count);
+  }
+  render_banner(r, frame->frame, frame->player_count);
+  present_frame(r);
 }
 
 /**
@@ -316,17 +1039,17 @@ void renderer_render_splash(GameRenderer *r, const Game *game) {
     return;
   SDL_SetRenderDrawColor(r->renderer, 0, 0, 0, 255);
   SDL_RenderClear(r->renderer);
-  render_players(r, game);
-  render_banner(r, game);
+  Player players[MAX_PLAYERS];
+  uint32_t player_count = game_get_players((Game *)game, players);
+  render_players(r, game, players, player_count, NULL, 1.0f);
+  render_banner(r, game_get_frame(game), player_count);
   if (r->font) {
     SDL_Color white = {255, 255, 255, 255};
     SDL_Color black = {0, 0, 0, 255};
-    render_text(r->renderer, r->font, "Waiting for players",
-                r->window_width / 2 - 150, r->window_height / 2 - 60, black,
-                white, 2);
-    render_text(r->renderer, r->font, "press SPACE to start",
-                r->window_width / 2 - 150, r->window_height / 2 - 20, black,
-                white, 2);
+    draw_label(r, "Waiting for players", r->window_width / 2 - 150,
+               r->window_height / 2 - 60, black, white, 2);
+    draw_label(r, "press SPACE to start", r->window_width / 2 - 150,
+               r->window_height / 2 - 20, black, white, 2);
   }
-  SDL_RenderPresent(r->renderer);
+  present_frame(r);
 }
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "board_lod.h"
+#include "camera.h"
+#include "capture.h"
 #include "game_logic.h"
+#include "label_cache.h"
+#include "postprocess.h"
+#include "render_sched.h"
 #include "types.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -17,6 +23,28 @@ extern "C" {
 
 /**
  * @brief Internal renderer structure
+ *
+ * The board is seen through a Camera that can zoom, pan and follow a
+ * player. It is kept in streaming textures, one texel per cell plus one per
+ * reduced level of a BoardLod. Each frame the levels are recomputed under the
+ * rows written since the previous frame; the level drawn is the finest one
+ * whose cells are at least a pixel, and only its rows in view are converted
+ * through the owner palette and uploaded before the visible part is copied
+ * to the window. While zoomed in, the coarsest level is shown as a minimap.
+ * Heads are tinted copies of two pre-rendered sprites. If no level has a
+ * texture (e.g. the board exceeds the maximum texture size) the visible
+ * cells are drawn as rectangles instead.
+ *
+ * Names and banner text are drawn from a LabelCache, so a label is only
+ * rasterized the first time it is shown and the changing counters come from
+ * a digit atlas.
+ *
+ * With enablePostProcessing every presented frame is read back and run
+ * through the CPU bloom pass of postprocess.h on a worker thread.
+ *
+ * An offscreen renderer draws into a surface with the software renderer, so
+ * it runs without a display (e.g. on CI machines). Any renderer can record
+ * its presented frames through a CaptureSink.
  */
 typedef struct {
   SDL_Window *window;
@@ -26,12 +54,63 @@ typedef struct {
   int window_width;
   int window_height;
   bool is_open;
+  Camera camera;             ///< Part of the board in view
+  bool show_minimap;         ///< Draw the minimap while zoomed in
+  bool follow_next;          ///< Follow the next player on the next frame
+  bool dragging;             ///< Left button held, mouse motion pans
+  BoardLod *lod;             ///< Reduced board levels, NULL = no board
+  const Game *board;         ///< Game the board levels were synced from
+  SDL_Texture *grid_texture; ///< One texel per cell, NULL = too large
+  SDL_Texture *lod_textures[BOARD_LOD_MAX_LEVELS]; ///< Levels 1 and up
+  uint32_t palette[256];     ///< ARGB8888 colour of each owner ID
+  uint64_t *dirty_rows;      ///< Rows written since the previous frame
+  uint8_t *row_buffer;       ///< One row of owners, for non-dense grids
+  SDL_Texture *head_fill;    ///< White disc, tinted with the head colour
+  SDL_Texture *head_ring;    ///< White ring, tinted with the player colour
+  int head_half_size;        ///< Distance from sprite centre to its edge
+  LabelCache *labels;        ///< Rasterized text, NULL = render per draw
+  PostProcess *post;         ///< Bloom pass, NULL = disabled
+  SDL_Texture *post_texture; ///< Last bloom layer, added over the frame
+  uint32_t *post_frame;      ///< Read-back buffer of the drawn frame
+  int post_width;            ///< Output width in pixels
+  int post_height;           ///< Output height in pixels
+  bool post_ready;           ///< post_texture holds a finished layer
+  SDL_Surface *surface;      ///< Offscreen target, NULL = window
+  CaptureSink *capture;      ///< Recording of presented frames, NULL = off
+  uint32_t *capture_frame;   ///< Read-back buffer for window captures
+  int capture_width;         ///< Captured frame width in pixels
+  int capture_height;        ///< Captured frame height in pixels
 } GameRenderer;
 /**
  * @brief Create a new SDL renderer
  */
 GameRenderer *renderer_create(const GameConfig *config);
 
+/**
+ * @brief Create a renderer drawing into an ARGB8888 surface, with no window
+ *
+ * Only the SDL events subsystem is initialised, so no video driver or
+ * display is needed.
+ */
+GameRenderer *renderer_create_offscreen(const GameConfig *config);
+
+/**
+ * @brief Record every presented frame until renderer_stop_capture()
+ *
+ * Frames are encoded on a background thread; if it falls behind, frames
+ * are dropped rather than slowing down rendering.
+ * @param path Output file, or file name pattern for capture_format_png
+ * @param fps Frame rate stored in the Y4M header
+ * @return 0 on success, -1 on failure (or if already recording)
+ */
+int renderer_start_capture(GameRenderer *renderer, const char *path,
+                           CaptureFormat format, uint32_t fps);
+
+/**
+ * @brief Flush the queued frames, close the recording and log its counters
+ */
+void renderer_stop_capture(GameRenderer *renderer);
+
 /**
  * @brief Destroy renderer and free resources
  */
@@ -42,6 +121,17 @@ void renderer_destroy(GameRenderer *renderer);
  */
 void renderer_render(GameRenderer *renderer, const Game *game);
 
+/**
+ * @brief Render a frame handed out by render_sched_next()
+ *
+ * Heads, names and the banner come from the frame, with heads placed
+ * frame->alpha of the way from their previous cell. The board is read from
+ * the game, which must not be the one the simulation is moving, e.g. the
+ * board filled by render_sched_next().
+ */
+void renderer_render_frame(GameRenderer *renderer, const Game *game,
+                           const RenderFrame *frame);
+
 /**
  * @brief Check if window is open
  */
@@ -1,4 +1,5 @@
 #include "server.h"
+#include "defines.h"
 #include "player.h"
 #include <errno.h>
 #include <fcntl.h>
@@ -108,9 +109,22 @@ static int send_color_packet(int sock, Rgb color) {
 
 #define member_size(type, member) (sizeof(((type *)0)->member))
 
+static uint32_t compute_players_size(uint32_t player_count,
+                                     const Player *players) {
+  uint32_t size = 0;
+  for (uint32_t i = 0; i < player_count; ++i) {
+    size_t name_len = strlen(players[i].name);
+    size += 4 * 2;            // x, y
+    size += sizeof(Rgb);      // r,g,b
+    size += 4 + name_len;     // string length + bytes
+    size += sizeof(PlayerId); // id
+  }
+  return size;
+}
+
 static uint32_t compute_game_server_size(const GameServer *s,
                                          uint32_t player_count,
-                                         Player **players) {
+                                         const Player *players) {
   uint32_t w = 0, h = 0;
   game_get_grid_size(s->game, &w, &h);
   // Estimate size
@@ -118,24 +132,76 @@ static uint32_t compute_game_server_size(const GameServer *s,
   packet_size += member_size(GameConfig, grid_width);
   packet_size += member_size(GameConfig, grid_height);
   packet_size += sizeof(uint32_t); // player count
-  for (uint32_t i = 0; i < player_count; ++i) {
-    size_t name_len = strlen(players[i]->name);
-    packet_size += 4 * 2;            // x, y
-    packet_size += sizeof(Rgb);      // r,g,b
-    packet_size += 4 + name_len;     // string length + bytes
-    packet_size += sizeof(PlayerId); // id
-  }
+  packet_size += compute_players_size(player_count, players);
   packet_size += 4; // frame
 
   packet_size += (size_t)w * (size_t)h * sizeof(PlayerId); // grid bytes
   return packet_size;
 }
 
+// --- Packet buffers ------------------------------------------------------
+
+static int packet_reserve(PacketBuffer *b, size_t size) {
+  if (size <= b->capacity)
+    return 0;
+  size_t capacity = b->capacity ? b->capacity : 256;
+  while (capacity < size)
+    capacity *= 2;
+  if (!b->huge_pages) {
+    uint8_t *data = (uint8_t *)realloc(b->data, capacity);
+    if (!data)
+      return -1;
+    b->data = data;
+    b->capacity = capacity;
+    return 0;
+  }
+  // Mapped buffers cannot be realloc'ed, move the contents instead
+  PageBacking backing;
+  uint8_t *data = (uint8_t *)huge_pages_alloc(capacity, true, &backing);
+  if (!data)
+    return -1;
+  if (b->size)
+    memcpy(data, b->data, b->size);
+  huge_pages_free(b->data, b->capacity, b->backing);
+  if (backing != b->backing && backing != page_backing_heap)
+    ulog_debug("server: %zu byte packet buffer backed by %s", capacity,
+               huge_pages_backing_name(backing));
+  b->data = data;
+  b->capacity = capacity;
+  b->backing = backing;
+  return 0;
+}
+
+// Writers below assume packet_reserve() made room for them
+static void packet_put(PacketBuffer *b, const void *src, size_t n) {
+  memcpy(b->data + b->size, src, n);
+  b->size += n;
+}
+
+static void packet_put_u32(PacketBuffer *b, uint32_t v) {
+  uint32_t be = htonl(v);
+  packet_put(b, &be, 4);
+}
+
+static void packet_put_player(PacketBuffer *b, const Player *p) {
+  uint32_t name_len = (uint32_t)strlen(p->name);
+  packet_put_u32(b, (uint32_t)p->position.x);
+  packet_put_u32(b, (uint32_t)p->position.y);
+  packet_put(b, &p->color, sizeof(Rgb));
+  packet_put_u32(b, name_len);
+  packet_put(b, p->name, name_len);
+  packet_put(b, &p->id, sizeof(PlayerId));
+}
+
+static void packet_free(PacketBuffer *b) {
+  huge_pages_free(b->data, b->capacity, b->backing);
+  memset(b, 0, sizeof(PacketBuffer));
+}
+
 /**
- * @brief Send the current game state to a client
+ * @brief Serialize everything in a full state packet that precedes the grid
  *
- * This function constructs and sends a packet containing the current game state
- * in the following format:
+ * The full packet has the following format:
  * - Payload length (4 bytes, big-endian) - total length of the rest of the
  * packet
  * - Grid width (4 bytes)
@@ -145,75 +211,348 @@ static uint32_t compute_game_server_size(const GameServer *s,
  *   - Position (2 * 4 bytes)
  *   - Color (3 bytes)
  *   - Name length (4 bytes) + Name (variable length)
- *   - Player ID (4 bytes)
+ *   - Player ID (1 byte)
  * - Frame (4 bytes)
  * - Grid (width * height * 1 byte)
  *
- * @param s Game server instance
- * @param sock Client socket
+ * The header is the same for every client, so it is built once per frame.
  */
-static int send_game_state_packet(GameServer *s, int sock) {
-  Player *player_ptrs[MAX_PLAYERS];
-  uint32_t player_count = game_get_players(s->game, player_ptrs);
-  uint32_t packet_size = compute_game_server_size(s, player_count, player_ptrs);
-  ulog_debug("send_game_state_packet: computed packet size %u bytes",
-             packet_size);
-  uint32_t payload_len_be = htonl(packet_size);
-  // Send payload length
-  if (send_all(sock, &payload_len_be, 4) < 0)
-    return -1;
-  // Send grid w,h, player count
+static int build_full_header(GameServer *s, uint32_t player_count,
+                             const Player *players) {
+  PacketBuffer *b = &s->full_header;
+  uint32_t packet_size = compute_game_server_size(s, player_count, players);
+  ulog_debug("build_full_header: computed packet size %u bytes", packet_size);
   uint32_t w = 0, h = 0;
   game_get_grid_size(s->game, &w, &h);
-  uint32_t be;
-  be = htonl(w);
-  if (send_all(sock, &be, 4) < 0)
-    return -1;
-  be = htonl(h);
-  if (send_all(sock, &be, 4) < 0)
+  size_t header_size = 4 * 5 + compute_players_size(player_count, players);
+  b->size = 0;
+  if (packet_reserve(b, header_size) < 0)
     return -1;
-  be = htonl(player_count);
-  if (send_all(sock, &be, 4) < 0)
+  packet_put_u32(b, packet_size);
+  packet_put_u32(b, w);
+  packet_put_u32(b, h);
+  packet_put_u32(b, player_count);
+  for (uint32_t i = 0; i < player_count; ++i)
+    packet_put_player(b, &players[i]);
+  packet_put_u32(b, server_get_frame(s));
+  return 0;
+}
+
+// Convert a non-dense grid to row-major order once per frame, for every
+// client receiving the full state
+static int build_full_grid(GameServer *s) {
+  PacketBuffer *b = &s->full_grid;
+  const Grid *grid = game_get_grid_storage(s->game);
+  size_t size = (size_t)grid->width * grid->height;
+  b->size = 0;
+  if (packet_reserve(b, size) < 0)
     return -1;
+  if (size)
+    grid_copy_rows(grid, 0, grid->height, b->data);
+  b->size = size;
+  return 0;
+}
 
-  // Players
-  for (uint32_t i = 0; i < player_count; ++i) {
-    const Player *p = player_ptrs[i];
-    uint32_t x_be = htonl((uint32_t)p->position.x);
-    uint32_t y_be = htonl((uint32_t)p->position.y);
-    uint32_t name_len = (uint32_t)strlen(p->name);
-    uint32_t name_len_be = htonl(name_len);
-    PlayerId idb = p->id;
-    int failed = 0;
-    failed |= send_all(sock, &x_be, 4) < 0;
-    failed |= send_all(sock, &y_be, 4) < 0;
-    failed |= send_all(sock, &p->color, sizeof(Rgb)) < 0;
-    failed |= send_all(sock, &name_len_be, 4) < 0;
-    failed |= send_all(sock, p->name, name_len) < 0;
-    failed |= send_all(sock, &idb, sizeof(PlayerId)) < 0;
-    if (failed) {
-      return -1;
-    }
-  }
-  uint32_t frame_be = htonl(server_get_frame(s));
-  if (send_all(sock, &frame_be, 4) < 0) {
+/**
+ * @brief Send the full game state to a client
+ *
+ * Sends the shared header built by build_full_header() followed by the grid,
+ * taken from the row-major copy of build_full_grid() for non-dense storage.
+ */
+static int send_game_state_packet(GameServer *s, int sock) {
+  if (send_all(sock, s->full_header.data, s->full_header.size) < 0)
     return -1;
-  }
   // Grid
   const uint8_t *grid = game_get_grid(s->game);
+  if (!grid)
+    return send_all(sock, s->full_grid.data, s->full_grid.size);
+  uint32_t w = 0, h = 0;
+  game_get_grid_size(s->game, &w, &h);
   size_t grid_sz = (size_t)w * (size_t)h * sizeof(PlayerId);
   if (grid_sz && send_all(sock, grid, grid_sz) < 0)
     return -1;
+  return 0;
+}
+
+// --- Viewport packets ----------------------------------------------------
 
+static Overview *find_overview(GameServer *s, uint32_t factor) {
+  for (uint32_t i = 0; i < s->overview_count; ++i) {
+    if (s->overviews[i].factor == factor)
+      return &s->overviews[i];
+  }
+  return NULL;
+}
+
+/**
+ * @brief Downsample the board into factor x factor blocks
+ *
+ * Only tiles holding occupied cells are visited, so the cost follows the
+ * occupied area rather than the board size.
+ */
+static int build_overview(const Grid *grid, uint32_t factor, Overview *o) {
+  uint32_t ow = (uint32_t)(((uint64_t)grid->width + factor - 1) / factor);
+  uint32_t oh = (uint32_t)(((uint64_t)grid->height + factor - 1) / factor);
+  size_t blocks = (size_t)ow * oh;
+  if (blocks > o->capacity) {
+    uint8_t *density = (uint8_t *)realloc(o->density, blocks);
+    if (!density)
+      return -1;
+    o->density = density;
+    uint64_t *counts =
+        (uint64_t *)realloc(o->counts, blocks * sizeof(uint64_t));
+    if (!counts)
+      return -1;
+    o->counts = counts;
+    o->capacity = blocks;
+  }
+  o->factor = factor;
+  o->width = ow;
+  o->height = oh;
+  memset(o->counts, 0, blocks * sizeof(uint64_t));
+  GridChunkIter it;
+  GridChunkView view;
+  grid_chunk_iter_init(&it, grid);
+  while (grid_chunk_iter_next(&it, &view)) {
+    for (uint32_t j = 0; j < view.height; ++j) {
+      uint64_t word = view.occupancy[(size_t)j * view.occupancy_stride];
+      uint64_t *row = &o->counts[(size_t)((view.y + j) / factor) * ow];
+      while (word) {
+        uint32_t i = (uint32_t)__builtin_ctzll(word);
+        row[(view.x + i) / factor]++;
+        word &= word - 1;
+      }
+    }
+  }
+  for (uint32_t by = 0; by < oh; ++by) {
+    uint64_t bh = grid->height - (uint64_t)by * factor;
+    if (bh > factor)
+      bh = factor;
+    for (uint32_t bx = 0; bx < ow; ++bx) {
+      uint64_t bw = grid->width - (uint64_t)bx * factor;
+      if (bw > factor)
+        bw = factor;
+      size_t k = (size_t)by * ow + bx;
+      o->density[k] = (uint8_t)(o->counts[k] * 255 / (bw * bh));
+    }
+  }
   return 0;
 }
 
-static int recv_move_direction(int sock, int32_t *out_dir) {
+// Clip [center - radius, center + radius] to [0, size)
+static void view_span(uint32_t center, uint32_t radius, uint32_t size,
+                      uint32_t *start, uint32_t *length) {
+  uint64_t lo = center > radius ? center - radius : 0;
+  uint64_t hi = (uint64_t)center + radius + 1;
+  if (hi > size)
+    hi = size;
+  *start = (uint32_t)lo;
+  *length = (uint32_t)(hi - lo);
+}
+
+/**
+ * @brief Serialize the viewport state packet of one client
+ *
+ * Extended packets keep the full packet layout up to the frame number, with
+ * CYCLES_STATE_EXTENDED set in the width field and only the players whose
+ * head lies inside the window. The grid is replaced by tagged sections
+ * ([tag][length][payload]): the cells of the window and, if requested, the
+ * board overview and the grid hash. Without a radius the window is the whole
+ * board.
+ */
+static int build_view_packet(GameServer *s, PlayerId id, uint32_t player_count,
+                             const Player *players) {
+  PacketBuffer *b = &s->packets[id];
+  const ClientView *cv = &s->views[id];
+  const Player *me = NULL;
+  for (uint32_t i = 0; i < player_count && !me; ++i) {
+    if (players[i].id == id)
+      me = &players[i];
+  }
+  const Grid *grid = game_get_grid_storage(s->game);
+  b->size = 0;
+  if (!me || !grid)
+    return -1;
+  uint32_t vx = 0, vy = 0, vw = grid->width, vh = grid->height;
+  if (cv->radius) {
+    view_span((uint32_t)me->position.x, cv->radius, grid->width, &vx, &vw);
+    view_span((uint32_t)me->position.y, cv->radius, grid->height, &vy, &vh);
+  }
+  const Player *visible[MAX_PLAYERS];
+  uint32_t visible_count = 0;
+  size_t players_size = 0;
+  for (uint32_t i = 0; i < player_count; ++i) {
+    const Player *p = &players[i];
+    if ((uint32_t)p->position.x - vx < vw &&
+        (uint32_t)p->position.y - vy < vh) {
+      visible[visible_count++] = p;
+      players_size += compute_players_size(1, &players[i]);
+    }
+  }
+  const Overview *overview =
+      cv->overview_factor ? find_overview(s, cv->overview_factor) : NULL;
+  size_t view_cells = (size_t)vw * vh;
+  size_t size = 4 * 5 + players_size + 4 * 6 + view_cells;
+  if (overview)
+    size += 4 * 5 + (size_t)overview->width * overview->height;
+  if (cv->state_hash)
+    size += 4 * 4;
+  if (size - 4 > NET_MAX_PACKET || packet_reserve(b, size) < 0)
+    return -1;
+  packet_put_u32(b, (uint32_t)(size - 4));
+  packet_put_u32(b, grid->width | CYCLES_STATE_EXTENDED);
+  packet_put_u32(b, grid->height);
+  packet_put_u32(b, visible_count);
+  for (uint32_t i = 0; i < visible_count; ++i)
+    packet_put_player(b, visible[i]);
+  packet_put_u32(b, server_get_frame(s));
+  packet_put_u32(b, CYCLES_SECTION_VIEW);
+  packet_put_u32(b, (uint32_t)(4 * 4 + view_cells));
+  packet_put_u32(b, vx);
+  packet_put_u32(b, vy);
+  packet_put_u32(b, vw);
+  packet_put_u32(b, vh);
+  grid_copy_window(grid, vx, vy, vw, vh, b->data + b->size);
+  b->size += view_cells;
+  if (overview) {
+    size_t blocks = (size_t)overview->width * overview->height;
+    packet_put_u32(b, CYCLES_SECTION_OVERVIEW);
+    packet_put_u32(b, (uint32_t)(4 * 3 + blocks));
+    packet_put_u32(b, overview->factor);
+    packet_put_u32(b, overview->width);
+    packet_put_u32(b, overview->height);
+    packet_put(b, overview->density, blocks);
+  }
+  if (cv->state_hash) {
+    uint64_t hash = game_get_state_hash(s->game);
+    packet_put_u32(b, CYCLES_SECTION_HASH);
+    packet_put_u32(b, 4 * 2);
+    packet_put_u32(b, (uint32_t)(hash >> 32));
+    packet_put_u32(b, (uint32_t)hash);
+  }
+  return 0;
+}
+
+typedef struct {
+  GameServer *s;
+  PlayerId ids[MAX_PLAYERS];
+  uint32_t player_count;
+  const Player *players;
+} ViewBuildJob;
+
+static void build_view_task(void *ctx, uint32_t index) {
+  ViewBuildJob *job = (ViewBuildJob *)ctx;
+  PlayerId id = job->ids[index];
+  if (build_view_packet(job->s, id, job->player_count, job->players) < 0) {
+    // The client falls back to the full state packet
+    job->s->packets[id].size = 0;
+  }
+}
+
+/**
+ * @brief Build this frame's state packets for every active client
+ *
+ * Clients that negotiated no option share one full-state header; extended
+ * packets are built in parallel on the server thread pool.
+ */
+static void build_state_packets(GameServer *s,
+                                const bool clients_unsent[MAX_PLAYERS]) {
+  Player players[MAX_PLAYERS];
+  uint32_t player_count = game_get_players(s->game, players);
+  ViewBuildJob job = {
+      .s = s, .player_count = player_count, .players = players};
+  uint32_t view_count = 0;
+  bool full_state = false;
+  s->overview_count = 0;
+  const Grid *grid = game_get_grid_storage(s->game);
+  for (int id = 1; id < MAX_PLAYERS; ++id) {
+    s->packets[id].size = 0;
+    const ClientView *cv = &s->views[id];
+    if (!clients_unsent[id])
+      continue;
+    if (cv->radius == 0 && !cv->state_hash) {
+      full_state = true;
+      continue;
+    }
+    job.ids[view_count++] = (PlayerId)id;
+    uint32_t factor = cv->overview_factor;
+    if (factor && !find_overview(s, factor)) {
+      Overview *o = &s->overviews[s->overview_count];
+      if (build_overview(grid, factor, o) == 0)
+        s->overview_count++;
+    }
+  }
+  thread_pool_run(s->pool, view_count, build_view_task, &job);
+  if (build_full_header(s, player_count, players) < 0 ||
+      (full_state && !game_get_grid(s->game) && build_full_grid(s) < 0))
+    s->full_header.size = 0;
+}
+
+static int send_state_to_client(GameServer *s, PlayerId id, int sock) {
+  const PacketBuffer *b = &s->packets[id];
+  if (b->size)
+    return send_all(sock, b->data, b->size);
+  if (s->full_header.size == 0)
+    return -1;
+  return send_game_state_packet(s, sock);
+}
+
+// Whether an overview of this factor is worth building: a factor of 1 only
+// repeats the grid, and the overview has to fit in one packet
+static bool overview_factor_allowed(const GameServer *s, uint32_t factor) {
+  if (factor == 0)
+    return true;
+  if (factor == 1)
+    return false;
+  uint32_t w = 0, h = 0;
+  game_get_grid_size(s->game, &w, &h);
+  uint64_t blocks = (((uint64_t)w + factor - 1) / factor) *
+                    (((uint64_t)h + factor - 1) / factor);
+  return 4 * 5 + blocks <= NET_MAX_PACKET;
+}
+
+// Apply an option packet sent by a client
+static void apply_client_option(GameServer *s, PlayerId id, uint32_t opcode,
+                                uint32_t arg0, uint32_t arg1) {
+  switch (opcode) {
+  case CYCLES_OPTION_VIEWPORT:
+    if (!overview_factor_allowed(s, arg1)) {
+      ulog_warn("server: client %d asked for overview factor %u, ignoring",
+                id, arg1);
+      arg1 = 0;
+    }
+    s->views[id].radius = arg0;
+    s->views[id].overview_factor = arg1;
+    ulog_debug("server: client %d viewport radius %u overview %u", id, arg0,
+               arg1);
+    break;
+  case CYCLES_OPTION_STATE_HASH:
+    s->views[id].state_hash = arg0 != 0;
+    ulog_debug("server: client %d state hash %s", id, arg0 ? "on" : "off");
+    break;
+  default:
+    ulog_warn("server: client %d sent unknown option %u, ignoring", id,
+              opcode);
+    break;
+  }
+}
+
+// Receive one packet from a client: either a move (returns 0 and fills
+// out_dir) or an option (applied, returns 1). Returns -1 on error.
+static int recv_client_packet(GameServer *s, PlayerId id, int sock,
+                              int32_t *out_dir) {
   if (!out_dir)
     return -1;
   uint32_t len = 0;
   if (recv_packet_len(sock, &len) < 0)
     return -1;
+  if (len == CYCLES_OPTION_PACKET_LEN) {
+    uint32_t v_be[3];
+    if (recv_all(sock, v_be, sizeof v_be) < 0)
+      return -1;
+    apply_client_option(s, id, ntohl(v_be[0]), ntohl(v_be[1]), ntohl(v_be[2]));
+    return 1;
+  }
   if (len != 4)
     return -1;
   uint32_t v_be = 0;
@@ -232,12 +571,21 @@ GameServer *server_create(Game *game, const GameConfig *config) {
   s->game = game;
   s->conf = *config;
   s->listen_socket = -1;
-  for (int i = 0; i < MAX_PLAYERS; ++i)
+  for (int i = 0; i < MAX_PLAYERS; ++i) {
     s->client_sockets[i] = -1;
+    s->packets[i].huge_pages = config->huge_pages;
+  }
+  s->full_header.huge_pages = config->huge_pages;
+  s->full_grid.huge_pages = config->huge_pages;
+  if (config->huge_pages)
+    ulog_info("server: grid backed by %s",
+              huge_pages_backing_name(game_get_grid_backing(game)));
   s->running = false;
   s->accepting = true;
   s->frame = 0;
   s->max_comm_ms = 100;
+  // A failed pool is not fatal, packets are then built serially
+  s->pool = thread_pool_create(0);
   return s;
 }
 
@@ -249,7 +597,13 @@ void server_destroy(GameServer *server) {
   for (int i = 0; i < MAX_PLAYERS; ++i) {
     if (server->client_sockets[i] >= 0)
       close(server->client_sockets[i]);
+    packet_free(&server->packets[i]);
+    free(server->overviews[i].density);
+    free(server->overviews[i].counts);
   }
+  packet_free(&server->full_header);
+  packet_free(&server->full_grid);
+  thread_pool_destroy(server->pool);
   free(server);
 }
 
@@ -332,12 +686,14 @@ void server_accept_clients(GameServer *s) {
       free(name);
       if (id != 0) {
         ulog_debug("accept_clients: added player with ID %d", id);
-        const Player *p = game_get_player(s->game, id);
-        if (p && send_color_packet(client_sock, p->color) == 0) {
+        Player p;
+        if (game_get_player(s->game, id, &p) &&
+            send_color_packet(client_sock, p.color) == 0) {
           ulog_info("accept_clients: sent color R=%d G=%d B=%d to player %d",
-                    p->color.r, p->color.g, p->color.b, id);
+                    p.color.r, p.color.g, p.color.b, id);
           // Set back to non-blocking for game loop
           set_nonblocking(client_sock);
+          s->views[id] = (ClientView){0};
           s->client_sockets[id] = client_sock;
           ulog_info("accept_clients: client %d fully connected", id);
           continue; // accept more
@@ -383,7 +739,7 @@ static int attempt_send_to_clients(GameServer *s,
   for (int id = 1; id < MAX_PLAYERS; ++id) {
     if (clients_unsent[id]) {
       int sock = s->client_sockets[id];
-      if (send_game_state_packet(s, sock) == 0) {
+      if (send_state_to_client(s, (PlayerId)id, sock) == 0) {
         ulog_trace("server_run: sent game state to client %d", id);
         clients_unsent[id] = false;
         to_recv[id] = true;
@@ -437,7 +793,12 @@ static int attempt_recv_from_ready(GameServer *s, const fd_set *rfds,
     int sock = s->client_sockets[id];
     if (to_recv[id] && sock >= 0 && FD_ISSET(sock, rfds)) {
       int32_t dir = 0;
-      if (recv_move_direction(sock, &dir) == 0) {
+      int rc = recv_client_packet(s, (PlayerId)id, sock, &dir);
+      if (rc == 1) {
+        // Option applied, keep waiting for this frame's move
+        continue;
+      }
+      if (rc == 0) {
         ulog_trace("server_run: received direction %d from client %d", dir, id);
         if (dir < 0)
           dir = 0;
@@ -513,6 +874,7 @@ void server_run(GameServer *s) {
     int active_clients = mark_active_clients(s, clients_unsent);
     ulog_trace("server_run: found %d active clients to send state to",
                active_clients);
+    build_state_packets(s, clients_unsent);
     struct timeval comm_start;
     gettimeofday(&comm_start, NULL);
     for (;;) {
@@ -546,7 +908,15 @@ void server_run(GameServer *s) {
       }
     }
     ulog_trace("server_run: moving players for frame %u", s->frame);
-    game_move_players(s->game, directions);
+    if (game_move_players(s->game, directions) != 0) {
+      ulog_warn("server_run: failed to update the grid in frame %u", s->frame);
+    }
+    if (s->render_sched) {
+      render_sched_publish(s->render_sched, s->game, render_sched_now_ns());
+    }
+    if (s->frame_ring) {
+      frame_ring_publish(s->frame_ring, s->game, render_sched_now_ns());
+    }
     s->frame++;
     ulog_trace("server_run: frame %u complete", s->frame - 1);
     // Maintain ~30 fps
@@ -564,6 +934,16 @@ void server_stop(GameServer *server) {
   }
 }
 
+void server_set_render_scheduler(GameServer *server, RenderScheduler *sched) {
+  if (server)
+    server->render_sched = sched;
+}
+
+void server_set_frame_ring(GameServer *server, FrameRingWriter *ring) {
+  if (server)
+    server->frame_ring = ring;
+}
+
 void server_set_accepting_clients(GameServer *server, bool accepting) {
   if (server)
     server->accepting = accepting;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "frame_ring.h"
 #include "game_logic.h"
+#include "render_sched.h"
+#include "thread_pool.h"
 #include "types.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -14,18 +17,60 @@ extern "C" {
  * @brief Network server for the Cycles game (C port).
  */
 
+/**
+ * @brief State packet options negotiated by a client
+ */
+typedef struct {
+  uint32_t radius;          ///< Viewport half-size in cells, 0 = whole board
+  uint32_t overview_factor; ///< Overview block size in cells, 0 = none
+  bool state_hash;          ///< Append the grid hash to every state
+} ClientView;
+
+/**
+ * @brief Growable byte buffer holding a serialized packet
+ */
+typedef struct {
+  uint8_t *data;       ///< Packet bytes
+  size_t size;         ///< Bytes in use
+  size_t capacity;     ///< Bytes allocated
+  bool huge_pages;     ///< Try huge pages when growing
+  PageBacking backing; ///< Backing of data
+} PacketBuffer;
+
+/**
+ * @brief Downsampled board occupancy, shared by clients asking for the same
+ * factor
+ */
+typedef struct {
+  uint32_t factor;  ///< Block size in cells
+  uint32_t width;   ///< Blocks per row
+  uint32_t height;  ///< Rows of blocks
+  uint8_t *density; ///< Occupied fraction per block scaled to 0..255
+  uint64_t *counts; ///< Occupied cells per block (scratch)
+  size_t capacity;  ///< Blocks allocated in density and counts
+} Overview;
+
 /**
  * @brief Server state
  */
 typedef struct GameServer {
-  Game *game;                      ///< Game logic instance (owned externally)
-  GameConfig conf;                 ///< Server/game configuration snapshot
-  int listen_socket;               ///< Listening TCP socket
-  int client_sockets[MAX_PLAYERS]; ///< Per-player sockets indexed by PlayerId
-  bool running;                    ///< Main loop flag
-  bool accepting;                  ///< Whether to accept new clients
-  uint32_t frame;                  ///< Current frame number
-  int max_comm_ms;                 ///< Max per-frame comm time budget in ms
+  Game *game;                        ///< Game logic instance (owned externally)
+  GameConfig conf;                   ///< Server/game configuration snapshot
+  int listen_socket;                 ///< Listening TCP socket
+  int client_sockets[MAX_PLAYERS];   ///< Per-player sockets indexed by PlayerId
+  bool running;                      ///< Main loop flag
+  bool accepting;                    ///< Whether to accept new clients
+  uint32_t frame;                    ///< Current frame number
+  int max_comm_ms;                   ///< Max per-frame comm time budget in ms
+  ClientView views[MAX_PLAYERS];     ///< Per-player viewport options
+  PacketBuffer packets[MAX_PLAYERS]; ///< Per-player viewport state packets
+  PacketBuffer full_header;          ///< Shared full-state packet header
+  PacketBuffer full_grid;            ///< Row-major non-dense grid, shared
+  Overview overviews[MAX_PLAYERS];   ///< Overviews built this frame
+  uint32_t overview_count;           ///< Valid entries in overviews
+  ThreadPool *pool;                  ///< Workers building state packets
+  RenderScheduler *render_sched;     ///< Receives every tick, may be NULL
+  FrameRingWriter *frame_ring;       ///< Shares every tick, may be NULL
 } GameServer;
 
 /**
@@ -70,6 +115,20 @@ void server_set_accepting_clients(GameServer *server, bool accepting);
  */
 void server_accept_clients(GameServer *server);
 
+/**
+ * @brief Publish every simulated frame to a render scheduler
+ *
+ * The scheduler is not owned by the server. Pass NULL to stop publishing.
+ */
+void server_set_render_scheduler(GameServer *server, RenderScheduler *sched);
+
+/**
+ * @brief Publish every simulated frame to observer processes
+ *
+ * The ring is not owned by the server. Pass NULL to stop publishing.
+ */
+void server_set_frame_ring(GameServer *server, FrameRingWriter *ring);
+
 /**
  * @brief Get current frame number
  */
@@ -1,20 +1,32 @@
+#include "capture.h"
+#include "frame_ring.h"
 #include "game_logic.h"
+#include "render_sched.h"
 #include "renderer.h"
 #include "server.h"
 #include <errno.h>
 #include <limits.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <ulog.h>
+#include <unistd.h>
+
+enum {
+  DEFAULT_START_DELAY = 10, ///< Seconds a headless server waits for players
+  DEFAULT_CAPTURE_FPS = 30  ///< Video frame rate when renderFps is 0
+};
 
 /**
  * @brief Thread argument for running the server
  */
 typedef struct {
   GameServer *server;
+  atomic_bool done; ///< Set when server_run() returns
 } ServerThreadArg;
 
 /**
@@ -24,10 +36,51 @@ static void *server_thread_func(void *arg) {
   ServerThreadArg *thread_arg = (ServerThreadArg *)arg;
   if (thread_arg && thread_arg->server) {
     server_run(thread_arg->server);
+    atomic_store(&thread_arg->done, true);
   }
   return NULL;
 }
 
+/**
+ * @brief Read an optional non-negative integer from the environment
+ * @return 0 if unset or valid, -1 if set to anything else
+ */
+static int env_get_uint(const char *name, uint32_t *value) {
+  const char *env = getenv(name);
+  if (!env || !*env) {
+    return 0;
+  }
+  char *endptr = NULL;
+  errno = 0;
+  long val = strtol(env, &endptr, 10);
+  if (errno != 0 || !endptr || *endptr != '\0' || val < 0 ||
+      val > UINT32_MAX) {
+    fprintf(stderr, "Warning: invalid %s='%s'.\n", name, env);
+    return -1;
+  }
+  *value = (uint32_t)val;
+  return 0;
+}
+
+/**
+ * @brief Without a window to press SPACE in, start the game once every
+ * client slot is taken or after delay seconds
+ * @return Number of players that joined
+ */
+static uint32_t wait_for_players(Game *game, const GameConfig *config,
+                                 uint32_t delay) {
+  ulog_info("Waiting up to %u s for %u players...", delay,
+            config->max_clients);
+  uint64_t deadline = render_sched_now_ns() + (uint64_t)delay * 1000000000ull;
+  Player players[MAX_PLAYERS];
+  uint32_t count = 0;
+  while ((count = game_get_players(game, players)) < config->max_clients &&
+         render_sched_now_ns() < deadline) {
+    usleep(100000);
+  }
+  return count;
+}
+
 int main(int argc, char *argv[]) {
   srand((unsigned int)time(NULL));
   const char *config_path = argc > 1 ? argv[1] : "config.yaml";
@@ -69,8 +122,26 @@ int main(int argc, char *argv[]) {
     game_destroy(game);
     return 1;
   }
+  // Headless servers render offscreen, e.g. to record matches on CI
+  const char *env_headless = getenv("CYCLES_HEADLESS");
+  bool headless = env_headless && *env_headless && strcmp(env_headless, "0");
+  uint32_t start_delay = DEFAULT_START_DELAY;
+  const char *capture_path = getenv("CYCLES_CAPTURE");
+  const char *capture_format_name = getenv("CYCLES_CAPTURE_FORMAT");
+  CaptureFormat capture_format = capture_format_y4m;
+  if (env_get_uint("CYCLES_START_DELAY", &start_delay) != 0) {
+    exit(1);
+  }
+  if (capture_format_name && *capture_format_name &&
+      capture_format_from_name(capture_format_name, &capture_format) != 0) {
+    fprintf(stderr, "Warning: invalid CYCLES_CAPTURE_FORMAT='%s'.\n",
+            capture_format_name);
+    exit(1);
+  }
+
   ulog_info("Server listening on port %d", port);
-  GameRenderer *renderer = renderer_create(&config);
+  GameRenderer *renderer = headless ? renderer_create_offscreen(&config)
+                                    : renderer_create(&config);
   if (!renderer) {
     fprintf(stderr, "Failed to create renderer\n");
     server_destroy(server);
@@ -80,7 +151,7 @@ int main(int argc, char *argv[]) {
 
   // Phase 1: Start accept thread and wait for space bar
   pthread_t accept_thread;
-  ServerThreadArg accept_arg = {server};
+  ServerThreadArg accept_arg = {server, false};
   if (pthread_create(&accept_thread, NULL,
                      (void *(*)(void *))server_accept_clients, server) != 0) {
     fprintf(stderr, "Failed to create accept thread\n");
@@ -91,7 +162,13 @@ int main(int argc, char *argv[]) {
   }
 
   bool accepting_clients = true;
-  ulog_info("Waiting for players... Press SPACE to start the game.");
+  uint32_t headless_players = 0;
+  if (headless) {
+    headless_players = wait_for_players(game, &config, start_delay);
+    accepting_clients = false;
+  } else {
+    ulog_info("Waiting for players... Press SPACE to start the game.");
+  }
   while (accepting_clients && renderer_is_open(renderer)) {
     bool space_pressed = false;
     if (!renderer_poll_events(renderer, &space_pressed)) {
@@ -111,13 +188,59 @@ int main(int argc, char *argv[]) {
   // Stop accepting clients and wait for accept thread to finish
   server_set_accepting_clients(server, false);
   pthread_join(accept_thread, NULL);
+  if (headless && headless_players == 0) {
+    // The game would never end, and no one is there to close it
+    fprintf(stderr, "No players joined, not starting the game\n");
+    renderer_destroy(renderer);
+    server_destroy(server);
+    game_destroy(game);
+    return 1;
+  }
 
-  // Phase 2: Start game loop thread and render game
+  // Phase 2: Start game loop thread and render the frames it publishes. The
+  // render thread draws its own copy of the board, never the live one
+  RenderScheduler *render_sched = render_sched_create(&config);
+  Game *render_board = render_sched ? game_create(&config) : NULL;
+  if (!render_board) {
+    fprintf(stderr, "Failed to create render scheduler\n");
+    render_sched_destroy(render_sched);
+    renderer_destroy(renderer);
+    server_destroy(server);
+    game_destroy(game);
+    return 1;
+  }
+  server_set_render_scheduler(server, render_sched);
+  // Observer processes (cycles_viewer) read the ticks from shared memory
+  const char *shm_name = getenv("CYCLES_SHM");
+  FrameRingWriter *frame_ring = NULL;
+  if (shm_name && *shm_name) {
+    frame_ring = frame_ring_create(shm_name, &config);
+    if (!frame_ring) {
+      fprintf(stderr, "Failed to create shared memory frame ring %s\n",
+              shm_name);
+    } else {
+      frame_ring_publish(frame_ring, game, render_sched_now_ns());
+      server_set_frame_ring(server, frame_ring);
+      ulog_info("Publishing frames to shared memory %s", shm_name);
+    }
+  }
+  if (capture_path && *capture_path) {
+    uint32_t fps = config.render_fps ? config.render_fps : DEFAULT_CAPTURE_FPS;
+    if (renderer_start_capture(renderer, capture_path, capture_format, fps) !=
+        0) {
+      fprintf(stderr, "Failed to start capture to %s\n", capture_path);
+    } else {
+      ulog_info("Recording frames to %s", capture_path);
+    }
+  }
   pthread_t server_thread;
-  ServerThreadArg thread_arg = {server};
+  ServerThreadArg thread_arg = {server, false};
   if (pthread_create(&server_thread, NULL, server_thread_func, &thread_arg) !=
       0) {
     fprintf(stderr, "Failed to create server thread\n");
+    frame_ring_destroy(frame_ring);
+    game_destroy(render_board);
+    render_sched_destroy(render_sched);
     renderer_destroy(renderer);
     server_destroy(server);
     game_destroy(game);
@@ -130,13 +253,32 @@ int main(int argc, char *argv[]) {
       // Quit event received
       break;
     }
-    renderer_render(renderer, game);
+    RenderFrame frame;
+    if (render_sched_next(render_sched, render_sched_now_ns(), &frame,
+                          render_board)) {
+      renderer_render_frame(renderer, render_board, &frame);
+    } else if (headless && atomic_load(&thread_arg.done)) {
+      break; // No one to close the window, stop after the last frame
+    } else {
+      render_sched_wait(render_sched, 10); // Keep polling window events
+    }
   }
 
   // Cleanup
   ulog_info("Shutting down...");
   server_stop(server);
   pthread_join(server_thread, NULL);
+  RenderSchedStats stats;
+  render_sched_get_stats(render_sched, &stats);
+  ulog_info("Rendered %llu of %llu frames (%llu dropped, %llu duplicated)",
+            (unsigned long long)stats.rendered,
+            (unsigned long long)stats.published,
+            (unsigned long long)stats.dropped,
+            (unsigned long long)stats.duplicated);
+  render_sched_destroy(render_sched);
+  game_destroy(render_board);
+  frame_ring_destroy(frame_ring);
+  renderer_stop_capture(renderer);
   renderer_destroy(renderer);
   server_destroy(server);
   game_destroy(game);
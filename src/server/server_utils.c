@@ -11,6 +11,11 @@ void fill_default_configuration(GameConfig *config) {
   config->game_width = 1000;
   config->game_height = 1000;
   config->enable_postprocessing = false;
+  config->grid_storage = grid_storage_dense;
+  config->huge_pages = false;
+  config->render_fps = 0;
+  config->render_tick_stride = 1;
+  config->render_interpolate = false;
   if (config->grid_width > 0) {
     config->cell_size = (float)config->game_width / (float)config->grid_width;
   } else {
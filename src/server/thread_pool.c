@@ -0,0 +1,131 @@
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct ThreadPool {
+  pthread_t *threads;        /* Worker threads */
+  uint32_t thread_count;     /* Number of worker threads */
+  pthread_mutex_t mutex;     /* Protects the fields below */
+  pthread_cond_t work_cond;  /* Signalled when a new loop is published */
+  pthread_cond_t done_cond;  /* Signalled when the last worker finishes */
+  uint64_t generation;       /* Incremented for every published loop */
+  uint32_t busy_workers;     /* Workers still running the current loop */
+  bool stopping;             /* Set when the pool is being destroyed */
+  ThreadPoolTask task;       /* Current task */
+  void *ctx;                 /* Current task context */
+  uint32_t count;            /* Number of indices in the current loop */
+  atomic_uint_fast32_t next; /* Next index to hand out */
+};
+
+static void run_indices(ThreadPool *pool) {
+  for (;;) {
+    uint32_t index = (uint32_t)atomic_fetch_add(&pool->next, 1);
+    if (index >= pool->count) {
+      break;
+    }
+    pool->task(pool->ctx, index);
+  }
+}
+
+static void *worker_main(void *arg) {
+  ThreadPool *pool = (ThreadPool *)arg;
+  uint64_t seen = 0;
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!pool->stopping && pool->generation == seen) {
+      pthread_cond_wait(&pool->work_cond, &pool->mutex);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->mutex);
+    run_indices(pool);
+    pthread_mutex_lock(&pool->mutex);
+    if (--pool->busy_workers == 0) {
+      pthread_cond_signal(&pool->done_cond);
+    }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+ThreadPool *thread_pool_create(uint32_t threads) {
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 1 ? (uint32_t)(cpus - 1) : 0;
+  }
+  ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+  if (!pool) {
+    return NULL;
+  }
+  pool->threads = calloc(threads ? threads : 1, sizeof(pthread_t));
+  if (!pool->threads) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+  atomic_init(&pool->next, 0);
+  for (uint32_t i = 0; i < threads; i++) {
+    if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+      break;
+    }
+    pool->thread_count++;
+  }
+  return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+  if (!pool) {
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+  for (uint32_t i = 0; i < pool->thread_count; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool->threads);
+  free(pool);
+}
+
+void thread_pool_run(ThreadPool *pool, uint32_t count, ThreadPoolTask task,
+                     void *ctx) {
+  if (!task || count == 0) {
+    return;
+  }
+  if (!pool || pool->thread_count == 0 || count == 1) {
+    for (uint32_t i = 0; i < count; i++) {
+      task(ctx, i);
+    }
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->task = task;
+  pool->ctx = ctx;
+  pool->count = count;
+  atomic_store(&pool->next, 0);
+  pool->busy_workers = pool->thread_count;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->mutex);
+  run_indices(pool);
+  pthread_mutex_lock(&pool->mutex);
+  while (pool->busy_workers > 0) {
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+uint32_t thread_pool_concurrency(const ThreadPool *pool) {
+  return pool ? pool->thread_count + 1 : 1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file thread_pool.h
+ * @brief Fixed-size pool of worker threads for data-parallel loops.
+ */
+
+/**
+ * @brief Task run for each index of a parallel loop
+ * @param ctx User context passed to thread_pool_run()
+ * @param index Loop index in [0, count)
+ */
+typedef void (*ThreadPoolTask)(void *ctx, uint32_t index);
+
+/** Opaque thread pool */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Create a pool
+ * @param threads Number of worker threads, 0 picks one per online CPU minus
+ * the calling thread
+ * @return Pool, or NULL on failure
+ */
+ThreadPool *thread_pool_create(uint32_t threads);
+
+/**
+ * @brief Stop all workers and free the pool
+ */
+void thread_pool_destroy(ThreadPool *pool);
+
+/**
+ * @brief Run task(ctx, i) for every i in [0, count) and wait for completion
+ *
+ * The calling thread takes part in the loop. Indices are handed out
+ * dynamically, so the order in which they run is unspecified. With a NULL
+ * pool the loop runs serially on the calling thread.
+ */
+void thread_pool_run(ThreadPool *pool, uint32_t count, ThreadPoolTask task,
+                     void *ctx);
+
+/**
+ * @brief Number of threads taking part in a loop, including the caller
+ */
+uint32_t thread_pool_concurrency(const ThreadPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
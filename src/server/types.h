@@ -33,6 +33,13 @@ typedef struct {
 /** Directions for player movement */
 typedef enum { north = 0, east = 1, south = 2, west = 3 } Direction;
 
+/** Backing storage for the game grid */
+typedef enum {
+  grid_storage_dense = 0,   ///< One byte per cell, allocated up front
+  grid_storage_chunked = 1, ///< Lazily allocated chunks for sparse boards
+  grid_storage_tiled = 2    ///< Like dense, in Morton-ordered 8x8 tiles
+} GridStorage;
+
 /**
  * @brief Game configuration
  */
@@ -44,6 +51,11 @@ typedef struct {
   uint32_t game_height;
   float cell_size;
   bool enable_postprocessing;
+  GridStorage grid_storage;
+  bool huge_pages; ///< Back large grids and frame buffers with huge pages
+  uint32_t render_fps;         ///< Render rate in Hz, 0 = follow the ticks
+  uint32_t render_tick_stride; ///< Ticks per render when render_fps is 0
+  bool render_interpolate;     ///< Slide heads between ticks (render_fps > 0)
 } GameConfig;
 
 #ifdef __cplusplus
@@ -0,0 +1,103 @@
+#include "frame_ring.h"
+#include "game_logic.h"
+#include "render_sched.h"
+#include "renderer.h"
+#include "server_utils.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ulog.h>
+#include <unistd.h>
+
+#define DEFAULT_SHM_NAME "/cycles"
+
+enum {
+  ATTACH_RETRY_MS = 200, ///< Wait between attempts to find the server
+  IDLE_SLEEP_MS = 5,     ///< Wait when no new frame was published
+  REDRAW_MS = 33         ///< Redraw interval of an unchanged frame
+};
+
+/**
+ * @brief Observe a running server from another process
+ *
+ * Usage: cycles_viewer [shm-name] [config.yaml]. The segment name defaults
+ * to CYCLES_SHM, or /cycles. The board size comes from the server; the
+ * optional configuration only sets render options, e.g. postprocessing.
+ */
+int main(int argc, char *argv[]) {
+  const char *env_name = getenv("CYCLES_SHM");
+  const char *name = argc > 1                  ? argv[1]
+                     : env_name && *env_name ? env_name
+                                             : DEFAULT_SHM_NAME;
+  GameConfig config;
+  fill_default_configuration(&config);
+  if (argc > 2 && game_config_load(argv[2], &config) != 0) {
+    fprintf(stderr, "Failed to load configuration from %s\n", argv[2]);
+    return 1;
+  }
+  ulog_output_level_set_all(DEFAULT_ULOG_LEVEL);
+
+  ulog_info("Waiting for a server publishing to %s...", name);
+  FrameRingReader *reader;
+  while (!(reader = frame_ring_open(name))) {
+    usleep(ATTACH_RETRY_MS * 1000);
+  }
+  FrameRingInfo info;
+  frame_ring_get_info(reader, &info);
+  config.grid_width = info.grid_width;
+  config.grid_height = info.grid_height;
+  config.game_width = info.game_width;
+  config.game_height = info.game_height;
+  config.cell_size = (float)config.game_width / (float)config.grid_width;
+  // Only holds the board, players come with every frame
+  Game *game = game_create(&config);
+  if (!game) {
+    fprintf(stderr, "Failed to create game instance\n");
+    frame_ring_close(reader);
+    return 1;
+  }
+  GameRenderer *renderer = renderer_create(&config);
+  if (!renderer) {
+    fprintf(stderr, "Failed to create renderer\n");
+    game_destroy(game);
+    frame_ring_close(reader);
+    return 1;
+  }
+  ulog_info("Attached to %s (%ux%u grid)", name, info.grid_width,
+            info.grid_height);
+
+  RenderFrame frame;
+  bool have_frame = false;
+  bool closed = false;
+  uint64_t last_draw_ns = 0;
+  while (renderer_is_open(renderer)) {
+    bool space_pressed = false;
+    if (!renderer_poll_events(renderer, &space_pressed)) {
+      break;
+    }
+    int read = frame_ring_read(reader, game, &frame);
+    uint64_t now_ns = render_sched_now_ns();
+    if (read == 1) {
+      have_frame = true;
+    } else if (now_ns - last_draw_ns < REDRAW_MS * 1000000ull) {
+      usleep(IDLE_SLEEP_MS * 1000);
+      continue;
+    }
+    // Unchanged frames are redrawn too, so zoom and pan stay responsive
+    if (have_frame) {
+      renderer_render_frame(renderer, game, &frame);
+    } else {
+      renderer_render_splash(renderer, game);
+    }
+    last_draw_ns = now_ns;
+    if (!closed && frame_ring_closed(reader)) {
+      closed = true;
+      ulog_info("Server stopped, showing its last frame");
+    }
+  }
+
+  renderer_destroy(renderer);
+  game_destroy(game);
+  frame_ring_close(reader);
+  return 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "server/game_logic.h"
+#include "server/server.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <ulog.h>
+#include <unistd.h>
+
+// Test fixture that manages a C server instance accepting clients on a
+// random port, also exported as CYCLES_PORT
+class ServerFixture : public ::testing::Test {
+protected:
+  Game *game = nullptr;
+  GameServer *server = nullptr;
+  std::thread acceptThread;
+  std::thread serverThread;
+  std::string configFile;
+  std::string port;
+  GameConfig config;
+
+  explicit ServerFixture(int grid_size = 50,
+                         ulog_level log_level = ULOG_LEVEL_DEBUG,
+                         const char *grid_storage = "dense")
+      : gridSize(grid_size), logLevel(log_level), gridStorage(grid_storage) {}
+
+  void SetUp() override {
+    ulog_output_level_set_all(logLevel);
+    configFile = createTempConfig();
+    unsigned seed =
+        std::chrono::system_clock::now().time_since_epoch().count() +
+        reinterpret_cast<uintptr_t>(this);
+    if (game_config_load(configFile.c_str(), &config) != 0) {
+      throw std::runtime_error("Failed to load config");
+    }
+    game = game_create(&config);
+    if (!game) {
+      throw std::runtime_error("Failed to create game");
+    }
+    server = server_create(game, &config);
+    if (!server) {
+      game_destroy(game);
+      game = nullptr;
+      throw std::runtime_error("Failed to create server");
+    }
+    // A random port may be taken, e.g. by a connection of an earlier test
+    bool listening = false;
+    for (int attempt = 0; attempt < 10 && !listening; attempt++) {
+      port = std::to_string(20000 + ((seed + attempt * 7919) % 40000));
+      listening = server_listen(server, std::stoi(port)) == 0;
+    }
+    if (!listening) {
+      server_destroy(server);
+      server = nullptr;
+      game_destroy(game);
+      game = nullptr;
+      throw std::runtime_error("Failed to start server");
+    }
+    setenv("CYCLES_PORT", port.c_str(), 1);
+    // Start accept thread to allow clients to connect
+    // server_accept_clients loops internally while accepting is true
+    acceptThread = std::thread([this]() { server_accept_clients(server); });
+  }
+
+  void TearDown() override {
+    if (server) {
+      server_set_accepting_clients(server, false);
+      if (acceptThread.joinable()) {
+        acceptThread.join();
+      }
+      server_stop(server);
+      if (serverThread.joinable()) {
+        serverThread.join();
+      }
+      server_destroy(server);
+    }
+    if (game) {
+      game_destroy(game);
+    }
+    if (!configFile.empty()) {
+      std::remove(configFile.c_str());
+    }
+    unsetenv("CYCLES_PORT");
+  }
+
+  // Helper to start the game loop after clients have connected
+  void startGameLoop() {
+    server_set_accepting_clients(server, false);
+    if (acceptThread.joinable()) {
+      acceptThread.join();
+    }
+    serverThread = std::thread([this]() { server_run(server); });
+    // Give server thread a moment to start
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  std::string createTempConfig() {
+    std::string size = std::to_string(gridSize);
+    std::string conf_yaml = "gameHeight: 600\n"
+                            "gameWidth: 600\n"
+                            "gameBannerHeight: 100\n"
+                            "gridHeight: " + size + "\n"
+                            "gridWidth: " + size + "\n"
+                            "gridStorage: " + gridStorage + "\n"
+                            "maxClients: 10\n"
+                            "enablePostProcessing: false\n";
+    char temp_template[] = "/tmp/ccycles_test_XXXXXX";
+    int fd = mkstemp(temp_template);
+    if (fd == -1) {
+      throw std::runtime_error("Failed to create temporary config file");
+    }
+    std::string temp_file(temp_template);
+    close(fd);
+    std::ofstream out(temp_file);
+    out << conf_yaml;
+    out.close();
+    return temp_file;
+  }
+
+private:
+  int gridSize;            // Width and height of the board
+  ulog_level logLevel;     // Log level while the test runs
+  std::string gridStorage; // Grid storage backend of the board
+};
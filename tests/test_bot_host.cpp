@@ -0,0 +1,133 @@
+#include "client/bot_host.h"
+#include "server/game_logic.h"
+#include "server/server.h"
+#include "server_fixture.h"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <ulog.h>
+
+// Runs a C server on a larger board for the bots of a host
+class BotHostTest : public ServerFixture {
+protected:
+  BotHostTest() : ServerFixture(100, ULOG_LEVEL_WARN) {}
+
+  // Wait until count players joined, then start the game loop
+  bool startGameWith(uint32_t count) {
+    Player players[MAX_PLAYERS];
+    for (int i = 0; i < 500 && game_get_players(game, players) < count; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (game_get_players(game, players) != count) {
+      return false;
+    }
+    server_set_accepting_clients(server, false);
+    acceptThread.join();
+    serverThread = std::thread([this]() { server_run(server); });
+    return true;
+  }
+};
+
+TEST_F(BotHostTest, EveryBotPlaysAndReportsLatency) {
+  const uint32_t bots = 6;
+  BotHostConfig host_config = {};
+  host_config.host = "127.0.0.1";
+  host_config.port = port.c_str();
+  host_config.name_prefix = "hosted";
+  host_config.bots = bots;
+  host_config.threads = 2;
+  host_config.strategy = bot_strategy_find("random");
+  host_config.seed = 7;
+  ASSERT_NE(host_config.strategy, nullptr);
+  BotHost *host = bot_host_create(&host_config);
+  ASSERT_NE(host, nullptr);
+  EXPECT_EQ(bot_host_count(host), bots);
+  int status = -1;
+  std::thread hostThread([&]() { status = bot_host_run(host); });
+  bool started = startGameWith(bots);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  bot_host_stop(host);
+  hostThread.join();
+  ASSERT_TRUE(started);
+  EXPECT_EQ(status, 0);
+  for (uint32_t i = 0; i < bots; i++) {
+    BotLatency latency;
+    bot_host_latency(host, i, &latency);
+    EXPECT_TRUE(latency.connected) << "bot " << i;
+    EXPECT_GE(latency.moves, 1u) << "bot " << i;
+    EXPECT_LE(latency.p50_us, latency.p90_us);
+    EXPECT_LE(latency.p90_us, latency.p99_us);
+    EXPECT_LE(latency.p99_us, latency.max_us);
+  }
+  BotLatency none;
+  bot_host_latency(host, bots, &none);
+  EXPECT_EQ(none.moves, 0u);
+  bot_host_report(host);
+  bot_host_destroy(host);
+}
+
+// Plays like "random", but the first move takes slow_ms, during which the
+// moves of the other bots are counted
+namespace {
+const uint32_t slow_ms = 400;
+std::atomic<bool> slow_started{false};
+std::atomic<bool> slow_done{false};
+std::atomic<uint32_t> moves_while_slow{0};
+
+cycles_direction slow_decide(void *bot, const cycles_game_state *gs,
+                             const cycles_player *me) {
+  if (!slow_started.exchange(true)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(slow_ms));
+    slow_done = true;
+  } else if (slow_started && !slow_done) {
+    moves_while_slow++;
+  }
+  return bot_strategy_find("random")->decide_move(bot, gs, me);
+}
+} // namespace
+
+TEST_F(BotHostTest, SlowBotDoesNotStallTheOthers) {
+  const uint32_t bots = 6;
+  const BotStrategy *random = bot_strategy_find("random");
+  ASSERT_NE(random, nullptr);
+  BotStrategy slow = {"slow", random->state_size, random->init, slow_decide};
+  BotHostConfig host_config = {};
+  host_config.host = "127.0.0.1";
+  host_config.port = port.c_str();
+  host_config.bots = bots;
+  host_config.threads = 2;
+  host_config.strategy = &slow;
+  BotHost *host = bot_host_create(&host_config);
+  ASSERT_NE(host, nullptr);
+  int status = -1;
+  std::thread hostThread([&]() { status = bot_host_run(host); });
+  bool started = startGameWith(bots);
+  for (int i = 0; i < 500 && !slow_done; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  bot_host_stop(host);
+  hostThread.join();
+  ASSERT_TRUE(started);
+  EXPECT_EQ(status, 0);
+  EXPECT_TRUE(slow_done);
+  // Waiting for a whole round would allow at most the other bots of the
+  // round to move while the slow one thinks
+  EXPECT_GT(moves_while_slow.load(), bots - 1);
+  bot_host_destroy(host);
+}
+
+TEST_F(BotHostTest, InvalidConfig) {
+  EXPECT_EQ(bot_strategy_find("nonexistent"), nullptr);
+  EXPECT_EQ(bot_strategy_find(nullptr), nullptr);
+  BotHostConfig host_config = {};
+  host_config.host = "127.0.0.1";
+  host_config.port = port.c_str();
+  host_config.strategy = bot_strategy_find("north");
+  ASSERT_NE(host_config.strategy, nullptr);
+  // No bots
+  EXPECT_EQ(bot_host_create(&host_config), nullptr);
+  EXPECT_EQ(bot_host_create(nullptr), nullptr);
+  EXPECT_EQ(bot_host_run(nullptr), -1);
+  EXPECT_EQ(bot_host_count(nullptr), 0u);
+}
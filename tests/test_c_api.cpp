@@ -1,111 +1,19 @@
 #include "c_api.h"
+#include "c_utils.h"
 #include "server/game_logic.h"
 #include "server/server.h"
+#include "server_fixture.h"
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <gtest/gtest.h>
 #include <memory>
+#include <poll.h>
 #include <thread>
 #include <ulog.h>
 
-// Test fixture that manages a C server instance
-class CApiTest : public ::testing::Test {
-protected:
-  Game *game;
-  GameServer *server;
-  std::thread acceptThread;
-  std::thread serverThread;
-  std::string configFile;
-  std::string port;
-  GameConfig config;
-
-  void SetUp() override {
-    // Set ulog to info to reduce test output
-    ulog_output_level_set_all(ULOG_LEVEL_DEBUG);
-    configFile = createTempConfig();
-    unsigned seed =
-        std::chrono::system_clock::now().time_since_epoch().count() +
-        reinterpret_cast<uintptr_t>(this);
-    port = std::to_string(20000 + (seed % 40000));
-    setenv("CYCLES_PORT", port.c_str(), 1);
-    if (game_config_load(configFile.c_str(), &config) != 0) {
-      throw std::runtime_error("Failed to load config");
-    }
-    game = game_create(&config);
-    if (!game) {
-      throw std::runtime_error("Failed to create game");
-    }
-    server = server_create(game, &config);
-    if (!server) {
-      game_destroy(game);
-      throw std::runtime_error("Failed to create game");
-    }
-    if (server_listen(server, std::stoi(port)) != 0) {
-      server_destroy(server);
-      game_destroy(game);
-      throw std::runtime_error("Failed to start server");
-    }
-    // Start accept thread to allow clients to connect
-    // server_accept_clients loops internally while accepting is true
-    acceptThread = std::thread([this]() { server_accept_clients(server); });
-  }
-
-  void TearDown() override {
-    if (server) {
-      server_set_accepting_clients(server, false);
-      if (acceptThread.joinable()) {
-        acceptThread.join();
-      }
-      server_stop(server);
-      if (serverThread.joinable()) {
-        serverThread.join();
-      }
-      server_destroy(server);
-    }
-    if (game) {
-      game_destroy(game);
-    }
-    if (!configFile.empty()) {
-      std::remove(configFile.c_str());
-    }
-    unsetenv("CYCLES_PORT");
-  }
-
-  // Helper to start the game loop after clients have connected
-  void startGameLoop() {
-    server_set_accepting_clients(server, false);
-    if (acceptThread.joinable()) {
-      acceptThread.join();
-    }
-    serverThread = std::thread([this]() { server_run(server); });
-    // Give server thread a moment to start
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-  }
-
-  std::string createTempConfig() {
-    std::string conf_yaml = R"(
-gameHeight: 600
-gameWidth: 600
-gameBannerHeight: 100
-gridHeight: 50
-gridWidth: 50
-maxClients: 10
-enablePostProcessing: false
-)";
-    char temp_template[] = "/tmp/ccycles_test_XXXXXX";
-    int fd = mkstemp(temp_template);
-    if (fd == -1) {
-      throw std::runtime_error("Failed to create temporary config file");
-    }
-    std::string temp_file(temp_template);
-    close(fd);
-    std::ofstream out(temp_file);
-    out << conf_yaml;
-    out.close();
-    return temp_file;
-  }
-};
+class CApiTest : public ServerFixture {};
 
 TEST_F(CApiTest, ConnectAndDisconnect) {
   cycles_connection conn;
@@ -127,8 +35,8 @@ TEST_F(CApiTest, MultipleClientsConnect) {
   EXPECT_STREQ(conn1.name, "Player1");
   EXPECT_STREQ(conn2.name, "Player2");
   EXPECT_STREQ(conn3.name, "Player3");
-  Player *player_ptrs[MAX_PLAYERS];
-  uint32_t player_count = game_get_players(game, player_ptrs);
+  Player players[MAX_PLAYERS];
+  uint32_t player_count = game_get_players(game, players);
   EXPECT_EQ(player_count, 3u);
 
   // Start game loop (no longer accepting clients, server begins game)
@@ -189,13 +97,47 @@ TEST_F(CApiTest, GameStateStructure) {
     ASSERT_TRUE(
         compare_grids(gs.grid, grid_width, grid_height, grid_copy.data()));
     EXPECT_EQ(gs.frame_number, 0u);
+    cycles_free_game_state(&gs);
   }
-  cycles_free_game_state(&gs);
   for (int i = 0; i < 2; i++) {
     cycles_disconnect(&conn[i]);
   }
 }
 
+// Same server with the board stored in chunks, sent as one row-major copy
+class CApiChunkedTest : public ServerFixture {
+protected:
+  CApiChunkedTest() : ServerFixture(50, ULOG_LEVEL_DEBUG, "chunked") {}
+};
+
+TEST_F(CApiChunkedTest, FullStateMatchesGrid) {
+  cycles_connection conn[3];
+  for (int i = 0; i < 3; i++) {
+    std::string name = "Chunked" + std::to_string(i);
+    ASSERT_EQ(cycles_connect(name.c_str(), "127.0.0.1", port.c_str(), &conn[i]),
+              0);
+  }
+  ASSERT_EQ(game_get_grid(game), nullptr);
+  uint32_t grid_width, grid_height;
+  game_get_grid_size(game, &grid_width, &grid_height);
+  std::vector<uint8_t> grid_copy(grid_width * grid_height);
+  grid_copy_rows(game_get_grid_storage(game), 0, grid_height,
+                 grid_copy.data());
+  startGameLoop();
+  cycles_game_state gs = {};
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(cycles_recv_game_state(conn[i].sock, &gs), 0);
+    EXPECT_EQ(gs.frame_number, 0u);
+    EXPECT_EQ(gs.player_count, 3u);
+    ASSERT_TRUE(
+        compare_grids(gs.grid, grid_width, grid_height, grid_copy.data()));
+    cycles_free_game_state(&gs);
+  }
+  for (int i = 0; i < 3; i++) {
+    cycles_disconnect(&conn[i]);
+  }
+}
+
 TEST_F(CApiTest, SendMove) {
   // add a player
   cycles_connection
@@ -223,6 +165,7 @@ TEST_F(CApiTest, SendMove) {
       // Move north
       ASSERT_EQ(cycles_send_move_i32(&conn[i], cycles_north), 0);
     }
+    cycles_free_game_state(&gs);
   }
   for (int i = 0; i < 2; i++) {
     int result = cycles_recv_game_state(conn[i].sock, &gs);
@@ -238,10 +181,363 @@ TEST_F(CApiTest, SendMove) {
       // Moved north
       EXPECT_EQ(player_pos.y, initial_positions[i].y - 1);
     }
+    cycles_free_game_state(&gs);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    cycles_disconnect(&conn[i]);
+  }
+}
+
+TEST_F(CApiTest, ViewportLimitsGridAndPlayers) {
+  cycles_connection conn[2];
+  for (int i = 0; i < 2; i++) {
+    std::string name = "TestPlayer" + std::to_string(i);
+    ASSERT_EQ(cycles_connect(name.c_str(), "127.0.0.1", port.c_str(), &conn[i]),
+              0);
+  }
+  startGameLoop();
+  const uint32_t radius = 2;
+  const uint32_t factor = 10;
+  cycles_game_state gs[2] = {};
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(cycles_recv_game_state(conn[i].sock, &gs[i]), 0);
+    // The first frame is sent before the request, so it holds the full board
+    EXPECT_EQ(gs[i].view_width, gs[i].grid_width);
+    EXPECT_EQ(gs[i].view_height, gs[i].grid_height);
+    EXPECT_EQ(gs[i].overview, nullptr);
+  }
+  // Both players make a valid move and release their state
+  auto play_frame = [&]() {
+    for (int i = 0; i < 2; i++) {
+      const cycles_player *me = nullptr;
+      for (uint32_t j = 0; j < gs[i].player_count; j++) {
+        if (strcmp(gs[i].players[j].name, conn[i].name) == 0)
+          me = &gs[i].players[j];
+      }
+      ASSERT_NE(me, nullptr);
+      cycles_vec2i pos = {me->x, me->y};
+      int32_t dir = cycles_north;
+      while (!cycles_is_valid_move(&gs[i], pos, (cycles_direction)dir) &&
+             dir < cycles_west)
+        dir++;
+      ASSERT_EQ(cycles_send_move_i32(&conn[i], dir), 0);
+      cycles_free_game_state(&gs[i]);
+    }
+  };
+  ASSERT_EQ(cycles_request_viewport(&conn[0], radius, factor), 0);
+  play_frame();
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(cycles_recv_game_state(conn[i].sock, &gs[i]), 0);
+    EXPECT_EQ(gs[i].frame_number, 1u);
+    EXPECT_EQ(gs[i].grid_width, config.grid_width);
+    EXPECT_EQ(gs[i].grid_height, config.grid_height);
+  }
+  // The other client keeps receiving the whole board
+  EXPECT_EQ(gs[1].view_width, gs[1].grid_width);
+  EXPECT_EQ(gs[1].player_count, 2u);
+  // The requesting client gets a window around its head
+  const cycles_game_state &view = gs[0];
+  EXPECT_LE(view.view_width, 2 * radius + 1);
+  EXPECT_LE(view.view_height, 2 * radius + 1);
+  const cycles_player *me = nullptr;
+  for (uint32_t j = 0; j < view.player_count; j++) {
+    const cycles_player &p = view.players[j];
+    EXPECT_TRUE(cycles_is_inside_view(&view, {p.x, p.y}));
+    if (strcmp(p.name, conn[0].name) == 0)
+      me = &p;
+  }
+  ASSERT_NE(me, nullptr);
+  EXPECT_EQ(cycles_get_grid_cell(&view, {me->x, me->y}), me->id);
+  EXPECT_EQ(view.grid_width, gs[1].grid_width);
+  for (uint32_t y = view.view_y; y < view.view_y + view.view_height; y++) {
+    for (uint32_t x = view.view_x; x < view.view_x + view.view_width; x++) {
+      cycles_vec2i p = {(int)x, (int)y};
+      EXPECT_EQ(cycles_get_grid_cell(&view, p),
+                cycles_get_grid_cell(&gs[1], p));
+    }
+  }
+  // Overview of the whole board, with the block holding our head occupied
+  ASSERT_NE(view.overview, nullptr);
+  EXPECT_EQ(view.overview_factor, factor);
+  EXPECT_EQ(view.overview_width, (config.grid_width + factor - 1) / factor);
+  EXPECT_EQ(view.overview_height, (config.grid_height + factor - 1) / factor);
+  EXPECT_GT(view.overview[(me->y / factor) * view.overview_width +
+                          me->x / factor],
+            0);
+  // A factor of 1 would only repeat the grid, so the server sends no overview
+  ASSERT_EQ(cycles_request_viewport(&conn[1], radius, 1), 0);
+  play_frame();
+  for (int i = 0; i < 2; i++)
+    ASSERT_EQ(cycles_recv_game_state(conn[i].sock, &gs[i]), 0);
+  EXPECT_LE(gs[1].view_width, 2 * radius + 1);
+  EXPECT_EQ(gs[1].overview, nullptr);
+  for (int i = 0; i < 2; i++) {
+    cycles_free_game_state(&gs[i]);
+    cycles_disconnect(&conn[i]);
   }
+}
+
+TEST_F(CApiTest, StateHashMatchesGrid) {
+  cycles_connection conn[2];
+  for (int i = 0; i < 2; i++) {
+    std::string name = "TestPlayer" + std::to_string(i);
+    ASSERT_EQ(cycles_connect(name.c_str(), "127.0.0.1", port.c_str(), &conn[i]),
+              0);
+  }
+  ASSERT_EQ(cycles_request_state_hash(&conn[0], true), 0);
+  startGameLoop();
+  cycles_game_state gs[2] = {};
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(cycles_recv_game_state(conn[i].sock, &gs[i]), 0);
+  }
+  // The request is read while the server waits for the first move
+  EXPECT_FALSE(gs[0].has_state_hash);
+  for (int i = 0; i < 2; i++) {
+    cycles_vec2i pos = {gs[i].players[i].x, gs[i].players[i].y};
+    int32_t dir = cycles_north;
+    while (!cycles_is_valid_move(&gs[i], pos, (cycles_direction)dir) &&
+           dir < cycles_west)
+      dir++;
+    ASSERT_EQ(cycles_send_move_i32(&conn[i], dir), 0);
+    cycles_free_game_state(&gs[i]);
+  }
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(cycles_recv_game_state(conn[i].sock, &gs[i]), 0);
+    EXPECT_EQ(gs[i].frame_number, 1u);
+  }
+  ASSERT_TRUE(gs[0].has_state_hash);
+  EXPECT_EQ(gs[0].view_width, gs[0].grid_width);
+  EXPECT_EQ(gs[0].view_height, gs[0].grid_height);
+  EXPECT_EQ(gs[0].player_count, 2u);
+  EXPECT_NE(gs[0].state_hash, 0u);
+  EXPECT_EQ(cycles_compute_grid_hash(&gs[0]), gs[0].state_hash);
+  // Clients that did not ask keep the plain packet
+  EXPECT_FALSE(gs[1].has_state_hash);
+  EXPECT_EQ(cycles_compute_grid_hash(&gs[1]), gs[0].state_hash);
+  for (int i = 0; i < 2; i++) {
+    cycles_free_game_state(&gs[i]);
+    cycles_disconnect(&conn[i]);
+  }
+}
 
+TEST_F(CApiTest, StateBufferReusesStorage) {
+  cycles_connection conn[2];
+  for (int i = 0; i < 2; i++) {
+    std::string name = "TestPlayer" + std::to_string(i);
+    ASSERT_EQ(cycles_connect(name.c_str(), "127.0.0.1", port.c_str(), &conn[i]),
+              0);
+  }
+  startGameLoop();
+  cycles_state_buffer buf;
+  cycles_state_buffer_init(&buf);
+  cycles_game_state gs = {};
+  const cycles_game_state &state = buf.state;
+  // Frame 0 is a plain packet, frame 1 carries sections once the hash is on
+  for (uint32_t frame = 0; frame < 2; frame++) {
+    ASSERT_EQ(cycles_recv_game_state_into(conn[0].sock, &buf), 0);
+    ASSERT_EQ(cycles_recv_game_state(conn[1].sock, &gs), 0);
+    EXPECT_EQ(state.frame_number, frame);
+    EXPECT_EQ(state.has_state_hash, frame == 1);
+    ASSERT_EQ(state.grid_width, gs.grid_width);
+    ASSERT_EQ(state.grid_height, gs.grid_height);
+    EXPECT_EQ(state.view_width, state.grid_width);
+    EXPECT_EQ(state.overview, nullptr);
+    ASSERT_TRUE(compare_grids(state.grid, gs.grid_width, gs.grid_height,
+                              gs.grid));
+    ASSERT_EQ(state.player_count, gs.player_count);
+    for (uint32_t i = 0; i < state.player_count; i++) {
+      EXPECT_STREQ(state.players[i].name, gs.players[i].name);
+      EXPECT_EQ(state.players[i].id, gs.players[i].id);
+      EXPECT_EQ(state.players[i].x, gs.players[i].x);
+      EXPECT_EQ(state.players[i].y, gs.players[i].y);
+      // Names are kept by player ID
+      EXPECT_EQ(state.players[i].name, buf.names[state.players[i].id]);
+    }
+    if (frame == 0) {
+      ASSERT_EQ(cycles_request_state_hash(&conn[0], true), 0);
+    } else {
+      EXPECT_EQ(cycles_compute_grid_hash(&state), state.state_hash);
+    }
+    for (int i = 0; i < 2; i++) {
+      const cycles_game_state &s = i == 0 ? state : gs;
+      cycles_vec2i pos = {s.players[i].x, s.players[i].y};
+      int32_t dir = cycles_north;
+      while (!cycles_is_valid_move(&s, pos, (cycles_direction)dir) &&
+             dir < cycles_west)
+        dir++;
+      ASSERT_EQ(cycles_send_move_i32(&conn[i], dir), 0);
+    }
+    cycles_free_game_state(&gs);
+  }
+  // The storage of the first frame was large enough for the second one
+  const uint8_t *grid = buf.grid;
+  const cycles_player *players = buf.players;
+  const char *name = buf.names[state.players[0].id];
+  ASSERT_EQ(cycles_recv_game_state_into(conn[0].sock, &buf), 0);
+  EXPECT_EQ(state.frame_number, 2u);
+  EXPECT_EQ(state.grid, grid);
+  EXPECT_EQ(state.players, players);
+  EXPECT_EQ(buf.names[state.players[0].id], name);
+  // Drain the other client, closing with unread data resets the connection
+  ASSERT_EQ(cycles_recv_game_state(conn[1].sock, &gs), 0);
   cycles_free_game_state(&gs);
+  cycles_state_buffer_free(&buf);
+  EXPECT_EQ(buf.grid, nullptr);
+  for (int i = 0; i < 2; i++) {
+    cycles_disconnect(&conn[i]);
+  }
+}
+
+namespace {
+
+// Direction from pos whose next steps cells are all free
+int32_t free_direction(const cycles_game_state &gs, cycles_vec2i pos,
+                       int steps) {
+  for (int32_t dir = cycles_north; dir <= cycles_west; dir++) {
+    cycles_vec2i d = cycles_get_direction_vector((cycles_direction)dir);
+    bool free = true;
+    for (int k = 1; k <= steps && free; k++) {
+      cycles_vec2i p = {pos.x + k * d.x, pos.y + k * d.y};
+      free = cycles_is_inside_grid(&gs, p) && cycles_get_grid_cell(&gs, p) == 0;
+    }
+    if (free)
+      return dir;
+  }
+  return cycles_north;
+}
+
+} // namespace
+
+TEST_F(CApiTest, LatestOnlySkipsStaleStates) {
+  cycles_connection conn[2];
+  cycles_state_buffer buf[2];
   for (int i = 0; i < 2; i++) {
+    std::string name = "TestPlayer" + std::to_string(i);
+    ASSERT_EQ(cycles_connect(name.c_str(), "127.0.0.1", port.c_str(), &conn[i]),
+              0);
+    cycles_state_buffer_init(&buf[i]);
+  }
+  startGameLoop();
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(cycles_recv_state(&conn[i], &buf[i]), 0);
+    EXPECT_EQ(buf[i].state.frame_number, 0u);
+  }
+  // Client 0 keeps moving straight without reading the states it is sent
+  const cycles_game_state &first = buf[0].state;
+  cycles_vec2i pos = {first.players[0].x, first.players[0].y};
+  int32_t blind = free_direction(first, pos, 4);
+  cycles_set_latest_only(&conn[0], true);
+  const uint32_t frames = 3;
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    const cycles_game_state &gs = buf[1].state;
+    pos = {gs.players[1].x, gs.players[1].y};
+    ASSERT_EQ(cycles_send_move_i32(&conn[0], blind), 0);
+    ASSERT_EQ(cycles_send_move_i32(&conn[1], free_direction(gs, pos, 1)), 0);
+    ASSERT_EQ(cycles_recv_state(&conn[1], &buf[1]), 0);
+    ASSERT_EQ(buf[1].state.frame_number, frame + 1);
+  }
+  // Read until the last frame shows up; every state not handed out was
+  // skipped. The server writes to client 0 first, so that is usually all of
+  // them but the last.
+  uint32_t returned = 0;
+  do {
+    ASSERT_EQ(cycles_recv_state(&conn[0], &buf[0]), 0);
+    returned++;
+  } while (buf[0].state.frame_number < frames);
+  EXPECT_EQ(buf[0].state.frame_number, frames);
+  EXPECT_GT(conn[0].skipped_states, 0u);
+  EXPECT_EQ(conn[0].skipped_states, frames - returned);
+  EXPECT_EQ(conn[1].skipped_states, 0u);
+  const cycles_game_state &latest = buf[0].state;
+  ASSERT_EQ(latest.player_count, buf[1].state.player_count);
+  EXPECT_TRUE(compare_grids(latest.grid, latest.grid_width,
+                            latest.grid_height, buf[1].state.grid));
+  for (int i = 0; i < 2; i++) {
+    cycles_state_buffer_free(&buf[i]);
+    cycles_disconnect(&conn[i]);
+  }
+}
+
+namespace {
+
+// Index of the player named like conn in gs
+uint32_t own_player(const cycles_game_state &gs,
+                    const cycles_connection &conn) {
+  for (uint32_t i = 0; i < gs.player_count; i++) {
+    if (strcmp(gs.players[i].name, conn.name) == 0)
+      return i;
+  }
+  return 0;
+}
+
+} // namespace
+
+TEST_F(CApiTest, NonBlockingClientsShareOneThread) {
+  const int n = 3;
+  const uint32_t frames = 5;
+  cycles_connection conn[n];
+  cycles_state_buffer buf[n];
+  bool connected[n] = {};
+  uint32_t received[n] = {};
+  for (int i = 0; i < n; i++) {
+    std::string name = "TestPlayer" + std::to_string(i);
+    ASSERT_EQ(cycles_connect_async(name.c_str(), "127.0.0.1", port.c_str(),
+                                   &conn[i]),
+              0);
+    EXPECT_TRUE(cycles_wants_write(&conn[i]));
+    cycles_state_buffer_init(&buf[i]);
+  }
+  // One poll loop drives every client, moving right after each state
+  auto drive = [&](auto done) {
+    for (int round = 0; round < 1000 && !done(); round++) {
+      pollfd fds[n];
+      for (int i = 0; i < n; i++) {
+        short out = cycles_wants_write(&conn[i]) ? POLLOUT : 0;
+        fds[i] = {conn[i].sock, (short)(POLLIN | out), 0};
+      }
+      ASSERT_GT(poll(fds, n, 1000), 0);
+      for (int i = 0; i < n; i++) {
+        if (!fds[i].revents)
+          continue;
+        ASSERT_EQ(cycles_handle_io(&conn[i]), 0);
+        int event;
+        while ((event = cycles_next_event(&conn[i], &buf[i])) > 0) {
+          if (event == cycles_event_connected) {
+            connected[i] = true;
+            continue;
+          }
+          ASSERT_EQ(event, cycles_event_state);
+          const cycles_game_state &gs = buf[i].state;
+          ASSERT_EQ(gs.frame_number, received[i]++);
+          ASSERT_EQ(gs.player_count, (uint32_t)n);
+          const cycles_player &me = gs.players[own_player(gs, conn[i])];
+          if (received[i] < frames) {
+            int32_t dir = free_direction(gs, {me.x, me.y}, 1);
+            ASSERT_EQ(cycles_send_move_i32(&conn[i], dir), 0);
+          }
+        }
+        ASSERT_EQ(event, cycles_event_none);
+      }
+    }
+  };
+  drive([&] {
+    return std::all_of(connected, connected + n, [](bool c) { return c; });
+  });
+  for (int i = 0; i < n; i++) {
+    ASSERT_TRUE(connected[i]) << "client " << i;
+    EXPECT_FALSE(cycles_wants_write(&conn[i]));
+  }
+  Player players[MAX_PLAYERS];
+  ASSERT_EQ(game_get_players(game, players), (uint32_t)n);
+  startGameLoop();
+  drive([&] {
+    return std::all_of(received, received + n,
+                       [&](uint32_t r) { return r == frames; });
+  });
+  for (int i = 0; i < n; i++) {
+    EXPECT_EQ(received[i], frames) << "client " << i;
+    cycles_state_buffer_free(&buf[i]);
     cycles_disconnect(&conn[i]);
   }
 }
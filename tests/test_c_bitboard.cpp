@@ -0,0 +1,199 @@
+#include "c_bitboard.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+// State over a whole w x h board
+cycles_game_state board_state(std::vector<uint8_t> &grid, uint32_t w,
+                              uint32_t h) {
+  cycles_game_state gs = {};
+  gs.grid = grid.data();
+  gs.grid_width = w;
+  gs.grid_height = h;
+  gs.view_width = w;
+  gs.view_height = h;
+  return gs;
+}
+
+// Random walls, dense enough to split the board into many regions
+std::vector<uint8_t> random_grid(uint32_t w, uint32_t h, std::mt19937 &rng,
+                                 double walls) {
+  std::vector<uint8_t> grid(w * h);
+  std::bernoulli_distribution wall(walls);
+  for (auto &cell : grid)
+    cell = wall(rng) ? (uint8_t)(1 + rng() % 8) : 0;
+  return grid;
+}
+
+// Plain byte-grid BFS, 1 for the free cells reachable from the free seeds
+std::vector<int> bfs(const std::vector<uint8_t> &grid, int w, int h,
+                     const std::vector<int> &seeds) {
+  std::vector<int> seen(w * h, 0), queue;
+  for (int s : seeds) {
+    if (!grid[s] && !seen[s]) {
+      seen[s] = 1;
+      queue.push_back(s);
+    }
+  }
+  for (size_t i = 0; i < queue.size(); i++) {
+    int x = queue[i] % w, y = queue[i] / w;
+    const int nx[] = {x, x + 1, x, x - 1}, ny[] = {y - 1, y, y + 1, y};
+    for (int d = 0; d < 4; d++) {
+      if (nx[d] < 0 || ny[d] < 0 || nx[d] >= w || ny[d] >= h)
+        continue;
+      int n = ny[d] * w + nx[d];
+      if (!grid[n] && !seen[n]) {
+        seen[n] = 1;
+        queue.push_back(n);
+      }
+    }
+  }
+  return seen;
+}
+
+} // namespace
+
+TEST(CBitboardTest, FreeCellsOfAState) {
+  // Wider than a word and an AVX2 block, with a tail
+  const uint32_t w = 150, h = 3;
+  std::vector<uint8_t> grid(w * h, 0);
+  grid[0] = 1;
+  grid[63] = 2;
+  grid[64] = 2;
+  grid[2 * w + 149] = 3;
+  cycles_game_state gs = board_state(grid, w, h);
+  cycles_bitboard free_cells;
+  cycles_bitboard_init(&free_cells);
+  ASSERT_EQ(cycles_bitboard_from_state(&free_cells, &gs), 0);
+  EXPECT_EQ(free_cells.words, 3u);
+  EXPECT_EQ(cycles_bitboard_count(&free_cells), w * h - 4);
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {0, 0}));
+  EXPECT_TRUE(cycles_bitboard_get(&free_cells, {1, 0}));
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {64, 0}));
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {149, 2}));
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {150, 0}));
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {-1, 0}));
+  cycles_bitboard_set(&free_cells, {0, 0}, true);
+  cycles_bitboard_set(&free_cells, {1, 0}, false);
+  cycles_bitboard_set(&free_cells, {500, 0}, true);
+  EXPECT_TRUE(cycles_bitboard_get(&free_cells, {0, 0}));
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {1, 0}));
+  EXPECT_EQ(cycles_bitboard_count(&free_cells), w * h - 4);
+
+  // A viewport maps to board coordinates
+  gs.grid_width = 1000;
+  gs.grid_height = 1000;
+  gs.view_x = 300;
+  gs.view_y = 700;
+  ASSERT_EQ(cycles_bitboard_from_state(&free_cells, &gs), 0);
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {300, 700}));
+  EXPECT_TRUE(cycles_bitboard_get(&free_cells, {301, 700}));
+  EXPECT_FALSE(cycles_bitboard_get(&free_cells, {1, 0}));
+  EXPECT_EQ(cycles_bitboard_from_state(nullptr, &gs), -1);
+  cycles_bitboard_free(&free_cells);
+}
+
+TEST(CBitboardTest, ReachableMatchesBfs) {
+  std::mt19937 rng(11);
+  cycles_bitboard free_cells, reach;
+  cycles_bitboard_init(&free_cells);
+  cycles_bitboard_init(&reach);
+  for (int round = 0; round < 40; round++) {
+    const int w = 1 + (int)(rng() % 200), h = 1 + (int)(rng() % 90);
+    std::vector<uint8_t> grid = random_grid(w, h, rng, 0.05 * (round % 10));
+    cycles_game_state gs = board_state(grid, w, h);
+    ASSERT_EQ(cycles_bitboard_from_state(&free_cells, &gs), 0);
+    int sx = (int)(rng() % w), sy = (int)(rng() % h);
+    // The head itself is occupied, so the fill starts from its neighbours
+    grid[sy * w + sx] = 1;
+    ASSERT_EQ(cycles_bitboard_from_state(&free_cells, &gs), 0);
+    std::vector<int> seeds;
+    const int nx[] = {sx, sx + 1, sx, sx - 1}, ny[] = {sy - 1, sy, sy + 1, sy};
+    for (int d = 0; d < 4; d++) {
+      if (nx[d] >= 0 && ny[d] >= 0 && nx[d] < w && ny[d] < h)
+        seeds.push_back(ny[d] * w + nx[d]);
+    }
+    std::vector<int> expected = bfs(grid, w, h, seeds);
+    ASSERT_EQ(cycles_bitboard_reachable(&free_cells, {sx, sy}, &reach), 0);
+    uint32_t count = 0;
+    for (int i = 0; i < w * h; i++) {
+      count += expected[i];
+      ASSERT_EQ(cycles_bitboard_get(&reach, {i % w, i / w}), expected[i] != 0)
+          << "round " << round << " cell " << i % w << "," << i / w;
+    }
+    EXPECT_EQ(cycles_bitboard_count(&reach), count);
+  }
+  // A spiral needs many sweeps
+  const int n = 41;
+  std::vector<uint8_t> spiral(n * n, 0);
+  for (int ring = 0; 2 * ring < n; ring += 2) {
+    for (int i = ring; i < n - ring; i++) {
+      spiral[ring * n + i] = spiral[(n - 1 - ring) * n + i] = 1;
+      spiral[i * n + ring] = spiral[i * n + n - 1 - ring] = 1;
+    }
+    if (ring + 2 < n - ring)
+      spiral[(ring + 1) * n + ring] = 0;
+    if (ring + 2 < n - ring - 1)
+      spiral[(ring + 2) * n + ring + 1] = 1;
+  }
+  cycles_game_state gs = board_state(spiral, n, n);
+  ASSERT_EQ(cycles_bitboard_from_state(&free_cells, &gs), 0);
+  int start = 0;
+  while (spiral[start])
+    start++;
+  std::vector<int> expected = bfs(spiral, n, n, {start});
+  ASSERT_EQ(
+      cycles_bitboard_reachable(&free_cells, {start % n, start / n}, &reach),
+      0);
+  uint32_t count = 0;
+  for (int v : expected)
+    count += v;
+  EXPECT_EQ(cycles_bitboard_count(&reach), count);
+  EXPECT_EQ(cycles_bitboard_reachable(&free_cells, {0, 0}, &free_cells), -1);
+  cycles_bitboard_free(&free_cells);
+  cycles_bitboard_free(&reach);
+}
+
+TEST(CBitboardTest, ComponentsPartitionTheFreeCells) {
+  std::mt19937 rng(3);
+  cycles_bitboard free_cells;
+  cycles_components components;
+  cycles_bitboard_init(&free_cells);
+  cycles_components_init(&components);
+  for (int round = 0; round < 20; round++) {
+    const int w = 1 + (int)(rng() % 150), h = 1 + (int)(rng() % 70);
+    std::vector<uint8_t> grid = random_grid(w, h, rng, 0.1 + 0.03 * round);
+    cycles_game_state gs = board_state(grid, w, h);
+    ASSERT_EQ(cycles_bitboard_from_state(&free_cells, &gs), 0);
+    ASSERT_EQ(cycles_bitboard_components(&free_cells, &components), 0);
+    // Labels are numbered in order of their first cell, like a row scan
+    std::vector<int> region(w * h, 0);
+    std::vector<uint32_t> sizes;
+    for (int i = 0; i < w * h; i++) {
+      if (grid[i] || region[i])
+        continue;
+      std::vector<int> seen = bfs(grid, w, h, {i});
+      sizes.push_back(0);
+      for (int j = 0; j < w * h; j++) {
+        if (seen[j]) {
+          region[j] = (int)sizes.size();
+          sizes.back()++;
+        }
+      }
+    }
+    ASSERT_EQ(components.count, sizes.size()) << "round " << round;
+    for (int i = 0; i < w * h; i++) {
+      ASSERT_EQ(cycles_component_at(&components, {i % w, i / w}),
+                (uint32_t)region[i])
+          << "round " << round << " cell " << i;
+    }
+    for (uint32_t c = 0; c < components.count; c++)
+      EXPECT_EQ(components.sizes[c], sizes[c]);
+  }
+  EXPECT_EQ(cycles_component_at(&components, {-1, 0}), 0u);
+  EXPECT_EQ(cycles_bitboard_components(nullptr, &components), -1);
+  cycles_components_free(&components);
+  cycles_bitboard_free(&free_cells);
+}
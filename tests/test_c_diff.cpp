@@ -0,0 +1,227 @@
+#include "c_diff.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// State over a whole w x h board
+cycles_game_state board_state(std::vector<uint8_t> &grid, uint32_t w,
+                              uint32_t h) {
+  cycles_game_state gs = {};
+  gs.grid = grid.data();
+  gs.grid_width = w;
+  gs.grid_height = h;
+  gs.view_width = w;
+  gs.view_height = h;
+  return gs;
+}
+
+using Cell = std::tuple<int32_t, int32_t, uint8_t>;
+
+std::vector<Cell> cells(const cycles_cell_change *list, uint32_t count) {
+  std::vector<Cell> out;
+  for (uint32_t i = 0; i < count; i++) {
+    out.emplace_back(list[i].x, list[i].y, list[i].owner);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+} // namespace
+
+TEST(CDiffTest, FirstUpdateReportsEveryOccupiedCell) {
+  std::vector<uint8_t> grid(50 * 30, 0);
+  grid[0] = 1;
+  grid[29 * 50 + 49] = 2;
+  grid[10 * 50 + 17] = 1;
+  cycles_game_state gs = board_state(grid, 50, 30);
+  cycles_player players[2] = {{nullptr, {}, 17, 10, 1},
+                              {nullptr, {}, 49, 29, 2}};
+  gs.players = players;
+  gs.player_count = 2;
+  cycles_frame_diff diff;
+  cycles_frame_diff_init(&diff);
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  EXPECT_TRUE(diff.reset);
+  EXPECT_EQ(cells(diff.occupied, diff.occupied_count),
+            (std::vector<Cell>{{0, 0, 1}, {17, 10, 1}, {49, 29, 2}}));
+  EXPECT_EQ(diff.freed_count, 0u);
+  ASSERT_EQ(diff.move_count, 2u);
+  EXPECT_TRUE(diff.moves[0].appeared);
+  EXPECT_EQ(diff.moves[1].from.x, 49);
+  EXPECT_EQ(diff.gone_count, 0u);
+
+  // Nothing changed
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  EXPECT_FALSE(diff.reset);
+  EXPECT_EQ(diff.occupied_count, 0u);
+  EXPECT_FALSE(diff.moves[0].appeared);
+
+  // Player 2 moves north and player 1 dies, freeing its cells
+  std::fill(grid.begin(), grid.end(), 0);
+  grid[29 * 50 + 49] = 2;
+  grid[28 * 50 + 49] = 2;
+  players[1].y = 28;
+  gs.players = &players[1];
+  gs.player_count = 1;
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  EXPECT_EQ(cells(diff.occupied, diff.occupied_count),
+            (std::vector<Cell>{{49, 28, 2}}));
+  EXPECT_EQ(cells(diff.freed, diff.freed_count),
+            (std::vector<Cell>{{0, 0, 1}, {17, 10, 1}}));
+  ASSERT_EQ(diff.move_count, 1u);
+  EXPECT_EQ(diff.moves[0].id, 2u);
+  EXPECT_EQ(diff.moves[0].from.y, 29);
+  EXPECT_EQ(diff.moves[0].to.y, 28);
+  ASSERT_EQ(diff.gone_count, 1u);
+  EXPECT_EQ(diff.gone[0], 1);
+  cycles_frame_diff_free(&diff);
+}
+
+TEST(CDiffTest, MatchesABruteForceComparison) {
+  // Odd sizes, so changes fall in the SIMD blocks and in the tail
+  const uint32_t w = 203, h = 77;
+  std::vector<uint8_t> grid(w * h, 0), before;
+  cycles_game_state gs = board_state(grid, w, h);
+  cycles_frame_diff diff;
+  cycles_frame_diff_init(&diff);
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  std::mt19937 rng(5);
+  for (int step = 0; step < 50; step++) {
+    before = grid;
+    int writes = step % 10 == 0 ? 5000 : (int)(rng() % 40);
+    for (int i = 0; i < writes; i++) {
+      grid[rng() % grid.size()] = (uint8_t)(rng() % 3 ? 1 + rng() % 8 : 0);
+    }
+    std::vector<Cell> occupied, freed;
+    for (uint32_t i = 0; i < w * h; i++) {
+      int32_t x = (int32_t)(i % w), y = (int32_t)(i / w);
+      if (before[i] != grid[i] && before[i])
+        freed.emplace_back(x, y, before[i]);
+      if (before[i] != grid[i] && grid[i])
+        occupied.emplace_back(x, y, grid[i]);
+    }
+    std::sort(occupied.begin(), occupied.end());
+    std::sort(freed.begin(), freed.end());
+    ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+    EXPECT_FALSE(diff.reset);
+    ASSERT_EQ(cells(diff.occupied, diff.occupied_count), occupied)
+        << "step " << step;
+    ASSERT_EQ(cells(diff.freed, diff.freed_count), freed) << "step " << step;
+  }
+  cycles_frame_diff_free(&diff);
+}
+
+TEST(CDiffTest, MovedViewportReportsScrolledCells) {
+  std::vector<uint8_t> window(5 * 5, 0);
+  window[2 * 5 + 2] = 3;
+  window[2 * 5 + 0] = 4;
+  cycles_game_state gs = board_state(window, 5, 5);
+  gs.grid_width = 100;
+  gs.grid_height = 100;
+  gs.view_x = 40;
+  gs.view_y = 60;
+  cycles_frame_diff diff;
+  cycles_frame_diff_init(&diff);
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  EXPECT_EQ(cells(diff.occupied, diff.occupied_count),
+            (std::vector<Cell>{{40, 62, 4}, {42, 62, 3}}));
+
+  // The window moves east by one: (40, 62) scrolls out, (45, 62) scrolls in
+  // and (43, 62) gets taken
+  std::fill(window.begin(), window.end(), 0);
+  window[2 * 5 + 1] = 3;
+  window[2 * 5 + 2] = 3;
+  window[2 * 5 + 4] = 5;
+  gs.view_x = 41;
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  EXPECT_FALSE(diff.reset);
+  EXPECT_EQ(cells(diff.occupied, diff.occupied_count),
+            (std::vector<Cell>{{43, 62, 3}, {45, 62, 5}}));
+  ASSERT_EQ(diff.freed_count, 1u);
+  EXPECT_EQ(cells(diff.freed, diff.freed_count),
+            (std::vector<Cell>{{40, 62, 4}}));
+  EXPECT_TRUE(diff.freed[0].scrolled);
+  for (uint32_t i = 0; i < diff.occupied_count; i++) {
+    EXPECT_EQ(diff.occupied[i].scrolled, diff.occupied[i].x == 45);
+  }
+
+  // Another board size starts over
+  gs.grid_width = 120;
+  ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+  EXPECT_TRUE(diff.reset);
+  EXPECT_EQ(diff.occupied_count, 3u);
+  EXPECT_EQ(diff.freed_count, 0u);
+
+  cycles_player bad = {nullptr, {}, 0, 0, 300};
+  gs.players = &bad;
+  gs.player_count = 1;
+  EXPECT_EQ(cycles_frame_diff_update(&diff, &gs), -1);
+  EXPECT_EQ(cycles_frame_diff_update(nullptr, &gs), -1);
+  cycles_frame_diff_free(&diff);
+}
+
+TEST(CDiffTest, MovingViewportMatchesABruteForceComparison) {
+  // Windows of changing size wander over a random board; the diff must turn
+  // the cells seen in one window into those seen in the next
+  const uint32_t w = 90, h = 70;
+  std::vector<uint8_t> board(w * h, 0), window;
+  std::mt19937 rng(11);
+  for (auto &cell : board) {
+    cell = rng() % 4 ? 0 : (uint8_t)(1 + rng() % 8);
+  }
+  std::map<std::pair<int32_t, int32_t>, uint8_t> seen;
+  cycles_frame_diff diff;
+  cycles_frame_diff_init(&diff);
+  for (int step = 0; step < 200; step++) {
+    for (int i = 0; i < 20; i++) {
+      board[rng() % board.size()] = (uint8_t)(rng() % 2 ? 1 + rng() % 8 : 0);
+    }
+    cycles_game_state gs = {};
+    gs.grid_width = w;
+    gs.grid_height = h;
+    gs.view_width = 20 + rng() % 20;
+    gs.view_height = 20 + rng() % 20;
+    gs.view_x = step % 7 == 0 ? rng() % (w - gs.view_width)
+                              : std::min<uint32_t>(w - gs.view_width,
+                                                   diff.view_x + rng() % 3);
+    gs.view_y = std::min<uint32_t>(h - gs.view_height,
+                                   diff.view_y + rng() % 3);
+    window.assign((size_t)gs.view_width * gs.view_height, 0);
+    for (uint32_t y = 0; y < gs.view_height; y++) {
+      for (uint32_t x = 0; x < gs.view_width; x++) {
+        window[y * gs.view_width + x] =
+            board[(gs.view_y + y) * w + gs.view_x + x];
+      }
+    }
+    gs.grid = window.data();
+    ASSERT_EQ(cycles_frame_diff_update(&diff, &gs), 0);
+    EXPECT_EQ(diff.reset, step == 0);
+    for (uint32_t i = 0; i < diff.freed_count; i++) {
+      auto it = seen.find({diff.freed[i].x, diff.freed[i].y});
+      ASSERT_NE(it, seen.end()) << "step " << step;
+      ASSERT_EQ(it->second, diff.freed[i].owner) << "step " << step;
+      seen.erase(it);
+    }
+    for (uint32_t i = 0; i < diff.occupied_count; i++) {
+      ASSERT_TRUE(seen.emplace(std::make_pair(diff.occupied[i].x,
+                                              diff.occupied[i].y),
+                               diff.occupied[i].owner)
+                      .second)
+          << "step " << step;
+    }
+    std::map<std::pair<int32_t, int32_t>, uint8_t> expected;
+    for (uint32_t i = 0; i < window.size(); i++) {
+      if (window[i]) {
+        expected[{(int32_t)(gs.view_x + i % gs.view_width),
+                  (int32_t)(gs.view_y + i / gs.view_width)}] = window[i];
+      }
+    }
+    ASSERT_EQ(seen, expected) << "step " << step;
+  }
+  cycles_frame_diff_free(&diff);
+}
@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <string>
 #include <unistd.h>
+#include <vector>
 
 extern "C" {
 #include "server/game_logic.h"
@@ -30,11 +33,11 @@ TEST(GameLogicTest, AddPlayer) {
   Game *game = game_create(&config);
   PlayerId id = game_add_player(game, "TestPlayer");
   EXPECT_NE(id, 0);
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   uint32_t count = game_get_players(game, players);
   EXPECT_EQ(count, 1);
-  EXPECT_EQ(players[0]->id, id);
-  EXPECT_STREQ(players[0]->name, "TestPlayer");
+  EXPECT_EQ(players[0].id, id);
+  EXPECT_STREQ(players[0].name, "TestPlayer");
   game_destroy(game);
 }
 
@@ -49,7 +52,7 @@ TEST(GameLogicTest, AddMultiplePlayers) {
   EXPECT_NE(id3, 0);
   EXPECT_NE(id1, id2);
   EXPECT_NE(id2, id3);
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   uint32_t count = game_get_players(game, players);
   EXPECT_EQ(count, 3);
   game_destroy(game);
@@ -60,7 +63,7 @@ TEST(GameLogicTest, RemovePlayer) {
   Game *game = game_create(&config);
   PlayerId id = game_add_player(game, "TestPlayer");
   EXPECT_NE(id, 0);
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   EXPECT_EQ(game_get_players(game, players), 1);
   game_remove_player(game, id);
   EXPECT_EQ(game_get_players(game, players), 0);
@@ -104,16 +107,16 @@ TEST(GameLogicTest, MovePlayerNorth) {
   Game *game = game_create(&config);
   PlayerId id = game_add_player(game, "TestPlayer");
   ASSERT_NE(id, 0);
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   game_get_players(game, players);
-  Vec2i initial_pos = players[0]->position;
+  Vec2i initial_pos = players[0].position;
   Direction directions[MAX_PLAYERS] = {north};
   directions[id] = north;
   if (initial_pos.y > 0) {
     game_move_players(game, directions);
     game_get_players(game, players);
-    EXPECT_EQ(players[0]->position.y, initial_pos.y - 1);
-    EXPECT_EQ(players[0]->position.x, initial_pos.x);
+    EXPECT_EQ(players[0].position.y, initial_pos.y - 1);
+    EXPECT_EQ(players[0].position.x, initial_pos.x);
   }
   game_destroy(game);
 }
@@ -123,16 +126,16 @@ TEST(GameLogicTest, MovePlayerEast) {
   Game *game = game_create(&config);
   PlayerId id = game_add_player(game, "TestPlayer");
   ASSERT_NE(id, 0);
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   game_get_players(game, players);
-  Vec2i initial_pos = players[0]->position;
+  Vec2i initial_pos = players[0].position;
   Direction directions[MAX_PLAYERS] = {east};
   directions[id] = east;
   if (initial_pos.x < 9) {
     game_move_players(game, directions);
     game_get_players(game, players);
-    EXPECT_EQ(players[0]->position.x, initial_pos.x + 1);
-    EXPECT_EQ(players[0]->position.y, initial_pos.y);
+    EXPECT_EQ(players[0].position.x, initial_pos.x + 1);
+    EXPECT_EQ(players[0].position.y, initial_pos.y);
   }
   game_destroy(game);
 }
@@ -142,7 +145,7 @@ TEST(GameLogicTest, PlayerCollisionWithWall) {
   Game *game = game_create(&config);
   PlayerId id = game_add_player(game, "TestPlayer");
   ASSERT_NE(id, 0);
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   game_get_players(game, players);
   Direction directions[MAX_PLAYERS] = {north};
   directions[id] = north;
@@ -163,10 +166,10 @@ TEST(GameLogicTest, PlayerHasTailAfterMoving) {
   for (int i = 0; i < 5; i++) {
     game_move_players(game, directions);
   }
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   game_get_players(game, players);
   ASSERT_EQ(game_get_players(game, players), 1);
-  TailNode *tail = players[0]->tail_linked_list;
+  TailNode *tail = players[0].tail_linked_list;
   int tail_len = 0;
   while (tail) {
     tail_len++;
@@ -286,3 +289,360 @@ TEST(GameLogicTest, ConfigLoadNullConfig) {
   int result = game_config_load(tmpl, nullptr);
   EXPECT_EQ(result, -1);
 }
+
+static void expect_occupancy_matches_grid(Game *game) {
+  uint32_t width, height, stride;
+  game_get_grid_size(game, &width, &height);
+  const uint8_t *grid = game_get_grid(game);
+  const uint64_t *occupancy = game_get_occupancy(game, &stride);
+  ASSERT_NE(occupancy, nullptr);
+  EXPECT_EQ(stride, (width + 63) / 64);
+  uint64_t occupied = 0;
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      bool expected = grid[y * width + x] != 0;
+      occupied += expected;
+      EXPECT_EQ(game_occupancy_test(occupancy, stride, x, y), expected)
+          << "Mismatch at (" << x << "," << y << ")";
+    }
+  }
+  EXPECT_EQ(game_count_occupied_cells(game), occupied);
+}
+
+TEST(GameLogicTest, OccupancyInitiallyEmpty) {
+  GameConfig config = {130, 7, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  ASSERT_NE(game, nullptr);
+  EXPECT_EQ(game_count_occupied_cells(game), 0u);
+  expect_occupancy_matches_grid(game);
+  game_destroy(game);
+}
+
+TEST(GameLogicTest, OccupancyTracksMovesAndRemovals) {
+  GameConfig config = {100, 100, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  PlayerId id1 = game_add_player(game, "Player1");
+  PlayerId id2 = game_add_player(game, "Player2");
+  ASSERT_NE(id1, 0);
+  ASSERT_NE(id2, 0);
+  Direction directions[MAX_PLAYERS] = {north};
+  directions[id1] = east;
+  directions[id2] = south;
+  for (int i = 0; i < 80; i++) {
+    game_set_frame(game, i);
+    game_move_players(game, directions);
+    expect_occupancy_matches_grid(game);
+  }
+  game_remove_player(game, id1);
+  game_remove_player(game, id2);
+  EXPECT_EQ(game_count_occupied_cells(game), 0u);
+  expect_occupancy_matches_grid(game);
+  game_destroy(game);
+}
+
+struct PlayerState {
+  PlayerId id;
+  Vec2i position;
+  std::vector<std::pair<int, int>> tail;
+};
+
+static std::vector<PlayerState> capture_players(Game *game) {
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(game, players);
+  std::vector<PlayerState> out;
+  for (uint32_t i = 0; i < count; i++) {
+    PlayerState state{players[i].id, players[i].position, {}};
+    for (TailNode *n = players[i].tail_linked_list; n; n = n->next) {
+      state.tail.emplace_back(n->position.x, n->position.y);
+    }
+    out.push_back(state);
+  }
+  return out;
+}
+
+static void expect_same_state(Game *a, Game *b) {
+  uint32_t width, height;
+  game_get_grid_size(a, &width, &height);
+  const uint8_t *grid_a = game_get_grid(a);
+  const uint8_t *grid_b = game_get_grid(b);
+  EXPECT_TRUE(std::equal(grid_a, grid_a + width * height, grid_b));
+  EXPECT_EQ(game_get_frame(a), game_get_frame(b));
+  EXPECT_EQ(game_count_occupied_cells(a), game_count_occupied_cells(b));
+  std::vector<PlayerState> pa = capture_players(a);
+  std::vector<PlayerState> pb = capture_players(b);
+  ASSERT_EQ(pa.size(), pb.size());
+  for (size_t i = 0; i < pa.size(); i++) {
+    EXPECT_EQ(pa[i].id, pb[i].id);
+    EXPECT_EQ(pa[i].position.x, pb[i].position.x);
+    EXPECT_EQ(pa[i].position.y, pb[i].position.y);
+    EXPECT_EQ(pa[i].tail, pb[i].tail);
+  }
+}
+
+static void play_turns(Game *game, int turns, uint32_t seed) {
+  for (int t = 0; t < turns; t++) {
+    Direction directions[MAX_PLAYERS];
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      seed = seed * 1664525u + 1013904223u;
+      directions[i] = (Direction)((seed >> 16) % 4);
+    }
+    game_set_frame(game, game_get_frame(game) + 1);
+    game_move_players(game, directions);
+  }
+}
+
+TEST(GameLogicTest, SnapshotRestoreRewindsState) {
+  GameConfig config = {40, 40, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  for (int i = 0; i < 8; i++) {
+    game_add_player(game, ("Player" + std::to_string(i)).c_str());
+  }
+  play_turns(game, 10, 1);
+  Game *reference = game_clone(game);
+  ASSERT_NE(reference, nullptr);
+  GameSnapshot *snapshot = game_snapshot_create(game);
+  ASSERT_NE(snapshot, nullptr);
+  ASSERT_EQ(game_snapshot(game, snapshot), 0);
+  for (uint32_t seed = 2; seed < 6; seed++) {
+    play_turns(game, 25, seed);
+    ASSERT_EQ(game_restore(game, snapshot), 0);
+    expect_same_state(game, reference);
+    expect_occupancy_matches_grid(game);
+  }
+  // Replaying the same moves after a restore is deterministic
+  play_turns(game, 30, 7);
+  play_turns(reference, 30, 7);
+  expect_same_state(game, reference);
+  game_snapshot_destroy(snapshot);
+  game_destroy(reference);
+  game_destroy(game);
+}
+
+TEST(GameLogicTest, CloneIsIndependent) {
+  GameConfig config = {30, 30, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  game_add_player(game, "Player1");
+  game_add_player(game, "Player2");
+  play_turns(game, 5, 3);
+  Game *clone = game_clone(game);
+  ASSERT_NE(clone, nullptr);
+  expect_same_state(game, clone);
+  uint64_t occupied = game_count_occupied_cells(game);
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(clone, players);
+  for (uint32_t i = 0; i < count; i++) {
+    game_remove_player(clone, players[i].id);
+  }
+  EXPECT_EQ(game_count_occupied_cells(clone), 0u);
+  EXPECT_EQ(game_count_occupied_cells(game), occupied);
+  game_destroy(clone);
+  game_destroy(game);
+}
+
+TEST(GameLogicTest, SnapshotRejectsMismatchedGrid) {
+  GameConfig small = {10, 10, 60, 100, 100, 10.0f, false};
+  GameConfig large = {20, 20, 60, 100, 100, 10.0f, false};
+  Game *a = game_create(&small);
+  Game *b = game_create(&large);
+  GameSnapshot *snapshot = game_snapshot_create(a);
+  ASSERT_NE(snapshot, nullptr);
+  EXPECT_EQ(game_snapshot(b, snapshot), -1);
+  EXPECT_EQ(game_restore(b, snapshot), -1);
+  EXPECT_EQ(game_snapshot(nullptr, snapshot), -1);
+  EXPECT_EQ(game_restore(a, nullptr), -1);
+  game_snapshot_destroy(snapshot);
+  game_destroy(a);
+  game_destroy(b);
+}
+
+TEST(GameLogicTest, FailedSnapshotKeepsThePreviousOne) {
+  GameConfig config = {30, 30, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  for (int i = 0; i < 4; i++) {
+    game_add_player(game, ("Player" + std::to_string(i)).c_str());
+  }
+  play_turns(game, 5, 1);
+  Game *reference = game_clone(game);
+  ASSERT_NE(reference, nullptr);
+  GameSnapshot *snapshot = game_snapshot_create(game);
+  ASSERT_NE(snapshot, nullptr);
+  ASSERT_EQ(game_snapshot(game, snapshot), 0);
+  // Same size but another storage: the tails fit, the grid copy fails
+  GameConfig chunked_config = config;
+  chunked_config.grid_storage = grid_storage_chunked;
+  Game *chunked = game_create(&chunked_config);
+  for (int i = 0; i < 4; i++) {
+    game_add_player(chunked, ("Other" + std::to_string(i)).c_str());
+  }
+  play_turns(chunked, 20, 2);
+  EXPECT_EQ(game_snapshot(chunked, snapshot), -1);
+  play_turns(game, 20, 3);
+  ASSERT_EQ(game_restore(game, snapshot), 0);
+  expect_same_state(game, reference);
+  expect_occupancy_matches_grid(game);
+  game_snapshot_destroy(snapshot);
+  game_destroy(chunked);
+  game_destroy(reference);
+  game_destroy(game);
+}
+
+TEST(GameLogicTest, StateHashTracksGrid) {
+  GameConfig config = {40, 40, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  EXPECT_EQ(game_get_state_hash(game), 0u);
+  for (int i = 0; i < 8; i++) {
+    game_add_player(game, ("Player" + std::to_string(i)).c_str());
+  }
+  EXPECT_NE(game_get_state_hash(game), 0u);
+  EXPECT_EQ(game_get_state_hash(game), game_compute_state_hash(game));
+  GameSnapshot *snapshot = game_snapshot_create(game);
+  ASSERT_NE(snapshot, nullptr);
+  ASSERT_EQ(game_snapshot(game, snapshot), 0);
+  uint64_t initial = game_get_state_hash(game);
+  for (uint32_t seed = 1; seed < 80; seed++) {
+    play_turns(game, 1, seed);
+    ASSERT_EQ(game_get_state_hash(game), game_compute_state_hash(game))
+        << "Hash diverged at frame " << game_get_frame(game);
+  }
+  Game *clone = game_clone(game);
+  ASSERT_NE(clone, nullptr);
+  EXPECT_EQ(game_get_state_hash(clone), game_get_state_hash(game));
+  ASSERT_EQ(game_restore(game, snapshot), 0);
+  EXPECT_EQ(game_get_state_hash(game), initial);
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(clone, players);
+  for (uint32_t i = 0; i < count; i++) {
+    game_remove_player(clone, players[i].id);
+  }
+  EXPECT_EQ(game_get_state_hash(clone), 0u);
+  game_snapshot_destroy(snapshot);
+  game_destroy(clone);
+  game_destroy(game);
+}
+
+// Run every available legality kernel on the same game and compare with the
+// scalar one
+static void expect_kernels_agree(Game *game, const Direction *directions) {
+  Vec2i scalar_targets[MAX_PLAYERS], targets[MAX_PLAYERS];
+  bool scalar_legal[MAX_PLAYERS], legal[MAX_PLAYERS];
+  int count = game_check_moves(game, directions, legality_kernel_scalar,
+                               scalar_targets, scalar_legal);
+  ASSERT_GE(count, 0);
+  for (LegalityKernel kernel : {legality_kernel_avx2, legality_kernel_neon,
+                                legality_kernel_fixed}) {
+    if (game_check_moves(game, directions, kernel, targets, legal) < 0) {
+      continue; // Not supported on this CPU or board
+    }
+    for (int i = 0; i < count; i++) {
+      EXPECT_EQ(targets[i].x, scalar_targets[i].x) << "kernel " << kernel;
+      EXPECT_EQ(targets[i].y, scalar_targets[i].y) << "kernel " << kernel;
+      EXPECT_EQ(legal[i], scalar_legal[i])
+          << "kernel " << kernel << " slot " << i;
+    }
+  }
+}
+
+TEST(GameLogicTest, LegalityKernelsMatchScalar) {
+  // Odd widths exercise partial occupancy words, small boards put many
+  // players next to the walls. Tiled grids share the dense bitboard, the
+  // last two sizes have their own kernels.
+  const uint32_t sizes[][2] = {{7, 5},   {33, 9},    {70, 41},
+                               {130, 3}, {100, 100}, {256, 256}};
+  for (GridStorage storage : {grid_storage_dense, grid_storage_tiled}) {
+    for (const auto &size : sizes) {
+      GameConfig config = {size[0], size[1], 60, 1000, 1000, 10.0f, false};
+      config.grid_storage = storage;
+      Game *game = game_create(&config);
+      uint32_t players = std::min<uint32_t>(size[0] * size[1] / 3, 60);
+      for (uint32_t i = 0; i < players; i++) {
+        game_add_player(game, ("Player" + std::to_string(i)).c_str());
+      }
+      uint32_t seed = size[0];
+      for (int turn = 0; turn < 20 && !game_is_over(game); turn++) {
+        Direction directions[MAX_PLAYERS];
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+          seed = seed * 1664525u + 1013904223u;
+          directions[i] = (Direction)((seed >> 16) % 4);
+        }
+        expect_kernels_agree(game, directions);
+        game_set_frame(game, turn);
+        game_move_players(game, directions);
+      }
+      game_destroy(game);
+    }
+  }
+}
+
+TEST(GameLogicTest, FixedBoardKernelsSelectedAtCreate) {
+  GameConfig config = {100, 100, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  EXPECT_TRUE(game_has_fixed_board_kernels(game));
+  // A few players so the fixed kernel also runs on AVX2 machines
+  for (int i = 0; i < 5; i++) {
+    game_add_player(game, ("Player" + std::to_string(i)).c_str());
+  }
+  Direction directions[MAX_PLAYERS];
+  for (int i = 0; i < MAX_PLAYERS; i++) {
+    directions[i] = east;
+  }
+  Vec2i targets[MAX_PLAYERS];
+  bool legal[MAX_PLAYERS];
+  EXPECT_EQ(game_check_moves(game, directions, legality_kernel_fixed, targets,
+                             legal),
+            5);
+  game_destroy(game);
+
+  config.grid_width = 101;
+  game = game_create(&config);
+  EXPECT_FALSE(game_has_fixed_board_kernels(game));
+  EXPECT_EQ(game_check_moves(game, directions, legality_kernel_fixed, targets,
+                             legal),
+            -1);
+  game_destroy(game);
+
+  config.grid_width = 256;
+  config.grid_height = 256;
+  config.grid_storage = grid_storage_chunked;
+  game = game_create(&config);
+  EXPECT_FALSE(game_has_fixed_board_kernels(game));
+  game_destroy(game);
+}
+
+TEST(GameLogicTest, DirtyRowsCoverEveryChangedRow) {
+  const uint32_t w = 50, h = 130;
+  GameConfig config = {w, h, 60, 1000, 1000, 10.0f, false};
+  Game *game = game_create(&config);
+  for (int i = 0; i < 20; i++) {
+    game_add_player(game, ("Player" + std::to_string(i)).c_str());
+  }
+  std::vector<uint64_t> rows((h + 63) / 64, 0);
+  EXPECT_TRUE(game_take_dirty_rows(game, rows.data()));
+  std::fill(rows.begin(), rows.end(), 0);
+  EXPECT_FALSE(game_take_dirty_rows(game, rows.data()));
+  GameSnapshot *snapshot = game_snapshot_create(game);
+  ASSERT_EQ(game_snapshot(game, snapshot), 0);
+  std::vector<uint8_t> before(w * h), after(w * h);
+  for (uint32_t seed = 1; seed < 60 && !game_is_over(game); seed++) {
+    std::copy_n(game_get_grid(game), w * h, before.begin());
+    play_turns(game, 1, seed);
+    std::copy_n(game_get_grid(game), w * h, after.begin());
+    std::fill(rows.begin(), rows.end(), 0);
+    game_take_dirty_rows(game, rows.data());
+    for (uint32_t y = 0; y < h; y++) {
+      bool changed = !std::equal(&before[y * w], &before[y * w] + w,
+                                 &after[y * w]);
+      if (changed) {
+        EXPECT_TRUE((rows[y / 64] >> (y % 64)) & 1u) << "row " << y;
+      }
+    }
+  }
+  // Restoring rewrites the whole grid
+  ASSERT_EQ(game_restore(game, snapshot), 0);
+  std::fill(rows.begin(), rows.end(), 0);
+  game_take_dirty_rows(game, rows.data());
+  for (uint32_t y = 0; y < h; y++) {
+    EXPECT_TRUE((rows[y / 64] >> (y % 64)) & 1u) << "row " << y;
+  }
+  game_snapshot_destroy(snapshot);
+  game_destroy(game);
+}
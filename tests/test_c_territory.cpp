@@ -0,0 +1,186 @@
+#include "c_territory.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Head {
+  int x, y;
+  uint32_t id;
+};
+
+// Territory from one plain BFS per head
+cycles_territory_counts brute_force(const std::vector<uint8_t> &grid, int w,
+                                    int h, const std::vector<Head> &heads) {
+  const uint32_t unreached = CYCLES_TERRITORY_UNREACHED;
+  std::vector<std::vector<uint32_t>> dist;
+  for (const Head &head : heads) {
+    std::vector<uint32_t> d(w * h, unreached);
+    std::vector<int> queue = {head.y * w + head.x};
+    d[queue[0]] = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+      int x = queue[i] % w, y = queue[i] / w;
+      const int nx[] = {x, x + 1, x, x - 1}, ny[] = {y - 1, y, y + 1, y};
+      for (int k = 0; k < 4; k++) {
+        if (nx[k] < 0 || ny[k] < 0 || nx[k] >= w || ny[k] >= h)
+          continue;
+        int n = ny[k] * w + nx[k];
+        if (!grid[n] && d[n] == unreached) {
+          d[n] = d[queue[i]] + 1;
+          queue.push_back(n);
+        }
+      }
+    }
+    dist.push_back(d);
+  }
+  cycles_territory_counts counts = {};
+  for (int v = 0; v < w * h; v++) {
+    if (grid[v])
+      continue;
+    uint32_t best = unreached, owner = 0;
+    int ties = 0;
+    for (size_t p = 0; p < heads.size(); p++) {
+      if (dist[p][v] < best) {
+        best = dist[p][v];
+        owner = heads[p].id;
+        ties = 1;
+      } else if (dist[p][v] == best && best != unreached) {
+        ties++;
+      }
+    }
+    if (ties > 1)
+      counts.contested++;
+    else if (ties == 1)
+      counts.owned[owner]++;
+  }
+  return counts;
+}
+
+void expect_counts(const cycles_territory_counts &a,
+                   const cycles_territory_counts &b, const char *what) {
+  EXPECT_EQ(a.contested, b.contested) << what;
+  for (int id = 0; id < 256; id++)
+    EXPECT_EQ(a.owned[id], b.owned[id]) << what << ", player " << id;
+}
+
+// Random board with trails and heads at free cells
+struct Board {
+  int w, h;
+  std::vector<uint8_t> grid;
+  std::vector<Head> heads;
+  std::vector<cycles_player> players;
+  cycles_game_state gs = {};
+
+  Board(int w_, int h_, int count, double walls, std::mt19937 &rng)
+      : w(w_), h(h_), grid(w_ * h_, 0) {
+    std::bernoulli_distribution wall(walls);
+    for (auto &cell : grid)
+      cell = wall(rng) ? 200 : 0;
+    for (int i = 0; i < count; i++) {
+      int v = (int)(rng() % grid.size());
+      if (grid[v])
+        continue;
+      uint32_t id = (uint32_t)heads.size() + 1;
+      grid[v] = (uint8_t)id;
+      heads.push_back({v % w, v / w, id});
+    }
+    for (const Head &head : heads)
+      players.push_back({nullptr, {}, head.x, head.y, head.id});
+    gs.grid = grid.data();
+    gs.grid_width = gs.view_width = w;
+    gs.grid_height = gs.view_height = h;
+    gs.players = players.data();
+    gs.player_count = (uint32_t)players.size();
+  }
+};
+
+} // namespace
+
+TEST(CTerritoryTest, MatchesPerPlayerSearches) {
+  std::mt19937 rng(17);
+  cycles_territory territory;
+  cycles_territory_init(&territory);
+  for (int round = 0; round < 30; round++) {
+    Board board(2 + rng() % 60, 2 + rng() % 40, 1 + rng() % 8,
+                0.05 * (round % 6), rng);
+    ASSERT_EQ(cycles_territory_update(&territory, &board.gs), 0);
+    expect_counts(territory.counts,
+                  brute_force(board.grid, board.w, board.h, board.heads),
+                  "update");
+    for (const Head &head : board.heads)
+      EXPECT_EQ(cycles_territory_distance(&territory, {head.x, head.y}), 0u);
+  }
+  // Two heads facing each other split a corridor, the middle cell is shared
+  std::vector<uint8_t> corridor(7, 0);
+  corridor[0] = 1;
+  corridor[6] = 2;
+  cycles_player players[2] = {{nullptr, {}, 0, 0, 1}, {nullptr, {}, 6, 0, 2}};
+  cycles_game_state gs = {};
+  gs.grid = corridor.data();
+  gs.grid_width = gs.view_width = 7;
+  gs.grid_height = gs.view_height = 1;
+  gs.players = players;
+  gs.player_count = 2;
+  ASSERT_EQ(cycles_territory_update(&territory, &gs), 0);
+  EXPECT_EQ(territory.counts.owned[1], 2u);
+  EXPECT_EQ(territory.counts.owned[2], 2u);
+  EXPECT_EQ(territory.counts.contested, 1u);
+  EXPECT_EQ(cycles_territory_owner(&territory, {3, 0}),
+            CYCLES_TERRITORY_CONTESTED);
+  EXPECT_EQ(cycles_territory_owner(&territory, {1, 0}), 1u);
+  EXPECT_EQ(cycles_territory_owner(&territory, {0, 0}), 0u);
+  EXPECT_EQ(cycles_territory_distance(&territory, {3, 0}), 3u);
+  EXPECT_EQ(cycles_territory_distance(&territory, {9, 0}),
+            CYCLES_TERRITORY_UNREACHED);
+  cycles_territory_free(&territory);
+}
+
+TEST(CTerritoryTest, EvaluatedMovesMatchRecomputing) {
+  std::mt19937 rng(29);
+  cycles_territory territory;
+  cycles_territory_init(&territory);
+  for (int round = 0; round < 40; round++) {
+    Board board(2 + rng() % 50, 2 + rng() % 40, 2 + rng() % 7,
+                0.04 * (round % 8), rng);
+    ASSERT_EQ(cycles_territory_update(&territory, &board.gs), 0);
+    for (size_t p = 0; p < board.heads.size(); p++) {
+      for (int d = 0; d < 4; d++) {
+        Head moved = board.heads[p];
+        moved.x += d == 1 ? 1 : d == 3 ? -1 : 0;
+        moved.y += d == 2 ? 1 : d == 0 ? -1 : 0;
+        // The old head stays occupied; a crash takes the player out
+        std::vector<uint8_t> grid = board.grid;
+        std::vector<Head> heads = board.heads;
+        bool valid = moved.x >= 0 && moved.y >= 0 && moved.x < board.w &&
+                     moved.y < board.h && !grid[moved.y * board.w + moved.x];
+        if (valid) {
+          grid[moved.y * board.w + moved.x] = (uint8_t)moved.id;
+          heads[p] = moved;
+        } else {
+          heads.erase(heads.begin() + p);
+        }
+        cycles_territory_counts counts;
+        ASSERT_EQ(cycles_territory_evaluate_move(&territory, board.heads[p].id,
+                                                 (cycles_direction)d, &counts),
+                  0);
+        expect_counts(counts, brute_force(grid, board.w, board.h, heads),
+                      "move");
+        if (HasFailure()) {
+          FAIL() << "round " << round << " player " << board.heads[p].id
+                 << " direction " << d;
+        }
+      }
+    }
+    // Queries leave the territory of the state alone
+    expect_counts(territory.counts,
+                  brute_force(board.grid, board.w, board.h, board.heads),
+                  "after moves");
+  }
+  cycles_territory_counts counts;
+  EXPECT_EQ(
+      cycles_territory_evaluate_move(&territory, 255, cycles_north, &counts),
+      -1);
+  EXPECT_EQ(cycles_territory_update(nullptr, nullptr), -1);
+  cycles_territory_free(&territory);
+}
@@ -0,0 +1,24 @@
+// The bot helpers with the board size fixed at compile time
+#define CYCLES_FIXED_GRID_WIDTH 100
+#define CYCLES_FIXED_GRID_HEIGHT 100
+#include "c_utils.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(CUtilsFixedTest, HelpersUseFixedSize) {
+  std::vector<uint8_t> grid(100 * 100, 0);
+  grid[42 * 100 + 7] = 3;
+  cycles_game_state gs = {};
+  gs.grid = grid.data();
+  // Sizes in the state are ignored in favour of the constants
+  gs.grid_width = 1;
+  gs.grid_height = 1;
+  EXPECT_TRUE(cycles_is_inside_grid(&gs, {0, 0}));
+  EXPECT_TRUE(cycles_is_inside_grid(&gs, {99, 99}));
+  EXPECT_FALSE(cycles_is_inside_grid(&gs, {100, 0}));
+  EXPECT_FALSE(cycles_is_inside_grid(&gs, {0, 100}));
+  EXPECT_FALSE(cycles_is_inside_grid(&gs, {-1, 5}));
+  EXPECT_FALSE(cycles_is_inside_grid(&gs, {5, -1}));
+  EXPECT_EQ(cycles_get_grid_cell(&gs, {7, 42}), 3);
+  EXPECT_EQ(cycles_get_grid_cell(&gs, {42, 7}), 0);
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "server/board_lod.h"
+#include "server/camera.h"
+#include "server/grid.h"
+}
+
+TEST(CameraTest, StartsShowingTheWholeBoard) {
+  Camera camera;
+  ASSERT_EQ(camera_init(&camera, 2000, 1000, 1000, 1000), 0);
+  EXPECT_FLOAT_EQ(camera.zoom, 0.5f);
+  EXPECT_TRUE(camera_shows_board(&camera));
+  EXPECT_EQ(camera_lod_level(&camera), 1u);
+  // Zooming out further is not allowed
+  camera_zoom_at(&camera, 0.5f, 500, 500);
+  EXPECT_FLOAT_EQ(camera.zoom, 0.5f);
+  EXPECT_EQ(camera_init(&camera, 0, 10, 100, 100), -1);
+}
+
+TEST(CameraTest, ZoomKeepsThePointUnderTheCursor) {
+  Camera camera;
+  ASSERT_EQ(camera_init(&camera, 1000, 1000, 500, 500), 0);
+  float before_x, before_y;
+  camera_screen_to_board(&camera, 120, 340, &before_x, &before_y);
+  camera_zoom_at(&camera, 8.0f, 120, 340);
+  EXPECT_FLOAT_EQ(camera.zoom, 4.0f);
+  float after_x, after_y;
+  camera_screen_to_board(&camera, 120, 340, &after_x, &after_y);
+  EXPECT_NEAR(after_x, before_x, 1e-3);
+  EXPECT_NEAR(after_y, before_y, 1e-3);
+  EXPECT_FALSE(camera_shows_board(&camera));
+  EXPECT_EQ(camera_lod_level(&camera), 0u);
+}
+
+TEST(CameraTest, VisibleCellsFollowThePan) {
+  Camera camera;
+  ASSERT_EQ(camera_init(&camera, 1000, 1000, 400, 400), 0);
+  camera_zoom_at(&camera, 25.0f, 200, 200); // 10 px per cell, 40x40 cells
+  camera_center_on(&camera, 100.0f, 100.0f);
+  CameraCells cells;
+  camera_visible_cells(&camera, &cells);
+  EXPECT_EQ(cells.x0, 80u);
+  EXPECT_EQ(cells.x1, 120u);
+  EXPECT_EQ(cells.y0, 80u);
+  EXPECT_EQ(cells.y1, 120u);
+  camera.follow = 3;
+  camera_pan(&camera, 55.0f, 0.0f);
+  EXPECT_EQ(camera.follow, 0);
+  camera_visible_cells(&camera, &cells);
+  EXPECT_EQ(cells.x0, 85u);
+  EXPECT_EQ(cells.x1, 126u);
+  // Panning past the edge stops at the board
+  camera_pan(&camera, -1e6f, 1e6f);
+  camera_visible_cells(&camera, &cells);
+  EXPECT_EQ(cells.x0, 0u);
+  EXPECT_EQ(cells.x1, 40u);
+  EXPECT_EQ(cells.y1, 1000u);
+}
+
+TEST(BoardLodTest, LevelsHalveUntilTheTopFits) {
+  BoardLod *lod = board_lod_create(1000, 301, 128);
+  ASSERT_NE(lod, nullptr);
+  ASSERT_EQ(board_lod_levels(lod), 4u);
+  uint32_t w, h;
+  board_lod_level_size(lod, 3, &w, &h);
+  EXPECT_EQ(w, 125u);
+  EXPECT_EQ(h, 38u);
+  board_lod_destroy(lod);
+  lod = board_lod_create(100, 100, 128);
+  ASSERT_NE(lod, nullptr);
+  EXPECT_EQ(board_lod_levels(lod), 1u);
+  board_lod_destroy(lod);
+}
+
+TEST(BoardLodTest, IncrementalUpdatesMatchAFullRebuild) {
+  const uint32_t w = 203, h = 150;
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, w, h, grid_storage_chunked), 0);
+  BoardLod *lod = board_lod_create(w, h, 16);
+  ASSERT_NE(lod, nullptr);
+  std::mt19937 rng(11);
+  std::vector<uint64_t> rows((h + 63) / 64);
+  for (int step = 0; step < 20; step++) {
+    std::fill(rows.begin(), rows.end(), 0);
+    for (int i = 0; i < 40; i++) {
+      uint32_t x = rng() % w, y = rng() % h;
+      grid_set(&grid, x, y, (uint8_t)(rng() % 3 ? 1 + rng() % 8 : 0));
+      rows[y >> 6] |= 1ull << (y & 63);
+    }
+    board_lod_update(lod, &grid, rows.data());
+  }
+  // Rebuild every level from the final board
+  std::vector<uint8_t> below(w * h);
+  grid_copy_rows(&grid, 0, h, below.data());
+  uint32_t bw = w, bh = h;
+  for (uint32_t k = 1; k < board_lod_levels(lod); k++) {
+    uint32_t lw, lh;
+    board_lod_level_size(lod, k, &lw, &lh);
+    std::vector<uint8_t> level(lw * lh, 0);
+    for (uint32_t y = 0; y < lh; y++) {
+      for (uint32_t x = 0; x < lw; x++) {
+        for (uint32_t i = 0; i < 4 && !level[y * lw + x]; i++) {
+          uint32_t sx = 2 * x + (i & 1), sy = 2 * y + (i >> 1);
+          if (sx < bw && sy < bh)
+            level[y * lw + x] = below[sy * bw + sx];
+        }
+      }
+      const uint8_t *row = board_lod_row(lod, k, y);
+      ASSERT_EQ(std::vector<uint8_t>(row, row + lw),
+                std::vector<uint8_t>(level.begin() + y * lw,
+                                     level.begin() + (y + 1) * lw))
+          << "level " << k << " row " << y;
+    }
+    below = level;
+    bw = lw;
+    bh = lh;
+  }
+  board_lod_destroy(lod);
+  grid_free(&grid);
+}
+
+TEST(BoardLodTest, ChangedRowsAreTakenOnce) {
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, 256, 256, grid_storage_dense), 0);
+  BoardLod *lod = board_lod_create(256, 256, 64);
+  ASSERT_NE(lod, nullptr);
+  std::vector<uint64_t> rows(4, 0);
+  rows[2] = 1ull << (130 - 128) | 1ull << (131 - 128);
+  grid_set(&grid, 7, 130, 2);
+  board_lod_update(lod, &grid, rows.data());
+  uint32_t first, count;
+  // Outside the requested range, the rows stay pending
+  EXPECT_FALSE(board_lod_take_rows(lod, 0, 0, 100, &first, &count));
+  ASSERT_TRUE(board_lod_take_rows(lod, 0, 0, 256, &first, &count));
+  EXPECT_EQ(first, 130u);
+  EXPECT_EQ(count, 2u);
+  EXPECT_FALSE(board_lod_take_rows(lod, 0, 0, 256, &first, &count));
+  ASSERT_TRUE(board_lod_take_rows(lod, 2, 0, 64, &first, &count));
+  EXPECT_EQ(first, 32u);
+  EXPECT_EQ(count, 1u);
+  EXPECT_EQ(board_lod_row(lod, 2, 32)[1], 2);
+  board_lod_invalidate(lod);
+  ASSERT_TRUE(board_lod_take_rows(lod, 2, 0, 64, &first, &count));
+  EXPECT_EQ(count, 64u);
+  board_lod_destroy(lod);
+  grid_free(&grid);
+}
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "server/capture.h"
+}
+
+namespace {
+
+std::string temp_path(const char *name) {
+  return testing::TempDir() + "capture_" + name;
+}
+
+std::vector<uint8_t> read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+uint32_t be32(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         p[3];
+}
+
+uint32_t crc32(const uint8_t *data, size_t size) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++)
+      crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+} // namespace
+
+TEST(CaptureTest, FormatNames) {
+  CaptureFormat format;
+  EXPECT_EQ(capture_format_from_name("png", &format), 0);
+  EXPECT_EQ(format, capture_format_png);
+  EXPECT_EQ(capture_format_from_name("y4m", &format), 0);
+  EXPECT_EQ(format, capture_format_y4m);
+  EXPECT_EQ(capture_format_from_name("mp4", &format), -1);
+  EXPECT_EQ(capture_open("x", capture_format_rgb, 0, 10, 30, 0), nullptr);
+}
+
+TEST(CaptureTest, RawFramesAreRgb) {
+  std::string path = temp_path("frames.rgb");
+  CaptureSink *sink =
+      capture_open(path.c_str(), capture_format_rgb, 2, 2, 30, 4);
+  ASSERT_NE(sink, nullptr);
+  // Padded rows: the pitch is larger than the frame width
+  uint32_t pixels[6] = {0xFFFF0000u, 0xFF00FF00u, 0xDEADBEEFu,
+                        0xFF0000FFu, 0xFF123456u, 0xDEADBEEFu};
+  EXPECT_TRUE(capture_submit(sink, pixels, 3 * sizeof(uint32_t)));
+  capture_close(sink, nullptr);
+  std::vector<uint8_t> expected = {255, 0, 0, 0,    255,  0,
+                                   0,   0, 255, 0x12, 0x34, 0x56};
+  EXPECT_EQ(read_file(path), expected);
+  std::remove(path.c_str());
+}
+
+TEST(CaptureTest, Y4mHeaderAndPlanes) {
+  std::string path = temp_path("video.y4m");
+  CaptureSink *sink =
+      capture_open(path.c_str(), capture_format_y4m, 3, 3, 25, 4);
+  ASSERT_NE(sink, nullptr);
+  std::vector<uint32_t> white(9, 0xFFFFFFFFu), black(9, 0xFF000000u);
+  EXPECT_TRUE(capture_submit(sink, white.data(), 3 * sizeof(uint32_t)));
+  EXPECT_TRUE(capture_submit(sink, black.data(), 3 * sizeof(uint32_t)));
+  capture_close(sink, nullptr);
+  std::vector<uint8_t> data = read_file(path);
+  std::string header = "YUV4MPEG2 W3 H3 F25:1 Ip A1:1 C420jpeg\n";
+  // 9 luma samples and two 2x2 chroma planes per frame
+  size_t frame_size = 6 + 9 + 2 * 4;
+  ASSERT_EQ(data.size(), header.size() + 2 * frame_size);
+  EXPECT_EQ(std::string(data.begin(), data.begin() + header.size()), header);
+  const uint8_t *first = data.data() + header.size();
+  EXPECT_EQ(std::string(first, first + 6), "FRAME\n");
+  EXPECT_EQ(first[6], 255);
+  EXPECT_EQ(first[6 + 9], 128);
+  EXPECT_EQ(first[6 + 9 + 4], 128);
+  const uint8_t *second = first + frame_size;
+  EXPECT_EQ(second[6], 0);
+  EXPECT_EQ(second[6 + 9], 128);
+}
+
+TEST(CaptureTest, PngSequenceIsWellFormed) {
+  std::string pattern = temp_path("png_%03u.png");
+  CaptureSink *sink =
+      capture_open(pattern.c_str(), capture_format_png, 4, 2, 30, 4);
+  ASSERT_NE(sink, nullptr);
+  std::vector<uint32_t> pixels(8, 0xFF204080u);
+  EXPECT_TRUE(capture_submit(sink, pixels.data(), 4 * sizeof(uint32_t)));
+  EXPECT_TRUE(capture_submit(sink, pixels.data(), 4 * sizeof(uint32_t)));
+  capture_close(sink, nullptr);
+  for (const char *name : {"png_000.png", "png_001.png"}) {
+    std::string path = temp_path(name);
+    std::vector<uint8_t> data = read_file(path);
+    ASSERT_GT(data.size(), 8u) << name;
+    EXPECT_EQ(std::string(data.begin() + 1, data.begin() + 4), "PNG");
+    // Walk the chunks and check every CRC
+    std::vector<std::string> chunks;
+    for (size_t pos = 8; pos + 12 <= data.size();) {
+      uint32_t size = be32(&data[pos]);
+      ASSERT_LE(pos + 12 + size, data.size());
+      chunks.emplace_back(data.begin() + pos + 4, data.begin() + pos + 8);
+      EXPECT_EQ(be32(&data[pos + 8 + size]), crc32(&data[pos + 4], size + 4))
+          << chunks.back();
+      pos += 12 + size;
+    }
+    EXPECT_EQ(chunks, (std::vector<std::string>{"IHDR", "IDAT", "IEND"}));
+    EXPECT_EQ(be32(&data[16]), 4u);
+    EXPECT_EQ(be32(&data[20]), 2u);
+    std::remove(path.c_str());
+  }
+}
+
+TEST(CaptureTest, EveryFrameIsAccounted) {
+  std::string path = temp_path("busy.rgb");
+  const uint32_t size = 256;
+  CaptureSink *sink =
+      capture_open(path.c_str(), capture_format_rgb, size, size, 30, 1);
+  ASSERT_NE(sink, nullptr);
+  std::vector<uint32_t> pixels(size * size, 0xFF00FF00u);
+  int queued = 0;
+  for (int i = 0; i < 50; i++)
+    queued += capture_submit(sink, pixels.data(), size * sizeof(uint32_t));
+  CaptureStats stats;
+  capture_get_stats(sink, &stats);
+  EXPECT_EQ(stats.submitted, 50u);
+  EXPECT_EQ(stats.dropped, 50u - queued);
+  capture_close(sink, &stats);
+  EXPECT_EQ(stats.written, (uint64_t)queued);
+  EXPECT_EQ(read_file(path).size(), (size_t)queued * size * size * 3);
+  std::remove(path.c_str());
+}
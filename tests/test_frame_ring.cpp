@@ -0,0 +1,210 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+#include "server/frame_ring.h"
+#include "server/game_logic.h"
+#include "server/server_utils.h"
+}
+
+namespace {
+
+// One segment per test and process, so parallel runs do not collide
+std::string ring_name(const char *test) {
+  return "/ccycles-test-" + std::to_string(getpid()) + "-" + test;
+}
+
+GameConfig make_config(uint32_t width, uint32_t height) {
+  GameConfig config;
+  fill_default_configuration(&config);
+  config.grid_width = width;
+  config.grid_height = height;
+  return config;
+}
+
+// Every player turns clockwise every three ticks
+void tick(Game *game) {
+  static const Direction turn[] = {east, south, west, north};
+  Direction directions[MAX_PLAYERS] = {};
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(game, players);
+  uint32_t frame = game_get_frame(game);
+  for (uint32_t i = 0; i < count; i++) {
+    directions[players[i].id] = turn[(frame / 3) % 4];
+  }
+  game_move_players(game, directions);
+  game_set_frame(game, frame + 1);
+}
+
+std::vector<uint8_t> owners(const Game *game) {
+  const Grid *grid = game_get_grid_storage(game);
+  std::vector<uint8_t> cells((size_t)grid->width * grid->height);
+  grid_copy_rows(grid, 0, grid->height, cells.data());
+  return cells;
+}
+
+} // namespace
+
+TEST(FrameRingTest, ReaderSeesThePublishedBoardAndPlayers) {
+  GameConfig config = make_config(100, 100);
+  std::string name = ring_name("board");
+  FrameRingWriter *ring = frame_ring_create(name.c_str(), &config);
+  ASSERT_NE(ring, nullptr);
+  Game *game = game_create(&config);
+  game_add_player(game, "alice");
+  game_add_player(game, "bob");
+  tick(game);
+  ASSERT_EQ(frame_ring_publish(ring, game, 1000), 0);
+  tick(game);
+  ASSERT_EQ(frame_ring_publish(ring, game, 3000), 0);
+
+  FrameRingReader *reader = frame_ring_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+  FrameRingInfo info;
+  frame_ring_get_info(reader, &info);
+  EXPECT_EQ(info.grid_width, 100u);
+  EXPECT_EQ(info.game_width, config.game_width);
+  Game *view = game_create(&config);
+  RenderFrame frame;
+  ASSERT_EQ(frame_ring_read(reader, view, &frame), 1);
+  EXPECT_EQ(frame.frame, 2u);
+  EXPECT_EQ(frame.interval_ns, 2000u);
+  ASSERT_EQ(frame.player_count, 2u);
+  Player players[MAX_PLAYERS];
+  game_get_players(game, players);
+  for (uint32_t i = 0; i < 2; i++) {
+    EXPECT_EQ(frame.players[i].id, players[i].id);
+    EXPECT_STREQ(frame.players[i].name, players[i].name);
+    EXPECT_EQ(frame.players[i].position.x, players[i].position.x);
+    EXPECT_EQ(frame.players[i].position.x, frame.previous[i].x + 1);
+    EXPECT_EQ(frame.players[i].tail_linked_list, nullptr);
+  }
+  EXPECT_EQ(owners(view), owners(game));
+  EXPECT_EQ(game_get_state_hash(view), game_get_state_hash(game));
+  // Nothing new until the next publish
+  EXPECT_EQ(frame_ring_read(reader, view, &frame), 0);
+  frame_ring_close(reader);
+  game_destroy(view);
+  game_destroy(game);
+  frame_ring_destroy(ring);
+}
+
+TEST(FrameRingTest, ReaderCopiesOnlyChangedRows) {
+  GameConfig config = make_config(100, 100);
+  std::string name = ring_name("rows");
+  FrameRingWriter *ring = frame_ring_create(name.c_str(), &config);
+  ASSERT_NE(ring, nullptr);
+  FrameRingReader *reader = frame_ring_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+  Game *game = game_create(&config);
+  game_add_player(game, "alice");
+  game_add_player(game, "bob");
+  Game *view = game_create(&config);
+  RenderFrame frame;
+  EXPECT_EQ(frame_ring_read(reader, view, &frame), 0);
+  ASSERT_EQ(frame_ring_publish(ring, game, 0), 0);
+  ASSERT_EQ(frame_ring_read(reader, view, &frame), 1);
+
+  const size_t words = (100 + 63) / 64;
+  std::vector<uint64_t> written(words, 0), loaded(words, 0);
+  game_take_dirty_rows(game, written.data());
+  game_take_dirty_rows(view, loaded.data());
+  std::fill(written.begin(), written.end(), 0);
+  std::fill(loaded.begin(), loaded.end(), 0);
+  // More publishes than slots, so the reader skips some
+  for (int i = 0; i < 2 * FRAME_RING_SLOTS + 1; i++) {
+    tick(game);
+    ASSERT_EQ(frame_ring_publish(ring, game, 0), 0);
+  }
+  ASSERT_EQ(frame_ring_read(reader, view, &frame), 1);
+  EXPECT_EQ(frame.frame, game_get_frame(game));
+  EXPECT_EQ(owners(view), owners(game));
+  game_take_dirty_rows(game, written.data());
+  ASSERT_TRUE(game_take_dirty_rows(view, loaded.data()));
+  EXPECT_EQ(loaded, written);
+  frame_ring_close(reader);
+  game_destroy(view);
+  game_destroy(game);
+  frame_ring_destroy(ring);
+}
+
+TEST(FrameRingTest, AttachAndDetach) {
+  GameConfig config = make_config(50, 40);
+  std::string name = ring_name("attach");
+  EXPECT_EQ(frame_ring_open(name.c_str()), nullptr);
+  EXPECT_EQ(frame_ring_create("no-slash", &config), nullptr);
+  FrameRingWriter *ring = frame_ring_create(name.c_str(), &config);
+  ASSERT_NE(ring, nullptr);
+  FrameRingReader *first = frame_ring_open(name.c_str());
+  FrameRingReader *second = frame_ring_open(name.c_str());
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  Game *game = game_create(&config);
+  GameConfig other = make_config(40, 50);
+  Game *wrong = game_create(&other);
+  RenderFrame frame;
+  EXPECT_EQ(frame_ring_publish(ring, wrong, 0), -1);
+  ASSERT_EQ(frame_ring_publish(ring, game, 0), 0);
+  EXPECT_EQ(frame_ring_read(first, wrong, &frame), -1);
+  frame_ring_close(first);
+  EXPECT_FALSE(frame_ring_closed(second));
+  frame_ring_destroy(ring);
+  // The mapping outlives the segment, with the last frame still readable
+  EXPECT_TRUE(frame_ring_closed(second));
+  EXPECT_EQ(frame_ring_read(second, game, &frame), 1);
+  EXPECT_EQ(frame_ring_open(name.c_str()), nullptr);
+  frame_ring_close(second);
+  game_destroy(wrong);
+  game_destroy(game);
+}
+
+TEST(FrameRingTest, ReadsAreNeverTorn) {
+  const uint32_t size = 64;
+  GameConfig config = make_config(size, size);
+  std::string name = ring_name("torn");
+  FrameRingWriter *ring = frame_ring_create(name.c_str(), &config);
+  ASSERT_NE(ring, nullptr);
+  FrameRingReader *reader = frame_ring_open(name.c_str());
+  ASSERT_NE(reader, nullptr);
+  Game *game = game_create(&config);
+  Game *view = game_create(&config);
+  // Every publish repaints the whole board with an owner matching the frame
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    std::vector<uint8_t> cells(size * size);
+    for (uint32_t frame = 1; frame <= 3000; frame++) {
+      std::fill(cells.begin(), cells.end(), (uint8_t)(1 + frame % 250));
+      game_load_rows(game, 0, size, cells.data());
+      game_set_frame(game, frame);
+      frame_ring_publish(ring, game, 0);
+    }
+    done = true;
+  });
+  uint32_t reads = 0, last = 0;
+  RenderFrame frame;
+  for (;;) {
+    bool finished = done;
+    if (frame_ring_read(reader, view, &frame) != 1) {
+      if (finished) {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    reads++;
+    ASSERT_GT(frame.frame, last);
+    last = frame.frame;
+    std::vector<uint8_t> expected(size * size, (uint8_t)(1 + last % 250));
+    ASSERT_EQ(owners(view), expected) << "frame " << last;
+  }
+  writer.join();
+  EXPECT_GT(reads, 0u);
+  frame_ring_close(reader);
+  game_destroy(view);
+  game_destroy(game);
+  frame_ring_destroy(ring);
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "server/game_logic.h"
+#include "server/grid.h"
+#include "server/types.h"
+}
+
+class GridStorageTest : public ::testing::TestWithParam<GridStorage> {};
+
+TEST_P(GridStorageTest, InitiallyEmpty) {
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, 130, 70, GetParam()), 0);
+  EXPECT_EQ(grid_count_occupied(&grid), 0u);
+  for (uint32_t y = 0; y < 70; y++) {
+    for (uint32_t x = 0; x < 130; x++) {
+      EXPECT_EQ(grid_get(&grid, x, y), 0);
+      EXPECT_FALSE(grid_is_occupied(&grid, x, y));
+    }
+  }
+  GridChunkIter iter;
+  GridChunkView view;
+  grid_chunk_iter_init(&iter, &grid);
+  EXPECT_FALSE(grid_chunk_iter_next(&iter, &view));
+  grid_free(&grid);
+}
+
+TEST_P(GridStorageTest, SetGetAndClear) {
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, 130, 70, GetParam()), 0);
+  EXPECT_EQ(grid_set(&grid, 0, 0, 1), 0);
+  EXPECT_EQ(grid_set(&grid, 129, 69, 2), 0);
+  EXPECT_EQ(grid_set(&grid, 64, 63, 3), 0);
+  EXPECT_EQ(grid_get(&grid, 0, 0), 1);
+  EXPECT_EQ(grid_get(&grid, 129, 69), 2);
+  EXPECT_EQ(grid_get(&grid, 64, 63), 3);
+  EXPECT_TRUE(grid_is_occupied(&grid, 64, 63));
+  EXPECT_FALSE(grid_is_occupied(&grid, 63, 63));
+  EXPECT_EQ(grid_count_occupied(&grid), 3u);
+  grid_set(&grid, 0, 0, 0);
+  grid_set(&grid, 129, 69, 0);
+  grid_set(&grid, 64, 63, 0);
+  EXPECT_EQ(grid_count_occupied(&grid), 0u);
+  EXPECT_EQ(grid.allocated_chunks, 0u);
+  grid_free(&grid);
+}
+
+TEST_P(GridStorageTest, CopyRowsMatchesCells) {
+  const uint32_t w = 150, h = 90;
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, w, h, GetParam()), 0);
+  std::vector<uint8_t> expected(w * h, 0);
+  uint32_t seed = 12345;
+  for (int i = 0; i < 500; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t x = (seed >> 8) % w;
+    uint32_t y = (seed >> 20) % h;
+    uint8_t v = (uint8_t)(1 + (seed & 63));
+    grid_set(&grid, x, y, v);
+    expected[y * w + x] = v;
+  }
+  std::vector<uint8_t> rows(w * h, 0xFF);
+  grid_copy_rows(&grid, 0, h, rows.data());
+  EXPECT_EQ(rows, expected);
+
+  // The chunk iterator must visit every occupied cell exactly once
+  std::vector<uint8_t> rebuilt(w * h, 0);
+  GridChunkIter iter;
+  GridChunkView view;
+  grid_chunk_iter_init(&iter, &grid);
+  while (grid_chunk_iter_next(&iter, &view)) {
+    for (uint32_t j = 0; j < view.height; j++) {
+      uint64_t bits = view.occupancy[j * view.occupancy_stride];
+      for (uint32_t i = 0; i < view.width; i++) {
+        uint8_t v = view.cells[j * view.stride + i];
+        EXPECT_EQ((bits >> i) & 1u, v != 0 ? 1u : 0u);
+        rebuilt[(view.y + j) * w + view.x + i] = v;
+      }
+    }
+  }
+  EXPECT_EQ(rebuilt, expected);
+  grid_free(&grid);
+}
+
+TEST_P(GridStorageTest, CopyBetweenGrids) {
+  Grid a, b;
+  ASSERT_EQ(grid_init(&a, 100, 100, GetParam()), 0);
+  ASSERT_EQ(grid_init(&b, 100, 100, GetParam()), 0);
+  grid_set(&a, 10, 10, 5);
+  grid_set(&b, 90, 90, 7);
+  ASSERT_EQ(grid_copy(&b, &a), 0);
+  EXPECT_EQ(grid_get(&b, 10, 10), 5);
+  EXPECT_EQ(grid_get(&b, 90, 90), 0);
+  EXPECT_EQ(grid_count_occupied(&b), 1u);
+  Grid other;
+  ASSERT_EQ(grid_init(&other, 50, 100, GetParam()), 0);
+  EXPECT_EQ(grid_copy(&other, &a), -1);
+  grid_free(&a);
+  grid_free(&b);
+  grid_free(&other);
+}
+
+TEST_P(GridStorageTest, CopyWindowMatchesGet) {
+  const uint32_t w = 150, h = 90;
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, w, h, GetParam()), 0);
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      grid_set(&grid, x, y, (uint8_t)(1 + (x * 7 + y * 13) % 60));
+    }
+  }
+  // Windows with unaligned edges, inside one tile and across blocks
+  const uint32_t windows[][4] = {
+      {0, 0, w, h}, {3, 5, 2, 3}, {13, 7, 70, 61}, {63, 63, 2, 2}};
+  for (const auto &win : windows) {
+    std::vector<uint8_t> out(win[2] * win[3], 0xFF);
+    grid_copy_window(&grid, win[0], win[1], win[2], win[3], out.data());
+    for (uint32_t j = 0; j < win[3]; j++) {
+      for (uint32_t i = 0; i < win[2]; i++) {
+        ASSERT_EQ(out[j * win[2] + i], grid_get(&grid, win[0] + i, win[1] + j));
+      }
+    }
+  }
+  grid_free(&grid);
+}
+
+INSTANTIATE_TEST_SUITE_P(Storage, GridStorageTest,
+                         ::testing::Values(grid_storage_dense,
+                                           grid_storage_chunked,
+                                           grid_storage_tiled));
+
+TEST(GridTest, TiledNeighboursShareCacheLines) {
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, 300, 200, grid_storage_tiled), 0);
+  std::vector<bool> seen(grid.chunks_x * grid.chunks_y * 64 * 64, false);
+  for (uint32_t y = 0; y < 200; y++) {
+    for (uint32_t x = 0; x < 300; x++) {
+      size_t offset = grid_cell_offset(&grid, x, y);
+      ASSERT_LT(offset, seen.size());
+      ASSERT_FALSE(seen[offset]);
+      seen[offset] = true;
+      // Vertical neighbours inside a tile are in the same 64 byte line
+      if ((y & 7) != 7 && y + 1 < 200) {
+        EXPECT_EQ(offset / 64, grid_cell_offset(&grid, x, y + 1) / 64);
+      }
+    }
+  }
+  grid_free(&grid);
+}
+
+TEST(GridTest, ChunkedMemoryScalesWithOccupiedArea) {
+  Grid grid;
+  ASSERT_EQ(grid_init(&grid, 20000, 20000, grid_storage_chunked), 0);
+  grid_set(&grid, 0, 0, 1);
+  grid_set(&grid, 19999, 19999, 2);
+  grid_set(&grid, 10000, 10000, 3);
+  grid_set(&grid, 10001, 10000, 3);
+  EXPECT_EQ(grid.allocated_chunks, 3u);
+  EXPECT_EQ(grid_get(&grid, 19999, 19999), 2);
+  EXPECT_EQ(grid_count_occupied(&grid), 4u);
+  grid_set(&grid, 10000, 10000, 0);
+  EXPECT_EQ(grid.allocated_chunks, 3u);
+  grid_set(&grid, 10001, 10000, 0);
+  EXPECT_EQ(grid.allocated_chunks, 2u);
+  grid_free(&grid);
+}
+
+TEST(GridTest, HugePagesBackLargeDenseGrids) {
+  Grid grid;
+  ASSERT_EQ(grid_init_ex(&grid, 4096, 4096, grid_storage_dense, true), 0);
+  /* Whatever backing the kernel grants, the grid must start empty */
+  EXPECT_NE(grid.cells_backing, page_backing_heap);
+  EXPECT_EQ(grid_count_occupied(&grid), 0u);
+  grid_set(&grid, 4095, 4095, 7);
+  grid_set(&grid, 0, 2048, 1);
+  EXPECT_EQ(grid_get(&grid, 4095, 4095), 7);
+  EXPECT_TRUE(grid_is_occupied(&grid, 0, 2048));
+  EXPECT_EQ(grid_count_occupied(&grid), 2u);
+  Grid copy;
+  ASSERT_EQ(grid_init(&copy, 4096, 4096, grid_storage_dense), 0);
+  EXPECT_EQ(copy.cells_backing, page_backing_heap);
+  ASSERT_EQ(grid_copy(&copy, &grid), 0);
+  EXPECT_EQ(grid_get(&copy, 4095, 4095), 7);
+  grid_free(&copy);
+  grid_free(&grid);
+
+  /* Small boards stay on the heap */
+  ASSERT_EQ(grid_init_ex(&grid, 100, 100, grid_storage_dense, true), 0);
+  EXPECT_EQ(grid.cells_backing, page_backing_heap);
+  grid_free(&grid);
+}
+
+class GridGameTest : public ::testing::TestWithParam<GridStorage> {};
+
+TEST_P(GridGameTest, MatchesDenseGame) {
+  GameConfig dense_config = {100, 100, 60, 1000, 1000, 10.0f, false};
+  GameConfig chunked_config = dense_config;
+  chunked_config.grid_storage = GetParam();
+  Game *dense = game_create(&dense_config);
+  Game *chunked = game_create(&chunked_config);
+  ASSERT_NE(dense, nullptr);
+  ASSERT_NE(chunked, nullptr);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(game_add_player(dense, "Bot"), game_add_player(chunked, "Bot"));
+  }
+  EXPECT_EQ(game_get_grid(chunked), nullptr);
+  uint32_t seed = 99;
+  std::vector<uint8_t> rows(100 * 100);
+  for (int t = 0; t < 200; t++) {
+    Direction directions[MAX_PLAYERS];
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      seed = seed * 1664525u + 1013904223u;
+      directions[i] = (Direction)((seed >> 16) % 4);
+    }
+    game_set_frame(dense, t);
+    game_set_frame(chunked, t);
+    game_move_players(dense, directions);
+    game_move_players(chunked, directions);
+    grid_copy_rows(game_get_grid_storage(chunked), 0, 100, rows.data());
+    ASSERT_TRUE(std::equal(rows.begin(), rows.end(), game_get_grid(dense)));
+    ASSERT_EQ(game_count_occupied_cells(dense),
+              game_count_occupied_cells(chunked));
+  }
+  game_destroy(dense);
+  game_destroy(chunked);
+}
+
+INSTANTIATE_TEST_SUITE_P(Storage, GridGameTest,
+                         ::testing::Values(grid_storage_chunked,
+                                           grid_storage_tiled));
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "server/label_cache.h"
+#include "server/resource_loader.hpp"
+}
+
+// Draws into a software renderer on a plain surface, so no window is needed
+class LabelCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_EQ(TTF_Init(), 0);
+    surface = SDL_CreateRGBSurfaceWithFormat(0, 320, 120, 32,
+                                             SDL_PIXELFORMAT_ARGB8888);
+    ASSERT_NE(surface, nullptr);
+    renderer = SDL_CreateSoftwareRenderer(surface);
+    ASSERT_NE(renderer, nullptr);
+    font = (TTF_Font *)resource_load_font_from_memory("resources/SAIBA-45.ttf",
+                                                      24);
+    ASSERT_NE(font, nullptr);
+  }
+
+  void TearDown() override {
+    if (font)
+      TTF_CloseFont(font);
+    if (renderer)
+      SDL_DestroyRenderer(renderer);
+    if (surface)
+      SDL_FreeSurface(surface);
+    TTF_Quit();
+  }
+
+  void clear() {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+  }
+
+  uint32_t pixel(int x, int y) const {
+    return ((const uint32_t *)((const uint8_t *)surface->pixels +
+                               y * surface->pitch))[x];
+  }
+
+  SDL_Surface *surface = nullptr;
+  SDL_Renderer *renderer = nullptr;
+  TTF_Font *font = nullptr;
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Color black = {0, 0, 0, 255};
+};
+
+TEST_F(LabelCacheTest, RepeatedLabelIsRasterizedOnce) {
+  LabelCache *cache = label_cache_create(renderer, font, 8);
+  ASSERT_NE(cache, nullptr);
+  int width = label_cache_draw(cache, "alice", 10, 10, white, black, 2);
+  EXPECT_GT(width, 0);
+  EXPECT_EQ(label_cache_draw(cache, "alice", 50, 30, white, black, 2), width);
+  LabelCacheStats stats;
+  label_cache_get_stats(cache, &stats);
+  EXPECT_EQ(stats.misses, 1u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.size, 1u);
+  label_cache_destroy(cache);
+}
+
+TEST_F(LabelCacheTest, KeyIncludesColourAndOutline) {
+  LabelCache *cache = label_cache_create(renderer, font, 8);
+  ASSERT_NE(cache, nullptr);
+  label_cache_draw(cache, "bob", 0, 0, white, black, 2);
+  label_cache_draw(cache, "bob", 0, 0, black, white, 2);
+  label_cache_draw(cache, "bob", 0, 0, white, black, 3);
+  label_cache_draw(cache, "bob", 0, 0, white, black, 0);
+  label_cache_draw(cache, "bob", 0, 0, white, white, 0); // No outline drawn
+  LabelCacheStats stats;
+  label_cache_get_stats(cache, &stats);
+  EXPECT_EQ(stats.misses, 4u);
+  EXPECT_EQ(stats.hits, 1u);
+  label_cache_destroy(cache);
+}
+
+TEST_F(LabelCacheTest, LeastRecentlyDrawnIsEvicted) {
+  LabelCache *cache = label_cache_create(renderer, font, 2);
+  ASSERT_NE(cache, nullptr);
+  label_cache_draw(cache, "a", 0, 0, white, black, 0);
+  label_cache_draw(cache, "b", 0, 0, white, black, 0);
+  label_cache_draw(cache, "a", 0, 0, white, black, 0);
+  label_cache_draw(cache, "c", 0, 0, white, black, 0); // Evicts "b"
+  label_cache_draw(cache, "a", 0, 0, white, black, 0);
+  LabelCacheStats stats;
+  label_cache_get_stats(cache, &stats);
+  EXPECT_EQ(stats.misses, 3u);
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.evictions, 1u);
+  EXPECT_EQ(stats.size, 2u);
+  label_cache_draw(cache, "b", 0, 0, white, black, 0);
+  label_cache_get_stats(cache, &stats);
+  EXPECT_EQ(stats.misses, 4u);
+  label_cache_destroy(cache);
+}
+
+TEST_F(LabelCacheTest, OutlineSurroundsText) {
+  LabelCache *cache = label_cache_create(renderer, font, 8);
+  ASSERT_NE(cache, nullptr);
+  clear();
+  const int x = 40, y = 40, t = 3;
+  int width = label_cache_draw(cache, "I", x, y, black, white, t);
+  ASSERT_GT(width, 0);
+  int text_h = 0;
+  TTF_SizeText(font, "I", nullptr, &text_h);
+  bool left = false;
+  for (int py = y; py < y + text_h; py++) {
+    for (int px = x - t; px < x; px++) {
+      left |= (pixel(px, py) & 0xFFFFFF) != 0;
+    }
+    EXPECT_EQ(pixel(x - t - 1, py) & 0xFFFFFF, 0u);
+    EXPECT_EQ(pixel(x + width + t, py) & 0xFFFFFF, 0u);
+  }
+  EXPECT_TRUE(left);
+  label_cache_destroy(cache);
+}
+
+TEST_F(LabelCacheTest, NumbersComeFromDigitAtlas) {
+  LabelCache *cache = label_cache_create(renderer, font, 8);
+  ASSERT_NE(cache, nullptr);
+  int expected = 0;
+  for (const char *d : {"9", "0", "4", "2", "0"}) {
+    int w = 0;
+    TTF_SizeText(font, d, &w, nullptr);
+    expected += w;
+  }
+  clear();
+  EXPECT_EQ(label_cache_draw_number(cache, 90420, 10, 10, white), expected);
+  std::vector<uint32_t> lit;
+  for (int py = 0; py < surface->h; py++) {
+    for (int px = 0; px < surface->w; px++) {
+      if (pixel(px, py) & 0xFFFFFF)
+        lit.push_back(px);
+    }
+  }
+  EXPECT_FALSE(lit.empty());
+  for (uint32_t px : lit) {
+    EXPECT_GE(px, 10u);
+    EXPECT_LT(px, 10u + expected);
+  }
+  LabelCacheStats stats;
+  label_cache_get_stats(cache, &stats);
+  EXPECT_EQ(stats.misses, 0u);
+  EXPECT_EQ(stats.size, 0u);
+  label_cache_destroy(cache);
+}
@@ -49,13 +49,13 @@ TEST(PlayerMapTest, FindExistingPlayer) {
   Player p = createTestPlayer(42, "Player42", 100, 200);
   map_insert(map, 42, &p);
 
-  Player *found = map_find(map, 42);
+  Player found;
 
-  ASSERT_NE(found, nullptr);
-  EXPECT_EQ(found->id, 42);
-  EXPECT_STREQ(found->name, "Player42");
-  EXPECT_EQ(found->position.x, 100);
-  EXPECT_EQ(found->position.y, 200);
+  ASSERT_TRUE(map_find(map, 42, &found));
+  EXPECT_EQ(found.id, 42);
+  EXPECT_STREQ(found.name, "Player42");
+  EXPECT_EQ(found.position.x, 100);
+  EXPECT_EQ(found.position.y, 200);
   map_destroy(map);
 }
 
@@ -64,7 +64,8 @@ TEST(PlayerMapTest, FindNonExistingPlayer) {
   Player p = createTestPlayer(10, "Player10", 5, 5);
   map_insert(map, 10, &p);
 
-  EXPECT_EQ(map_find(map, 20), nullptr);
+  Player found;
+  EXPECT_FALSE(map_find(map, 20, &found));
   map_destroy(map);
 }
 
@@ -78,10 +79,10 @@ TEST(PlayerMapTest, InsertDuplicateKey) {
 
   EXPECT_EQ(map_size(map), 1);
 
-  Player *found = map_find(map, 7);
-  ASSERT_NE(found, nullptr);
-  EXPECT_STREQ(found->name, "Player7");
-  EXPECT_EQ(found->position.x, 10);
+  Player found;
+  ASSERT_TRUE(map_find(map, 7, &found));
+  EXPECT_STREQ(found.name, "Player7");
+  EXPECT_EQ(found.position.x, 10);
   map_destroy(map);
 }
 
@@ -94,7 +95,8 @@ TEST(PlayerMapTest, DeleteExistingPlayer) {
   map_delete(map, 15);
 
   EXPECT_EQ(map_size(map), 0);
-  EXPECT_EQ(map_find(map, 15), nullptr);
+  Player found;
+  EXPECT_FALSE(map_find(map, 15, &found));
   map_destroy(map);
 }
 
@@ -138,18 +140,18 @@ TEST(PlayerMapTest, GetAllPlayers) {
   map_insert(map, 2, &p2);
   map_insert(map, 3, &p3);
 
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   uint32_t count = map_get_all(map, players);
 
   EXPECT_EQ(count, 3);
 
   bool found_p1 = false, found_p2 = false, found_p3 = false;
   for (uint32_t i = 0; i < count; i++) {
-    if (players[i]->id == 1)
+    if (players[i].id == 1)
       found_p1 = true;
-    if (players[i]->id == 2)
+    if (players[i].id == 2)
       found_p2 = true;
-    if (players[i]->id == 3)
+    if (players[i].id == 3)
       found_p3 = true;
   }
 
@@ -172,8 +174,9 @@ TEST(PlayerMapTest, DeleteMultiplePlayers) {
   map_delete(map, 2);
 
   EXPECT_EQ(map_size(map), 0);
-  EXPECT_EQ(map_find(map, 1), nullptr);
-  EXPECT_EQ(map_find(map, 2), nullptr);
+  Player found;
+  EXPECT_FALSE(map_find(map, 1, &found));
+  EXPECT_FALSE(map_find(map, 2, &found));
   map_destroy(map);
 }
 
@@ -187,13 +190,13 @@ TEST(PlayerMapTest, BoundaryKeys) {
 
   EXPECT_EQ(map_size(map), 2);
 
-  Player *found0 = map_find(map, 0);
-  Player *found255 = map_find(map, 255);
+  Player found0;
+  Player found255;
 
-  ASSERT_NE(found0, nullptr);
-  ASSERT_NE(found255, nullptr);
-  EXPECT_EQ(found0->id, 0);
-  EXPECT_EQ(found255->id, 255);
+  ASSERT_TRUE(map_find(map, 0, &found0));
+  ASSERT_TRUE(map_find(map, 255, &found255));
+  EXPECT_EQ(found0.id, 0);
+  EXPECT_EQ(found255.id, 255);
   map_destroy(map);
 }
 
@@ -201,12 +204,56 @@ TEST(PlayerMapTest, NullMapOperations) {
   Player p = createTestPlayer(1, "P1", 1, 1);
 
   EXPECT_EQ(map_insert(nullptr, 1, &p), -1);
-  EXPECT_EQ(map_find(nullptr, 1), nullptr);
+  Player found;
+  EXPECT_FALSE(map_find(nullptr, 1, &found));
   map_delete(nullptr, 1);
   EXPECT_EQ(map_size(nullptr), 0);
 
-  Player *players[MAX_PLAYERS];
+  Player players[MAX_PLAYERS];
   EXPECT_EQ(map_get_all(nullptr, players), 0);
 
   map_destroy(nullptr);
 }
+
+TEST(PlayerMapTest, DeleteKeepsPlayersPacked) {
+  PlayerMap *map = map_create();
+  for (int id = 10; id < 15; id++) {
+    Player p = createTestPlayer(id, "P", id, id * 2);
+    ASSERT_EQ(map_insert(map, id, &p), 0);
+  }
+  map_delete(map, 11);
+  map_delete(map, 14);
+  ASSERT_EQ(map_size(map), 3);
+  Player players[MAX_PLAYERS];
+  ASSERT_EQ(map_get_all(map, players), 3u);
+  for (uint32_t slot = 0; slot < map_size(map); slot++) {
+    MapKey key = map->keys[slot];
+    EXPECT_EQ(map_slot(map, key), (int)slot);
+    EXPECT_EQ(players[slot].id, key);
+    EXPECT_EQ(map->positions[slot].x, key);
+    EXPECT_EQ(map->positions[slot].y, key * 2);
+    EXPECT_EQ(map->cold[slot].color.r, key);
+  }
+  EXPECT_EQ(map_slot(map, 11), -1);
+  EXPECT_EQ(map_slot(map, 14), -1);
+  int slot = map_slot(map, 13);
+  ASSERT_GE(slot, 0);
+  map->positions[slot] = {7, 8};
+  Player found;
+  ASSERT_TRUE(map_find(map, 13, &found));
+  EXPECT_EQ(found.position.x, 7);
+  EXPECT_EQ(found.position.y, 8);
+  map_destroy(map);
+}
+
+TEST(PlayerMapTest, InsertBeyondCapacityFails) {
+  PlayerMap *map = map_create();
+  for (int id = 0; id < MAX_PLAYERS; id++) {
+    Player p = createTestPlayer(id + 100, "P", 0, 0);
+    ASSERT_EQ(map_insert(map, id + 100, &p), 0);
+  }
+  Player extra = createTestPlayer(1, "Extra", 0, 0);
+  EXPECT_EQ(map_insert(map, 1, &extra), -1);
+  EXPECT_EQ(map_size(map), (uint32_t)MAX_PLAYERS);
+  map_destroy(map);
+}
@@ -0,0 +1,147 @@
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "server/postprocess.h"
+}
+
+namespace {
+
+struct Frame {
+  uint32_t width, height;
+  std::vector<uint32_t> pixels;
+  Frame(uint32_t w, uint32_t h, uint32_t fill = 0xFF000000u)
+      : width(w), height(h), pixels((size_t)w * h, fill) {}
+  uint32_t &at(uint32_t x, uint32_t y) { return pixels[(size_t)y * width + x]; }
+  size_t pitch() const { return width * sizeof(uint32_t); }
+  void fill_rect(uint32_t x0, uint32_t y0, uint32_t w, uint32_t h,
+                 uint32_t color) {
+    for (uint32_t y = y0; y < y0 + h; y++)
+      for (uint32_t x = x0; x < x0 + w; x++)
+        at(x, y) = color;
+  }
+};
+
+Frame apply(PostProcess *pp, Frame &in) {
+  Frame out(in.width, in.height, 0);
+  EXPECT_EQ(postprocess_apply(pp, in.pixels.data(), in.pitch(),
+                              out.pixels.data(), out.pitch()),
+            0);
+  return out;
+}
+
+uint32_t red(uint32_t p) { return (p >> 16) & 0xFF; }
+
+} // namespace
+
+TEST(PostProcessTest, BlackStaysBlack) {
+  PostProcess *pp = postprocess_create(64, 48, 2);
+  ASSERT_NE(pp, nullptr);
+  Frame in(64, 48);
+  Frame out = apply(pp, in);
+  for (uint32_t p : out.pixels) {
+    EXPECT_EQ(p, 0xFF000000u);
+  }
+  postprocess_destroy(pp);
+}
+
+TEST(PostProcessTest, BrightAreasBleedIntoTheirSurroundings) {
+  PostProcess *pp = postprocess_create(200, 160, 2);
+  ASSERT_NE(pp, nullptr);
+  Frame in(200, 160);
+  in.fill_rect(96, 76, 8, 8, 0xFFFF0000u);
+  Frame out = apply(pp, in);
+  EXPECT_GE(red(out.at(100, 80)), 200u);
+  // Light falls off with distance and stays red
+  EXPECT_GT(red(out.at(116, 80)), 0u);
+  EXPECT_GT(red(out.at(100, 64)), red(out.at(100, 50)));
+  EXPECT_EQ(out.at(116, 80) & 0xFFFF, 0u);
+  EXPECT_EQ(out.at(0, 0), 0xFF000000u);
+  postprocess_destroy(pp);
+}
+
+TEST(PostProcessTest, WhiteTextDoesNotBloom) {
+  PostProcess *pp = postprocess_create(200, 160, 2);
+  ASSERT_NE(pp, nullptr);
+  Frame in(200, 160);
+  in.fill_rect(96, 76, 8, 8, 0xFFFFFFFFu);
+  Frame out = apply(pp, in);
+  EXPECT_EQ(out.at(116, 80), 0xFF000000u);
+  EXPECT_EQ(out.at(100, 80) & 0xFFFFFF, 0xFFFFFFu);
+  postprocess_destroy(pp);
+}
+
+TEST(PostProcessTest, KernelsMatchScalar) {
+  // Odd sizes exercise the edge clamping and the scalar tails
+  PostProcess *pp = postprocess_create(203, 117, 3);
+  ASSERT_NE(pp, nullptr);
+  Frame in(203, 117);
+  std::mt19937 rng(7);
+  for (uint32_t &p : in.pixels) {
+    p = 0xFF000000u | (rng() & 0xFFFFFF);
+  }
+  ASSERT_EQ(postprocess_set_kernel(pp, postprocess_kernel_scalar), 0);
+  Frame expected = apply(pp, in);
+  for (int k = postprocess_kernel_avx2; k <= postprocess_kernel_neon; k++) {
+    if (postprocess_set_kernel(pp, (PostProcessKernel)k) != 0)
+      continue;
+    Frame out = apply(pp, in);
+    EXPECT_EQ(out.pixels, expected.pixels) << "kernel " << k;
+  }
+  postprocess_destroy(pp);
+}
+
+TEST(PostProcessTest, LayerAddsUpToApply) {
+  // Dim enough that the shoulder compression never applies
+  PostProcess *pp = postprocess_create(120, 90, 2);
+  ASSERT_NE(pp, nullptr);
+  Frame in(120, 90);
+  in.fill_rect(30, 30, 10, 4, 0xFF006040u);
+  in.fill_rect(70, 50, 6, 6, 0xFFFFFFFFu);
+  Frame expected = apply(pp, in);
+  Frame layer(120, 90, 0);
+  ASSERT_EQ(postprocess_apply_layer(pp, in.pixels.data(), in.pitch(),
+                                    layer.pixels.data(), layer.pitch()),
+            0);
+  // Light around the rectangle, none from the white square
+  EXPECT_GT(layer.at(35, 27) & 0xFFFFFF, 0u);
+  EXPECT_EQ(layer.at(72, 52), 0xFF000000u);
+  for (size_t i = 0; i < in.pixels.size(); i++) {
+    uint32_t sum = 0xFF000000u;
+    for (int shift = 0; shift < 24; shift += 8) {
+      uint32_t c = ((in.pixels[i] >> shift) & 0xFF) +
+                   ((layer.pixels[i] >> shift) & 0xFF);
+      sum |= (c < 0xFF ? c : 0xFF) << shift;
+    }
+    ASSERT_EQ(sum, expected.pixels[i]) << "pixel " << i;
+  }
+  postprocess_destroy(pp);
+}
+
+TEST(PostProcessTest, WorkerMatchesApplyLayer) {
+  PostProcess *pp = postprocess_create(120, 90, 2);
+  ASSERT_NE(pp, nullptr);
+  Frame in(120, 90);
+  in.fill_rect(30, 30, 10, 4, 0xFF00C0FFu);
+  Frame expected(120, 90, 0);
+  ASSERT_EQ(postprocess_apply_layer(pp, in.pixels.data(), in.pitch(),
+                                    expected.pixels.data(), expected.pitch()),
+            0);
+  Frame out(120, 90, 0);
+  EXPECT_FALSE(postprocess_take(pp, out.pixels.data(), out.pitch()));
+  ASSERT_EQ(postprocess_submit(pp, in.pixels.data(), in.pitch()), 0);
+  bool taken = false;
+  for (int i = 0; i < 1000 && !taken; i++) {
+    taken = postprocess_take(pp, out.pixels.data(), out.pitch());
+    if (!taken)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(taken);
+  EXPECT_EQ(out.pixels, expected.pixels);
+  // Each finished frame is handed out once
+  EXPECT_FALSE(postprocess_take(pp, out.pixels.data(), out.pitch()));
+  postprocess_destroy(pp);
+}
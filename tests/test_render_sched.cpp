@@ -0,0 +1,199 @@
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "server/game_logic.h"
+#include "server/render_sched.h"
+#include "server/server_utils.h"
+}
+
+namespace {
+
+const uint64_t kMs = 1000000;
+
+// Two players heading towards the centre, so nobody dies for a while
+Game *make_game() {
+  GameConfig config;
+  fill_default_configuration(&config);
+  Game *game = game_create(&config);
+  game_add_player(game, "alice");
+  game_add_player(game, "bob");
+  return game;
+}
+
+void tick(Game *game) {
+  Direction directions[MAX_PLAYERS] = {};
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(game, players);
+  for (uint32_t i = 0; i < count; i++) {
+    directions[players[i].id] = players[i].position.x < 50 ? east : west;
+  }
+  game_move_players(game, directions);
+  game_set_frame(game, game_get_frame(game) + 1);
+}
+
+RenderScheduler *make_sched(uint32_t fps, uint32_t stride, bool interpolate) {
+  GameConfig config;
+  fill_default_configuration(&config);
+  config.render_fps = fps;
+  config.render_tick_stride = stride;
+  config.render_interpolate = interpolate;
+  return render_sched_create(&config);
+}
+
+} // namespace
+
+TEST(RenderSchedTest, PublishCopiesPlayers) {
+  Game *game = make_game();
+  RenderScheduler *sched = make_sched(0, 1, false);
+  ASSERT_NE(sched, nullptr);
+  RenderFrame frame;
+  EXPECT_FALSE(render_sched_next(sched, 0, &frame, nullptr));
+  ASSERT_EQ(render_sched_publish(sched, game, 0), 0);
+  ASSERT_TRUE(render_sched_next(sched, 0, &frame, nullptr));
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(game, players);
+  ASSERT_EQ(frame.player_count, count);
+  for (uint32_t i = 0; i < count; i++) {
+    EXPECT_EQ(frame.players[i].id, players[i].id);
+    EXPECT_STREQ(frame.players[i].name, players[i].name);
+    EXPECT_EQ(frame.players[i].position.x, players[i].position.x);
+    EXPECT_EQ(frame.players[i].tail_linked_list, nullptr);
+    // Nothing moved yet
+    EXPECT_EQ(frame.previous[i].x, players[i].position.x);
+  }
+  EXPECT_FALSE(frame.game_over);
+  EXPECT_EQ(frame.alpha, 1.0f);
+  render_sched_destroy(sched);
+  game_destroy(game);
+}
+
+TEST(RenderSchedTest, FollowsTicksWithoutRepeats) {
+  Game *game = make_game();
+  RenderScheduler *sched = make_sched(0, 1, false);
+  RenderFrame frame;
+  for (int i = 0; i < 5; i++) {
+    tick(game);
+    render_sched_publish(sched, game, i * 33 * kMs);
+    EXPECT_TRUE(render_sched_next(sched, i * 33 * kMs, &frame, nullptr));
+    EXPECT_EQ(frame.frame, (uint32_t)i + 1);
+    EXPECT_FALSE(
+        render_sched_next(sched, i * 33 * kMs + kMs, &frame, nullptr));
+  }
+  RenderSchedStats stats;
+  render_sched_get_stats(sched, &stats);
+  EXPECT_EQ(stats.published, 5u);
+  EXPECT_EQ(stats.rendered, 5u);
+  EXPECT_EQ(stats.dropped, 0u);
+  EXPECT_EQ(stats.duplicated, 0u);
+  render_sched_destroy(sched);
+  game_destroy(game);
+}
+
+TEST(RenderSchedTest, RendersEveryNthTick) {
+  Game *game = make_game();
+  RenderScheduler *sched = make_sched(0, 3, false);
+  RenderFrame frame;
+  std::vector<uint32_t> rendered;
+  for (int i = 0; i < 7; i++) {
+    tick(game);
+    render_sched_publish(sched, game, i * 33 * kMs);
+    if (render_sched_next(sched, i * 33 * kMs, &frame, nullptr)) {
+      rendered.push_back(frame.frame);
+    }
+  }
+  EXPECT_EQ(rendered, (std::vector<uint32_t>{1, 4, 7}));
+  RenderSchedStats stats;
+  render_sched_get_stats(sched, &stats);
+  EXPECT_EQ(stats.dropped, 0u);
+  EXPECT_EQ(stats.duplicated, 0u);
+  render_sched_destroy(sched);
+  game_destroy(game);
+}
+
+TEST(RenderSchedTest, BoardMatchesTheRenderedFrame) {
+  Game *game = make_game();
+  RenderScheduler *sched = make_sched(0, 3, false);
+  GameConfig config;
+  fill_default_configuration(&config);
+  Game *board = game_create(&config);
+  RenderFrame frame;
+  for (int i = 0; i < 7; i++) {
+    tick(game);
+    render_sched_publish(sched, game, i * 33 * kMs);
+    uint64_t published = game_get_state_hash(game);
+    // Moves after the publish stay out of the board until the next one
+    tick(game);
+    if (render_sched_next(sched, i * 33 * kMs, &frame, board)) {
+      EXPECT_EQ(game_get_state_hash(board), published) << "tick " << i;
+      EXPECT_EQ(game_get_state_hash(board), game_compute_state_hash(board));
+    }
+  }
+  // Frames 1, 5, 9 and 13 were rendered
+  RenderSchedStats stats;
+  render_sched_get_stats(sched, &stats);
+  EXPECT_EQ(stats.rendered, 4u);
+  game_destroy(board);
+  render_sched_destroy(sched);
+  game_destroy(game);
+}
+
+TEST(RenderSchedTest, FixedRateCountsDuplicatesAndDrops) {
+  Game *game = make_game();
+  RenderScheduler *sched = make_sched(50, 1, false); // 20 ms slots
+  RenderFrame frame;
+  tick(game);
+  render_sched_publish(sched, game, 0);
+  EXPECT_TRUE(render_sched_next(sched, 0, &frame, nullptr));
+  EXPECT_FALSE(render_sched_next(sched, 10 * kMs, &frame, nullptr));
+  // Same frame
+  EXPECT_TRUE(render_sched_next(sched, 20 * kMs, &frame, nullptr));
+  for (int i = 0; i < 3; i++) {
+    tick(game);
+    render_sched_publish(sched, game, (25 + i) * kMs);
+  }
+  EXPECT_TRUE(render_sched_next(sched, 40 * kMs, &frame, nullptr));
+  EXPECT_EQ(frame.frame, 4u);
+  RenderSchedStats stats;
+  render_sched_get_stats(sched, &stats);
+  EXPECT_EQ(stats.rendered, 3u);
+  EXPECT_EQ(stats.duplicated, 1u);
+  EXPECT_EQ(stats.dropped, 2u);
+  render_sched_destroy(sched);
+  game_destroy(game);
+}
+
+TEST(RenderSchedTest, InterpolatesHeadsBetweenTicks) {
+  Game *game = make_game();
+  RenderScheduler *sched = make_sched(100, 1, true); // 10 ms slots
+  RenderFrame frame;
+  render_sched_publish(sched, game, 0);
+  Player players[MAX_PLAYERS];
+  uint32_t count = game_get_players(game, players);
+  std::vector<Vec2i> before;
+  for (uint32_t i = 0; i < count; i++) {
+    before.push_back(players[i].position);
+  }
+  tick(game);
+  render_sched_publish(sched, game, 40 * kMs);
+  ASSERT_TRUE(render_sched_next(sched, 50 * kMs, &frame, nullptr));
+  EXPECT_NEAR(frame.alpha, 0.25f, 1e-6);
+  ASSERT_EQ(frame.player_count, count);
+  for (uint32_t i = 0; i < count; i++) {
+    EXPECT_EQ(frame.previous[i].x, before[i].x);
+    EXPECT_EQ(frame.previous[i].y, before[i].y);
+    EXPECT_EQ(std::abs(frame.players[i].position.x - before[i].x), 1);
+  }
+  ASSERT_TRUE(render_sched_next(sched, 70 * kMs, &frame, nullptr));
+  EXPECT_NEAR(frame.alpha, 0.75f, 1e-6);
+  // Heads reached their cell, further renders of this frame are repeats
+  ASSERT_TRUE(render_sched_next(sched, 90 * kMs, &frame, nullptr));
+  EXPECT_EQ(frame.alpha, 1.0f);
+  ASSERT_TRUE(render_sched_next(sched, 100 * kMs, &frame, nullptr));
+  RenderSchedStats stats;
+  render_sched_get_stats(sched, &stats);
+  EXPECT_EQ(stats.duplicated, 1u);
+  render_sched_destroy(sched);
+  game_destroy(game);
+}